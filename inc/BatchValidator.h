@@ -0,0 +1,64 @@
+#ifndef __BATCH_VALIDATOR_H__
+#define __BATCH_VALIDATOR_H__
+
+#include "LegalChess.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace LC {
+
+// number of games the batch kernel validates per instruction, 8 with avx-512, 4 with avx2, 1 otherwise
+#if defined(__AVX512F__)
+constexpr int BATCH_LANES = 8;
+#elif defined(__AVX2__)
+constexpr int BATCH_LANES = 4;
+#else
+constexpr int BATCH_LANES = 1;
+#endif
+
+// one position and one candidate move per game, stored as a structure of arrays so that the kernel
+// loads the same bitboard of consecutive games into one vector register.
+// positions are stored from the point of view of the side to move, black positions are mirrored
+// (ranks flipped), so the kernel only has to handle white to move
+class MoveBatch {
+public:
+    MoveBatch(size_t size = 0) { resize(size); }
+
+    void resize(size_t size);
+
+    size_t size() const {
+        return m_size;
+    }
+
+    // a move that can't be parsed or a game that is over is stored as an illegal move
+    void set(size_t index, const Board& board, const std::string& move);
+    void set(size_t index, const LegalChess& game, const std::string& move);
+
+private:
+    friend void validateMoveBatch(const MoveBatch& batch, std::vector<uint8_t>& legal, bool allowSimd);
+
+    // validates the games index to index + lanes of T - 1
+    template<class T>
+    void validateLanes(size_t index, uint8_t* out) const;
+
+    size_t m_size = 0;
+
+    // indexed by piece type, pawn to king
+    std::vector<uint64_t> m_own[6], m_opponent[6];
+
+    // single square masks, the from mask is 0 for a move that is known to be illegal
+    std::vector<uint64_t> m_from, m_to;
+    std::vector<uint64_t> m_enpassant;
+    std::vector<uint64_t> m_castlingRooks;  // rook squares the side to move can still castle with
+    std::vector<uint64_t> m_promotion;      // all bits set if the move names a promotion piece
+};
+
+// legal[i] is 1 if makeMove would accept the i-th move of the batch on the i-th position and 0 otherwise,
+// allowSimd = false runs the same kernel one game at a time
+void validateMoveBatch(const MoveBatch& batch, std::vector<uint8_t>& legal, bool allowSimd = true);
+
+};
+
+#endif
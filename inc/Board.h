@@ -1,6 +1,7 @@
 #ifndef __BOARD_H__
 #define __BOARD_H__
 
+#include <array>
 #include <string>
 #include <vector>
 #include <cstdint>
@@ -10,6 +11,8 @@
 #include "MoveManager.h"
 #include "Zobrist.h"
 #include "Helper.h"
+#include "PositionCache.h"
+#include "PositionHistory.h"
 
 namespace LC {
 
@@ -81,6 +84,15 @@ struct Move {
     }
 };
 
+// everything a board needs to continue a game except the position history, see OpeningTrie
+struct BoardSnapshot {
+    uint64_t positionHash;      // key of the position in the repetition history
+    uint8_t grid[64];           // Piece per square
+    uint16_t enpassantSquare, halfMovesCount, movesCount;
+    uint8_t isWhiteTurn;
+    uint8_t castlingRights;     // white short, white long, black short, black long from the lowest bit
+};
+
 enum class Piece {
     WHITE_PAWN, 
     WHITE_KNIGHT,
@@ -114,16 +126,98 @@ enum class GameResult {
     DRAW_BY_50_HALF_MOVES
 };
 
+// the state of the position before a move that Board::unmakeMove can't derive from the board after it
+struct MoveUndo {
+    uint64_t pieceKeys, extendedPieceKeys;
+    uint16_t enpassantSquare, halfMovesCount;
+    uint8_t castlingRights;     // as in BoardSnapshot
+    GameResult gameResult;
+    Piece lastCapturedPiece;    // the last move delta of the position before the move
+    uint8_t lastCaptureSquare;
+    bool hasLastMove;
+};
+
+// what a move changed, a client that knows the position before the move can follow the game with it, see MoveDelta.h
+struct MoveDelta {
+    uint8_t fromSquare, toSquare;
+    Piece capturedPiece;                    // EMPTY if the move didn't capture
+    uint8_t captureSquare;                  // differs from toSquare for en passant, 64 if the move didn't capture
+    uint8_t rookFromSquare, rookToSquare;   // 64 if the move is not castling
+    char choosenPiece;                      // 0 for non promotion moves
+    CheckType checkType;
+    GameResult result;
+};
+
+// key of a position for indexes shared across games. hash is the repetition hash, builds with LC_WIDE_POSITION_KEYS
+// fill extendedHash from independent keys (0 otherwise), so two positions only collide if both lanes do
+struct PositionKey {
+    uint64_t hash;
+    uint64_t extendedHash;
+
+    inline bool operator==(const PositionKey& other) const {
+        return hash == other.hash && extendedHash == other.extendedHash;
+    }
+
+    inline bool operator!=(const PositionKey& other) const {
+        return !(*this == other);
+    }
+};
+
 extern const char* const gameResultToString[7];
 extern char const pieceToChar[13];
 
+// writes the FEN of a position (at most Board::FEN_BUFFER_SIZE - 1 characters) and returns its length. pBoard is in the
+// order of Board::getBoardArray, castlingRights as in BoardSnapshot and movesCount counts plies
+size_t formatFEN(const char* pBoard, bool whiteTurn, uint8_t castlingRights, int enpassantSquare, int halfMovesCount, int movesCount, char* pOutput);
+
 class Board {
 public:
     Board();
     ~Board() = default;
 
+    // the copy shares the position history with this board, see PositionHistory
+    Board(const Board&) = default;
+
     void move(const Move&);
     void promote(char choosenPiece, const Move&);
+
+    // applies a move known to be legal without validating it, choosenPiece is 0 for non promotion moves
+    void applyTrustedMove(const Move&, char choosenPiece, bool detectResult);
+
+    // the same, undo receives what unmakeMove needs to take the move back
+    void applyTrustedMove(const Move&, char choosenPiece, bool detectResult, MoveUndo& undo);
+
+    // takes back the last move, undo is the record applyTrustedMove filled for it. the position before a move is
+    // always in progress, so the result flags of the position after it are cleared
+    void unmakeMove(const MoveUndo& undo);
+
+    // runs checkmate, stalemate and draw detection for the current position
+    void detectGameResult();
+
+    // squares the piece on square can legally move to, 0 if it is not a piece of the side to move or the game is over.
+    // the destinations of all pieces are computed together on the first query after a move
+    uint64_t getLegalDestinations(int square) const;
+
+    // choosenPiece is 0 for non promotion moves
+    bool isLegal(const Move& move, char choosenPiece) const;
+
+    // a position has at most 218 legal moves
+    static constexpr size_t MAX_LEGAL_MOVES = 256;
+
+    // writes the legal moves of the side to move and returns their number, none if the game is over. the order only
+    // depends on the position: by from square, then by to square, promotions as n, b, r, q
+    size_t getLegalMoves(PackedMove* pMoves) const;
+
+    void saveSnapshot(BoardSnapshot& snapshot) const;
+
+    // the board continues the game from the snapshot with an empty position history,
+    // push the earlier positions to positionHistory for repetition detection
+    void loadSnapshot(const BoardSnapshot& snapshot);
+
+    // true if the destinations of the current position are already computed
+    inline bool hasLegalDestinations() const {
+        return legalDestinationsReady;
+    }
     
     
     inline void updatePieceMoveOnBoard(Piece piece, int fromSquare, int toSquare) {
@@ -179,14 +273,6 @@ public:
         return grid[square/8][square%8];
     }
 
-    inline void updateDiscoveryCheckSquare(int square) {
-        discoveryCheckSquare = square;
-    }
-
-    inline void updateDirectCheckSquare(int square) {
-        directCheckSquare = square;
-    }
-
     inline bool isGameOver() const {
         return gameResult != GameResult::IN_PROGRESS;
     }
@@ -223,20 +309,29 @@ public:
         return board;
     }
 
+    // squares in the order of getBoard, row by row from rank 1, every row from the h-file
+    inline std::array<char, 64> getBoardArray() const {
+        std::array<char, 64> board;
+
+        for(int square = 0; square < 64; square++) board[square] = pieceToChar[(int)grid[square/8][square%8]];
+
+        return board;
+    }
+
     inline std::string getMoveHistory() const {
-        return moveHistory;
+        return positionHistory.getMoves();
     }
 
-    inline void addMoveToHistory(std::string move) {
-        if(moveHistory.length() != 0) moveHistory.push_back(' ');
-        moveHistory += move;
+    // occurrences of the current position since the last capture or pawn move, including the current one
+    inline int countRepetitions(uint64_t positionHash) const {
+        return positionHistory.countRepetitions(positionHash, halfMovesCount + 1);
     }
 
     inline void setPieceOnBoard(Piece piece, int square) {
         grid[square/8][square%8] = piece;
     }
 
-    inline int getMoveNumber() {
+    inline int getMoveNumber() const {
         return movesCount;
     }
 
@@ -254,29 +349,95 @@ public:
 
     std::string getFENString() const;
 
+    // the writers below fill a caller buffer without allocating. they return the length of the whole output, which is
+    // written with a terminating NUL if it is shorter than size, otherwise only the NUL is written (if size > 0)
+    size_t writeFEN(char* pBuffer, size_t size) const;
+
+    // {"fen":"...","turn":"w","check":false,"lastMove":"e2e4","result":"Game_In_Progress"}, lastMove is null before the first move
+    size_t writeJSON(char* pBuffer, size_t size) const;
+
+    // keys of the current position, see PositionKey
+    inline PositionKey getPositionKey() const {
+#ifdef LC_WIDE_POSITION_KEYS
+        return {computePositionHash(isWhiteTurn), computeExtendedHash(isWhiteTurn)};
+#else
+        return {computePositionHash(isWhiteTurn), 0};
+#endif
+    }
+
+    // same for all positions with the same number of pieces of every type (e.g. KRP vs KR)
+    uint64_t getMaterialKey() const;
+
+    // same for all positions with the same pawns on the same squares
+    uint64_t getPawnKey() const;
+
+    // the last move made on this board, false if there is none (e.g. right after loadSnapshot)
+    bool getLastMoveDelta(MoveDelta& delta) const;
+
+    // the longest FEN and JSON state (every field at its maximum length) with the NUL
+    static constexpr size_t FEN_BUFFER_SIZE = 96;
+    static constexpr size_t JSON_BUFFER_SIZE = 192;
+
 
     // member variables
-    std::unordered_map<uint64_t, uint16_t> positionHashToFreq;
+    PositionHistory positionHistory;
     bool isWhiteTurn;
     bool canWhiteKingShortCastle, canWhiteKingLongCastle, canBlackKingShortCastle, canBlackKingLongCastle;
     bool gameOver, whiteKingCheckmated, blackKingCheckmated, stalemate, drawByRepitition, drawBy50HalfMoves, drawByInsufficientMaterial;
 
-    uint16_t enpassantSquare, discoveryCheckSquare, directCheckSquare;
+    uint16_t enpassantSquare;
     uint16_t halfMovesCount, movesCount; // they treat each player's turn as different moves
     
     GameResult gameResult;
 
 private:
     void initBoard();
+    void resetState();
+
+    Piece getPromotionPiece(char choosenPiece, const Move& move) const;
+    void updateCastlingRights(int fromSquare, int toSquare);
+    void updateFENCache() const;
+    void recordCapture(Piece capturedPiece, int captureSquare);
+    uint64_t computePositionHash(bool whiteToMove) const;
+    uint64_t computeExtendedHash(bool whiteToMove) const;
+    int getCastlingRights() const;
+    int getEnpassantKeyFile(bool whiteToMove) const;
+    void initPieceKeys();
+    void updatePieceKeys(Piece movingPiece, Piece placedPiece, const Move& move);
+    uint32_t computeVerificationKey(bool whiteToMove) const;
+    uint64_t recordPosition(const Move& move, char choosenPiece);
+    void updateGameResult(uint64_t positionHash, bool moverIsWhite);
+    void computeLegalDestinations() const;
 
     uint64_t piecesArray[12];
     uint64_t allWhitePiecesBoard, allBlackPiecesBoard, allPiecesBoard;
 
+    // xor of the zobrist keys of all pieces on their squares, updated by every move. the extended lane is only
+    // maintained with LC_WIDE_POSITION_KEYS
+    uint64_t pieceKeys, extendedPieceKeys;
+
     Piece grid[8][8];
-    std::string moveHistory;
+
+    // cache of getLegalDestinations, every move clears it
+    mutable uint64_t legalDestinations[64];
+    mutable bool legalDestinationsReady;
+
+    // pieces the position cache reports as movable, all squares if the cache has no summary
+    mutable uint64_t movablePiecesHint;
+    mutable bool positionFactsProbed;
+
+    // FEN of the current position, spectators ask for it many times per move. every move clears it
+    mutable char fenCache[FEN_BUFFER_SIZE];
+    mutable uint8_t fenLength;
+
+    // what the last move captured, the rest of its delta follows from the board and the position history
+    Piece lastCapturedPiece;
+    uint8_t lastCaptureSquare;
+    bool hasLastMove;
 
     std::shared_ptr<const MoveManagerStore> m_pMoveManagerStore;
     std::shared_ptr<const Zobrist> m_pZobrist;
+    std::shared_ptr<PositionCache> m_pPositionCache;
 };
 
 
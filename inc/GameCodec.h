@@ -0,0 +1,122 @@
+#ifndef __GAME_CODEC_H__
+#define __GAME_CODEC_H__
+
+#include "LegalChess.h"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LC {
+
+class GameCodecException : public std::runtime_error {
+public:
+    GameCodecException(std::string msg) : std::runtime_error(msg) {}
+};
+
+// a move is stored as its index in LegalChess::getLegalMoves, the end of a game as the number of legal moves
+enum class MoveCoding : uint8_t {
+    INDEX_BYTES,    // one byte per symbol
+    ARITHMETIC      // range coded, every legal move equally likely: a move costs log2(legal moves) bits
+};
+
+// writes games to a stream: a 6 byte header, then the games one after the other. the moves are validated while
+// they are encoded, an illegal move throws and leaves the game as it was before the move
+class GameEncoder {
+public:
+    explicit GameEncoder(std::ostream& output, MoveCoding coding = MoveCoding::ARITHMETIC);
+    ~GameEncoder();
+
+    GameEncoder(const GameEncoder&) = delete;
+    GameEncoder& operator=(const GameEncoder&) = delete;
+
+    // appends a move to the current game, the first move starts a game
+    void addMove(const std::string& uciMove);
+
+    // ends the current game, an empty game if no move was added
+    void endGame();
+
+    // a game of space separated uci moves
+    void encodeGame(const std::string& uciMoves);
+
+    // ends the stream and writes the pending bytes, called by the destructor if needed. the stream can't be extended after it
+    void finish();
+
+    // the game being encoded
+    inline const LegalChess& getGame() const {
+        return *m_pGame;
+    }
+
+private:
+    void encodeSymbol(uint32_t start, uint32_t size, uint32_t total);
+    void shiftLow();
+    void putByte(uint8_t byte);
+    void flushBuffer();
+
+    std::ostream& m_output;
+    MoveCoding m_coding;
+    std::unique_ptr<LegalChess> m_pGame;
+    bool m_inGame = false;
+    bool m_finished = false;
+
+    // range coder state
+    uint64_t m_low = 0;
+    uint32_t m_range = UINT32_MAX;
+    uint8_t m_cache = 0;
+    uint64_t m_cacheSize = 1;
+
+    std::vector<char> m_buffer;
+};
+
+// reads the games written by GameEncoder, every move is replayed on a board to list the legal moves of the next one
+class GameDecoder {
+public:
+    // reads the header, throws GameCodecException if the stream wasn't written by GameEncoder
+    explicit GameDecoder(std::istream& input);
+
+    GameDecoder(const GameDecoder&) = delete;
+    GameDecoder& operator=(const GameDecoder&) = delete;
+
+    // starts the next game, false at the end of the stream
+    bool beginGame();
+
+    // the next move of the current game, false at its end
+    bool nextMove(std::string& uciMove);
+
+    // the next game as space separated uci moves, false at the end of the stream
+    bool decodeGame(std::string& uciMoves);
+
+    // the game being decoded, in the position after the last move returned
+    inline const LegalChess& getGame() const {
+        return *m_pGame;
+    }
+
+    inline MoveCoding getCoding() const {
+        return m_coding;
+    }
+
+private:
+    uint32_t decodeFrequency(uint32_t total);
+    void decodeUpdate(uint32_t start, uint32_t size);
+    int getByte();
+
+    std::istream& m_input;
+    MoveCoding m_coding;
+    std::unique_ptr<LegalChess> m_pGame;
+    bool m_inGame = false;
+    bool m_ended = false;
+
+    // range coder state
+    uint32_t m_code = 0;
+    uint32_t m_range = UINT32_MAX;
+
+    std::vector<char> m_buffer;
+    size_t m_position = 0;
+};
+
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef __GAME_IMPORTER_H__
+#define __GAME_IMPORTER_H__
+
+#include "LegalChess.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace LC {
+
+// 128 bits that identify a game, two lanes of a rolling hash of the packed moves for a move sequence
+// or the final position key for a transposition
+struct GameFingerprint {
+    uint64_t hash;
+    uint64_t check;
+
+    inline bool operator==(const GameFingerprint& other) const {
+        return hash == other.hash && check == other.check;
+    }
+};
+
+// folds the moves of a game of space separated uci moves into a fingerprint without allocating, returns false if
+// a move isn't uci (such a game is never a duplicate, it is validated and rejected)
+bool fingerprintMoves(const std::string& uciMoves, GameFingerprint& fingerprint);
+
+// fingerprints and the first game (by import number) seen with each of them, split into shards with a lock each
+// so that the import threads rarely wait for each other
+class FingerprintSet {
+public:
+    struct FirstGame {
+        uint64_t gameNumber;
+        GameResult result;
+        bool valid;
+    };
+
+    FingerprintSet();
+
+    // keeps the smaller game number if the fingerprint is known, so the first game wins whatever the thread order
+    void insert(const GameFingerprint& fingerprint, uint64_t gameNumber);
+
+    // the fingerprint must have been inserted
+    FirstGame find(const GameFingerprint& fingerprint) const;
+
+    // records the outcome of validating the first game of a fingerprint
+    void setOutcome(const GameFingerprint& fingerprint, GameResult result, bool valid);
+
+    size_t size() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 256;
+
+    struct FingerprintHash {
+        inline size_t operator()(const GameFingerprint& fingerprint) const {
+            return fingerprint.hash;
+        }
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<GameFingerprint, FirstGame, FingerprintHash> games;
+    };
+
+    // the low bits pick the bucket inside a shard, the high bits the shard
+    inline Shard& getShard(const GameFingerprint& fingerprint) const {
+        return m_pShards[fingerprint.hash >> 56];
+    }
+
+    std::unique_ptr<Shard[]> m_pShards;
+};
+
+enum class ImportStatus {
+    VALID,
+    INVALID,        // a move was rejected, error holds the message
+    DUPLICATE,      // same moves as game duplicateOf, skipped without validation
+    TRANSPOSITION   // legal, but reaches the same final position with the same number of moves and result as game duplicateOf
+};
+
+struct ImportedGame {
+    ImportStatus status;
+    GameResult result;          // after the last move, IN_PROGRESS for an invalid game
+    uint64_t duplicateOf;       // import number of the first game, for DUPLICATE and TRANSPOSITION
+    std::string error;
+};
+
+struct ImportStats {
+    size_t valid = 0;
+    size_t invalid = 0;
+    size_t duplicates = 0;
+    size_t transpositions = 0;
+};
+
+// validates a bulk import of games and filters the duplicates. games are numbered in import order across all
+// calls, and the first game of a set of duplicates is the one that counts, so the outcome doesn't depend on the
+// number of threads. a game with the same moves as an earlier one is not replayed. a duplicate of an invalid
+// game is reported as INVALID with duplicateOf set
+class GameImporter {
+public:
+    // 0 uses one thread per core
+    explicit GameImporter(unsigned threadCount = 0);
+
+    // results[i] belongs to games[i]. not safe to call from several threads at once
+    ImportStats import(const std::vector<std::string>& games, std::vector<ImportedGame>& results);
+
+    // the number of the next imported game
+    inline uint64_t getImportedCount() const {
+        return m_importedCount;
+    }
+
+    // distinct move sequences seen so far, and distinct final positions of the valid games
+    inline size_t getDistinctGameCount() const {
+        return m_moveSequences.size();
+    }
+
+    inline size_t getDistinctPositionCount() const {
+        return m_finalPositions.size();
+    }
+
+private:
+    unsigned m_threadCount;
+    uint64_t m_importedCount = 0;
+
+    FingerprintSet m_moveSequences;
+    FingerprintSet m_finalPositions;
+};
+
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef __GAME_TABLE_H__
+#define __GAME_TABLE_H__
+
+#include "BatchValidator.h"
+#include "LegalChess.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LC {
+
+class GameTableException : public std::runtime_error {
+public:
+    GameTableException(std::string msg) : std::runtime_error(msg) {}
+};
+
+// the positions of many live games as a structure of arrays: every bitboard, clock and flag is a column with one entry
+// per game, so a sweep over all games reads consecutive memory instead of one heap object per game. a game is a row.
+// the table is a read mostly mirror for the sweeps, not the store the moves are made on: a move goes through a cursor
+// LegalChess that loads the row when it switches games, about 1us on top of the move, see makeMove. a game played on
+// its own LegalChess is copied into its row with updateGame
+class GameTable {
+public:
+    GameTable();
+
+    GameTable(const GameTable&) = delete;
+    GameTable& operator=(const GameTable&) = delete;
+
+    inline size_t size() const {
+        return m_size;
+    }
+
+    // room for games rows without growing the columns
+    void reserve(size_t games);
+
+    // a new game in the start position, returns its row
+    size_t addGame();
+
+    // the position, move history and result of game, returns its row
+    size_t addGame(const LegalChess& game);
+
+    // the last game takes the row, the rows of the other games are kept
+    void removeGame(size_t row);
+
+    // the row takes the position, move history and result of game, e.g. after a move made on the game itself
+    void updateGame(size_t row, const LegalChess& game);
+
+    // validated like LegalChess::makeMove, throws the same exceptions and leaves the row as it was. a row other than
+    // the last one moved is loaded into the cursor first, which costs more than the move
+    GameResult makeMove(size_t row, const std::string& uciMove);
+
+    // the game at row with its move and repetition history, valid until the next call that changes the table.
+    // getLastMoveDelta is only known if the last move of the table was made on this row
+    const LegalChess& getGame(size_t row);
+
+    // the columns below have size() entries, the sweeps read them padded to whole vectors of BATCH_LANES
+    inline const uint64_t* getPieceColumn(Piece piece) const {
+        return m_pieces[(int)piece].data();
+    }
+
+    inline const uint64_t* getColorColumn(bool white) const {
+        return m_colors[white ? 0 : 1].data();
+    }
+
+    // 1 if white is to move
+    inline const uint8_t* getTurnColumn() const {
+        return m_turns.data();
+    }
+
+    // as in BoardSnapshot
+    inline const uint8_t* getCastlingColumn() const {
+        return m_castlingRights.data();
+    }
+
+    // 64 if there is no en passant square
+    inline const uint8_t* getEnpassantColumn() const {
+        return m_enpassantSquares.data();
+    }
+
+    inline const uint16_t* getHalfMovesColumn() const {
+        return m_halfMoves.data();
+    }
+
+    // plies played
+    inline const uint16_t* getMoveNumberColumn() const {
+        return m_moveNumbers.data();
+    }
+
+    // occurrences of the current position since the last capture or pawn move, including the current one. 0 before
+    // the first move
+    inline const uint8_t* getRepetitionColumn() const {
+        return m_repetitions.data();
+    }
+
+    inline const GameResult* getResultColumn() const {
+        return m_results.data();
+    }
+
+    // rows of the games in progress whose side to move is in check
+    void findChecks(std::vector<size_t>& rows) const;
+
+    // white material minus black material per row, pawn 1, knight 3, bishop 3, rook 5, queen 9
+    void computeMaterialBalance(std::vector<int>& balances) const;
+
+    // rows of the games in progress that have at least minHalfMoves plies since the last capture or pawn move, or whose
+    // current position occurred at least minRepetitions times
+    void findNearDraws(int minHalfMoves, int minRepetitions, std::vector<size_t>& rows) const;
+
+    // bytes held for the columns, without the chunks of the move histories and the cursor game
+    size_t getMemoryUsage() const;
+
+private:
+    static constexpr size_t NO_ROW = SIZE_MAX;
+
+    // all bits set in the lanes of the games whose side to move is in check, from row to row + lanes of T - 1
+    template<class T>
+    T findCheckLanes(size_t row) const;
+
+    void checkRow(size_t row) const;
+    // grows every column to hold row, padded to whole vectors
+    void reserveRow(size_t row);
+    void storeRow(size_t row, const Board& board);
+    // the cursor board gets the position, history and result of row
+    void loadRow(size_t row);
+
+    size_t m_size = 0;
+
+    // indexed by Piece, white pieces first
+    std::vector<uint64_t> m_pieces[12];
+    std::vector<uint64_t> m_colors[2];
+
+    std::vector<uint8_t> m_turns;
+    std::vector<uint8_t> m_castlingRights;
+    std::vector<uint8_t> m_enpassantSquares;
+    std::vector<uint16_t> m_halfMoves;
+    std::vector<uint16_t> m_moveNumbers;
+    std::vector<uint8_t> m_repetitions;
+    std::vector<GameResult> m_results;
+
+    // only read when a game is loaded, the cursor takes the history of its row while it makes a move
+    std::vector<PositionHistory> m_histories;
+
+    std::unique_ptr<LegalChess> m_pCursor;
+    size_t m_cursorRow = NO_ROW;     // the row the cursor board holds, NO_ROW after the row changed elsewhere
+};
+
+};
+
+#endif
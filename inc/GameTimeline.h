@@ -0,0 +1,82 @@
+#ifndef __GAME_TIMELINE_H__
+#define __GAME_TIMELINE_H__
+
+#include "LegalChess.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LC {
+
+class GameTimelineException : public std::runtime_error {
+public:
+    GameTimelineException(std::string msg) : std::runtime_error(msg) {}
+};
+
+// the moves of a game with a board snapshot every checkpointInterval plies, so any ply can be shown without replaying
+// the game from the start: seek restores the nearest checkpoint before the ply and replays at most
+// checkpointInterval - 1 moves. a smaller interval costs more memory (one BoardSnapshot per checkpoint) and seeks faster
+class GameTimeline {
+public:
+    explicit GameTimeline(int checkpointInterval = 8);
+
+    // validates the space separated uci moves, throws like LegalChess::makeMove
+    GameTimeline(const std::string& uciMoves, int checkpointInterval = 8);
+
+    GameTimeline(const GameTimeline&) = delete;
+    GameTimeline& operator=(const GameTimeline&) = delete;
+
+    // appends a move to the end of the game, validated like LegalChess::makeMove. the position of seek is kept
+    GameResult addMove(const std::string& uciMove);
+
+    // the game after ply moves, 0 is the start position. throws GameTimelineException if ply is past the last move.
+    // the game has the full move and repetition history of the ply. getLastMoveDelta is false when ply is on a checkpoint
+    const LegalChess& seek(int ply);
+
+    // the game at the ply of the last seek
+    inline const LegalChess& getGame() const {
+        return *m_pCursor;
+    }
+
+    inline int getCurrentPly() const {
+        return m_cursorPly;
+    }
+
+    // plies in the game
+    inline int getPlyCount() const {
+        return (int)m_moves.size();
+    }
+
+    // the move that leads to ply, 1 to getPlyCount()
+    inline PackedMove getMove(int ply) const {
+        return m_moves.at(ply - 1);
+    }
+
+    inline int getCheckpointInterval() const {
+        return m_checkpointInterval;
+    }
+
+    // bytes held for the moves, position keys and checkpoints, without the two boards every timeline has
+    size_t getMemoryUsage() const;
+
+private:
+    int m_checkpointInterval;
+
+    std::vector<PackedMove> m_moves;
+    std::vector<uint64_t> m_positionHashes;     // position after every ply, for the repetition history of a seek
+    std::vector<BoardSnapshot> m_checkpoints;   // position after ply i*m_checkpointInterval
+
+    // history of the head after ply i*PositionHistory::CHUNK_SIZE, shares its chunks with the head
+    std::vector<PositionHistory> m_histories;
+
+    std::unique_ptr<LegalChess> m_pHead;        // at the end of the game, validates the moves added
+    std::unique_ptr<LegalChess> m_pCursor;      // at m_cursorPly
+    int m_cursorPly = 0;
+};
+
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <algorithm>
 
 #include "Board.h"
+#include "SlidingAttacks.h"
 
 namespace LC {
 
@@ -12,32 +13,59 @@ extern uint64_t knightAttackSquares[64];
 extern uint64_t bishopAttackSquares[64];
 extern uint64_t rookAttackSquares[64];
 extern uint64_t kingAttackSquares[64];
+extern uint64_t pawnAttackSquares[2][64]; // [0] black pawns, [1] white pawns
 
 extern uint64_t rangeMasks[64][64];
 
+#ifndef LC_TABLE_FREE_SLIDERS
+// attacks of a slider per square and occupancy of its lines, several megabytes. builds with LC_TABLE_FREE_SLIDERS
+// compute them instead, see SlidingAttacks.h
 extern std::vector<std::vector<uint64_t>> rookAttacksForOccupancy, bishopAttacksForOccupancy;
-
-enum class PinDirection {
-    NONE,
-    RANK,
-    FILE,
-    TOP_BOTTOM_DIAG,
-    BOTTOM_TOP_DIAG
-};
+#endif
 
 class Board;
 enum class CheckType;
 
+// everything the legal move generation of one side needs about the position
+struct LegalMoveContext {
+    bool white;
+    int kingSquare;
+    uint64_t own, occupancy;
+    uint64_t checkers;
+    uint64_t checkMask;     // squares a non king move has to land on, all squares when not in check
+    uint64_t pinned;
+    uint64_t pinRays[64];   // for a pinned piece, the line from its king through the pinner
+};
+
 void compute();
-PinDirection getPinDirection(bool white, int pieceSquare, Board & board, bool updateDiscoveryCheckSquare);
+#ifdef LC_TABLE_FREE_SLIDERS
+inline uint64_t getBishopAttacksForSquareAndOccupancy(int square, uint64_t occupancy) {
+    return bishopAttacksFrom(square, occupancy);
+}
+
+inline uint64_t getRookAttacksForSquareAndOccupancy(int square, uint64_t occupancy) {
+    return rookAttacksFrom(square, occupancy);
+}
+
+inline uint64_t getQueenAttacksForSquareAndOccupancy(int square, uint64_t occupancy) {
+    return bishopAttacksFrom(square, occupancy) | rookAttacksFrom(square, occupancy);
+}
+#else
 uint64_t getBishopAttacksForSquareAndOccupancy(int square, uint64_t occupancy);
 uint64_t getRookAttacksForSquareAndOccupancy(int square, uint64_t occupancy);
 uint64_t getQueenAttacksForSquareAndOccupancy(int square, uint64_t occupancy);
-uint64_t generateLegalAttacksForColor(bool white, bool checkPins, bool includeKing, bool includePawnMoves, const Board& board);
+#endif
+// pieces of the color byWhite that attack square when the board has the given occupancy. leave a king out of the
+// occupancy to test the squares it can move to, it can't hide behind itself on the ray of a slider
+uint64_t attackersTo(int square, uint64_t occupancy, bool byWhite, const Board& board);
 bool isKingUnderCheck(bool white, const Board& board);
-bool canAnyPieceMove(bool white, const Board& board);
-bool isKingInSameRay(int pieceSquare, int kingSquare, int newKingSquare, Piece attackingPiece);
-void calculateMoveResult(CheckType check, uint64_t positionHash, bool isWhiteTurn, Board& board);
+// the king is not in check, the squares up to the rook are empty and the king doesn't pass or land on an attacked
+// square. the castling rights are not checked
+bool isCastlingPathClear(bool white, bool shortSide, const Board& board);
+void initLegalMoveContext(bool white, const Board& board, LegalMoveContext& context);
+uint64_t getLegalTargets(int square, const LegalMoveContext& context, const Board& board, bool includeCastling);
+bool hasAnyLegalMove(const LegalMoveContext& context, const Board& board);
+void calculateMoveResult(uint64_t checkers, bool hasLegalMove, uint64_t positionHash, bool isWhiteTurn, Board& board);
 bool doesColorHaveInsufficientMaterial(bool white, const Board& board);
 
 };
@@ -2,6 +2,10 @@
 #define __LEGAL_CHESS_H__
 
 #include "Board.h"
+#include "Metrics.h"
+#include "MoveDelta.h"
+#include "MoveLog.h"
+#include "OpeningTrie.h"
 
 #include <string>
 #include <vector>
@@ -16,6 +20,11 @@ namespace LC {
 class Board;
 struct Move;
 
+enum class ReplayMode {
+    VALIDATED,  // every move goes through makeMove
+    TRUSTED     // moves are known to be legal, the game result is detected on the final position only
+};
+
 class LegalChess {
 public:
     LegalChess() : m_pBoard(std::make_unique<Board>()) {}
@@ -49,24 +58,133 @@ public:
         std::cout << std::endl;
     }
 
+    LegalChess(const std::string& uciMoves, ReplayMode mode, bool detectResultEveryPly = false) : m_pBoard(std::make_unique<Board>()) {
+        std::stringstream ss(uciMoves);
+        std::string move;
+
+        if(mode == ReplayMode::VALIDATED) {
+            while(ss >> move) makeMove(move);
+            return;
+        }
+
+        while(ss >> move) makeTrustedMove(move, detectResultEveryPly);
+
+        if(!detectResultEveryPly) detectGameResult();
+    }
+
+    // loads the board after the longest prefix of the moves stored in the trie in one step and replays only the remaining moves
+    LegalChess(const std::string& uciMoves, const OpeningTrie& openings, ReplayMode mode = ReplayMode::VALIDATED) : m_pBoard(std::make_unique<Board>()) {
+        std::vector<std::string> moves;
+
+        // split by hand, a stringstream costs more than restoring the prefix
+        for(size_t end = 0, start = uciMoves.find_first_not_of(" \t\r\n"); start != std::string::npos; start = uciMoves.find_first_not_of(" \t\r\n", end)) {
+            end = uciMoves.find_first_of(" \t\r\n", start);
+            moves.emplace_back(uciMoves, start, end == std::string::npos ? std::string::npos : end - start);
+        }
+
+        size_t index = openings.restore(moves, *m_pBoard);
+
+        if(mode == ReplayMode::VALIDATED) {
+            for(; index < moves.size(); index++) makeMove(moves[index]);
+            return;
+        }
+
+        for(; index < moves.size(); index++) makeTrustedMove(moves[index]);
+
+        detectGameResult();
+    }
+
     ~LegalChess() = default;
 
+    // a new game that continues from the current position, e.g. an analysis board. the move and repetition history
+    // is shared with this game, so forking costs the same at any move. the fork has no move log attached
+    std::unique_ptr<LegalChess> fork() const {
+        return std::unique_ptr<LegalChess>(new LegalChess(*m_pBoard));
+    }
+
     GameResult makeMove(std::string move) {
-        if(m_pBoard->getGameResult() != GameResult::IN_PROGRESS) {
-            throw GameOverException("Game is Over. Game Result: " + std::string(gameResultToString[(int)m_pBoard->getGameResult()]) + ". Cannot make move. Move number: " + std::to_string(m_pBoard->getMoveNumber() + 1) + ". Move: " + move);
+        if(m_pMoveLog) m_pMoveLog->checkWritable();
+
+        LC_METRICS_BEGIN_MOVE();
+        LC_METRICS_SCOPE(MAKE_MOVE);
+
+#ifdef LC_ENABLE_METRICS
+        try {
+            applyMove(move);
+        }
+        catch(const std::exception& e) {
+            LC_METRICS_REJECT(e);
+            throw;
         }
 
-        Move sMove;
+        LC_METRICS_ACCEPT();
+#else
+        applyMove(move);
+#endif
 
+        if(m_pMoveLog) logMove(move);
+
+        return m_pBoard->getGameResult();
+    }   
+
+    // applies a move from a trusted source (e.g. our own game archive) skipping the legality checks,
+    // the game result is only detected when asked for, see detectGameResult
+    GameResult makeTrustedMove(std::string move, bool detectResult = false) {
+        if(m_pMoveLog) m_pMoveLog->checkWritable();
+
+        LC_METRICS_BEGIN_MOVE();
+        LC_METRICS_SCOPE(MAKE_MOVE);
+
+        Move sMove;
         validateMove(move, sMove);
 
-        if(move.length() == 4)
-            m_pBoard->move(sMove);
-        else 
-            m_pBoard->promote(move[4], sMove);
+        m_pBoard->applyTrustedMove(sMove, move.length() == 5 ? move[4] : 0, detectResult);
+
+        if(m_pMoveLog) logMove(move);
+
+        LC_METRICS_ACCEPT();
 
         return m_pBoard->getGameResult();
-    }   
+    }
+
+    // runs checkmate, stalemate and draw detection on the current position
+    GameResult detectGameResult() {
+        m_pBoard->detectGameResult();
+
+        return m_pBoard->getGameResult();
+    }
+
+    // squares (e.g. "e4") the piece on square can legally move to, empty if it is not a piece of the side to move
+    std::vector<std::string> legalDestinations(const std::string& square) const {
+        std::vector<std::string> destinations;
+
+        if(square.length() != 2 || square[0] < 'a' || square[0] > 'h' || square[1] < '1' || square[1] > '8') return destinations;
+
+        uint64_t targets = m_pBoard->getLegalDestinations((square[1] - '1')*8 + ('h' - square[0]));
+
+        while(targets) {
+            int targetSquare = __builtin_ctzll(targets);
+            targets &= targets - 1;
+
+            destinations.push_back({(char)('h' - targetSquare%8), (char)('1' + targetSquare/8)});
+        }
+
+        return destinations;
+    }
+
+    // true if makeMove would accept the move
+    bool isLegal(const std::string& move) const {
+        Move sMove;
+
+        return parseMove(move, sMove) && m_pBoard->isLegal(sMove, move.length() == 5 ? move[4] : 0);
+    }
+
+    static constexpr size_t MAX_LEGAL_MOVES = Board::MAX_LEGAL_MOVES;
+
+    // all legal moves in an order that only depends on the position, pMoves needs room for MAX_LEGAL_MOVES
+    size_t getLegalMoves(PackedMove* pMoves) const {
+        return m_pBoard->getLegalMoves(pMoves);
+    }
 
     bool isGameOver() {
         return m_pBoard->isGameOver();
@@ -92,10 +210,15 @@ public:
         return m_pBoard->isDrawBy50HalfMoves();
     }
 
-    GameResult getGameResult() {
+    GameResult getGameResult() const {
         return m_pBoard->getGameResult();
     }
 
+    // plies played so far
+    int getMoveNumber() const {
+        return m_pBoard->getMoveNumber();
+    }
+
     bool doesColorHaveInsufficientMaterial(bool white) {
         return m_pBoard->doesColorHaveInsufficientMaterial(white);
     }
@@ -108,14 +231,148 @@ public:
         return m_pBoard->getBoard();
     }
 
+    // the output calls below don't allocate, they write into the caller's buffer and return the length of the whole
+    // output. it is only written (with a terminating NUL) if it is shorter than size, buffers of the sizes below always fit
+    static constexpr size_t FEN_BUFFER_SIZE = Board::FEN_BUFFER_SIZE;
+    static constexpr size_t JSON_BUFFER_SIZE = Board::JSON_BUFFER_SIZE;
+
+    // the FEN is computed once per position
+    size_t writeFEN(char* pBuffer, size_t size) const {
+        return m_pBoard->writeFEN(pBuffer, size);
+    }
+
+    // {"fen":"...","turn":"w","check":false,"lastMove":"e2e4","result":"Game_In_Progress"}, lastMove is null before the first move
+    size_t writeJSON(char* pBuffer, size_t size) const {
+        return m_pBoard->writeJSON(pBuffer, size);
+    }
+
+    // the squares of getBoard in one array, index rank*8 + file counted from the h-file (h1 = 0, a8 = 63)
+    std::array<char, 64> getBoardArray() const {
+        return m_pBoard->getBoardArray();
+    }
+
+    // keys of the current position for indexes shared between games, see PositionKey
+    PositionKey getPositionKey() const {
+        return m_pBoard->getPositionKey();
+    }
+
+    // same for all positions with the same number of pieces of every type
+    uint64_t getMaterialKey() const {
+        return m_pBoard->getMaterialKey();
+    }
+
+    // same for all positions with the same pawns on the same squares
+    uint64_t getPawnKey() const {
+        return m_pBoard->getPawnKey();
+    }
+
+    // what the last move changed, false before the first move
+    bool getLastMoveDelta(MoveDelta& delta) const {
+        return m_pBoard->getLastMoveDelta(delta);
+    }
+
+    // the last move as a record of at most MAX_MOVE_DELTA_SIZE bytes for clients following the game, see MoveDelta.h.
+    // returns the size of the record, it is only written if it fits. 0 before the first move
+    size_t writeMoveDelta(uint8_t* pBuffer, size_t size) const {
+        MoveDelta delta;
+        if(!m_pBoard->getLastMoveDelta(delta)) return 0;
+
+        uint8_t record[MAX_MOVE_DELTA_SIZE];
+        size_t length = encodeMoveDelta(delta, record);
+
+        if(length <= size) std::copy(record, record + length, pBuffer);
+
+        return length;
+    }
+
+    // uci moves played so far, space separated
+    std::string getMoveHistory() const {
+        return m_pBoard->getMoveHistory();
+    }
+
+    // every move accepted from now on is appended to the log under gameId, nullptr stops logging. recovery replays a
+    // game from the starting position, so a log is only attached before the first move (a fork of a game with moves
+    // or a restored game is refused)
+    void attachMoveLog(std::shared_ptr<MoveLog> pMoveLog, uint32_t gameId) {
+        if(pMoveLog && m_pBoard->getMoveNumber() != 0) {
+            throw MoveLogException("A move log can only be attached before the first move. Game: " + std::to_string(gameId) + ". Moves played: " + std::to_string(m_pBoard->getMoveNumber()));
+        }
+
+        m_pMoveLog = std::move(pMoveLog);
+        m_logGameId = gameId;
+    }
+
+    // sequence number of the last logged move, pass it to MoveLog::waitDurable before acknowledging the move
+    uint64_t getLogSequence() const {
+        return m_logSequence;
+    }
+
 
 private:
-    void validateMove(std::string& move, Move& sMove) {
-        int file1 = move[0], rank1 = move[1], file2 = move[2], rank2 = move[3];
+    friend class MoveBatch;
+    friend class OpeningTrie;
+    friend class MoveExecutor;
+    friend class MoveLog;
+    friend class GameTimeline;
+    friend class VariationTree;
+    friend class GameTable;
+
+    explicit LegalChess(const Board& board) : m_pBoard(std::make_unique<Board>(board)) {}
+
+    // the moves check the log before they are applied. if writing fails between that check and the append, the move
+    // stays on the board without a record and append throws: the log (and every game on it) can't be recovered
+    // past that point anyway
+    void logMove(const std::string& move) {
+        m_logSequence = m_pMoveLog->append(m_logGameId, m_pBoard->getMoveNumber(), packMove(move));
+    }
+
+    void applyMove(std::string& move) {
+        if(m_pBoard->getGameResult() != GameResult::IN_PROGRESS) {
+            throw GameOverException("Game is Over. Game Result: " + std::string(gameResultToString[(int)m_pBoard->getGameResult()]) + ". Cannot make move. Move number: " + std::to_string(m_pBoard->getMoveNumber() + 1) + ". Move: " + move);
+        }
+
+        Move sMove;
+
+        {
+            LC_METRICS_SCOPE(PARSE);
+            validateMove(move, sMove);
+        }
+
+        // once the destinations of this position are known (e.g. after a piece pickup) a legal move is a single bit test,
+        // an illegal one still goes through the piece handlers to throw the matching exception
+        if(m_pBoard->hasLegalDestinations()) {
+            char choosenPiece = move.length() == 5 ? move[4] : 0;
+            bool isLegalMove;
+
+            {
+                LC_METRICS_SCOPE(PIECE_VALIDATION);
+                isLegalMove = m_pBoard->isLegal(sMove, choosenPiece);
+            }
+
+            if(isLegalMove) {
+                m_pBoard->applyTrustedMove(sMove, choosenPiece, true);
+                return;
+            }
+        }
 
-        if((move.length() != 4 && move.length() != 5) || file1 < 'a' || file1 > 'h' || file2 < 'a' || file2 > 'h' || rank1 < '1' || rank1 > '8' || rank2 < '1' || rank2 > '8') {
+        if(move.length() == 4)
+            m_pBoard->move(sMove);
+        else 
+            m_pBoard->promote(move[4], sMove);
+    }
+
+    void validateMove(std::string& move, Move& sMove) {
+        if(!parseMove(move, sMove)) {
             throw InvalidMoveException("The move is invalid. Make sure to follow UCI Notation. Move number: " + std::to_string(m_pBoard->getMoveNumber() + 1) + ". Move: " + move);
         }
+    }
+
+    static bool parseMove(const std::string& move, Move& sMove) {
+        if(move.length() != 4 && move.length() != 5) return false;
+
+        int file1 = move[0], rank1 = move[1], file2 = move[2], rank2 = move[3];
+
+        if(file1 < 'a' || file1 > 'h' || file2 < 'a' || file2 > 'h' || rank1 < '1' || rank1 > '8' || rank2 < '1' || rank2 > '8') return false;
 
         sMove.fromRow = rank1 - '1';
         sMove.fromCol = 'h' - file1;
@@ -124,10 +381,16 @@ private:
         sMove.fromSquare = sMove.fromRow*8 + sMove.fromCol;
         sMove.toSquare = sMove.toRow*8 + sMove.toCol;
         sMove.uciMove = move;
+
+        return true;
     }
 
 
     std::unique_ptr<Board> m_pBoard;
+
+    std::shared_ptr<MoveLog> m_pMoveLog;
+    uint32_t m_logGameId = 0;
+    uint64_t m_logSequence = 0;
 };
 
 
@@ -0,0 +1,115 @@
+#ifndef __LEGAL_CHESS_C_H__
+#define __LEGAL_CHESS_C_H__
+
+/*
+ * C interface to LegalChess for services that are not written in C++. No exception crosses it: every call returns an
+ * lc_status. Games are opaque handles, all output goes into buffers owned by the caller. The batch calls apply many
+ * moves of one game, or one move of many games, per call.
+ *
+ * A handle can be used by one thread at a time, different handles from any threads. lc_game_new may be called by
+ * several threads at once, also for the first game of the process.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define LC_API __declspec(dllexport)
+#else
+#define LC_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct lc_game lc_game;
+
+typedef enum lc_status {
+    LC_OK = 0,
+    LC_ERROR_INVALID_ARGUMENT,      /* null handle or buffer */
+    LC_ERROR_INVALID_MOVE,          /* not uci notation */
+    LC_ERROR_PLAYER_TURN,           /* a piece of the side not to move */
+    LC_ERROR_EMPTY_SQUARE,
+    LC_ERROR_INVALID_MOVE_PATTERN,  /* the piece can't move that way */
+    LC_ERROR_BLOCKED_MOVE,
+    LC_ERROR_KING_UNDER_CHECK,      /* the move leaves the king in check */
+    LC_ERROR_KING_CASTLE,
+    LC_ERROR_GAME_OVER,
+    LC_ERROR_BUFFER_TOO_SMALL,
+    LC_ERROR_OUT_OF_MEMORY,
+    LC_ERROR_INTERNAL
+} lc_status;
+
+/* same values as LC::GameResult */
+typedef enum lc_result {
+    LC_IN_PROGRESS = 0,
+    LC_WHITE_WON_BY_CHECKMATE,
+    LC_BLACK_WON_BY_CHECKMATE,
+    LC_STALEMATE,
+    LC_DRAW_BY_REPETITION,
+    LC_DRAW_BY_INSUFFICIENT_MATERIAL,
+    LC_DRAW_BY_50_HALF_MOVES
+} lc_result;
+
+/* buffers of these sizes always fit the output of lc_write_fen and lc_write_json */
+#define LC_FEN_BUFFER_SIZE 96
+#define LC_JSON_BUFFER_SIZE 192
+
+/* one move of one game for lc_apply_move_requests, status and result are written by the call */
+typedef struct lc_move_request {
+    lc_game* game;
+    const char* move;
+    size_t length;
+    lc_status status;
+    lc_result result;
+} lc_move_request;
+
+/* a name for the status, e.g. "LC_ERROR_GAME_OVER" */
+LC_API const char* lc_status_string(lc_status status);
+
+/* a new game in the starting position, released with lc_game_free */
+LC_API lc_status lc_game_new(lc_game** ppGame);
+
+/* a new game continuing from the position of pGame */
+LC_API lc_status lc_game_fork(const lc_game* pGame, lc_game** ppFork);
+
+/* null is ignored */
+LC_API void lc_game_free(lc_game* pGame);
+
+/* applies one uci move of length characters, pResult (may be null) receives the result after the move */
+LC_API lc_status lc_apply_move(lc_game* pGame, const char* move, size_t length, lc_result* pResult);
+
+/* applies the space separated uci moves in moves[0, length) in order and stops at the first one that is rejected.
+   pApplied (may be null) receives the number of moves applied, so the rejected move is the next one */
+LC_API lc_status lc_apply_moves_batch(lc_game* pGame, const char* moves, size_t length, size_t* pApplied, lc_result* pResult);
+
+/* applies every request, the games must be different handles. returns the number of requests that were accepted */
+LC_API size_t lc_apply_move_requests(lc_move_request* pRequests, size_t count);
+
+/* 1 in pLegal if lc_apply_move would accept the move, 0 otherwise */
+LC_API lc_status lc_is_legal(const lc_game* pGame, const char* move, size_t length, int* pLegal);
+
+LC_API lc_status lc_get_result(const lc_game* pGame, lc_result* pResult);
+
+/* plies played so far */
+LC_API lc_status lc_get_move_number(const lc_game* pGame, uint32_t* pMoveNumber);
+
+/* the FEN with a terminating NUL. pLength (may be null) receives its length without the NUL, also when the buffer is
+   too small */
+LC_API lc_status lc_write_fen(const lc_game* pGame, char* buffer, size_t size, size_t* pLength);
+
+/* the FENs of count games, the FEN of games[i] at buffer + i*LC_FEN_BUFFER_SIZE */
+LC_API lc_status lc_write_fen_batch(const lc_game* const* pGames, size_t count, char* buffer);
+
+/* the state as JSON, see LegalChess::writeJSON. same buffer rules as lc_write_fen */
+LC_API lc_status lc_write_json(const lc_game* pGame, char* buffer, size_t size, size_t* pLength);
+
+/* the message of the last rejected call on pGame, "" if there was none. valid until the next call on pGame */
+LC_API const char* lc_last_error(const lc_game* pGame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
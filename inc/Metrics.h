@@ -0,0 +1,168 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <cstdint>
+#include <atomic>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace LC {
+
+// phases of the move pipeline, a phase's time includes the phases nested inside it
+enum class MetricsPhase {
+    MAKE_MOVE,          // whole LegalChess::makeMove call
+    PARSE,              // UCI string to Move
+    PIECE_VALIDATION,   // move manager handlers (pattern, blocks and self check)
+    SELF_CHECK,         // is the mover's king under check after the move
+    REPETITION_HASH,    // zobrist hash and repetition table update
+    GAME_RESULT,        // checkmate, stalemate and draw detection
+    COUNT
+};
+
+enum class RejectReason {
+    INVALID_MOVE,
+    PLAYER_TURN,
+    EMPTY_SQUARE,
+    INVALID_MOVE_PATTERN,
+    BLOCKED_MOVE,
+    KING_UNDER_CHECK,
+    KING_CASTLE,
+    GAME_OVER,
+    OTHER,
+    COUNT
+};
+
+extern const char* const metricsPhaseToString[(int)MetricsPhase::COUNT];
+extern const char* const rejectReasonToString[(int)RejectReason::COUNT];
+
+struct PhaseSnapshot {
+    uint64_t samples;       // calls that were timed
+    uint64_t totalTicks;    // sum of the timed calls
+    uint64_t p50Ticks, p90Ticks, p99Ticks, maxTicks;
+};
+
+struct MetricsSnapshot {
+    bool enabled;
+    double ticksPerNanosecond;
+    uint64_t acceptedMoves;
+    uint64_t sampledMoves;
+    uint64_t positionCacheProbes, positionCacheHits;
+    PhaseSnapshot phases[(int)MetricsPhase::COUNT];
+    uint64_t rejected[(int)RejectReason::COUNT];
+};
+
+// each thread writes only to its own counters, a snapshot merges the counters of all threads
+class Metrics {
+public:
+    // latency buckets: 4 sub buckets per power of two of ticks
+    static constexpr int SUB_BUCKET_BITS = 2;
+    static constexpr int NUM_BUCKETS = 64 << SUB_BUCKET_BITS;
+
+    struct alignas(64) ThreadCounters {
+        std::atomic<uint64_t> acceptedMoves{0};
+        std::atomic<uint64_t> sampledMoves{0};
+        std::atomic<uint64_t> positionCacheProbes{0};
+        std::atomic<uint64_t> positionCacheHits{0};
+        std::atomic<uint64_t> phaseSamples[(int)MetricsPhase::COUNT] = {};
+        std::atomic<uint64_t> phaseTicks[(int)MetricsPhase::COUNT] = {};
+        std::atomic<uint64_t> histogram[(int)MetricsPhase::COUNT][NUM_BUCKETS] = {};
+        std::atomic<uint64_t> rejected[(int)RejectReason::COUNT] = {};
+    };
+
+    static MetricsSnapshot snapshot();
+    static void reset();
+
+    // time one in every interval moves (default 64), interval is rounded up to a power of two
+    static void setLatencySampleInterval(uint32_t interval);
+
+    static inline void beginMove() {
+        // moves in between samples only pay for this counter and the sampling flag checks
+        t_sampling = ((++t_moveTick) & m_sampleMask.load(std::memory_order_relaxed)) == 0;
+    }
+
+    static void recordSample(int phase, uint64_t startTicks, uint64_t endTicks);
+    static void recordRejection(const std::exception& e);
+
+    static inline void recordCacheProbe(bool hit) {
+        ThreadCounters& counters = local();
+
+        add(counters.positionCacheProbes, 1);
+        if(hit) add(counters.positionCacheHits, 1);
+    }
+
+    static inline uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static inline void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        // single writer per counter, no need for a locked add
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static inline ThreadCounters& local() {
+        if(t_pCounters == nullptr) registerThread();
+        return *t_pCounters;
+    }
+
+    static inline bool isSampling() {
+        return t_sampling;
+    }
+
+    static int bucketForTicks(uint64_t ticks);
+    static uint64_t ticksForBucket(int bucket);
+
+private:
+    // gives the counters of the thread back to the registry when it exits
+    struct ThreadRelease;
+
+    static void registerThread();
+
+    // defined inline so that every translation unit sees the constant initializer and can skip the tls wrapper call
+    static inline thread_local ThreadCounters* t_pCounters = nullptr;
+    static inline thread_local bool t_sampling = false;
+    static inline thread_local uint32_t t_moveTick = 0;
+    static inline std::atomic<uint32_t> m_sampleMask{63};
+};
+
+class ScopedPhaseTimer {
+public:
+    inline ScopedPhaseTimer(MetricsPhase phase) : m_phase((int)phase), m_start(Metrics::isSampling() ? Metrics::readTicks() : 0) {}
+
+    inline ~ScopedPhaseTimer() {
+        if(m_start != 0) Metrics::recordSample(m_phase, m_start, Metrics::readTicks());
+    }
+
+private:
+    int m_phase;
+    uint64_t m_start;
+};
+
+};
+
+#define LC_METRICS_CONCAT_INNER(a, b) a##b
+#define LC_METRICS_CONCAT(a, b) LC_METRICS_CONCAT_INNER(a, b)
+
+#ifdef LC_ENABLE_METRICS
+#define LC_METRICS_BEGIN_MOVE() LC::Metrics::beginMove()
+#define LC_METRICS_SCOPE(phase) LC::ScopedPhaseTimer LC_METRICS_CONCAT(lcPhaseTimer, __LINE__)(LC::MetricsPhase::phase)
+#define LC_METRICS_ACCEPT() LC::Metrics::add(LC::Metrics::local().acceptedMoves, 1)
+#define LC_METRICS_REJECT(e) LC::Metrics::recordRejection(e)
+#define LC_METRICS_CACHE_PROBE(hit) LC::Metrics::recordCacheProbe(hit)
+#else
+#define LC_METRICS_BEGIN_MOVE() ((void)0)
+#define LC_METRICS_SCOPE(phase) ((void)0)
+#define LC_METRICS_ACCEPT() ((void)0)
+#define LC_METRICS_REJECT(e) ((void)0)
+#define LC_METRICS_CACHE_PROBE(hit) ((void)0)
+#endif
+
+#endif
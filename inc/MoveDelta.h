@@ -0,0 +1,82 @@
+#ifndef __MOVE_DELTA_H__
+#define __MOVE_DELTA_H__
+
+#include "Board.h"
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace LC {
+
+// a MoveDelta on the wire, 2 to 4 bytes:
+//   byte 0: from square in bits 0-5, CheckType in bits 6-7
+//   byte 1: to square in bits 0-5, bit 6 set if a detail byte follows, bit 7 set if a result byte follows
+//   detail: captured Piece in bits 0-3 (EMPTY if none), kind in bits 4-5 (0 plain, 1 castling, 2 en passant,
+//           3 promotion), promotion piece in bits 6-7 (n, b, r, q). only sent for captures and special moves
+//   result: GameResult, only sent once the game is over
+// the rook squares of castling and the square of an en passant victim follow from the from and to squares
+constexpr size_t MAX_MOVE_DELTA_SIZE = 4;
+
+// writes the record (at most MAX_MOVE_DELTA_SIZE bytes) and returns its size
+size_t encodeMoveDelta(const MoveDelta& delta, uint8_t* pOutput);
+
+// reads one record from the front of pData, returns its size or 0 if size is too short or the bytes are not a record
+size_t decodeMoveDelta(const uint8_t* pData, size_t size, MoveDelta& delta);
+
+class MoveDeltaException : public std::runtime_error {
+public:
+    MoveDeltaException(std::string msg) : std::runtime_error(msg) {}
+};
+
+// the client side of the delta stream: follows a game from a FEN and the deltas of the moves after it. the moves are
+// trusted, only a delta that can't belong to the position (e.g. from an empty square) is rejected
+class MoveDeltaApplier {
+public:
+    // the starting position
+    MoveDeltaApplier();
+
+    // a game joined in progress, the check type of the position is not part of a FEN and starts as NO_CHECK
+    explicit MoveDeltaApplier(const std::string& fen);
+
+    // applies the record at the front of pData and returns its size
+    size_t apply(const uint8_t* pData, size_t size);
+
+    void apply(const MoveDelta& delta);
+
+    // same order as LegalChess::getBoardArray
+    inline const std::array<char, 64>& getBoardArray() const {
+        return m_board;
+    }
+
+    inline bool isWhiteTurn() const {
+        return m_whiteTurn;
+    }
+
+    // check type of the last move
+    inline CheckType getCheckType() const {
+        return m_checkType;
+    }
+
+    inline GameResult getGameResult() const {
+        return m_result;
+    }
+
+    std::string getFENString() const;
+
+private:
+    void loadFEN(const std::string& fen);
+
+    std::array<char, 64> m_board;
+    bool m_whiteTurn;
+    uint8_t m_castlingRights;   // as in BoardSnapshot
+    uint8_t m_enpassantSquare;
+    uint16_t m_halfMovesCount, m_movesCount;
+    CheckType m_checkType;
+    GameResult m_result;
+};
+
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef __MOVE_EXECUTOR_H__
+#define __MOVE_EXECUTOR_H__
+
+#include "LegalChess.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace LC {
+
+struct GameMove {
+    LegalChess* game;
+    std::string move;
+};
+
+struct MoveOutcome {
+    bool accepted;
+    GameResult result;      // result of the game after the move, or its unchanged result if the move was rejected
+    std::string error;      // message of the exception makeMove threw, empty if accepted
+};
+
+// applies the moves of many games with a pool of worker threads. moves of the same game are applied in
+// submission order, moves of different games run in parallel. every worker owns a queue of tasks and takes
+// tasks from the other queues once its own is empty, so uneven games don't leave workers idle
+class MoveExecutor {
+public:
+    // 0 uses one worker per core
+    explicit MoveExecutor(unsigned threadCount = 0);
+    ~MoveExecutor();
+
+    MoveExecutor(const MoveExecutor&) = delete;
+    MoveExecutor& operator=(const MoveExecutor&) = delete;
+
+    inline unsigned getThreadCount() const {
+        return m_workers.size();
+    }
+
+    // blocks until all moves are applied, the calling thread works as well. outcomes[i] belongs to pMoves[i].
+    // a game must not be used by other threads (or other submissions) until the call returns
+    void submitMoves(const GameMove* pMoves, size_t count, std::vector<MoveOutcome>& outcomes);
+
+    // onComplete is called once per move on the thread that applied it, in submission order for each game, and must not throw
+    void submitMoves(const GameMove* pMoves, size_t count, const std::function<void(size_t index, const MoveOutcome& outcome)>& onComplete);
+
+    inline void submitMoves(const std::vector<GameMove>& moves, std::vector<MoveOutcome>& outcomes) {
+        submitMoves(moves.data(), moves.size(), outcomes);
+    }
+
+private:
+    struct Job;
+
+    // moves order[begin] to order[end - 1] of a job, all moves of a game are in the same task
+    struct Task {
+        Job* pJob;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;     // the owner takes from the back, thieves from the front
+        std::thread thread;
+    };
+
+    void submit(Job& job);
+    void runWorker(unsigned index);
+    bool takeTask(unsigned index, Task& task);
+    void runTask(const Task& task);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // idle workers sleep until tasks are queued
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+    std::atomic<uint64_t> m_queuedTasks{0};
+    bool m_stopping = false;
+};
+
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef __MOVE_LOG_H__
+#define __MOVE_LOG_H__
+
+#include "PackedMove.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace LC {
+
+class LegalChess;
+
+class MoveLogException : public std::runtime_error {
+public:
+    MoveLogException(std::string msg) : std::runtime_error(msg) {}
+};
+
+// append only write ahead log of accepted moves. a background thread writes the queued records and syncs them
+// with one fdatasync per batch (group commit), the records queued while a batch is synced form the next batch.
+// every append returns a sequence number, the move is durable once getDurableSequence() reaches it
+class MoveLog {
+public:
+    // appends to the log at path, creates it if needed. a torn record at the end (crash during a write) is cut off.
+    // a batch starts at most commitBudget after its first record was queued, a longer budget collects more records
+    // per sync when the disk charges per sync rather than per byte, 0 starts as soon as the previous sync is done
+    MoveLog(const std::string& path, std::chrono::microseconds commitBudget = std::chrono::microseconds(0));
+
+    // writes and syncs the queued records
+    ~MoveLog();
+
+    MoveLog(const MoveLog&) = delete;
+    MoveLog& operator=(const MoveLog&) = delete;
+
+    // ply is the number of moves of the game including this one
+    uint64_t append(uint32_t gameId, uint16_t ply, PackedMove move);
+
+    // the game is not rebuilt by recover
+    uint64_t closeGame(uint32_t gameId);
+
+    // throws MoveLogException once writing failed, a game checks it before applying a move so that append doesn't
+    // throw for a move that is already on the board
+    void checkWritable() {
+        if(m_failed.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            throw MoveLogException(m_error);
+        }
+    }
+
+    // blocks until the record with this sequence number is on disk, throws MoveLogException if writing failed
+    void waitDurable(uint64_t sequence);
+
+    uint64_t getDurableSequence();
+
+    // rebuilds the games that were neither closed nor finished from the log at path, replaying their moves
+    // without validation (they were validated before they were logged). returns the number of records read,
+    // reading stops at the first damaged record
+    static uint64_t recover(const std::string& path, std::unordered_map<uint32_t, std::unique_ptr<LegalChess>>& games);
+
+    static constexpr size_t RECORD_SIZE = 12;
+
+private:
+    void runWriter();
+
+    // replays records (payloads without the check) and clears them
+    static void replayRecords(std::vector<uint64_t>& records, std::unordered_map<uint32_t, std::unique_ptr<LegalChess>>& games);
+
+    int m_fd;
+    std::chrono::microseconds m_commitBudget;
+
+    std::mutex m_mutex;
+    std::condition_variable m_recordsQueued;
+    std::condition_variable m_recordsDurable;
+
+    // guarded by m_mutex
+    std::vector<char> m_queue;
+    std::chrono::steady_clock::time_point m_oldestQueued;
+    uint64_t m_appendedSequence = 0;
+    uint64_t m_durableSequence = 0;
+    std::string m_error;
+    bool m_stopping = false;
+
+    // set with m_error, read without the lock
+    std::atomic<bool> m_failed{false};
+
+    std::thread m_writer;
+};
+
+};
+
+#endif
@@ -7,44 +7,43 @@ namespace LC {
 
 struct Move;
 class Board;
-enum class CheckType;
 enum class Piece;
 
 class MoveManager {
 public:
-    virtual CheckType handleMove(bool isPieceWhite, const Move& move, Board& board) = 0;
+    virtual void handleMove(bool isPieceWhite, const Move& move, Board& board) = 0;
 };
 
 class PawnMoveManager : public MoveManager {
 public:
-    CheckType handleMove(bool isPieceWhite, const Move& move, Board& board) override;
-    CheckType handlePromotion(Piece newPiece, bool isPieceWhite, const Move& move, Board& board);
+    void handleMove(bool isPieceWhite, const Move& move, Board& board) override;
+    void handlePromotion(Piece newPiece, bool isPieceWhite, const Move& move, Board& board);
 };
 
 class KnightMoveManager : public MoveManager {
 public:
-    CheckType handleMove(bool isPieceWhite, const Move& move, Board& board) override;
+    void handleMove(bool isPieceWhite, const Move& move, Board& board) override;
 };
 
 class BishopMoveManager : public MoveManager {
 public:
-    CheckType handleMove(bool isPieceWhite, const Move& move, Board& board) override;
+    void handleMove(bool isPieceWhite, const Move& move, Board& board) override;
 };
 
 class RookMoveManager : public MoveManager {
 public:
-    CheckType handleMove(bool isPieceWhite, const Move& move, Board& board) override;
+    void handleMove(bool isPieceWhite, const Move& move, Board& board) override;
 };
 
 class QueenMoveManager : public MoveManager {
 public:
-    CheckType handleMove(bool isPieceWhite, const Move& move, Board& board) override;
+    void handleMove(bool isPieceWhite, const Move& move, Board& board) override;
 };
 
 class KingMoveManager : public MoveManager {
 public:
-    CheckType handleMove(bool isPieceWhite, const Move& move, Board& board) override;
-    CheckType handleKingCastle(bool shortSide, bool isPieceWhite, Board& board);
+    void handleMove(bool isPieceWhite, const Move& move, Board& board) override;
+    void handleKingCastle(bool shortSide, bool isPieceWhite, Board& board);
 };
 
 class MoveManagerStore {
@@ -60,7 +59,6 @@ private:
     MoveManagerStore();
 
     std::shared_ptr<MoveManager> m_MoveManagers[6];
-    static std::shared_ptr<const MoveManagerStore> m_pInstance;
 };
 
 };
@@ -0,0 +1,120 @@
+#ifndef __MOVE_QUEUE_H__
+#define __MOVE_QUEUE_H__
+
+#include "LegalChess.h"
+#include "MoveExecutor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace LC {
+
+class MoveQueueException : public std::runtime_error {
+public:
+    MoveQueueException(std::string msg) : std::runtime_error(msg) {}
+};
+
+enum class SubmitStatus {
+    QUEUED,     // the queue already waits for its owner
+    SCHEDULE,   // the queue was idle, the caller drains it or hands it to the owner of the game
+    FULL        // not queued, the owner is capacity moves behind
+};
+
+// where the owner of a game reports a queued move. the submitter keeps it alive until isDone
+class MoveCompletion {
+public:
+    MoveCompletion() = default;
+
+    MoveCompletion(const MoveCompletion&) = delete;
+    MoveCompletion& operator=(const MoveCompletion&) = delete;
+
+    inline bool isDone() const {
+        return m_done.load(std::memory_order_acquire);
+    }
+
+    // spins for a short while, then yields until the move is applied
+    void wait() const;
+
+    // valid once isDone
+    inline const MoveOutcome& getOutcome() const {
+        return m_outcome;
+    }
+
+    // position of the move in the order the queue applied its moves, from 0
+    inline uint64_t getSequence() const {
+        return m_sequence;
+    }
+
+    // before the completion is submitted again
+    inline void reset() {
+        m_done.store(false, std::memory_order_relaxed);
+    }
+
+private:
+    friend class MoveQueue;
+
+    MoveOutcome m_outcome;
+    uint64_t m_sequence = 0;
+    std::atomic<bool> m_done{false};
+};
+
+// bounded multi producer, single consumer queue of the moves of one game. any thread submits without a lock, one
+// thread at a time drains the queue: it applies the moves in the order they took their slots, with the game's
+// makeMove, and fills their completions. the drainer is the owner of the game (e.g. its event loop or executor), or,
+// without an owner, the submitter that got SCHEDULE. moves of a game never wait on a lock
+class MoveQueue {
+public:
+    // the longest move kept as it was submitted, a longer one is kept truncated and rejected as invalid anyway
+    static constexpr size_t MAX_MOVE_LENGTH = 15;
+
+    // capacity is rounded up to a power of two. the game must outlive the queue
+    explicit MoveQueue(LegalChess& game, size_t capacity = 64);
+
+    MoveQueue(const MoveQueue&) = delete;
+    MoveQueue& operator=(const MoveQueue&) = delete;
+
+    // any thread. pCompletion may be nullptr if the outcome is not needed, it is not touched when the queue is full
+    SubmitStatus submit(const std::string& uciMove, MoveCompletion* pCompletion = nullptr);
+
+    // the thread the queue was handed to by SCHEDULE. applies the queued moves in order, at most maxMoves, and returns
+    // their number. the queue is idle again when drain returns less than maxMoves, the next submit returns SCHEDULE.
+    // after maxMoves the queue stays scheduled and the same thread calls drain again
+    size_t drain(size_t maxMoves = SIZE_MAX);
+
+    // for the drainer, between drains
+    inline LegalChess& getGame() {
+        return m_game;
+    }
+
+    inline size_t getCapacity() const {
+        return m_mask + 1;
+    }
+
+private:
+    // sequence is the position of the move for a filled slot plus one, the position of the next lap's move for a
+    // free slot. slots are not padded to cache lines, a queue per game has to stay small
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        MoveCompletion* pCompletion;
+        uint8_t length;
+        char move[MAX_MOVE_LENGTH];
+    };
+
+    void apply(Slot& slot);
+
+    LegalChess& m_game;
+    std::unique_ptr<Slot[]> m_pSlots;
+    uint64_t m_mask;
+
+    // written by the producers and by the owner, on separate cache lines
+    alignas(64) std::atomic<uint64_t> m_tail{0};
+    alignas(64) std::atomic<bool> m_scheduled{false};
+    alignas(64) uint64_t m_head = 0;
+};
+
+};
+
+#endif
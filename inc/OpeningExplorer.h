@@ -0,0 +1,96 @@
+#ifndef __OPENING_EXPLORER_H__
+#define __OPENING_EXPLORER_H__
+
+#include "LegalChess.h"
+#include "PackedMove.h"
+
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LC {
+
+class OpeningExplorerException : public std::runtime_error {
+public:
+    OpeningExplorerException(std::string msg) : std::runtime_error(msg) {}
+};
+
+// how the games that played a move from a position ended, games also counts games without a known result
+struct ExplorerMove {
+    PackedMove move;
+    uint32_t games;
+    uint32_t whiteWins;
+    uint32_t draws;
+    uint32_t blackWins;
+};
+
+struct OpeningExplorerStats {
+    uint64_t games = 0;
+    uint64_t positions = 0;     // positions kept in the file
+    uint64_t moves = 0;         // moves kept in the file
+};
+
+// per position move statistics of a game archive. positions are keyed by getPositionKey().hash, so transpositions
+// share their statistics. the file holds the positions sorted by key and the moves of every position sorted by
+// games, and is used straight from a read only memory map
+class OpeningExplorer {
+public:
+    OpeningExplorer() = default;
+    ~OpeningExplorer();
+
+    OpeningExplorer(const OpeningExplorer&) = delete;
+    OpeningExplorer& operator=(const OpeningExplorer&) = delete;
+
+    // one game of space separated uci moves per line, optionally followed by its result (1-0, 0-1, 1/2-1/2 or *).
+    // without one the result is the one the replay detects. the first maxDepth moves of every game are counted up to
+    // its first illegal move, positions reached by fewer than minGames games are left out. every thread counts into
+    // its own table and the tables are merged at the end. 0 threads uses one per core
+    static OpeningExplorerStats build(std::istream& games, const std::string& path, int maxDepth = 30, uint32_t minGames = 2, unsigned threadCount = 0);
+
+    // maps a file written by build, throws OpeningExplorerException if it is not an explorer of this version
+    void load(const std::string& path);
+
+    inline uint64_t getPositionCount() const {
+        return m_pHeader ? m_pHeader->positionCount : 0;
+    }
+
+    // replaces the content of moves with the moves played from the position, most played first, and returns their number
+    size_t find(uint64_t key, std::vector<ExplorerMove>& moves) const;
+
+    inline size_t find(const LegalChess& game, std::vector<ExplorerMove>& moves) const {
+        return find(game.getPositionKey().hash, moves);
+    }
+
+    // the move counters of the FEN don't matter
+    size_t find(const std::string& fen, std::vector<ExplorerMove>& moves) const;
+
+private:
+    static constexpr char MAGIC[8] = {'L', 'C', 'E', 'X', 'P', 'L', '0', '1'};
+
+    struct Header {
+        char magic[8];
+        uint64_t positionCount;
+        uint64_t moveCount;
+    };
+
+    struct Position {
+        uint64_t key;
+        uint32_t firstMove;
+        uint32_t moveCount;
+    };
+
+    void release();
+
+    void* m_pMapping = nullptr;
+    size_t m_mappingSize = 0;
+
+    const Header* m_pHeader = nullptr;
+    const Position* m_pPositions = nullptr;
+    const ExplorerMove* m_pMoves = nullptr;
+};
+
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __OPENING_TRIE_H__
+#define __OPENING_TRIE_H__
+
+#include "Board.h"
+#include "PackedMove.h"
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace LC {
+
+class OpeningTrieException : public std::runtime_error {
+public:
+    OpeningTrieException(std::string msg) : std::runtime_error(msg) {}
+};
+
+// immutable trie of the opening moves of a game corpus, every node holds the board after its move sequence.
+// the nodes are stored in one flat buffer (children of a node next to each other, sorted by move), so a
+// saved trie is used straight from a read only memory map without parsing
+class OpeningTrie {
+public:
+    OpeningTrie() = default;
+    ~OpeningTrie();
+
+    OpeningTrie(const OpeningTrie&) = delete;
+    OpeningTrie& operator=(const OpeningTrie&) = delete;
+
+    // one game of space separated uci moves per line. keeps the maxNodes most played move sequences of at most
+    // maxDepth moves that occur in at least minGames games, a game stops adding nodes at its first illegal move
+    void build(std::istream& games, size_t maxNodes, int maxDepth = 20, int minGames = 2);
+
+    void save(const std::string& path) const;
+
+    // maps a file written by save, throws OpeningTrieException if it is not a trie of this version
+    void load(const std::string& path);
+
+    // number of nodes including the start position, 0 before build or load
+    inline size_t getNodeCount() const {
+        return m_pHeader ? m_pHeader->nodeCount : 0;
+    }
+
+    // loads the board after the longest prefix of moves stored in the trie and returns the length of that prefix,
+    // 0 leaves the board untouched
+    size_t restore(const std::vector<std::string>& moves, Board& board) const;
+
+private:
+    // 02: an en passant square no pawn can capture on is not part of the snapshot hash anymore
+    static constexpr char MAGIC[8] = {'L', 'C', 'T', 'R', 'I', 'E', '0', '2'};
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    struct Header {
+        char magic[8];
+        uint32_t nodeSize;
+        uint32_t nodeCount;
+    };
+
+    struct Node {
+        uint32_t firstChild;
+        uint32_t parent;
+        uint16_t childCount;
+        PackedMove move;
+        BoardSnapshot snapshot;
+    };
+
+    void release();
+    void attach(const char* pData, size_t size);
+
+    // one of the two holds the nodes, the buffer after build and the mapping after load
+    std::vector<char> m_buffer;
+    void* m_pMapping = nullptr;
+    size_t m_mappingSize = 0;
+
+    const Header* m_pHeader = nullptr;
+    const Node* m_pNodes = nullptr;
+};
+
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef __PACKED_MOVE_H__
+#define __PACKED_MOVE_H__
+
+#include <cstdint>
+#include <string>
+
+namespace LC {
+
+// from square in bits 0-5, to square in bits 6-11, promotion piece in bits 12-14 (0 none, 1 n, 2 b, 3 r, 4 q).
+// 0 is never a valid move since from and to would be the same square
+typedef uint16_t PackedMove;
+
+// choosenPiece is 0 for non promotion moves
+inline PackedMove packMove(int fromSquare, int toSquare, char choosenPiece) {
+    int promotion = choosenPiece == 'n' ? 1 : choosenPiece == 'b' ? 2 : choosenPiece == 'r' ? 3 : choosenPiece == 'q' ? 4 : 0;
+
+    return (PackedMove)(fromSquare | (toSquare << 6) | (promotion << 12));
+}
+
+// 0 if the move can't be parsed as uci
+inline PackedMove packMove(const char* uciMove, size_t length) {
+    if(length != 4 && length != 5) return 0;
+
+    char file1 = uciMove[0], rank1 = uciMove[1], file2 = uciMove[2], rank2 = uciMove[3];
+
+    if(file1 < 'a' || file1 > 'h' || file2 < 'a' || file2 > 'h' || rank1 < '1' || rank1 > '8' || rank2 < '1' || rank2 > '8') return 0;
+
+    int fromSquare = (rank1 - '1')*8 + ('h' - file1);
+    int toSquare = (rank2 - '1')*8 + ('h' - file2);
+    int promotion = 0;
+
+    if(length == 5) {
+        switch(uciMove[4]) {
+            case 'n': promotion = 1; break;
+            case 'b': promotion = 2; break;
+            case 'r': promotion = 3; break;
+            case 'q': promotion = 4; break;
+            default: return 0;
+        }
+    }
+
+    if(fromSquare == toSquare) return 0;
+
+    return (PackedMove)(fromSquare | (toSquare << 6) | (promotion << 12));
+}
+
+inline PackedMove packMove(const std::string& uciMove) {
+    return packMove(uciMove.data(), uciMove.length());
+}
+
+inline std::string unpackMove(PackedMove move) {
+    int fromSquare = move & 63, toSquare = (move >> 6) & 63, promotion = (move >> 12) & 7;
+
+    std::string uciMove = {(char)('h' - fromSquare%8), (char)('1' + fromSquare/8), (char)('h' - toSquare%8), (char)('1' + toSquare/8)};
+    if(promotion != 0) uciMove.push_back(" nbrq"[promotion]);
+
+    return uciMove;
+}
+
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef __POSITION_CACHE_H__
+#define __POSITION_CACHE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace LC {
+
+// facts that only depend on the position (pieces, side to move, castling rights and enpassant square)
+struct PositionFacts {
+    uint64_t checkers;          // opponent pieces giving check to the side to move
+    uint64_t movablePieces;     // pieces of the side to move with at least one legal move, valid with hasDestinationSummary
+    uint8_t destinationCount;   // sum of the legal destinations of all pieces, valid with hasDestinationSummary
+    bool hasLegalMove;
+    bool hasDestinationSummary;
+
+    inline bool isInCheck() const {
+        return checkers != 0;
+    }
+
+    inline bool isCheckmate() const {
+        return checkers != 0 && !hasLegalMove;
+    }
+
+    inline bool isStalemate() const {
+        return checkers == 0 && !hasLegalMove;
+    }
+};
+
+// process wide, fixed size table of position facts shared by all boards, disabled until resized.
+// entries are read and written without locks, a key check word xor-ed with the data words
+// rejects entries torn by a concurrent store, so a probe either sees a whole entry or misses
+class PositionCache {
+public:
+    static std::shared_ptr<PositionCache> getInstance();
+
+    // sizeInBytes is rounded down to a power of two number of entries, 0 disables the cache.
+    // not safe while other threads use the cache, size it before the games start
+    void resize(size_t sizeInBytes);
+
+    inline bool isEnabled() const {
+        return m_pEntries != nullptr;
+    }
+
+    inline size_t getEntryCount() const {
+        return isEnabled() ? m_mask + 1 : 0;
+    }
+
+    // the verification key guards against two positions that share the zobrist key
+    bool probe(uint64_t key, uint32_t verificationKey, PositionFacts& facts) const;
+    void store(uint64_t key, uint32_t verificationKey, const PositionFacts& facts);
+
+    void clear();
+
+    static constexpr size_t ENTRY_SIZE = 32;
+
+private:
+    PositionCache() = default;
+
+    struct alignas(ENTRY_SIZE) Entry {
+        std::atomic<uint64_t> check{0};     // key ^ checkers ^ movablePieces ^ info
+        std::atomic<uint64_t> checkers{0};
+        std::atomic<uint64_t> movablePieces{0};
+        std::atomic<uint64_t> info{0};      // verification key, destination count and flags
+    };
+
+    std::unique_ptr<Entry[]> m_pEntries;
+    uint64_t m_mask = 0;
+};
+
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef __POSITION_HISTORY_H__
+#define __POSITION_HISTORY_H__
+
+#include "PackedMove.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LC {
+
+// the moves of a game and the positions after them, for repetition detection. stored as a list of chunks,
+// newest first. a copy shares all chunks with the original, a chunk is only written while one history uses it,
+// so copying costs the same at any game length and both copies go on independently
+class PositionHistory {
+public:
+    // a copy taken when the newest chunk is full shares every chunk, the next push starts a new one anyway
+    static constexpr uint32_t CHUNK_SIZE = 16;
+
+    inline void push(uint64_t positionHash, PackedMove move) {
+        // a shared or full tail is frozen, continue in a new chunk
+        if(!m_pTail || m_pTail->size == CHUNK_SIZE || m_pTail.use_count() != 1) {
+            auto pChunk = std::make_shared<Chunk>();
+            pChunk->pPrevious = std::move(m_pTail);
+            pChunk->size = 0;
+            m_pTail = std::move(pChunk);
+        }
+        else ownTail();
+
+        m_pTail->positionHashes[m_pTail->size] = positionHash;
+        m_pTail->moves[m_pTail->size] = move;
+        m_pTail->size++;
+    }
+
+    // removes the newest position, the history must not be empty
+    inline void pop() {
+        // a shared tail is still needed by the other history, shrink a copy of it
+        if(m_pTail.use_count() != 1) m_pTail = std::make_shared<Chunk>(*m_pTail);
+        else ownTail();
+
+        if(--m_pTail->size == 0) {
+            std::shared_ptr<Chunk> pPrevious = std::move(m_pTail->pPrevious);
+            m_pTail = std::move(pPrevious);
+        }
+    }
+
+    inline void clear() {
+        m_pTail.reset();
+    }
+
+    // occurrences of positionHash among the newest plies positions, stepping two plies at a time (positions
+    // with the other side to move never match). positionHash is expected to be the newest position
+    inline int countRepetitions(uint64_t positionHash, int plies) const {
+        int count = 0, skip = 0;
+
+        for(const Chunk* pChunk = m_pTail.get(); pChunk != nullptr && plies > 0; pChunk = pChunk->pPrevious.get()) {
+            int index = (int)pChunk->size - 1 - skip;
+
+            for(; index >= 0 && plies > 0; index -= 2, plies -= 2) {
+                if(pChunk->positionHashes[index] == positionHash) count++;
+            }
+
+            // index is -1 or -2, a chunk may have an odd size
+            skip = -1 - index;
+        }
+
+        return count;
+    }
+
+    // 0 if the history is empty
+    inline PackedMove getLastMove() const {
+        return m_pTail ? m_pTail->moves[m_pTail->size - 1] : 0;
+    }
+
+    // uci moves from the oldest, space separated
+    inline std::string getMoves() const {
+        std::vector<const Chunk*> chunks;
+        for(const Chunk* pChunk = m_pTail.get(); pChunk != nullptr; pChunk = pChunk->pPrevious.get()) chunks.push_back(pChunk);
+
+        std::string moves;
+
+        for(auto it = chunks.rbegin(); it != chunks.rend(); ++it) {
+            for(uint32_t index = 0; index < (*it)->size; index++) {
+                if(!moves.empty()) moves.push_back(' ');
+                moves += unpackMove((*it)->moves[index]);
+            }
+        }
+
+        return moves;
+    }
+
+private:
+    struct Chunk {
+        std::shared_ptr<Chunk> pPrevious;
+        uint32_t size;
+        uint64_t positionHashes[CHUNK_SIZE];
+        PackedMove moves[CHUNK_SIZE];
+    };
+
+    // the tail is only used by this history. use_count is a relaxed load, a fork on another thread may just have
+    // dropped its reference: the fence orders our writes after its reads of the chunk, which come before its release
+    // of the count
+    inline void ownTail() const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    std::shared_ptr<Chunk> m_pTail;
+};
+
+};
+
+#endif
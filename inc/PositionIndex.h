@@ -0,0 +1,105 @@
+#ifndef __POSITION_INDEX_H__
+#define __POSITION_INDEX_H__
+
+#include "LegalChess.h"
+
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LC {
+
+class PositionIndexException : public std::runtime_error {
+public:
+    PositionIndexException(std::string msg) : std::runtime_error(msg) {}
+};
+
+// a game that reached a position, ply 0 is the starting position
+struct PositionPosting {
+    uint32_t gameId;
+    uint16_t ply;
+};
+
+struct PositionIndexStats {
+    uint64_t games = 0;
+    uint64_t postings = 0;
+    uint64_t positions = 0;     // distinct position keys
+    uint64_t runs = 0;          // sorted runs spilled to disk while building
+};
+
+// inverted index from position keys (getPositionKey().hash) to the games and plies that reached them. the postings
+// of a key are sorted by game and ply and delta coded with varints, keys are grouped in blocks behind a sorted
+// directory, so a saved index is queried straight from a read only memory map
+class PositionIndex {
+public:
+    PositionIndex() = default;
+    ~PositionIndex();
+
+    PositionIndex(const PositionIndex&) = delete;
+    PositionIndex& operator=(const PositionIndex&) = delete;
+
+    // one game of space separated uci moves per line, the game id is the line number from 0. every game is replayed
+    // up to its first illegal move. threads sort their postings in buffers that share memoryBudget bytes, a full
+    // buffer is written to a run file next to path and the runs are merged into the index at the end. 0 threads
+    // uses one per core
+    static PositionIndexStats build(std::istream& games, const std::string& path, size_t memoryBudget = 256 << 20, unsigned threadCount = 0);
+
+    // maps a file written by build, throws PositionIndexException if it is not an index of this version
+    void load(const std::string& path);
+
+    inline uint64_t getPositionCount() const {
+        return m_pHeader ? m_pHeader->positionCount : 0;
+    }
+
+    inline uint64_t getPostingCount() const {
+        return m_pHeader ? m_pHeader->postingCount : 0;
+    }
+
+    // replaces the content of postings with the games that reached the position and returns their number
+    size_t find(uint64_t key, std::vector<PositionPosting>& postings) const;
+
+    inline size_t find(const LegalChess& game, std::vector<PositionPosting>& postings) const {
+        return find(game.getPositionKey().hash, postings);
+    }
+
+    inline size_t find(const std::string& fen, std::vector<PositionPosting>& postings) const {
+        return find(computeKey(fen), postings);
+    }
+
+    // the key a game in the position of the FEN has, the move counters don't matter
+    static uint64_t computeKey(const std::string& fen);
+
+private:
+    static constexpr char MAGIC[8] = {'L', 'C', 'P', 'I', 'N', 'D', '0', '1'};
+
+    // keys per directory entry
+    static constexpr uint32_t BLOCK_KEYS = 64;
+
+    struct Header {
+        char magic[8];
+        uint64_t positionCount;
+        uint64_t postingCount;
+        uint64_t blockCount;
+        uint64_t directoryOffset;   // the blocks are between the header and the directory
+    };
+
+    struct DirectoryEntry {
+        uint64_t firstKey;
+        uint64_t offset;
+    };
+
+    void release();
+
+    void* m_pMapping = nullptr;
+    size_t m_mappingSize = 0;
+
+    const Header* m_pHeader = nullptr;
+    const DirectoryEntry* m_pDirectory = nullptr;
+    const uint8_t* m_pData = nullptr;
+};
+
+};
+
+#endif
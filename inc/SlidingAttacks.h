@@ -0,0 +1,146 @@
+#ifndef __SLIDING_ATTACKS_H__
+#define __SLIDING_ATTACKS_H__
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace LC {
+
+// table free attack generation with kogge-stone fills, the functions are templates so the same
+// code works on a single uint64_t and on a gcc vector of bitboards (one board per lane)
+
+// square = row*8 + col with col 0 on the h-file, shifting left by one moves towards the a-file
+constexpr uint64_t NOT_COLUMN_0 = ~0x0101010101010101ULL;
+constexpr uint64_t NOT_COLUMN_7 = ~0x8080808080808080ULL;
+
+template<int SHIFT, class T>
+inline T shiftBy(T bitBoard) {
+    if constexpr (SHIFT > 0) return bitBoard << SHIFT;
+    else return bitBoard >> -SHIFT;
+}
+
+// squares reached by sliding from the pieces in one direction until (and including) the first blocker,
+// the wrap mask removes the squares that a shift moved around the board edge
+template<int SHIFT, uint64_t WRAP, class T>
+inline T slideAttacks(T pieces, T empty) {
+    empty &= WRAP;
+
+    pieces |= empty & shiftBy<SHIFT>(pieces);
+    empty &= shiftBy<SHIFT>(empty);
+    pieces |= empty & shiftBy<2*SHIFT>(pieces);
+    empty &= shiftBy<2*SHIFT>(empty);
+    pieces |= empty & shiftBy<4*SHIFT>(pieces);
+
+    return shiftBy<SHIFT>(pieces) & WRAP;
+}
+
+template<class T>
+inline T rookAttacks(T pieces, T empty) {
+    return slideAttacks<8, ~0ULL>(pieces, empty) | slideAttacks<-8, ~0ULL>(pieces, empty) |
+           slideAttacks<1, NOT_COLUMN_0>(pieces, empty) | slideAttacks<-1, NOT_COLUMN_7>(pieces, empty);
+}
+
+template<class T>
+inline T bishopAttacks(T pieces, T empty) {
+    return slideAttacks<9, NOT_COLUMN_0>(pieces, empty) | slideAttacks<7, NOT_COLUMN_7>(pieces, empty) |
+           slideAttacks<-7, NOT_COLUMN_0>(pieces, empty) | slideAttacks<-9, NOT_COLUMN_7>(pieces, empty);
+}
+
+template<class T>
+inline T knightAttacks(T pieces) {
+    constexpr uint64_t NOT_COLUMNS_01 = ~0x0303030303030303ULL, NOT_COLUMNS_67 = ~0xC0C0C0C0C0C0C0C0ULL;
+
+    return ((shiftBy<17>(pieces) | shiftBy<-15>(pieces)) & NOT_COLUMN_0) | ((shiftBy<15>(pieces) | shiftBy<-17>(pieces)) & NOT_COLUMN_7) |
+           ((shiftBy<10>(pieces) | shiftBy<-6>(pieces)) & NOT_COLUMNS_01) | ((shiftBy<6>(pieces) | shiftBy<-10>(pieces)) & NOT_COLUMNS_67);
+}
+
+template<class T>
+inline T kingAttacks(T pieces) {
+    T sideways = (shiftBy<1>(pieces) & NOT_COLUMN_0) | (shiftBy<-1>(pieces) & NOT_COLUMN_7);
+    T row = sideways | pieces;
+
+    return sideways | shiftBy<8>(row) | shiftBy<-8>(row);
+}
+
+// captures of white pawns, black pawns capture with the mirrored board
+template<class T>
+inline T whitePawnAttacks(T pawns) {
+    return (shiftBy<9>(pawns) & NOT_COLUMN_0) | (shiftBy<7>(pawns) & NOT_COLUMN_7);
+}
+
+// attacks of a single slider, used instead of the occupancy tables with LC_TABLE_FREE_SLIDERS.
+// with avx2 the four directions of the piece fill in the lanes of one register, each lane shifts by its own count
+// (a count of 64 or more gives 0, so every lane shifts one way only)
+#if defined(__AVX2__)
+
+inline uint64_t slideAttacks4(uint64_t piece, uint64_t occupancy, __m256i leftShifts, __m256i rightShifts, __m256i wraps) {
+    __m256i pieces = _mm256_set1_epi64x(piece);
+    __m256i empty = _mm256_and_si256(_mm256_set1_epi64x(~occupancy), wraps);
+
+    auto shift = [&](__m256i bitBoards, int step) {
+        return _mm256_or_si256(_mm256_sllv_epi64(bitBoards, _mm256_slli_epi64(leftShifts, step)), _mm256_srlv_epi64(bitBoards, _mm256_slli_epi64(rightShifts, step)));
+    };
+
+    // same fill as slideAttacks, shifting by 1, 2 and 4 steps
+    pieces = _mm256_or_si256(pieces, _mm256_and_si256(empty, shift(pieces, 0)));
+    empty = _mm256_and_si256(empty, shift(empty, 0));
+    pieces = _mm256_or_si256(pieces, _mm256_and_si256(empty, shift(pieces, 1)));
+    empty = _mm256_and_si256(empty, shift(empty, 1));
+    pieces = _mm256_or_si256(pieces, _mm256_and_si256(empty, shift(pieces, 2)));
+    pieces = _mm256_and_si256(shift(pieces, 0), wraps);
+
+    __m128i half = _mm_or_si128(_mm256_castsi256_si128(pieces), _mm256_extracti128_si256(pieces, 1));
+
+    return _mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1);
+}
+
+inline uint64_t rookAttacksFrom(int square, uint64_t occupancy) {
+    return slideAttacks4(1ULL << square, occupancy, _mm256_setr_epi64x(8, 64, 1, 64), _mm256_setr_epi64x(64, 8, 64, 1),
+                         _mm256_setr_epi64x(~0ULL, ~0ULL, NOT_COLUMN_0, NOT_COLUMN_7));
+}
+
+inline uint64_t bishopAttacksFrom(int square, uint64_t occupancy) {
+    return slideAttacks4(1ULL << square, occupancy, _mm256_setr_epi64x(9, 7, 64, 64), _mm256_setr_epi64x(64, 64, 7, 9),
+                         _mm256_setr_epi64x(NOT_COLUMN_0, NOT_COLUMN_7, NOT_COLUMN_0, NOT_COLUMN_7));
+}
+
+#else
+
+// hyperbola quintessence: o ^ (o - 2r) on the line finds the first blocker above the piece, the same on the byte
+// swapped board the first one below. works on files and diagonals, a rank is not changed by the swap
+inline uint64_t lineAttacks(uint64_t piece, uint64_t occupancy, uint64_t line) {
+    uint64_t forward = occupancy & line;
+    uint64_t reverse = __builtin_bswap64(forward);
+
+    forward -= piece;
+    reverse -= __builtin_bswap64(piece);
+
+    return (forward ^ __builtin_bswap64(reverse)) & line;
+}
+
+inline uint64_t rookAttacksFrom(int square, uint64_t occupancy) {
+    uint64_t piece = 1ULL << square, empty = ~occupancy;
+    uint64_t file = (0x0101010101010101ULL << (square%8)) ^ piece;
+
+    return lineAttacks(piece, occupancy, file) | slideAttacks<1, NOT_COLUMN_0>(piece, empty) | slideAttacks<-1, NOT_COLUMN_7>(piece, empty);
+}
+
+inline uint64_t bishopAttacksFrom(int square, uint64_t occupancy) {
+    uint64_t piece = 1ULL << square;
+
+    // the diagonals through h1 and a1, moved up or down to the square's row
+    int diagonalRow = square/8 - square%8, antiDiagonalRow = square/8 + square%8 - 7;
+    uint64_t diagonal = diagonalRow >= 0 ? 0x8040201008040201ULL << (8*diagonalRow) : 0x8040201008040201ULL >> (-8*diagonalRow);
+    uint64_t antiDiagonal = antiDiagonalRow >= 0 ? 0x0102040810204080ULL << (8*antiDiagonalRow) : 0x0102040810204080ULL >> (-8*antiDiagonalRow);
+
+    return lineAttacks(piece, occupancy, diagonal ^ piece) | lineAttacks(piece, occupancy, antiDiagonal ^ piece);
+}
+
+#endif
+
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef __VARIATION_TREE_H__
+#define __VARIATION_TREE_H__
+
+#include "LegalChess.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LC {
+
+class VariationTreeException : public std::runtime_error {
+public:
+    VariationTreeException(std::string msg) : std::runtime_error(msg) {}
+};
+
+// the lines of an analysis session as one tree of moves: a line shares every move before its branch with the line it
+// branches from. the nodes live in one array and hold a packed move, every snapshotInterval plies a node also keeps a
+// BoardSnapshot. a single board walks the tree: it takes moves back to the common ancestor and makes the moves down
+// to the target, or starts from the nearest snapshot when that is shorter
+class VariationTree {
+public:
+    typedef uint32_t NodeId;
+
+    static constexpr NodeId ROOT = 0;
+    static constexpr NodeId NO_NODE = UINT32_MAX;
+
+    // 0 keeps no snapshots
+    explicit VariationTree(int snapshotInterval = 16);
+
+    VariationTree(const VariationTree&) = delete;
+    VariationTree& operator=(const VariationTree&) = delete;
+
+    // the child of parent for the uci move, created if it is new. the move is validated like LegalChess::makeMove and
+    // throws the same exceptions. the board ends on the child
+    NodeId addMove(NodeId parent, const std::string& uciMove);
+
+    // adds the space separated uci moves below parent and returns the last node
+    NodeId addLine(NodeId parent, const std::string& uciMoves);
+
+    // the game at node, with the move and repetition history of its line and its result
+    const LegalChess& goTo(NodeId node);
+
+    // the node of the last goTo or addMove
+    inline NodeId getCurrentNode() const {
+        return m_path.back();
+    }
+
+    inline const LegalChess& getGame() const {
+        return *m_pGame;
+    }
+
+    inline size_t getNodeCount() const {
+        return m_nodes.size();
+    }
+
+    // NO_NODE for the root
+    inline NodeId getParent(NodeId node) const {
+        return m_nodes.at(node).parent;
+    }
+
+    // children are kept in the order they were added, NO_NODE if there are none
+    inline NodeId getFirstChild(NodeId node) const {
+        return m_nodes.at(node).firstChild;
+    }
+
+    inline NodeId getNextSibling(NodeId node) const {
+        return m_nodes.at(node).nextSibling;
+    }
+
+    // 0 for the root
+    inline PackedMove getMove(NodeId node) const {
+        return m_nodes.at(node).move;
+    }
+
+    // plies from the root
+    inline int getDepth(NodeId node) const {
+        return m_nodes.at(node).depth;
+    }
+
+    // the uci moves from the root to node, space separated
+    std::string getLine(NodeId node) const;
+
+    // bytes held for the nodes and snapshots, without the board
+    size_t getMemoryUsage() const;
+
+private:
+    static constexpr uint32_t NO_SNAPSHOT = UINT32_MAX;
+
+    struct Node {
+        NodeId parent, firstChild, nextSibling;
+        uint32_t snapshot;      // index in m_snapshots or NO_SNAPSHOT
+        PackedMove move;
+        uint16_t depth;
+        GameResult result;      // detected when the node is added
+    };
+
+    // a node's board with the history of its line, which shares its chunks with the board that saved it
+    struct Snapshot {
+        BoardSnapshot board;
+        PositionHistory history;
+    };
+
+    // rough costs in ns on one core, to choose between walking the tree and starting from a snapshot
+    static constexpr int MAKE_COST = 85;
+    static constexpr int UNMAKE_COST = 50;
+    static constexpr int RESTORE_COST = 220;
+
+    void checkNode(NodeId node) const;
+    void makeMove(NodeId node);
+    void unmakeMove();
+    // loads the snapshot on the target's line at depth, which is not above commonDepth. see goTo
+    void restoreSnapshot(int depth, int commonDepth);
+
+    int m_snapshotInterval;
+
+    std::vector<Node> m_nodes;
+    std::vector<Snapshot> m_snapshots;
+
+    // the board is at m_path.back(), m_undo[i] takes back the move of m_path[i + 1]. a restored snapshot can't take
+    // back the moves above it, m_undo holds records from m_undoBase on
+    std::unique_ptr<LegalChess> m_pGame;
+    std::vector<NodeId> m_path;
+    std::vector<MoveUndo> m_undo;
+    int m_undoBase = 0;
+
+    // the target's line below the current one while goTo runs, kept to reuse its memory
+    std::vector<NodeId> m_targetPath;
+};
+
+};
+
+#endif
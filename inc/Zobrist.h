@@ -22,7 +22,14 @@ private:
     std::array<uint64_t, 8> enPassantHash; // Files a-h (if applicable)
     uint64_t sideToMoveHash;
 
-    static std::shared_ptr<const Zobrist> m_pInstance;
+    // the second lane of wide keys, drawn from its own generator so both lanes are independent
+    std::array<std::array<uint64_t, NUM_SQUARES>, NUM_PIECE_TYPES> extendedPieceHash;
+    std::array<uint64_t, 16> extendedCastlingHash;
+    std::array<uint64_t, 8> extendedEnPassantHash;
+    uint64_t extendedSideToMoveHash;
+
+    // per piece type and count, a side has at most 10 pieces of a type (2 + 8 promoted)
+    std::array<std::array<uint64_t, 11>, NUM_PIECE_TYPES> materialHash;
 
     Zobrist();
 
@@ -33,7 +40,32 @@ public:
     void initRandomKeys();
 
     // Compute the Zobrist hash for a given position
-    uint64_t computeHash(Piece board[8][8], bool whiteToMove, int castlingRights, int enPassantFile) const;
+    uint64_t computeHash(const Piece board[8][8], bool whiteToMove, int castlingRights, int enPassantFile) const;
+
+    // the hash is the xor of the keys of the pieces on their squares and the key of the rest of the state,
+    // so a board can update the piece part with the pieces that moved
+    inline uint64_t getPieceKey(Piece piece, int square) const {
+        return pieceHash[(int)piece][square];
+    }
+
+    // enPassantFile is 8 if there is no en passant square
+    inline uint64_t getStateKey(bool whiteToMove, int castlingRights, int enPassantFile) const {
+        return (whiteToMove ? sideToMoveHash : 0) ^ castlingHash[castlingRights] ^ (enPassantFile < 8 ? enPassantHash[enPassantFile] : 0);
+    }
+
+    inline uint64_t getExtendedPieceKey(Piece piece, int square) const {
+        return extendedPieceHash[(int)piece][square];
+    }
+
+    inline uint64_t getExtendedStateKey(bool whiteToMove, int castlingRights, int enPassantFile) const {
+        return (whiteToMove ? extendedSideToMoveHash : 0) ^ extendedCastlingHash[castlingRights] ^ (enPassantFile < 8 ? extendedEnPassantHash[enPassantFile] : 0);
+    }
+
+    // same for all positions with the same number of pieces of every type, pieceBoards as Board::getPieceBitBoard
+    uint64_t computeMaterialKey(const uint64_t pieceBoards[NUM_PIECE_TYPES]) const;
+
+    // same for all positions with the same pawns
+    uint64_t computePawnKey(uint64_t whitePawns, uint64_t blackPawns) const;
 };
 
 }
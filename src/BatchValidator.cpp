@@ -0,0 +1,214 @@
+#include "BatchValidator.h"
+#include "SlidingAttacks.h"
+
+#include <cstring>
+
+namespace LC {
+
+namespace {
+
+// board of BATCH_LANES bitboards, one game per lane
+typedef uint64_t LaneBoards __attribute__((vector_size(BATCH_LANES * sizeof(uint64_t))));
+
+constexpr uint64_t RANK_3 = 0xFFULL << 16;
+constexpr uint64_t RANK_8 = 0xFFULL << 56;
+
+// mirrored squares of the castling moves, king on e1 (square 3), short side rook on h1 (0), long side rook on a1 (7)
+constexpr uint64_t SQUARE_H1 = 1ULL << 0, SQUARE_G1 = 1ULL << 1, SQUARE_F1 = 1ULL << 2, SQUARE_E1 = 1ULL << 3;
+constexpr uint64_t SQUARE_D1 = 1ULL << 4, SQUARE_C1 = 1ULL << 5, SQUARE_B1 = 1ULL << 6, SQUARE_A1 = 1ULL << 7;
+
+// all bits set in the lanes that are not zero
+inline uint64_t nonZero(uint64_t bitBoard) {
+    return -(uint64_t)(bitBoard != 0);
+}
+
+template<class T>
+inline T nonZero(T bitBoards) {
+    return (T)(bitBoards != 0);
+}
+
+inline bool anyLane(uint64_t bitBoard) {
+    return bitBoard != 0;
+}
+
+template<class T>
+inline bool anyLane(T bitBoards) {
+    uint64_t combined = 0;
+    for(int lane = 0; lane < (int)(sizeof(T) / sizeof(uint64_t)); lane++) combined |= bitBoards[lane];
+
+    return combined != 0;
+}
+
+template<class T>
+inline T load(const std::vector<uint64_t>& array, size_t index) {
+    T value;
+    memcpy(&value, array.data() + index, sizeof(T));
+
+    return value;
+}
+
+inline void store(uint64_t legal, uint8_t* out) {
+    out[0] = legal != 0;
+}
+
+template<class T>
+inline void store(T legal, uint8_t* out) {
+    for(int lane = 0; lane < (int)(sizeof(T) / sizeof(uint64_t)); lane++) out[lane] = legal[lane] != 0;
+}
+
+// pieces of the opponent (black after mirroring) attacking any of the squares
+template<class T>
+inline T getAttackers(T squares, T occupancy, const T opponent[6]) {
+    T empty = ~occupancy;
+
+    return (whitePawnAttacks(squares) & opponent[0]) |
+           (knightAttacks(squares) & opponent[1]) |
+           (bishopAttacks(squares, empty) & (opponent[2] | opponent[4])) |
+           (rookAttacks(squares, empty) & (opponent[3] | opponent[4])) |
+           (kingAttacks(squares) & opponent[5]);
+}
+
+// mirrors the ranks so that the side to move plays up the board
+inline uint64_t orient(uint64_t bitBoard, bool white) {
+    return white ? bitBoard : __builtin_bswap64(bitBoard);
+}
+
+}
+
+template<class T>
+void MoveBatch::validateLanes(size_t index, uint8_t* out) const {
+    T own[6], opponent[6];
+    T ownAll = {}, opponentAll = {};
+
+    for(int type = 0; type < 6; type++) {
+        own[type] = load<T>(m_own[type], index);
+        opponent[type] = load<T>(m_opponent[type], index);
+        ownAll |= own[type];
+        opponentAll |= opponent[type];
+    }
+
+    T from = load<T>(m_from, index), to = load<T>(m_to, index);
+    T enpassant = load<T>(m_enpassant, index), castlingRooks = load<T>(m_castlingRooks, index), promotion = load<T>(m_promotion, index);
+
+    T occupancy = ownAll | opponentAll;
+    T empty = ~occupancy;
+
+    // moving piece, at most one of these is set per lane, none if the from square has no piece of the side to move
+    T isPawn = nonZero(own[0] & from), isKnight = nonZero(own[1] & from), isBishop = nonZero(own[2] & from);
+    T isRook = nonZero(own[3] & from), isQueen = nonZero(own[4] & from), isKing = nonZero(own[5] & from);
+
+    // pseudo legal targets of the moving piece
+    T diagonals = bishopAttacks(from, empty), lines = rookAttacks(from, empty);
+    T pawnPushes = shiftBy<8>(from) & empty;
+    pawnPushes |= shiftBy<8>(pawnPushes & RANK_3) & empty;
+    T pawnMoves = pawnPushes | (whitePawnAttacks(from) & (opponentAll | enpassant));
+
+    T targets = (isPawn & pawnMoves) | (isKnight & knightAttacks(from)) | (isBishop & diagonals) | (isRook & lines) |
+                (isQueen & (diagonals | lines)) | (isKing & kingAttacks(from));
+    targets &= ~ownAll;
+
+    // castling needs the right, empty squares up to the rook and a king that doesn't start on or pass an attacked square
+    T isCastlingKing = isKing & nonZero(from & SQUARE_E1);
+    T shortCastle = isCastlingKing & nonZero(to & SQUARE_G1) & nonZero(castlingRooks & SQUARE_H1) & ~nonZero(occupancy & (SQUARE_F1 | SQUARE_G1));
+    T longCastle = isCastlingKing & nonZero(to & SQUARE_C1) & nonZero(castlingRooks & SQUARE_A1) & ~nonZero(occupancy & (SQUARE_D1 | SQUARE_C1 | SQUARE_B1));
+    T castle = shortCastle | longCastle;
+
+    if(anyLane(castle)) {
+        T passedSquares = (shortCastle & (SQUARE_E1 | SQUARE_F1)) | (longCastle & (SQUARE_E1 | SQUARE_D1));
+        castle &= ~nonZero(getAttackers(passedSquares, occupancy, opponent));
+    }
+
+    // a pawn reaching the last rank has to name a promotion piece and no other move may name one
+    T needsPromotion = isPawn & nonZero(to & RANK_8);
+
+    T legal = (nonZero(targets & to) | castle) & ~(needsPromotion ^ promotion);
+
+    // make the move on the masks and look at the king, this covers pins, checks and enpassant discoveries
+    T enpassantVictim = isPawn & nonZero(to & enpassant) & shiftBy<-8>(enpassant);
+    T rookFrom = (shortCastle & SQUARE_H1) | (longCastle & SQUARE_A1);
+    T rookTo = (shortCastle & SQUARE_F1) | (longCastle & SQUARE_D1);
+    T removed = to | enpassantVictim;
+
+    T opponentAfter[6];
+    for(int type = 0; type < 6; type++) opponentAfter[type] = opponent[type] & ~removed;
+
+    T ownAfter = (ownAll & ~(from | rookFrom)) | to | rookTo;
+    T occupancyAfter = ownAfter | (opponentAll & ~removed);
+    T kingAfter = (isKing & to) | (~isKing & own[5]);
+
+    legal &= ~nonZero(getAttackers(kingAfter, occupancyAfter, opponentAfter));
+
+    store(legal, out);
+}
+
+void MoveBatch::resize(size_t size) {
+    m_size = size;
+
+    // the kernel reads whole vectors, the padding holds illegal moves
+    size_t paddedSize = (size + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+
+    for(int type = 0; type < 6; type++) {
+        m_own[type].resize(paddedSize, 0);
+        m_opponent[type].resize(paddedSize, 0);
+    }
+
+    m_from.resize(paddedSize, 0);
+    m_to.resize(paddedSize, 0);
+    m_enpassant.resize(paddedSize, 0);
+    m_castlingRooks.resize(paddedSize, 0);
+    m_promotion.resize(paddedSize, 0);
+}
+
+void MoveBatch::set(size_t index, const Board& board, const std::string& move) {
+    bool white = board.isWhiteTurn;
+
+    for(int type = 0; type < 6; type++) {
+        m_own[type][index] = orient(board.getPieceBitBoard((Piece)(white ? type : type + 6)), white);
+        m_opponent[type][index] = orient(board.getPieceBitBoard((Piece)(white ? type + 6 : type)), white);
+    }
+
+    m_enpassant[index] = board.enpassantSquare == 64 ? 0 : orient(1ULL << board.enpassantSquare, white);
+
+    m_castlingRooks[index] = 0;
+    if(white ? board.canWhiteKingShortCastle : board.canBlackKingShortCastle) m_castlingRooks[index] |= SQUARE_H1;
+    if(white ? board.canWhiteKingLongCastle : board.canBlackKingLongCastle) m_castlingRooks[index] |= SQUARE_A1;
+
+    // same checks as LegalChess::validateMove and Board::getPromotionPiece
+    bool parsed = (move.length() == 4 || move.length() == 5) && move[0] >= 'a' && move[0] <= 'h' && move[2] >= 'a' && move[2] <= 'h' &&
+                  move[1] >= '1' && move[1] <= '8' && move[3] >= '1' && move[3] <= '8';
+    if(move.length() == 5 && move[4] != 'q' && move[4] != 'r' && move[4] != 'b' && move[4] != 'n') parsed = false;
+
+    if(!parsed || board.getGameResult() != GameResult::IN_PROGRESS) {
+        m_from[index] = m_to[index] = m_promotion[index] = 0;
+        return;
+    }
+
+    int fromSquare = (move[1] - '1')*8 + ('h' - move[0]);
+    int toSquare = (move[3] - '1')*8 + ('h' - move[2]);
+
+    m_from[index] = orient(1ULL << fromSquare, white);
+    m_to[index] = orient(1ULL << toSquare, white);
+    m_promotion[index] = move.length() == 5 ? ~0ULL : 0;
+}
+
+void MoveBatch::set(size_t index, const LegalChess& game, const std::string& move) {
+    set(index, *game.m_pBoard, move);
+}
+
+void validateMoveBatch(const MoveBatch& batch, std::vector<uint8_t>& legal, bool allowSimd) {
+    // room for the padding lanes, trimmed below
+    legal.resize(batch.m_from.size());
+
+    size_t index = 0;
+
+    // the arrays are padded to whole vectors, so the last vector may run past the end of the batch
+    if(allowSimd && BATCH_LANES > 1) {
+        for(; index < batch.m_size; index += BATCH_LANES) batch.validateLanes<LaneBoards>(index, legal.data() + index);
+    }
+
+    for(; index < batch.m_size; index++) batch.validateLanes<uint64_t>(index, legal.data() + index);
+
+    legal.resize(batch.m_size);
+}
+
+};
@@ -1,5 +1,10 @@
 #include "Board.h"
 #include "Helper.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 
 namespace LC {
 
@@ -69,18 +74,31 @@ void Board::initBoard() {
         for(auto &piece : grid[rank]) piece = Piece::EMPTY;
     }
 
+    m_pMoveManagerStore = MoveManagerStore::getMoveManagerStore();
+    m_pZobrist = Zobrist::getInstance();
+    m_pPositionCache = PositionCache::getInstance();
+
+    initPieceKeys();
+    resetState();
+}
+
+void Board::resetState() {
     isWhiteTurn = true;
     gameOver = whiteKingCheckmated = blackKingCheckmated = stalemate = drawBy50HalfMoves = drawByInsufficientMaterial = drawByRepitition = false;
     canWhiteKingShortCastle = canBlackKingShortCastle = canWhiteKingLongCastle = canBlackKingLongCastle = true;
 
-    enpassantSquare = discoveryCheckSquare = directCheckSquare = 64;
+    enpassantSquare = 64;
 
     halfMovesCount = movesCount = 0; // they treat each player's turn as different moves
 
-    m_pMoveManagerStore = MoveManagerStore::getMoveManagerStore();
-    m_pZobrist = Zobrist::getInstance();
-
     gameResult = GameResult::IN_PROGRESS;
+
+    legalDestinationsReady = positionFactsProbed = false;
+    fenLength = 0;
+
+    lastCapturedPiece = Piece::EMPTY;
+    lastCaptureSquare = 64;
+    hasLastMove = false;
 }
 
 
@@ -98,35 +116,38 @@ void Board::move(const Move& move) {
         throw PlayerTurnException("It is " + std::string(isWhiteTurn ? "white's " : "black's ") + " turn to move. Move number: " + std::to_string(movesCount + 1) + ". Move: " + std::string(move.uciMove));
     }
 
-    CheckType check = m_pMoveManagerStore->getPieceMoveManager(movingPiece)->handleMove(isWhiteTurn, move, *this);
+    {
+        LC_METRICS_SCOPE(PIECE_VALIDATION);
+        m_pMoveManagerStore->getPieceMoveManager(movingPiece)->handleMove(isWhiteTurn, move, *this);
+    }
+
+    legalDestinationsReady = positionFactsProbed = false;
+    fenLength = 0;
 
     movesCount++;
     if((int)movingPiece % 6 == 0 || grid[move.toRow][move.toCol] != Piece::EMPTY) halfMovesCount = 0;
     else halfMovesCount++;
 
+    // the pawn handler already removed an en passant victim from the grid
+    if((int)movingPiece % 6 == 0 && move.fromCol != move.toCol && grid[move.toRow][move.toCol] == Piece::EMPTY) {
+        recordCapture(isWhiteTurn ? Piece::BLACK_PAWN : Piece::WHITE_PAWN, move.fromRow*8 + move.toCol);
+    }
+    else recordCapture(grid[move.toRow][move.toCol], move.toSquare);
+
+    updatePieceKeys(movingPiece, movingPiece, move);
+
     // update the move in grid
     grid[move.toRow][move.toCol] = movingPiece;
     grid[move.fromRow][move.fromCol] = Piece::EMPTY;
 
-    // update enpassant square if the moved piece is not a pawn
-    if(movingPiece != Piece::WHITE_PAWN && movingPiece != Piece::BLACK_PAWN) enpassantSquare = 64;
+    // the enpassant square only lives for one move after a double pawn push
+    if((int)movingPiece % 6 != 0 || abs(move.fromRow - move.toRow) != 2) enpassantSquare = 64;
 
-    int castlingRights = 0;
-    if(canWhiteKingShortCastle) castlingRights |= (1 << 0);
-    if(canWhiteKingLongCastle) castlingRights |= (1 << 1);
-    if(canBlackKingShortCastle) castlingRights |= (1 << 2);
-    if(canBlackKingLongCastle) castlingRights |= (1 << 3);
+    updateCastlingRights(move.fromSquare, move.toSquare);
 
-    uint64_t positionHash = m_pZobrist->computeHash(grid, !isWhiteTurn, castlingRights, enpassantSquare % 8);
-    positionHashToFreq[positionHash]++;
+    uint64_t positionHash = recordPosition(move, 0);
 
-    calculateMoveResult(check, positionHash, isWhiteTurn, *this);
-
-    // check for 50 move rule
-    if(halfMovesCount == 100 && gameResult == GameResult::IN_PROGRESS) {
-        drawBy50HalfMoves = true;
-        setGameResult(GameResult::DRAW_BY_50_HALF_MOVES);
-    }
+    updateGameResult(positionHash, isWhiteTurn);
 
     isWhiteTurn = !isWhiteTurn;    
 }
@@ -146,37 +167,539 @@ void Board::promote(char choosenPiece, const Move& move) {
         throw PlayerTurnException("It is " + std::string(isWhiteTurn ? "white's " : "black's ") + " turn to move. Move number: " + std::to_string(movesCount + 1) + ". Move: " + std::string(move.uciMove));
     }
 
-    Piece newPiece;
+    Piece newPiece = getPromotionPiece(choosenPiece, move);
+
+    {
+        LC_METRICS_SCOPE(PIECE_VALIDATION);
+        std::static_pointer_cast<PawnMoveManager>(m_pMoveManagerStore->getPieceMoveManager(movingPiece))->handlePromotion(newPiece, isWhiteTurn, move, *this);
+    }
+
+    legalDestinationsReady = positionFactsProbed = false;
+    fenLength = 0;
 
-    if(choosenPiece == 'q') newPiece = isWhiteTurn ? Piece::WHITE_QUEEN : Piece::BLACK_QUEEN;
-    else if(choosenPiece == 'r') newPiece = isWhiteTurn ? Piece::WHITE_ROOK : Piece::BLACK_ROOK;
-    else if(choosenPiece == 'b') newPiece = isWhiteTurn ? Piece::WHITE_BISHOP : Piece::BLACK_BISHOP;
-    else if(choosenPiece == 'n') newPiece = isWhiteTurn ? Piece::WHITE_KNIGHT : Piece::BLACK_KNIGHT;
-    else throw InvalidMoveException("The provied piece to promote is invalid: " + std::string(1, choosenPiece) + ". Move number: " + std::to_string(movesCount + 1) + ". Move: " + std::string(move.uciMove));
+    movesCount++;
+    halfMovesCount = 0;
 
-    CheckType check = std::static_pointer_cast<PawnMoveManager>(m_pMoveManagerStore->getPieceMoveManager(movingPiece))->handlePromotion(newPiece, isWhiteTurn, move, *this);
+    recordCapture(grid[move.toRow][move.toCol], move.toSquare);
+    updatePieceKeys(movingPiece, newPiece, move);
 
     // update the move in grid
     grid[move.toRow][move.toCol] = newPiece;
     grid[move.fromRow][move.fromCol] = Piece::EMPTY;
 
-    // update enpassant square if the moved piece is not a pawn
-    if(movingPiece != Piece::WHITE_PAWN && movingPiece != Piece::BLACK_PAWN) enpassantSquare = 64;
+    enpassantSquare = 64;
 
-    int castlingRights = 0;
-    if(canWhiteKingShortCastle) castlingRights |= (1 << 0);
-    if(canWhiteKingLongCastle) castlingRights |= (1 << 1);
-    if(canBlackKingShortCastle) castlingRights |= (1 << 2);
-    if(canBlackKingLongCastle) castlingRights |= (1 << 3);
+    updateCastlingRights(move.fromSquare, move.toSquare);
 
-    uint64_t positionHash = m_pZobrist->computeHash(grid, !isWhiteTurn, castlingRights, enpassantSquare % 8);
-    positionHashToFreq[positionHash]++;
+    uint64_t positionHash = recordPosition(move, choosenPiece);
 
-    calculateMoveResult(check, positionHash, isWhiteTurn, *this);
+    updateGameResult(positionHash, isWhiteTurn);
 
     isWhiteTurn = !isWhiteTurn;
+}
+
+
+void Board::applyTrustedMove(const Move& move, char choosenPiece, bool detectResult) {
+    Piece movingPiece = grid[move.fromRow][move.fromCol];
+    Piece capturedPiece = grid[move.toRow][move.toCol];
+    int pieceType = (int)movingPiece % 6;
+
+    legalDestinationsReady = positionFactsProbed = false;
+    fenLength = 0;
+
     movesCount++;
-    halfMovesCount = 0;
+    if(pieceType == 0 || capturedPiece != Piece::EMPTY) halfMovesCount = 0;
+    else halfMovesCount++;
+
+    if(capturedPiece != Piece::EMPTY) updatePieceCountOnBoard(capturedPiece, move.toSquare, false);
+
+    recordCapture(capturedPiece, move.toSquare);
+
+    if(choosenPiece) {
+        Piece newPiece = getPromotionPiece(choosenPiece, move);
+
+        updatePieceCountOnBoard(movingPiece, move.fromSquare, false);
+        updatePieceCountOnBoard(newPiece, move.toSquare, true);
+        movingPiece = newPiece;
+    }
+    else {
+        updatePieceMoveOnBoard(movingPiece, move.fromSquare, move.toSquare);
+
+        // castling, move the rook as well
+        if(pieceType == 5 && abs(move.fromCol - move.toCol) == 2) {
+            bool shortSide = move.toCol == 1;
+            int rookSquare = isWhiteTurn ? (shortSide ? 0 : 7) : (shortSide ? 56 : 63);
+            int rookToSquare = shortSide ? move.toSquare + 1 : move.toSquare - 1;
+            Piece rook = isWhiteTurn ? Piece::WHITE_ROOK : Piece::BLACK_ROOK;
+
+            updatePieceMoveOnBoard(rook, rookSquare, rookToSquare);
+            setPieceOnBoard(rook, rookToSquare);
+            setPieceOnBoard(Piece::EMPTY, rookSquare);
+        }
+        // enpassant, remove the pawn behind the target square
+        else if(pieceType == 0 && move.toSquare == enpassantSquare) {
+            int capturedPawnSquare = move.fromRow*8 + move.toCol;
+
+            updatePieceCountOnBoard(isWhiteTurn ? Piece::BLACK_PAWN : Piece::WHITE_PAWN, capturedPawnSquare, false);
+            setPieceOnBoard(Piece::EMPTY, capturedPawnSquare);
+            recordCapture(isWhiteTurn ? Piece::BLACK_PAWN : Piece::WHITE_PAWN, capturedPawnSquare);
+        }
+    }
+
+    updatePieceKeys(grid[move.fromRow][move.fromCol], movingPiece, move);
+
+    grid[move.toRow][move.toCol] = movingPiece;
+    grid[move.fromRow][move.fromCol] = Piece::EMPTY;
+
+    if(pieceType == 0 && abs(move.fromRow - move.toRow) == 2) enpassantSquare = isWhiteTurn ? move.fromSquare + 8 : move.fromSquare - 8;
+    else enpassantSquare = 64;
+
+    updateCastlingRights(move.fromSquare, move.toSquare);
+
+    uint64_t positionHash = recordPosition(move, choosenPiece);
+
+    if(detectResult) updateGameResult(positionHash, isWhiteTurn);
+
+    isWhiteTurn = !isWhiteTurn;
+}
+
+void Board::applyTrustedMove(const Move& move, char choosenPiece, bool detectResult, MoveUndo& undo) {
+    undo.pieceKeys = pieceKeys;
+    undo.extendedPieceKeys = extendedPieceKeys;
+    undo.enpassantSquare = enpassantSquare;
+    undo.halfMovesCount = halfMovesCount;
+    undo.castlingRights = getCastlingRights();
+    undo.gameResult = gameResult;
+    undo.lastCapturedPiece = lastCapturedPiece;
+    undo.lastCaptureSquare = lastCaptureSquare;
+    undo.hasLastMove = hasLastMove;
+
+    applyTrustedMove(move, choosenPiece, detectResult);
+}
+
+void Board::unmakeMove(const MoveUndo& undo) {
+    PackedMove lastMove = positionHistory.getLastMove();
+    int fromSquare = lastMove & 63, toSquare = (lastMove >> 6) & 63;
+
+    // the side that made the move is to move again
+    isWhiteTurn = !isWhiteTurn;
+
+    Piece placedPiece = grid[toSquare/8][toSquare%8];
+    Piece movingPiece = placedPiece;
+
+    if(lastMove >> 12) {
+        movingPiece = isWhiteTurn ? Piece::WHITE_PAWN : Piece::BLACK_PAWN;
+
+        updatePieceCountOnBoard(placedPiece, toSquare, false);
+        updatePieceCountOnBoard(movingPiece, fromSquare, true);
+    }
+    else {
+        updatePieceMoveOnBoard(movingPiece, toSquare, fromSquare);
+
+        // castling, the rook goes back to its corner
+        if((int)movingPiece % 6 == 5 && abs(fromSquare%8 - toSquare%8) == 2) {
+            bool shortSide = toSquare%8 == 1;
+            int rookSquare = shortSide ? toSquare - 1 : toSquare + 2;
+            int rookToSquare = shortSide ? toSquare + 1 : toSquare - 1;
+            Piece rook = isWhiteTurn ? Piece::WHITE_ROOK : Piece::BLACK_ROOK;
+
+            updatePieceMoveOnBoard(rook, rookToSquare, rookSquare);
+            setPieceOnBoard(rook, rookSquare);
+            setPieceOnBoard(Piece::EMPTY, rookToSquare);
+        }
+    }
+
+    grid[fromSquare/8][fromSquare%8] = movingPiece;
+    grid[toSquare/8][toSquare%8] = Piece::EMPTY;
+
+    // the capture of the move, on another square than toSquare for en passant
+    if(lastCapturedPiece != Piece::EMPTY) {
+        updatePieceCountOnBoard(lastCapturedPiece, lastCaptureSquare, true);
+        setPieceOnBoard(lastCapturedPiece, lastCaptureSquare);
+    }
+
+    pieceKeys = undo.pieceKeys;
+    extendedPieceKeys = undo.extendedPieceKeys;
+    enpassantSquare = undo.enpassantSquare;
+    halfMovesCount = undo.halfMovesCount;
+    movesCount--;
+
+    canWhiteKingShortCastle = undo.castlingRights & 1;
+    canWhiteKingLongCastle = undo.castlingRights & 2;
+    canBlackKingShortCastle = undo.castlingRights & 4;
+    canBlackKingLongCastle = undo.castlingRights & 8;
+
+    gameResult = undo.gameResult;
+    gameOver = whiteKingCheckmated = blackKingCheckmated = stalemate = drawBy50HalfMoves = drawByInsufficientMaterial = drawByRepitition = false;
+
+    legalDestinationsReady = positionFactsProbed = false;
+    fenLength = 0;
+
+    lastCapturedPiece = undo.lastCapturedPiece;
+    lastCaptureSquare = undo.lastCaptureSquare;
+    hasLastMove = undo.hasLastMove;
+
+    positionHistory.pop();
+}
+
+void Board::detectGameResult() {
+    if(movesCount == 0 || gameResult != GameResult::IN_PROGRESS) return;
+
+    updateGameResult(computePositionHash(isWhiteTurn), !isWhiteTurn);
+}
+
+void Board::saveSnapshot(BoardSnapshot& snapshot) const {
+    snapshot.positionHash = computePositionHash(isWhiteTurn);
+
+    for(int square = 0; square < 64; square++) snapshot.grid[square] = (uint8_t)grid[square/8][square%8];
+
+    snapshot.enpassantSquare = enpassantSquare;
+    snapshot.halfMovesCount = halfMovesCount;
+    snapshot.movesCount = movesCount;
+    snapshot.isWhiteTurn = isWhiteTurn;
+    snapshot.castlingRights = canWhiteKingShortCastle | (canWhiteKingLongCastle << 1) | (canBlackKingShortCastle << 2) | (canBlackKingLongCastle << 3);
+}
+
+void Board::loadSnapshot(const BoardSnapshot& snapshot) {
+    // resets the results and caches, the pieces are replaced below
+    resetState();
+    positionHistory.clear();
+
+    // one bitboard per piece and one for the empty squares, without a branch per square
+    uint64_t pieces[13] = {};
+
+    for(int square = 0; square < 64; square++) {
+        Piece piece = (Piece)snapshot.grid[square];
+        grid[square/8][square%8] = piece;
+        pieces[(int)piece] |= 1ULL << square;
+    }
+
+    allWhitePiecesBoard = allBlackPiecesBoard = 0;
+
+    for(int i = 0; i<12; i++) {
+        piecesArray[i] = pieces[i];
+
+        if(i < 6) allWhitePiecesBoard |= pieces[i];
+        else allBlackPiecesBoard |= pieces[i];
+    }
+
+    allPiecesBoard = allWhitePiecesBoard | allBlackPiecesBoard;
+
+    initPieceKeys();
+
+    enpassantSquare = snapshot.enpassantSquare;
+    halfMovesCount = snapshot.halfMovesCount;
+    movesCount = snapshot.movesCount;
+    isWhiteTurn = snapshot.isWhiteTurn;
+
+    canWhiteKingShortCastle = snapshot.castlingRights & 1;
+    canWhiteKingLongCastle = snapshot.castlingRights & 2;
+    canBlackKingShortCastle = snapshot.castlingRights & 4;
+    canBlackKingLongCastle = snapshot.castlingRights & 8;
+}
+
+uint64_t Board::getLegalDestinations(int square) const {
+    if(gameResult != GameResult::IN_PROGRESS) return 0;
+
+    if(!legalDestinationsReady) {
+        // probe once per position, a piece that can't move needs no move generation
+        if(!positionFactsProbed) {
+            PositionFacts facts;
+            positionFactsProbed = true;
+            movablePiecesHint = ~0ULL;
+
+            if(m_pPositionCache->isEnabled() && m_pPositionCache->probe(computePositionHash(isWhiteTurn), computeVerificationKey(isWhiteTurn), facts) &&
+               facts.hasDestinationSummary) {
+                movablePiecesHint = facts.movablePieces;
+            }
+        }
+
+        if((movablePiecesHint & (1ULL << square)) == 0) return 0;
+
+        computeLegalDestinations();
+    }
+
+    return legalDestinations[square];
+}
+
+bool Board::isLegal(const Move& move, char choosenPiece) const {
+    if((getLegalDestinations(move.fromSquare) & (1ULL << move.toSquare)) == 0) return false;
+
+    // a pawn reaching the last rank has to be promoted and no other move can name a piece
+    bool isPromotion = (int)grid[move.fromRow][move.fromCol] % 6 == 0 && (move.toRow == 0 || move.toRow == 7);
+
+    if(choosenPiece == 0) return !isPromotion;
+
+    return isPromotion && (choosenPiece == 'q' || choosenPiece == 'r' || choosenPiece == 'b' || choosenPiece == 'n');
+}
+
+size_t Board::getLegalMoves(PackedMove* pMoves) const {
+    uint64_t pieces = isWhiteTurn ? allWhitePiecesBoard : allBlackPiecesBoard;
+    size_t count = 0;
+
+    while(pieces) {
+        int fromSquare = __builtin_ctzll(pieces);
+        pieces &= pieces - 1;
+
+        uint64_t targets = getLegalDestinations(fromSquare);
+        bool isPawn = (int)grid[fromSquare/8][fromSquare%8] % 6 == 0;
+
+        while(targets) {
+            int toSquare = __builtin_ctzll(targets);
+            targets &= targets - 1;
+
+            if(isPawn && (toSquare/8 == 0 || toSquare/8 == 7)) {
+                for(char choosenPiece : {'n', 'b', 'r', 'q'}) pMoves[count++] = packMove(fromSquare, toSquare, choosenPiece);
+            }
+            else pMoves[count++] = packMove(fromSquare, toSquare, 0);
+        }
+    }
+
+    return count;
+}
+
+void Board::computeLegalDestinations() const {
+    LegalMoveContext context;
+    initLegalMoveContext(isWhiteTurn, *this, context);
+
+    std::fill(std::begin(legalDestinations), std::end(legalDestinations), 0);
+
+    uint64_t pieces = context.own;
+
+    while(pieces) {
+        int pieceSquare = __builtin_ctzll(pieces);
+        pieces &= pieces - 1;
+
+        legalDestinations[pieceSquare] = getLegalTargets(pieceSquare, context, *this, true);
+    }
+
+    legalDestinationsReady = true;
+
+    if(m_pPositionCache->isEnabled()) {
+        PositionFacts facts;
+        facts.checkers = context.checkers;
+        facts.movablePieces = 0;
+        facts.destinationCount = 0;
+
+        for(int pieceSquare = 0; pieceSquare < 64; pieceSquare++) {
+            if(legalDestinations[pieceSquare] == 0) continue;
+
+            facts.movablePieces |= (1ULL << pieceSquare);
+            facts.destinationCount += __builtin_popcountll(legalDestinations[pieceSquare]);
+        }
+
+        facts.hasLegalMove = facts.movablePieces != 0;
+        facts.hasDestinationSummary = true;
+
+        m_pPositionCache->store(computePositionHash(isWhiteTurn), computeVerificationKey(isWhiteTurn), facts);
+    }
+}
+
+Piece Board::getPromotionPiece(char choosenPiece, const Move& move) const {
+    if(choosenPiece == 'q') return isWhiteTurn ? Piece::WHITE_QUEEN : Piece::BLACK_QUEEN;
+    if(choosenPiece == 'r') return isWhiteTurn ? Piece::WHITE_ROOK : Piece::BLACK_ROOK;
+    if(choosenPiece == 'b') return isWhiteTurn ? Piece::WHITE_BISHOP : Piece::BLACK_BISHOP;
+    if(choosenPiece == 'n') return isWhiteTurn ? Piece::WHITE_KNIGHT : Piece::BLACK_KNIGHT;
+
+    throw InvalidMoveException("The provied piece to promote is invalid: " + std::string(1, choosenPiece) + ". Move number: " + std::to_string(movesCount + 1) + ". Move: " + std::string(move.uciMove));
+}
+
+void Board::updateCastlingRights(int fromSquare, int toSquare) {
+    // a king move loses both rights, a rook moving from or captured on its corner loses that side
+    if(fromSquare == 3) canWhiteKingShortCastle = canWhiteKingLongCastle = false;
+    if(fromSquare == 59) canBlackKingShortCastle = canBlackKingLongCastle = false;
+
+    if(fromSquare == 0 || toSquare == 0) canWhiteKingShortCastle = false;
+    if(fromSquare == 7 || toSquare == 7) canWhiteKingLongCastle = false;
+    if(fromSquare == 56 || toSquare == 56) canBlackKingShortCastle = false;
+    if(fromSquare == 63 || toSquare == 63) canBlackKingLongCastle = false;
+}
+
+int Board::getCastlingRights() const {
+    return canWhiteKingShortCastle | (canWhiteKingLongCastle << 1) | (canBlackKingShortCastle << 2) | (canBlackKingLongCastle << 3);
+}
+
+int Board::getEnpassantKeyFile(bool whiteToMove) const {
+    if(enpassantSquare == 64) return 8;
+
+    // the en passant square only makes a different position if a pawn can capture there, otherwise the same position
+    // reached without the double push has the same key
+    int row = enpassantSquare/8 + (whiteToMove ? -1 : 1), col = enpassantSquare%8;
+    uint64_t capturers = 0;
+
+    if(col > 0) capturers |= 1ULL << (row*8 + col - 1);
+    if(col < 7) capturers |= 1ULL << (row*8 + col + 1);
+
+    return (capturers & piecesArray[(int)(whiteToMove ? Piece::WHITE_PAWN : Piece::BLACK_PAWN)]) ? col : 8;
+}
+
+uint64_t Board::computePositionHash(bool whiteToMove) const {
+    // the same as m_pZobrist->computeHash(grid, ...) without visiting the squares
+    return pieceKeys ^ m_pZobrist->getStateKey(whiteToMove, getCastlingRights(), getEnpassantKeyFile(whiteToMove));
+}
+
+uint64_t Board::computeExtendedHash(bool whiteToMove) const {
+    return extendedPieceKeys ^ m_pZobrist->getExtendedStateKey(whiteToMove, getCastlingRights(), getEnpassantKeyFile(whiteToMove));
+}
+
+uint64_t Board::getMaterialKey() const {
+    return m_pZobrist->computeMaterialKey(piecesArray);
+}
+
+uint64_t Board::getPawnKey() const {
+    return m_pZobrist->computePawnKey(piecesArray[(int)Piece::WHITE_PAWN], piecesArray[(int)Piece::BLACK_PAWN]);
+}
+
+void Board::initPieceKeys() {
+    pieceKeys = extendedPieceKeys = 0;
+
+    for(int i = 0; i<12; i++) {
+        for(uint64_t pieces = piecesArray[i]; pieces; pieces &= pieces - 1) {
+            int square = __builtin_ctzll(pieces);
+
+            pieceKeys ^= m_pZobrist->getPieceKey((Piece)i, square);
+#ifdef LC_WIDE_POSITION_KEYS
+            extendedPieceKeys ^= m_pZobrist->getExtendedPieceKey((Piece)i, square);
+#endif
+        }
+    }
+}
+
+void Board::updatePieceKeys(Piece movingPiece, Piece placedPiece, const Move& move) {
+    // castling moves the rook as well, recordCapture has run already
+    int rookSquare = 64, rookToSquare = 64;
+    Piece rook = (int)movingPiece < 6 ? Piece::WHITE_ROOK : Piece::BLACK_ROOK;
+
+    if((int)movingPiece % 6 == 5 && abs(move.fromCol - move.toCol) == 2) {
+        bool shortSide = move.toCol == 1;
+
+        rookSquare = move.fromRow*8 + (shortSide ? 0 : 7);
+        rookToSquare = shortSide ? move.toSquare + 1 : move.toSquare - 1;
+    }
+
+    auto getMoveKeys = [&](auto getKey) {
+        uint64_t keys = getKey(movingPiece, move.fromSquare) ^ getKey(placedPiece, move.toSquare);
+
+        if(lastCapturedPiece != Piece::EMPTY) keys ^= getKey(lastCapturedPiece, lastCaptureSquare);
+        if(rookSquare != 64) keys ^= getKey(rook, rookSquare) ^ getKey(rook, rookToSquare);
+
+        return keys;
+    };
+
+    pieceKeys ^= getMoveKeys([this](Piece piece, int square) { return m_pZobrist->getPieceKey(piece, square); });
+#ifdef LC_WIDE_POSITION_KEYS
+    extendedPieceKeys ^= getMoveKeys([this](Piece piece, int square) { return m_pZobrist->getExtendedPieceKey(piece, square); });
+#endif
+}
+
+uint32_t Board::computeVerificationKey(bool whiteToMove) const {
+    uint64_t castlingRights = canWhiteKingShortCastle | (canWhiteKingLongCastle << 1) | (canBlackKingShortCastle << 2) | (canBlackKingLongCastle << 3);
+
+    // independent of the zobrist keys, the boards below and the state word fully describe the position
+    uint64_t parts[8] = {
+        allWhitePiecesBoard, allPiecesBoard,
+        piecesArray[0] | piecesArray[6], piecesArray[1] | piecesArray[7], piecesArray[2] | piecesArray[8],
+        piecesArray[3] | piecesArray[9], piecesArray[4] | piecesArray[10],
+        enpassantSquare | (castlingRights << 8) | ((uint64_t)whiteToMove << 12)
+    };
+
+    uint64_t key = 0;
+
+    for(uint64_t part : parts) {
+        key = (key ^ part) * 0xBF58476D1CE4E5B9ULL;
+        key ^= key >> 31;
+    }
+
+    return (uint32_t)(key >> 32);
+}
+
+uint64_t Board::recordPosition(const Move& move, char choosenPiece) {
+    LC_METRICS_SCOPE(REPETITION_HASH);
+
+    // called before the turn is flipped, hash the position for the side to move next
+    uint64_t positionHash = computePositionHash(!isWhiteTurn);
+
+    positionHistory.push(positionHash, packMove(move.fromSquare, move.toSquare, choosenPiece));
+
+    return positionHash;
+}
+
+void Board::updateGameResult(uint64_t positionHash, bool moverIsWhite) {
+    LC_METRICS_SCOPE(GAME_RESULT);
+
+    PositionFacts facts;
+    uint32_t verificationKey = 0;
+    bool isCached = false;
+
+    // the position may have been solved already by another game
+    if(m_pPositionCache->isEnabled()) {
+        verificationKey = computeVerificationKey(!moverIsWhite);
+        isCached = m_pPositionCache->probe(positionHash, verificationKey, facts);
+    }
+
+    if(!isCached) {
+        // derive the check from the board, so both the validated and the trusted move paths agree
+        LegalMoveContext context;
+        initLegalMoveContext(!moverIsWhite, *this, context);
+
+        facts.checkers = context.checkers;
+        facts.hasLegalMove = hasAnyLegalMove(context, *this);
+        facts.movablePieces = 0;
+        facts.destinationCount = 0;
+        facts.hasDestinationSummary = false;
+
+        m_pPositionCache->store(positionHash, verificationKey, facts);
+    }
+
+    calculateMoveResult(facts.checkers, facts.hasLegalMove, positionHash, moverIsWhite, *this);
+
+    // check for 50 move rule
+    if(halfMovesCount >= 100 && gameResult == GameResult::IN_PROGRESS) {
+        drawBy50HalfMoves = true;
+        setGameResult(GameResult::DRAW_BY_50_HALF_MOVES);
+    }
+}
+
+void Board::recordCapture(Piece capturedPiece, int captureSquare) {
+    lastCapturedPiece = capturedPiece;
+    lastCaptureSquare = capturedPiece == Piece::EMPTY ? 64 : captureSquare;
+    hasLastMove = true;
+}
+
+bool Board::getLastMoveDelta(MoveDelta& delta) const {
+    if(!hasLastMove) return false;
+
+    PackedMove lastMove = positionHistory.getLastMove();
+
+    delta.fromSquare = lastMove & 63;
+    delta.toSquare = (lastMove >> 6) & 63;
+    delta.capturedPiece = lastCapturedPiece;
+    delta.captureSquare = lastCaptureSquare;
+    delta.choosenPiece = (lastMove >> 12) ? " nbrq"[lastMove >> 12] : 0;
+    delta.rookFromSquare = delta.rookToSquare = 64;
+    delta.result = gameResult;
+
+    // castling is the only king move over two files
+    Piece movedPiece = grid[delta.toSquare/8][delta.toSquare%8];
+
+    if((int)movedPiece % 6 == 5 && abs(delta.fromSquare%8 - delta.toSquare%8) == 2) {
+        bool shortSide = delta.toSquare%8 == 1;
+
+        delta.rookFromSquare = shortSide ? delta.toSquare - 1 : delta.toSquare + 2;
+        delta.rookToSquare = shortSide ? delta.toSquare + 1 : delta.toSquare - 1;
+    }
+
+    // derive the check from the board, the trusted move path doesn't run the piece handlers
+    int kingSquare = __builtin_ctzll(getPieceBitBoard(isWhiteTurn ? Piece::WHITE_KING : Piece::BLACK_KING));
+    uint64_t checkers = attackersTo(kingSquare, allPiecesBoard, !isWhiteTurn, *this);
+    int movedToSquare = delta.rookToSquare != 64 ? delta.rookToSquare : delta.toSquare;
+
+    if(checkers == 0) delta.checkType = CheckType::NO_CHECK;
+    else if(checkers & (checkers - 1)) delta.checkType = CheckType::DOUBLE_CHECK;
+    else if(checkers == (1ULL << movedToSquare)) delta.checkType = CheckType::DIRECT_CHECK;
+    else delta.checkType = CheckType::DISCOVERY_CHECK;
+
+    return true;
 }
 
 bool Board::doesColorHaveInsufficientMaterial(bool white) {
@@ -188,55 +711,141 @@ bool Board::isKingUnderCheck(bool white) const {
 }
 
 
+namespace {
+
+// see Board::writeFEN
+size_t copyOutput(const char* pOutput, size_t length, char* pBuffer, size_t size) {
+    if(size == 0) return length;
+
+    if(length < size) {
+        std::memcpy(pBuffer, pOutput, length);
+        pBuffer[length] = 0;
+    }
+    else pBuffer[0] = 0;
+
+    return length;
+}
+
+template<size_t N>
+inline char* writeLiteral(char* pOutput, const char (&text)[N]) {
+    std::memcpy(pOutput, text, N - 1);
+
+    return pOutput + N - 1;
+}
+
+inline char* writeSquare(char* pOutput, int square) {
+    *pOutput++ = 'h' - square%8;
+    *pOutput++ = '1' + square/8;
+
+    return pOutput;
+}
+
+}
+
 std::string Board::getFENString() const {
-    std::string fenString = "";
+    if(fenLength == 0) updateFENCache();
+
+    return std::string(fenCache, fenLength);
+}
+
+size_t Board::writeFEN(char* pBuffer, size_t size) const {
+    if(fenLength == 0) updateFENCache();
+
+    return copyOutput(fenCache, fenLength, pBuffer, size);
+}
+
+size_t Board::writeJSON(char* pBuffer, size_t size) const {
+    if(fenLength == 0) updateFENCache();
+
+    char json[JSON_BUFFER_SIZE];
+    char* pOutput = json;
+
+    pOutput = writeLiteral(pOutput, "{\"fen\":\"");
+    std::memcpy(pOutput, fenCache, fenLength);
+    pOutput += fenLength;
+    pOutput = writeLiteral(pOutput, "\",\"turn\":\"");
+    *pOutput++ = isWhiteTurn ? 'w' : 'b';
+
+    if(isKingUnderCheck(isWhiteTurn)) pOutput = writeLiteral(pOutput, "\",\"check\":true");
+    else pOutput = writeLiteral(pOutput, "\",\"check\":false");
+
+    PackedMove lastMove = positionHistory.getLastMove();
+
+    if(lastMove != 0) {
+        pOutput = writeLiteral(pOutput, ",\"lastMove\":\"");
+        pOutput = writeSquare(pOutput, lastMove & 63);
+        pOutput = writeSquare(pOutput, (lastMove >> 6) & 63);
+        if(lastMove >> 12) *pOutput++ = " nbrq"[lastMove >> 12];
+        *pOutput++ = '"';
+    }
+    else pOutput = writeLiteral(pOutput, ",\"lastMove\":null");
+
+    const char* pResult = gameResultToString[(int)gameResult];
+
+    pOutput = writeLiteral(pOutput, ",\"result\":\"");
+    size_t resultLength = std::strlen(pResult);
+    std::memcpy(pOutput, pResult, resultLength);
+    pOutput += resultLength;
+    pOutput = writeLiteral(pOutput, "\"}");
+
+    return copyOutput(json, pOutput - json, pBuffer, size);
+}
+
+void Board::updateFENCache() const {
+    std::array<char, 64> board = getBoardArray();
+    uint8_t castlingRights = canWhiteKingShortCastle | (canWhiteKingLongCastle << 1) | (canBlackKingShortCastle << 2) | (canBlackKingLongCastle << 3);
+
+    fenLength = formatFEN(board.data(), isWhiteTurn, castlingRights, enpassantSquare, halfMovesCount, movesCount, fenCache);
+}
+
+size_t formatFEN(const char* pBoard, bool whiteTurn, uint8_t castlingRights, int enpassantSquare, int halfMovesCount, int movesCount, char* pOutput) {
+    char* pStart = pOutput;
 
     for(int i = 7; i >= 0; i--) {
         int emptyCount = 0;
+
         for(int j = 7; j >= 0; j--) {
-            if(grid[i][j] == Piece::EMPTY) emptyCount++;
-            else {
-                if(emptyCount) fenString.push_back('0' + emptyCount);
-                fenString.push_back(pieceToChar[(int)grid[i][j]]);
+            char piece = pBoard[i*8 + j];
+
+            if(piece == '.') {
+                emptyCount++;
+                continue;
             }
+
+            if(emptyCount) *pOutput++ = '0' + emptyCount;
+            emptyCount = 0;
+
+            *pOutput++ = piece;
         }
 
-        if(emptyCount) fenString.push_back('0' + emptyCount);
-        if(i!= 0) fenString.push_back('/');
+        if(emptyCount) *pOutput++ = '0' + emptyCount;
+        if(i != 0) *pOutput++ = '/';
     }
 
-    fenString.push_back(' ');
-    fenString.push_back(isWhiteTurn ? 'w' : 'b');
-    
-    fenString.push_back(' ');
-    // Castling Rights
-    std::string castling = "";
-    if (canWhiteKingShortCastle) castling += 'K';
-    if (canWhiteKingLongCastle)  castling += 'Q';
-    if (canBlackKingShortCastle) castling += 'k';
-    if (canBlackKingLongCastle)  castling += 'q';
-    fenString += castling.empty() ? "-" : castling;
+    *pOutput++ = ' ';
+    *pOutput++ = whiteTurn ? 'w' : 'b';
+    *pOutput++ = ' ';
 
-    fenString.push_back(' ');
+    // castling rights
+    if(castlingRights & 1) *pOutput++ = 'K';
+    if(castlingRights & 2) *pOutput++ = 'Q';
+    if(castlingRights & 4) *pOutput++ = 'k';
+    if(castlingRights & 8) *pOutput++ = 'q';
+    if(castlingRights == 0) *pOutput++ = '-';
+
+    *pOutput++ = ' ';
 
     // enpassant square
-    if (enpassantSquare != 64) {
-        char file = 'h' - (enpassantSquare % 8);
-        char rank = '1' + (enpassantSquare / 8);
-        fenString += file;
-        fenString += rank;
-    } else {
-        fenString += "-";
-    }
+    if(enpassantSquare != 64) pOutput = writeSquare(pOutput, enpassantSquare);
+    else *pOutput++ = '-';
 
-    fenString.push_back(' ');
-    fenString += std::to_string(halfMovesCount);
+    *pOutput++ = ' ';
+    pOutput = std::to_chars(pOutput, pStart + Board::FEN_BUFFER_SIZE, halfMovesCount).ptr;
 
-    fenString.push_back(' ');
-    fenString += std::to_string(movesCount/2 + 1);
+    *pOutput++ = ' ';
+    pOutput = std::to_chars(pOutput, pStart + Board::FEN_BUFFER_SIZE, movesCount/2 + 1).ptr;
 
-    return fenString;
+    return pOutput - pStart;
 }
 
-
 };
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "GameCodec.h"
+
+#include <algorithm>
+
+namespace LC {
+
+namespace {
+
+const char MAGIC[4] = {'L', 'C', 'G', 'M'};
+constexpr char VERSION = '1';
+
+constexpr size_t BUFFER_SIZE = 1 << 16;
+
+// the range is renormalized once it drops below 2^24, so a total of up to 2^16 keeps 8 bits of precision
+constexpr uint32_t RANGE_TOP = 1 << 24;
+
+// static model: every legal move has the same frequency, the end of a game has frequency 1
+constexpr uint32_t MOVE_FREQUENCY = 64;
+
+// before every game: another game (255) or the end of the stream (1)
+constexpr uint32_t STREAM_TOTAL = 256;
+constexpr uint32_t GAME_FREQUENCY = 255;
+
+}
+
+GameEncoder::GameEncoder(std::ostream& output, MoveCoding coding) : m_output(output), m_coding(coding), m_pGame(std::make_unique<LegalChess>()) {
+    m_buffer.reserve(BUFFER_SIZE);
+    m_buffer.insert(m_buffer.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    m_buffer.push_back(VERSION);
+    m_buffer.push_back((char)m_coding);
+}
+
+GameEncoder::~GameEncoder() {
+    finish();
+}
+
+void GameEncoder::addMove(const std::string& uciMove) {
+    if(m_finished) throw GameCodecException("The game stream is finished. Cannot add move " + uciMove + ".");
+
+    PackedMove moves[LegalChess::MAX_LEGAL_MOVES];
+    size_t count = m_pGame->getLegalMoves(moves);
+
+    PackedMove packedMove = packMove(uciMove);
+    size_t index = std::find(moves, moves + count, packedMove) - moves;
+
+    if(index == count) {
+        // makeMove throws the reason the move is illegal
+        if(!m_pGame->isLegal(uciMove)) m_pGame->makeMove(uciMove);
+
+        throw GameCodecException("The move can't be encoded. Move number: " + std::to_string(m_pGame->getMoveNumber() + 1) + ". Move: " + uciMove);
+    }
+
+    m_pGame->makeMove(uciMove);
+
+    if(!m_inGame && m_coding == MoveCoding::ARITHMETIC) encodeSymbol(0, GAME_FREQUENCY, STREAM_TOTAL);
+    m_inGame = true;
+
+    if(m_coding == MoveCoding::INDEX_BYTES) putByte(index);
+    else encodeSymbol(index*MOVE_FREQUENCY, MOVE_FREQUENCY, count*MOVE_FREQUENCY + 1);
+}
+
+void GameEncoder::endGame() {
+    if(m_finished) throw GameCodecException("The game stream is finished. Cannot end a game.");
+
+    PackedMove moves[LegalChess::MAX_LEGAL_MOVES];
+    size_t count = m_pGame->getLegalMoves(moves);
+
+    if(!m_inGame && m_coding == MoveCoding::ARITHMETIC) encodeSymbol(0, GAME_FREQUENCY, STREAM_TOTAL);
+
+    if(m_coding == MoveCoding::INDEX_BYTES) putByte(count);
+    else encodeSymbol(count*MOVE_FREQUENCY, 1, count*MOVE_FREQUENCY + 1);
+
+    m_pGame = std::make_unique<LegalChess>();
+    m_inGame = false;
+}
+
+void GameEncoder::encodeGame(const std::string& uciMoves) {
+    for(size_t end = 0, start = uciMoves.find_first_not_of(" \t\r\n"); start != std::string::npos; start = uciMoves.find_first_not_of(" \t\r\n", end)) {
+        end = uciMoves.find_first_of(" \t\r\n", start);
+        addMove(uciMoves.substr(start, end == std::string::npos ? std::string::npos : end - start));
+    }
+
+    endGame();
+}
+
+void GameEncoder::finish() {
+    if(m_finished) return;
+
+    if(m_inGame) endGame();
+
+    if(m_coding == MoveCoding::ARITHMETIC) {
+        encodeSymbol(GAME_FREQUENCY, STREAM_TOTAL - GAME_FREQUENCY, STREAM_TOTAL);
+
+        for(int i = 0; i < 5; i++) shiftLow();
+    }
+
+    m_finished = true;
+
+    flushBuffer();
+    m_output.flush();
+}
+
+void GameEncoder::encodeSymbol(uint32_t start, uint32_t size, uint32_t total) {
+    m_range /= total;
+    m_low += (uint64_t)start*m_range;
+    m_range *= size;
+
+    while(m_range < RANGE_TOP) {
+        m_range <<= 8;
+        shiftLow();
+    }
+}
+
+void GameEncoder::shiftLow() {
+    // a byte is only written once a carry can't change it anymore, a run of 0xFF bytes waits in m_cacheSize
+    if((uint32_t)m_low < 0xFF000000u || (m_low >> 32) != 0) {
+        uint8_t carry = m_low >> 32;
+        uint8_t byte = m_cache;
+
+        do {
+            putByte(byte + carry);
+            byte = 0xFF;
+        } while(--m_cacheSize != 0);
+
+        m_cache = (uint8_t)(m_low >> 24);
+    }
+
+    m_cacheSize++;
+    m_low = (m_low & 0x00FFFFFF) << 8;
+}
+
+void GameEncoder::putByte(uint8_t byte) {
+    m_buffer.push_back((char)byte);
+
+    if(m_buffer.size() >= BUFFER_SIZE) flushBuffer();
+}
+
+void GameEncoder::flushBuffer() {
+    m_output.write(m_buffer.data(), m_buffer.size());
+    m_buffer.clear();
+}
+
+
+GameDecoder::GameDecoder(std::istream& input) : m_input(input), m_pGame(std::make_unique<LegalChess>()) {
+    char header[sizeof(MAGIC) + 2];
+
+    for(char& c : header) {
+        int byte = getByte();
+        if(byte < 0) throw GameCodecException("The stream is not a game stream.");
+
+        c = (char)byte;
+    }
+
+    if(!std::equal(MAGIC, MAGIC + sizeof(MAGIC), header) || header[sizeof(MAGIC)] != VERSION || (uint8_t)header[sizeof(MAGIC) + 1] > (uint8_t)MoveCoding::ARITHMETIC) {
+        throw GameCodecException("The stream is not a game stream of this version.");
+    }
+
+    m_coding = (MoveCoding)header[sizeof(MAGIC) + 1];
+
+    if(m_coding == MoveCoding::ARITHMETIC) {
+        for(int i = 0; i < 5; i++) m_code = (m_code << 8) | (uint8_t)std::max(getByte(), 0);
+    }
+}
+
+bool GameDecoder::beginGame() {
+    std::string move;
+
+    while(m_inGame) nextMove(move);
+
+    if(m_ended) return false;
+
+    if(m_coding == MoveCoding::INDEX_BYTES) {
+        // the stream ends after the last game
+        int byte = getByte();
+
+        if(byte < 0) {
+            m_ended = true;
+            return false;
+        }
+
+        m_position--;
+    }
+    else if(decodeFrequency(STREAM_TOTAL) >= GAME_FREQUENCY) {
+        decodeUpdate(GAME_FREQUENCY, STREAM_TOTAL - GAME_FREQUENCY);
+        m_ended = true;
+        return false;
+    }
+    else decodeUpdate(0, GAME_FREQUENCY);
+
+    m_pGame = std::make_unique<LegalChess>();
+    m_inGame = true;
+
+    return true;
+}
+
+bool GameDecoder::nextMove(std::string& uciMove) {
+    if(!m_inGame) return false;
+
+    PackedMove moves[LegalChess::MAX_LEGAL_MOVES];
+    size_t count = m_pGame->getLegalMoves(moves);
+    size_t index;
+
+    if(m_coding == MoveCoding::INDEX_BYTES) {
+        int byte = getByte();
+
+        if(byte < 0) throw GameCodecException("The game stream ends inside a game. Move number: " + std::to_string(m_pGame->getMoveNumber() + 1));
+        if((size_t)byte > count) throw GameCodecException("Invalid move index " + std::to_string(byte) + ". Move number: " + std::to_string(m_pGame->getMoveNumber() + 1));
+
+        index = byte;
+    }
+    else {
+        uint32_t total = count*MOVE_FREQUENCY + 1;
+
+        index = std::min<size_t>(decodeFrequency(total)/MOVE_FREQUENCY, count);
+        decodeUpdate(index*MOVE_FREQUENCY, index == count ? 1 : MOVE_FREQUENCY);
+    }
+
+    if(index == count) {
+        m_inGame = false;
+        return false;
+    }
+
+    uciMove = unpackMove(moves[index]);
+
+    // the move comes from the legal moves, the result is detected for the moves of the next position
+    m_pGame->makeTrustedMove(uciMove, true);
+
+    return true;
+}
+
+bool GameDecoder::decodeGame(std::string& uciMoves) {
+    if(!beginGame()) return false;
+
+    std::string move;
+    uciMoves.clear();
+
+    while(nextMove(move)) {
+        if(!uciMoves.empty()) uciMoves.push_back(' ');
+        uciMoves += move;
+    }
+
+    return true;
+}
+
+uint32_t GameDecoder::decodeFrequency(uint32_t total) {
+    m_range /= total;
+
+    return std::min(m_code/m_range, total - 1);
+}
+
+void GameDecoder::decodeUpdate(uint32_t start, uint32_t size) {
+    m_code -= start*m_range;
+    m_range *= size;
+
+    // past the end of the stream the coder reads zeros
+    while(m_range < RANGE_TOP) {
+        m_code = (m_code << 8) | (uint8_t)std::max(getByte(), 0);
+        m_range <<= 8;
+    }
+}
+
+int GameDecoder::getByte() {
+    if(m_position == m_buffer.size()) {
+        m_buffer.resize(BUFFER_SIZE);
+        m_input.read(m_buffer.data(), BUFFER_SIZE);
+        m_buffer.resize(m_input.gcount());
+        m_position = 0;
+
+        if(m_buffer.empty()) return -1;
+    }
+
+    return (uint8_t)m_buffer[m_position++];
+}
+
+};
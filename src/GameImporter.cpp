@@ -0,0 +1,227 @@
+#include "GameImporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace LC {
+
+namespace {
+
+// games a thread claims at a time
+constexpr size_t CHUNK_SIZE = 64;
+
+inline uint64_t rotateLeft(uint64_t value, int shift) {
+    return (value << shift) | (value >> (64 - shift));
+}
+
+inline uint64_t mix(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+
+    return value ^ (value >> 31);
+}
+
+// second lane of the key of a final position. wide builds have one, the others hash the placement, the side to move
+// and the castling rights of the FEN (the en passant file is only in the first lane)
+inline uint64_t getSecondPositionLane(const LegalChess& game, const PositionKey& key) {
+#ifdef LC_WIDE_POSITION_KEYS
+    (void)game;
+    return key.extendedHash;
+#else
+    (void)key;
+
+    char fen[LegalChess::FEN_BUFFER_SIZE];
+    size_t length = std::min(game.writeFEN(fen, sizeof(fen)), sizeof(fen) - 1);
+    uint64_t lane = 0x452821E638D01377ULL;
+
+    for(size_t index = 0, fields = 0; index < length; index++) {
+        if(fen[index] == ' ' && ++fields == 3) break;
+        lane = rotateLeft((lane ^ (uint8_t)fen[index]) * 0x9E3779B97F4A7C15ULL, 29);
+    }
+
+    return mix(lane);
+#endif
+}
+
+// runs work(i) for every i below count on up to threadCount threads, the calling thread included
+template<class F>
+void runParallel(size_t count, unsigned threadCount, const F& work) {
+    std::atomic<size_t> next{0};
+
+    auto worker = [&]() {
+        for(size_t begin = next.fetch_add(CHUNK_SIZE); begin < count; begin = next.fetch_add(CHUNK_SIZE)) {
+            for(size_t index = begin; index < std::min(count, begin + CHUNK_SIZE); index++) work(index);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    unsigned helperCount = std::min<size_t>(threadCount, (count + CHUNK_SIZE - 1)/CHUNK_SIZE);
+
+    for(unsigned index = 1; index < helperCount; index++) threads.emplace_back(worker);
+
+    worker();
+
+    for(auto& thread : threads) thread.join();
+}
+
+}
+
+bool fingerprintMoves(const std::string& uciMoves, GameFingerprint& fingerprint) {
+    const char* pText = uciMoves.data();
+    size_t length = uciMoves.length();
+
+    uint64_t lane1 = 0x243F6A8885A308D3ULL, lane2 = 0x13198A2E03707344ULL, plies = 0;
+
+    for(size_t index = 0; index < length;) {
+        if(pText[index] == ' ' || pText[index] == '\t' || pText[index] == '\r' || pText[index] == '\n') {
+            index++;
+            continue;
+        }
+
+        size_t start = index;
+        while(index < length && pText[index] != ' ' && pText[index] != '\t' && pText[index] != '\r' && pText[index] != '\n') index++;
+
+        PackedMove move = packMove(pText + start, index - start);
+        if(move == 0) return false;
+
+        // different operations and constants in the two lanes, so a sequence that collides in one doesn't in the other
+        lane1 = rotateLeft((lane1 ^ move) * 0x9E3779B97F4A7C15ULL, 23);
+        lane2 = rotateLeft((lane2 + move) * 0xC2B2AE3D27D4EB4FULL, 31);
+        plies++;
+    }
+
+    fingerprint.hash = mix(lane1 ^ plies);
+    fingerprint.check = mix(lane2 + (plies << 32));
+
+    return true;
+}
+
+
+FingerprintSet::FingerprintSet() : m_pShards(std::make_unique<Shard[]>(SHARD_COUNT)) {}
+
+void FingerprintSet::insert(const GameFingerprint& fingerprint, uint64_t gameNumber) {
+    Shard& shard = getShard(fingerprint);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto inserted = shard.games.emplace(fingerprint, FirstGame{gameNumber, GameResult::IN_PROGRESS, false});
+    if(!inserted.second) inserted.first->second.gameNumber = std::min(inserted.first->second.gameNumber, gameNumber);
+}
+
+FingerprintSet::FirstGame FingerprintSet::find(const GameFingerprint& fingerprint) const {
+    Shard& shard = getShard(fingerprint);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    return shard.games.find(fingerprint)->second;
+}
+
+void FingerprintSet::setOutcome(const GameFingerprint& fingerprint, GameResult result, bool valid) {
+    Shard& shard = getShard(fingerprint);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    FirstGame& game = shard.games.find(fingerprint)->second;
+    game.result = result;
+    game.valid = valid;
+}
+
+size_t FingerprintSet::size() const {
+    size_t size = 0;
+
+    for(size_t index = 0; index < SHARD_COUNT; index++) {
+        std::lock_guard<std::mutex> lock(m_pShards[index].mutex);
+        size += m_pShards[index].games.size();
+    }
+
+    return size;
+}
+
+
+GameImporter::GameImporter(unsigned threadCount) : m_threadCount(threadCount) {
+    if(m_threadCount == 0) m_threadCount = std::max(1u, std::thread::hardware_concurrency());
+}
+
+ImportStats GameImporter::import(const std::vector<std::string>& games, std::vector<ImportedGame>& results) {
+    size_t count = games.size();
+    uint64_t firstNumber = m_importedCount;
+
+    std::vector<GameFingerprint> moveFingerprints(count), positionFingerprints(count);
+    std::vector<uint8_t> hasFingerprint(count);
+
+    results.assign(count, ImportedGame{ImportStatus::VALID, GameResult::IN_PROGRESS, 0, std::string()});
+
+    // all fingerprints go in before any lookup, so the first game of a sequence is known before validating
+    runParallel(count, m_threadCount, [&](size_t index) {
+        hasFingerprint[index] = fingerprintMoves(games[index], moveFingerprints[index]);
+        if(hasFingerprint[index]) m_moveSequences.insert(moveFingerprints[index], firstNumber + index);
+    });
+
+    // only the first game of a sequence is replayed
+    runParallel(count, m_threadCount, [&](size_t index) {
+        ImportedGame& result = results[index];
+
+        if(hasFingerprint[index] && m_moveSequences.find(moveFingerprints[index]).gameNumber != firstNumber + index) {
+            result.status = ImportStatus::DUPLICATE;
+            return;
+        }
+
+        try {
+            LegalChess game(games[index], ReplayMode::VALIDATED);
+            PositionKey key = game.getPositionKey();
+
+            result.result = game.getGameResult();
+
+            positionFingerprints[index].hash = key.hash;
+            positionFingerprints[index].check = getSecondPositionLane(game, key) ^ mix(((uint64_t)game.getMoveNumber() << 8) | (uint64_t)result.result);
+
+            m_finalPositions.insert(positionFingerprints[index], firstNumber + index);
+        }
+        catch(const std::exception& e) {
+            result.status = ImportStatus::INVALID;
+            result.error = e.what();
+        }
+
+        if(hasFingerprint[index]) m_moveSequences.setOutcome(moveFingerprints[index], result.result, result.status == ImportStatus::VALID);
+    });
+
+    // duplicates take the outcome of the first game, and transpositions are known once all final positions are in
+    runParallel(count, m_threadCount, [&](size_t index) {
+        ImportedGame& result = results[index];
+
+        if(result.status == ImportStatus::DUPLICATE) {
+            FingerprintSet::FirstGame first = m_moveSequences.find(moveFingerprints[index]);
+
+            result.duplicateOf = first.gameNumber;
+            result.result = first.result;
+
+            if(!first.valid) {
+                result.status = ImportStatus::INVALID;
+                result.error = "Same moves as invalid game " + std::to_string(first.gameNumber);
+            }
+        }
+        else if(result.status == ImportStatus::VALID) {
+            uint64_t firstGame = m_finalPositions.find(positionFingerprints[index]).gameNumber;
+
+            if(firstGame != firstNumber + index) {
+                result.status = ImportStatus::TRANSPOSITION;
+                result.duplicateOf = firstGame;
+            }
+        }
+    });
+
+    m_importedCount += count;
+
+    ImportStats stats;
+
+    for(const ImportedGame& result : results) {
+        if(result.status == ImportStatus::VALID) stats.valid++;
+        else if(result.status == ImportStatus::INVALID) stats.invalid++;
+        else if(result.status == ImportStatus::DUPLICATE) stats.duplicates++;
+        else stats.transpositions++;
+    }
+
+    return stats;
+}
+
+};
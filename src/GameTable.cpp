@@ -0,0 +1,323 @@
+#include "GameTable.h"
+#include "SlidingAttacks.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace LC {
+
+namespace {
+
+// see BatchValidator.cpp, one game per lane
+typedef uint64_t LaneBoards __attribute__((vector_size(BATCH_LANES * sizeof(uint64_t))));
+
+template<class T>
+inline T load(const std::vector<uint64_t>& column, size_t row) {
+    T value;
+    memcpy(&value, column.data() + row, sizeof(T));
+
+    return value;
+}
+
+// all bits set in the lanes of the rows with white to move
+template<class T>
+inline T loadTurns(const std::vector<uint8_t>& column, size_t row) {
+    T value;
+    for(int lane = 0; lane < (int)(sizeof(T) / sizeof(uint64_t)); lane++) value[lane] = -(uint64_t)column[row + lane];
+
+    return value;
+}
+
+template<>
+inline uint64_t loadTurns<uint64_t>(const std::vector<uint8_t>& column, size_t row) {
+    return -(uint64_t)column[row];
+}
+
+inline uint64_t laneMask(uint64_t bitBoard) {
+    return bitBoard != 0;
+}
+
+template<class T>
+inline uint64_t laneMask(T bitBoards) {
+    uint64_t mask = 0;
+    for(int lane = 0; lane < (int)(sizeof(T) / sizeof(uint64_t)); lane++) mask |= (uint64_t)(bitBoards[lane] != 0) << lane;
+
+    return mask;
+}
+
+template<class T>
+inline T blackPawnAttacks(T pawns) {
+    return (shiftBy<-7>(pawns) & NOT_COLUMN_0) | (shiftBy<-9>(pawns) & NOT_COLUMN_7);
+}
+
+}
+
+GameTable::GameTable() : m_pCursor(std::make_unique<LegalChess>()) {}
+
+void GameTable::reserve(size_t games) {
+    size_t paddedSize = (games + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+
+    for(int piece = 0; piece < 12; piece++) m_pieces[piece].reserve(paddedSize);
+    for(int color = 0; color < 2; color++) m_colors[color].reserve(paddedSize);
+
+    m_turns.reserve(paddedSize);
+    m_castlingRights.reserve(paddedSize);
+    m_enpassantSquares.reserve(paddedSize);
+    m_halfMoves.reserve(paddedSize);
+    m_moveNumbers.reserve(paddedSize);
+    m_repetitions.reserve(paddedSize);
+    m_results.reserve(paddedSize);
+    m_histories.reserve(paddedSize);
+}
+
+size_t GameTable::addGame() {
+    Board board;
+
+    reserveRow(m_size);
+    storeRow(m_size, board);
+
+    return m_size++;
+}
+
+size_t GameTable::addGame(const LegalChess& game) {
+    reserveRow(m_size);
+    storeRow(m_size, *game.m_pBoard);
+
+    // the game goes on independently, both histories freeze the shared tail
+    m_histories[m_size] = game.m_pBoard->positionHistory;
+
+    return m_size++;
+}
+
+void GameTable::removeGame(size_t row) {
+    checkRow(row);
+
+    size_t last = m_size - 1;
+
+    for(int piece = 0; piece < 12; piece++) {
+        m_pieces[piece][row] = m_pieces[piece][last];
+        m_pieces[piece][last] = 0;
+    }
+
+    for(int color = 0; color < 2; color++) {
+        m_colors[color][row] = m_colors[color][last];
+        m_colors[color][last] = 0;
+    }
+
+    // the padding rows stay empty, the sweeps read them
+    m_turns[row] = m_turns[last];
+    m_castlingRights[row] = m_castlingRights[last];
+    m_enpassantSquares[row] = m_enpassantSquares[last];
+    m_halfMoves[row] = m_halfMoves[last];
+    m_moveNumbers[row] = m_moveNumbers[last];
+    m_repetitions[row] = m_repetitions[last];
+    m_results[row] = m_results[last];
+    m_histories[row] = std::move(m_histories[last]);
+
+    m_turns[last] = m_castlingRights[last] = m_repetitions[last] = 0;
+    m_enpassantSquares[last] = 64;
+    m_halfMoves[last] = m_moveNumbers[last] = 0;
+    m_results[last] = GameResult::IN_PROGRESS;
+    m_histories[last].clear();
+
+    if(m_cursorRow == row) m_cursorRow = NO_ROW;
+    if(m_cursorRow == last) m_cursorRow = row;
+
+    m_size--;
+}
+
+void GameTable::updateGame(size_t row, const LegalChess& game) {
+    checkRow(row);
+
+    storeRow(row, *game.m_pBoard);
+    m_histories[row] = game.m_pBoard->positionHistory;
+
+    if(m_cursorRow == row) m_cursorRow = NO_ROW;
+}
+
+GameResult GameTable::makeMove(size_t row, const std::string& uciMove) {
+    checkRow(row);
+
+    if(m_cursorRow != row) loadRow(row);
+
+    // the row gives its history to the cursor, a history used by one board grows its newest chunk in place
+    Board& board = *m_pCursor->m_pBoard;
+    board.positionHistory = std::move(m_histories[row]);
+
+    GameResult result;
+
+    try {
+        result = m_pCursor->makeMove(uciMove);
+    }
+    catch(...) {
+        m_histories[row] = std::move(board.positionHistory);
+        throw;
+    }
+
+    storeRow(row, board);
+    m_histories[row] = std::move(board.positionHistory);
+
+    return result;
+}
+
+const LegalChess& GameTable::getGame(size_t row) {
+    checkRow(row);
+
+    if(m_cursorRow != row) loadRow(row);
+    else m_pCursor->m_pBoard->positionHistory = m_histories[row];
+
+    return *m_pCursor;
+}
+
+template<class T>
+T GameTable::findCheckLanes(size_t row) const {
+    T white = loadTurns<T>(m_turns, row);
+
+    T own[6], opponent[6];
+
+    for(int type = 0; type < 6; type++) {
+        T whitePieces = load<T>(m_pieces[type], row), blackPieces = load<T>(m_pieces[type + 6], row);
+
+        own[type] = (white & whitePieces) | (~white & blackPieces);
+        opponent[type] = (white & blackPieces) | (~white & whitePieces);
+    }
+
+    T empty = ~(load<T>(m_colors[0], row) | load<T>(m_colors[1], row));
+    T king = own[5];
+
+    // the pieces that would attack the king if they stood on its square, of the opponent's type
+    T pawnAttacks = (white & whitePawnAttacks(king)) | (~white & blackPawnAttacks(king));
+
+    return (pawnAttacks & opponent[0]) |
+           (knightAttacks(king) & opponent[1]) |
+           (bishopAttacks(king, empty) & (opponent[2] | opponent[4])) |
+           (rookAttacks(king, empty) & (opponent[3] | opponent[4])) |
+           (kingAttacks(king) & opponent[5]);
+}
+
+void GameTable::findChecks(std::vector<size_t>& rows) const {
+    rows.clear();
+
+    // the columns are padded to whole vectors and the padding rows have no pieces
+    size_t row = 0;
+
+    if(BATCH_LANES > 1) {
+        for(; row < m_size; row += BATCH_LANES) {
+            uint64_t checks = laneMask(findCheckLanes<LaneBoards>(row));
+
+            while(checks) {
+                size_t index = row + __builtin_ctzll(checks);
+                checks &= checks - 1;
+
+                if(index < m_size && m_results[index] == GameResult::IN_PROGRESS) rows.push_back(index);
+            }
+        }
+    }
+
+    for(; row < m_size; row++) {
+        if(findCheckLanes<uint64_t>(row) && m_results[row] == GameResult::IN_PROGRESS) rows.push_back(row);
+    }
+}
+
+void GameTable::computeMaterialBalance(std::vector<int>& balances) const {
+    balances.resize(m_size);
+
+    const uint64_t* pPieces[12];
+    for(int piece = 0; piece < 12; piece++) pPieces[piece] = m_pieces[piece].data();
+
+    for(size_t row = 0; row < m_size; row++) {
+        int balance = 0;
+
+        balance += __builtin_popcountll(pPieces[0][row]) - __builtin_popcountll(pPieces[6][row]);
+        balance += 3*(__builtin_popcountll(pPieces[1][row] | pPieces[2][row]) - __builtin_popcountll(pPieces[7][row] | pPieces[8][row]));
+        balance += 5*(__builtin_popcountll(pPieces[3][row]) - __builtin_popcountll(pPieces[9][row]));
+        balance += 9*(__builtin_popcountll(pPieces[4][row]) - __builtin_popcountll(pPieces[10][row]));
+
+        balances[row] = balance;
+    }
+}
+
+void GameTable::findNearDraws(int minHalfMoves, int minRepetitions, std::vector<size_t>& rows) const {
+    rows.clear();
+
+    for(size_t row = 0; row < m_size; row++) {
+        if((m_halfMoves[row] >= minHalfMoves || m_repetitions[row] >= minRepetitions) && m_results[row] == GameResult::IN_PROGRESS) rows.push_back(row);
+    }
+}
+
+size_t GameTable::getMemoryUsage() const {
+    size_t bytes = m_turns.capacity() + m_castlingRights.capacity() + m_enpassantSquares.capacity() + m_repetitions.capacity();
+
+    for(int piece = 0; piece < 12; piece++) bytes += m_pieces[piece].capacity()*sizeof(uint64_t);
+    for(int color = 0; color < 2; color++) bytes += m_colors[color].capacity()*sizeof(uint64_t);
+
+    bytes += (m_halfMoves.capacity() + m_moveNumbers.capacity())*sizeof(uint16_t);
+    bytes += m_results.capacity()*sizeof(GameResult) + m_histories.capacity()*sizeof(PositionHistory);
+
+    return bytes;
+}
+
+void GameTable::checkRow(size_t row) const {
+    if(row >= m_size) throw GameTableException("Row " + std::to_string(row) + " is not in the table. Games: " + std::to_string(m_size));
+}
+
+void GameTable::reserveRow(size_t row) {
+    if(row < m_turns.size()) return;
+
+    size_t paddedSize = (row + BATCH_LANES) / BATCH_LANES * BATCH_LANES;
+
+    for(int piece = 0; piece < 12; piece++) m_pieces[piece].resize(paddedSize, 0);
+    for(int color = 0; color < 2; color++) m_colors[color].resize(paddedSize, 0);
+
+    m_turns.resize(paddedSize, 0);
+    m_castlingRights.resize(paddedSize, 0);
+    m_enpassantSquares.resize(paddedSize, 64);
+    m_halfMoves.resize(paddedSize, 0);
+    m_moveNumbers.resize(paddedSize, 0);
+    m_repetitions.resize(paddedSize, 0);
+    m_results.resize(paddedSize, GameResult::IN_PROGRESS);
+    m_histories.resize(paddedSize);
+}
+
+void GameTable::storeRow(size_t row, const Board& board) {
+    for(int piece = 0; piece < 12; piece++) m_pieces[piece][row] = board.getPieceBitBoard((Piece)piece);
+
+    m_colors[0][row] = board.getColorBitBoard(true);
+    m_colors[1][row] = board.getColorBitBoard(false);
+
+    m_turns[row] = board.isWhiteTurn;
+    m_castlingRights[row] = board.canWhiteKingShortCastle | (board.canWhiteKingLongCastle << 1) | (board.canBlackKingShortCastle << 2) | (board.canBlackKingLongCastle << 3);
+    m_enpassantSquares[row] = board.enpassantSquare;
+    m_halfMoves[row] = board.halfMovesCount;
+    m_moveNumbers[row] = board.getMoveNumber();
+    m_repetitions[row] = board.getMoveNumber() == 0 ? 0 : std::min(board.countRepetitions(board.getPositionKey().hash), 255);
+    m_results[row] = board.getGameResult();
+}
+
+void GameTable::loadRow(size_t row) {
+    BoardSnapshot snapshot;
+
+    memset(snapshot.grid, (int)Piece::EMPTY, sizeof(snapshot.grid));
+
+    for(int piece = 0; piece < 12; piece++) {
+        for(uint64_t pieces = m_pieces[piece][row]; pieces; pieces &= pieces - 1) snapshot.grid[__builtin_ctzll(pieces)] = piece;
+    }
+
+    snapshot.enpassantSquare = m_enpassantSquares[row];
+    snapshot.halfMovesCount = m_halfMoves[row];
+    snapshot.movesCount = m_moveNumbers[row];
+    snapshot.isWhiteTurn = m_turns[row];
+    snapshot.castlingRights = m_castlingRights[row];
+
+    Board& board = *m_pCursor->m_pBoard;
+
+    board.loadSnapshot(snapshot);
+    board.positionHistory = m_histories[row];
+
+    // loading clears the result, the history is back for the draw rules
+    if(m_results[row] != GameResult::IN_PROGRESS) m_pCursor->detectGameResult();
+
+    m_cursorRow = row;
+}
+
+};
@@ -0,0 +1,76 @@
+#include "GameTimeline.h"
+
+namespace LC {
+
+GameTimeline::GameTimeline(int checkpointInterval) : m_checkpointInterval(checkpointInterval), m_pHead(std::make_unique<LegalChess>()), m_pCursor(std::make_unique<LegalChess>()) {
+    if(m_checkpointInterval < 1) throw GameTimelineException("The checkpoint interval must be at least 1. Interval: " + std::to_string(checkpointInterval));
+
+    m_checkpoints.emplace_back();
+    m_pHead->m_pBoard->saveSnapshot(m_checkpoints.back());
+    m_histories.push_back(m_pHead->m_pBoard->positionHistory);
+}
+
+GameTimeline::GameTimeline(const std::string& uciMoves, int checkpointInterval) : GameTimeline(checkpointInterval) {
+    for(size_t end = 0, start = uciMoves.find_first_not_of(" \t\r\n"); start != std::string::npos; start = uciMoves.find_first_not_of(" \t\r\n", end)) {
+        end = uciMoves.find_first_of(" \t\r\n", start);
+        addMove(uciMoves.substr(start, end == std::string::npos ? std::string::npos : end - start));
+    }
+
+    // a finished game is mostly reviewed, not extended
+    m_moves.shrink_to_fit();
+    m_positionHashes.shrink_to_fit();
+    m_checkpoints.shrink_to_fit();
+    m_histories.shrink_to_fit();
+}
+
+GameResult GameTimeline::addMove(const std::string& uciMove) {
+    GameResult result = m_pHead->makeMove(uciMove);
+
+    m_moves.push_back(packMove(uciMove));
+    m_positionHashes.push_back(m_pHead->getPositionKey().hash);
+
+    if(m_moves.size() % m_checkpointInterval == 0) {
+        m_checkpoints.emplace_back();
+        m_pHead->m_pBoard->saveSnapshot(m_checkpoints.back());
+    }
+
+    if(m_moves.size() % PositionHistory::CHUNK_SIZE == 0) m_histories.push_back(m_pHead->m_pBoard->positionHistory);
+
+    return result;
+}
+
+const LegalChess& GameTimeline::seek(int ply) {
+    if(ply < 0 || ply > (int)m_moves.size()) {
+        throw GameTimelineException("Ply " + std::to_string(ply) + " is not in the game. Plies: " + std::to_string(m_moves.size()));
+    }
+
+    int checkpoint = ply/m_checkpointInterval;
+    int checkpointPly = checkpoint*m_checkpointInterval;
+
+    // stepping forward past the checkpoint replays from the current ply instead
+    if(ply < m_cursorPly || m_cursorPly < checkpointPly) {
+        Board& board = *m_pCursor->m_pBoard;
+        board.loadSnapshot(m_checkpoints[checkpoint]);
+
+        // shares the history up to the last full chunk before the checkpoint, pushes the rest
+        int historyPly = checkpointPly/PositionHistory::CHUNK_SIZE*PositionHistory::CHUNK_SIZE;
+        board.positionHistory = m_histories[historyPly/PositionHistory::CHUNK_SIZE];
+
+        for(int index = historyPly; index < checkpointPly; index++) board.positionHistory.push(m_positionHashes[index], m_moves[index]);
+
+        m_cursorPly = checkpointPly;
+    }
+
+    // the moves were validated when they were added, only the last position of the game can be decided
+    for(; m_cursorPly < ply; m_cursorPly++) m_pCursor->makeTrustedMove(unpackMove(m_moves[m_cursorPly]));
+
+    if(ply == (int)m_moves.size()) m_pCursor->detectGameResult();
+
+    return *m_pCursor;
+}
+
+size_t GameTimeline::getMemoryUsage() const {
+    return m_moves.capacity()*sizeof(PackedMove) + m_positionHashes.capacity()*sizeof(uint64_t) + m_checkpoints.capacity()*sizeof(BoardSnapshot) + m_histories.capacity()*sizeof(PositionHistory);
+}
+
+};
@@ -1,5 +1,6 @@
 #include "Helper.h"
 #include "Board.h"
+#include "Metrics.h"
 
 namespace LC {
 
@@ -10,10 +11,13 @@ uint64_t knightAttackSquares[64];
 uint64_t bishopAttackSquares[64];
 uint64_t rookAttackSquares[64];
 uint64_t kingAttackSquares[64];
+uint64_t pawnAttackSquares[2][64];
 
 uint64_t rangeMasks[64][64];
 
+#ifndef LC_TABLE_FREE_SLIDERS
 std::vector<std::vector<uint64_t>> rookAttacksForOccupancy(64), bishopAttacksForOccupancy(64);
+#endif
 
 int power(int base, int exp) {
     if(exp == 0) return 1;
@@ -109,6 +113,14 @@ void compute() {
 
         kingAttackSquares[sq] = kingAttacks;
 
+        // pawn attacks
+        pawnAttackSquares[0][sq] = pawnAttackSquares[1][sq] = 0;
+
+        if(row < 7 && col > 0) pawnAttackSquares[1][sq] |= (1ULL << (sq + 7));
+        if(row < 7 && col < 7) pawnAttackSquares[1][sq] |= (1ULL << (sq + 9));
+        if(row > 0 && col > 0) pawnAttackSquares[0][sq] |= (1ULL << (sq - 9));
+        if(row > 0 && col < 7) pawnAttackSquares[0][sq] |= (1ULL << (sq - 7));
+
         // rook Attacks
         uint64_t rookAttacks = (rangeMasks[row*8][row*8+7] | rangeMasks[col][56+col]);
         rookAttacks &= ~(1ULL << sq);
@@ -133,6 +145,7 @@ void compute() {
         bishopAttackSquares[sq] = bishopAttacks;
     }
 
+#ifndef LC_TABLE_FREE_SLIDERS
     // rookAttacksForOccupancy.resize(64);
     // bishopAttacksForOccupancy.resize(64);
 
@@ -295,6 +308,7 @@ void compute() {
             bishopAttacksForOccupancy[sq][config] = legalAttacks;
         }
     }
+#endif
 }
 
 // struct PrecomputeInit {
@@ -307,193 +321,7 @@ void compute() {
 // static PrecomputeInit obj;
 
 
-PinDirection getPinDirection(bool white, int pieceSquare, Board & board, bool updateDiscoveryCheckSquare) {
-    int rank = pieceSquare / 8;
-    int file = pieceSquare % 8;
-
-    uint8_t kingSquare = __builtin_ctzll(board.getPieceBitBoard(white ? Piece::WHITE_KING : Piece::BLACK_KING));
-
-    uint8_t ki = kingSquare / 8, kj = kingSquare % 8;
-
-    uint64_t inBetweenMask = rangeMasks[pieceSquare][kingSquare];
-    inBetweenMask &= ~(1ULL << kingSquare);
-    inBetweenMask &= ~(1ULL << pieceSquare);
-
-    // if there is a piece between king square and piece square
-    if(inBetweenMask & board.getAllPiecesBitBoard()) return PinDirection::NONE;
-
-    int borderSquare;
-    PinDirection direction = PinDirection::NONE;
-    
-    // aligned in diagonal
-    if(abs(ki - rank) == abs(kj - file)) {
-        // topLeft
-        if(ki > rank && kj > file) {
-            borderSquare = -(std::min(rank, file) * 9) + pieceSquare;
-            direction = PinDirection::TOP_BOTTOM_DIAG;
-        }
-
-        // topRight
-        else if(ki > rank && kj < file) {
-            borderSquare = -(std::min(rank, 8-file-1) * 7) + pieceSquare;
-            direction = PinDirection::BOTTOM_TOP_DIAG;
-        }
-
-        // bottomRight
-        else if(ki < rank && kj < file) {
-            borderSquare = (std::min(8 - rank - 1, 8 - file - 1) * 9) + pieceSquare;
-            direction = PinDirection::BOTTOM_TOP_DIAG;
-        }
-
-        // bottomLeft
-        else {
-            borderSquare = (std::min(8 - rank - 1, file) * 7) + pieceSquare;
-            direction = PinDirection::TOP_BOTTOM_DIAG;
-        }
-
-        // if piece is at an edge, it can't be pinned
-        if(borderSquare == pieceSquare) return PinDirection::NONE;
-
-        uint64_t beyondMask = rangeMasks[pieceSquare][borderSquare];
-        beyondMask &= ~(1ULL << pieceSquare);
-
-        // obstructing pieces are all same color pieces and attacking color rooks, knights, pawns and king (opponent bishops and queens attack)
-        uint64_t attackingBishops = board.getPieceBitBoard(white ? Piece::BLACK_BISHOP : Piece::WHITE_BISHOP);
-        uint64_t attackingQueens = board.getPieceBitBoard(white ? Piece::BLACK_QUEEN : Piece::WHITE_QUEEN);
-        uint64_t obstructingPieces = board.getColorBitBoard(white) | 
-                                     (board.getColorBitBoard(!white) & ~(attackingBishops | attackingQueens));
-
-        obstructingPieces &= beyondMask;
-
-        // Now OR opponent Bishops and Queens
-        uint64_t attackingPieces = (attackingBishops | attackingQueens);
-        attackingPieces &= beyondMask;
-        
-        // if top left or top right
-        if((ki > rank && kj > file) || (ki > rank && kj < file)) {
-            int obstructingMSBBit = obstructingPieces ? __builtin_clzll(obstructingPieces) : 64;
-            int attackingMSBBit = attackingPieces ? __builtin_clzll(attackingPieces) : 64;
-
-            // the piece is not pinned
-            if(obstructingMSBBit <= attackingMSBBit) return PinDirection::NONE;  
-            
-            // piece is pinned, if the caller intends to find a discovery check, update
-            if(updateDiscoveryCheckSquare) board.updateDiscoveryCheckSquare(attackingMSBBit);
-        }
-        // if bottom left or bottom right
-        else {
-            int obstructingLSBBit = obstructingPieces ? __builtin_ctzll(obstructingPieces) : 64;
-            int attackingLSBBit = attackingPieces ? __builtin_ctzll(attackingPieces) : 64;
-
-            // the piece is not pinned
-            if(obstructingLSBBit <= attackingLSBBit) return PinDirection::NONE; 
-
-            // piece is pinned, if the caller intends to find a discovery check, update
-            if(updateDiscoveryCheckSquare) board.updateDiscoveryCheckSquare(attackingLSBBit);
-        }
-    }
-    // aligned in File
-    else if(kj == file) {
-        direction = PinDirection::FILE;
-
-        // top
-        if(ki > rank) borderSquare = file;
-        // bottom
-        else borderSquare = 56 + file;
-
-        // if piece is on edge, it cannot be pinned
-        if(pieceSquare == borderSquare) return PinDirection::NONE;
-
-        uint64_t beyondMask = rangeMasks[pieceSquare][borderSquare];
-        beyondMask &= ~(1ULL << pieceSquare);
-
-        // obstructing pieces are all same color pieces and attacking color bishops, knights, pawns and king (opponent rooks and queens attack)
-        uint64_t attackingRooks = board.getPieceBitBoard(white ? Piece::BLACK_ROOK : Piece::WHITE_ROOK);
-        uint64_t attackingQueens = board.getPieceBitBoard(white ? Piece::BLACK_QUEEN : Piece::WHITE_QUEEN);
-        uint64_t obstructingPieces = board.getColorBitBoard(white) | 
-                                     (board.getColorBitBoard(!white) & ~(attackingRooks | attackingQueens));
-
-        obstructingPieces &= beyondMask;
-        
-        // OR opponent queens and rooks
-        uint64_t attackingPieces = (attackingRooks | attackingQueens);
-        attackingPieces &= beyondMask;
-
-        // top
-        if(ki > rank) {
-            int obstructingMSBBit = obstructingPieces ? __builtin_clzll(obstructingPieces) : 64;
-            int attackingMSBBit = attackingPieces ? __builtin_clzll(attackingPieces) : 64;
-
-            if(obstructingMSBBit <= attackingMSBBit) return PinDirection::NONE;
-
-            // piece is pinned, if the caller intends to find a discovery check, update
-            if(updateDiscoveryCheckSquare) board.updateDiscoveryCheckSquare(attackingMSBBit);
-        }
-        // bottom
-        else {
-            int obstructingLSBBit = obstructingPieces ? __builtin_ctzll(obstructingPieces) : 64;
-            int attackingLSBBit = attackingPieces ? __builtin_ctzll(attackingPieces) : 64;
-
-            if(obstructingLSBBit <= attackingLSBBit) return PinDirection::NONE;
-
-            // piece is pinned, if the caller intends to find a discovery check, update
-            if(updateDiscoveryCheckSquare) board.updateDiscoveryCheckSquare(attackingLSBBit);
-        }
-    }
-    // aligned in rank
-    else if(ki == rank) {
-        direction = PinDirection::RANK;
-
-        // left
-        if(kj > file) borderSquare = rank*8;
-        // bottom
-        else borderSquare = rank*8 + 7;
-
-        // if piece is on edge, it cannot be pinned
-        if(pieceSquare == borderSquare) return PinDirection::NONE;
-
-        uint64_t beyondMask = rangeMasks[pieceSquare][borderSquare];
-        beyondMask &= ~(1ULL << pieceSquare);
-
-        // obstructing pieces are all same color pieces and attacking color bishops, knights, pawns and king (opponent rooks and queens attack)
-        uint64_t attackingRooks = board.getPieceBitBoard(white ? Piece::BLACK_ROOK : Piece::WHITE_ROOK);
-        uint64_t attackingQueens = board.getPieceBitBoard(white ? Piece::BLACK_QUEEN : Piece::WHITE_QUEEN);
-        uint64_t obstructingPieces = board.getColorBitBoard(white) | 
-                                     (board.getColorBitBoard(!white) & ~(attackingRooks | attackingQueens));
-        
-        obstructingPieces &= beyondMask;
-
-        // OR opponent queens and rooks
-        uint64_t attackingPieces = (attackingRooks | attackingQueens);
-        attackingPieces &= beyondMask;
-
-        // left
-        if(kj > file) {
-            int obstructingMSBBit = obstructingPieces ? __builtin_clzll(obstructingPieces) : 64;
-            int attackingMSBBit = attackingPieces ? __builtin_clzll(attackingPieces) : 64;
-
-            if(obstructingMSBBit <= attackingMSBBit) return PinDirection::NONE;
-
-            // piece is pinned, if the caller intends to find a discovery check, update
-            if(updateDiscoveryCheckSquare) board.updateDiscoveryCheckSquare(attackingMSBBit);
-        }
-        // bottom
-        else {
-            int obstructingLSBBit = obstructingPieces ? __builtin_ctzll(obstructingPieces) : 64;
-            int attackingLSBBit = attackingPieces ? __builtin_ctzll(attackingPieces) : 64;
-
-            if(obstructingLSBBit <= attackingLSBBit) return PinDirection::NONE;
-
-            // piece is pinned, if the caller intends to find a discovery check, update
-            if(updateDiscoveryCheckSquare) board.updateDiscoveryCheckSquare(attackingLSBBit);
-        }
-    }
-
-
-    return direction;
-}
-
-
+#ifndef LC_TABLE_FREE_SLIDERS
 uint64_t getBishopAttacksForSquareAndOccupancy(int square, uint64_t occupancy) {
     int configIndex = 0;
     uint64_t attacksFromSquare = bishopAttackSquares[square];
@@ -537,407 +365,232 @@ uint64_t getRookAttacksForSquareAndOccupancy(int square, uint64_t occupancy) {
 uint64_t getQueenAttacksForSquareAndOccupancy(int square, uint64_t occupancy) {
     return (getBishopAttacksForSquareAndOccupancy(square, occupancy) | getRookAttacksForSquareAndOccupancy(square, occupancy));
 }
+#endif
 
-uint64_t generateLegalAttacksForColor(bool white, bool checkPins, bool includeKing, bool pawnLegalMovesOnly, const Board& board) {
-    uint64_t finalAttacks = 0;
-    
-    // rooks
-    uint64_t rookBoard = board.getPieceBitBoard(white ? Piece::WHITE_ROOK : Piece::BLACK_ROOK);
-
-    while(rookBoard) {
-        int rookSquare = __builtin_ctzll(rookBoard);
-        rookBoard &= rookBoard-1;
-
-        int rank = rookSquare/8, file = rookSquare%8;
-
-        uint64_t legalAttacksFromSquare = getRookAttacksForSquareAndOccupancy(rookSquare, board.getAllPiecesBitBoard());
-
-        if(checkPins) {
-            PinDirection direction = getPinDirection(white, rookSquare, const_cast<Board&>(board), false);
-
-            if(direction == PinDirection::NONE) finalAttacks |= legalAttacksFromSquare;
-            else if(direction == PinDirection::FILE) {
-                // rook pinned in file remove rank attacks
-                finalAttacks |= (~(255 << (rank * 8)) & legalAttacksFromSquare);
-            }
-            else if(direction == PinDirection::RANK) {
-                // rook pinned in rank remove file attacks
-                finalAttacks |= (~(rangeMasks[file][56+file]) & legalAttacksFromSquare);
-            }
-        }
-        else {
-            finalAttacks |= legalAttacksFromSquare;
-        }
-    }
+uint64_t attackersTo(int square, uint64_t occupancy, bool byWhite, const Board& board) {
+    uint64_t rooksAndQueens = board.getPieceBitBoard(byWhite ? Piece::WHITE_ROOK : Piece::BLACK_ROOK) | board.getPieceBitBoard(byWhite ? Piece::WHITE_QUEEN : Piece::BLACK_QUEEN);
+    uint64_t bishopsAndQueens = board.getPieceBitBoard(byWhite ? Piece::WHITE_BISHOP : Piece::BLACK_BISHOP) | board.getPieceBitBoard(byWhite ? Piece::WHITE_QUEEN : Piece::BLACK_QUEEN);
 
+    // look from the square with each piece's attack pattern and intersect with the attacking pieces
+    uint64_t attackers = (knightAttackSquares[square] & board.getPieceBitBoard(byWhite ? Piece::WHITE_KNIGHT : Piece::BLACK_KNIGHT)) |
+                         (pawnAttackSquares[!byWhite][square] & board.getPieceBitBoard(byWhite ? Piece::WHITE_PAWN : Piece::BLACK_PAWN)) |
+                         (kingAttackSquares[square] & board.getPieceBitBoard(byWhite ? Piece::WHITE_KING : Piece::BLACK_KING));
 
-    // bishops
-    uint64_t bishopBoard = board.getPieceBitBoard(white ? Piece::WHITE_BISHOP : Piece::BLACK_BISHOP);
-
-    while(bishopBoard) {
-        int bishopSquare = __builtin_ctzll(bishopBoard);
-        bishopBoard &= bishopBoard-1;
-
-        int rank = bishopSquare/8, file = bishopSquare%8;
-
-        uint64_t legalAttacksFromSquare = getBishopAttacksForSquareAndOccupancy(bishopSquare, board.getAllPiecesBitBoard());
-
-        if(checkPins) {
-            PinDirection direction = getPinDirection(white, bishopSquare, const_cast<Board&>(board), false);
-
-            if(direction == PinDirection::NONE) finalAttacks |= legalAttacksFromSquare;
-            else if(direction == PinDirection::BOTTOM_TOP_DIAG) {
-                // bishop pinned bottom to top diag, remove top to bottom diag attacks
-                int topLeftSquare = bishopSquare - (9 * std::min(rank, file));
-                int bottomRightSquare = bishopSquare + (9 * std::min(8-rank-1, 8-file-1));
-
-                finalAttacks |= (~(rangeMasks[topLeftSquare][bottomRightSquare]) & legalAttacksFromSquare);
-            }
-            else if(direction == PinDirection::TOP_BOTTOM_DIAG) {
-                // bishop pinned on top to bottom diag, remove bottom to topo diag attacks
-                int bottomLeftSquare = bishopSquare + (7 * std::min(8-rank-1, file));
-                int topRightSquare = bishopSquare - (7 * std::min(rank, 8-file-1));
-
-                finalAttacks |= (~(rangeMasks[bottomLeftSquare][topRightSquare]) & legalAttacksFromSquare);
-            }
-        }
-        else {
-            finalAttacks |= legalAttacksFromSquare;
-        }
-    }
+    // the occupancy lookups are the expensive part, skip them when no slider is on the square's lines
+    if(rookAttackSquares[square] & rooksAndQueens) attackers |= getRookAttacksForSquareAndOccupancy(square, occupancy) & rooksAndQueens;
+    if(bishopAttackSquares[square] & bishopsAndQueens) attackers |= getBishopAttacksForSquareAndOccupancy(square, occupancy) & bishopsAndQueens;
 
+    return attackers;
+}
 
+bool isKingUnderCheck(bool white, const Board& board) {
+    LC_METRICS_SCOPE(SELF_CHECK);
 
-    // knights
-    uint64_t knightsBoard = board.getPieceBitBoard(white ? Piece::WHITE_KNIGHT : Piece::BLACK_KNIGHT);
+    int kingSquare = __builtin_ctzll(board.getPieceBitBoard(white ? Piece::WHITE_KING : Piece::BLACK_KING));
 
-    while(knightsBoard) {
-        int knightSquare = __builtin_ctzll(knightsBoard);
-        knightsBoard &= knightsBoard-1;
+    return attackersTo(kingSquare, board.getAllPiecesBitBoard(), !white, board) != 0;
+}
 
-        if(!checkPins || getPinDirection(white, knightSquare, const_cast<Board&>(board), false) == PinDirection::NONE) finalAttacks |= knightAttackSquares[knightSquare];
+void initLegalMoveContext(bool white, const Board& board, LegalMoveContext& context) {
+    context.white = white;
+    context.kingSquare = __builtin_ctzll(board.getPieceBitBoard(white ? Piece::WHITE_KING : Piece::BLACK_KING));
+    context.own = board.getColorBitBoard(white);
+    context.occupancy = board.getAllPiecesBitBoard();
+    context.checkers = attackersTo(context.kingSquare, context.occupancy, !white, board);
+
+    // a non king move has to capture the checker or block the check, with two checkers only the king can move
+    if(context.checkers == 0) context.checkMask = ~0ULL;
+    else if(context.checkers & (context.checkers - 1)) context.checkMask = 0;
+    else {
+        int checkerSquare = __builtin_ctzll(context.checkers);
+        context.checkMask = rangeMasks[context.kingSquare][checkerSquare] | context.checkers;
+        context.checkMask &= ~(1ULL << context.kingSquare);
     }
 
+    // opponent sliders that see the king on an empty board, with exactly one own piece in between pin it
+    uint64_t rooksAndQueens = board.getPieceBitBoard(white ? Piece::BLACK_ROOK : Piece::WHITE_ROOK) | board.getPieceBitBoard(white ? Piece::BLACK_QUEEN : Piece::WHITE_QUEEN);
+    uint64_t bishopsAndQueens = board.getPieceBitBoard(white ? Piece::BLACK_BISHOP : Piece::WHITE_BISHOP) | board.getPieceBitBoard(white ? Piece::BLACK_QUEEN : Piece::WHITE_QUEEN);
+    uint64_t pinners = (rookAttackSquares[context.kingSquare] & rooksAndQueens) | (bishopAttackSquares[context.kingSquare] & bishopsAndQueens);
 
+    context.pinned = 0;
 
-    // queens
-    uint64_t queensBoard = board.getPieceBitBoard(white ? Piece::WHITE_QUEEN : Piece::BLACK_QUEEN);
-
-    while(queensBoard) {
-        int queenSquare = __builtin_ctzll(queensBoard);
-        queensBoard &= queensBoard-1;
-
-        int rank = queenSquare/8, file = queenSquare%8;
+    while(pinners) {
+        int pinnerSquare = __builtin_ctzll(pinners);
+        pinners &= pinners - 1;
 
-        uint64_t legalAttacksFromSquare = getQueenAttacksForSquareAndOccupancy(queenSquare, board.getAllPiecesBitBoard());
+        uint64_t pinRay = rangeMasks[context.kingSquare][pinnerSquare];
+        uint64_t inBetween = pinRay & context.occupancy & ~((1ULL << context.kingSquare) | (1ULL << pinnerSquare));
 
-        if(checkPins) {
-            PinDirection direction = getPinDirection(white, queenSquare, const_cast<Board&>(board), false);
+        if(inBetween == 0 || (inBetween & (inBetween - 1)) || (inBetween & context.own) == 0) continue;
 
-            if(direction == PinDirection::NONE) finalAttacks |= legalAttacksFromSquare;
-            else if(direction == PinDirection::BOTTOM_TOP_DIAG) {
-                // bishop pinned bottom to top diag, remove top to bottom diag attacks
-                int topLeftSquare = queenSquare - (9 * std::min(rank, file));
-                int bottomRightSquare = queenSquare + (9 * std::min(8-rank-1, 8-file-1));
-
-                finalAttacks |= (~(rangeMasks[topLeftSquare][bottomRightSquare]) & legalAttacksFromSquare);
-            }
-            else if(direction == PinDirection::TOP_BOTTOM_DIAG) {
-                // bishop pinned on top to bottom diag, remove bottom to topo diag attacks
-                int bottomLeftSquare = queenSquare + (7 * std::min(8-rank-1, file));
-                int topRightSquare = queenSquare - (7 * std::min(rank, 8-file-1));
-
-                finalAttacks |= (~(rangeMasks[bottomLeftSquare][topRightSquare]) & legalAttacksFromSquare);
-            }
-            else if(direction == PinDirection::FILE) {
-                // rook pinned in file remove rank attacks
-                finalAttacks |= (~(255 << (rank * 8)) & legalAttacksFromSquare);
-            }
-            else if(direction == PinDirection::RANK) {
-                // rook pinned in rank remove file attacks
-                finalAttacks |= (~(rangeMasks[file][56+file]) & legalAttacksFromSquare);
-            }
-        }
-        else {
-            finalAttacks |= legalAttacksFromSquare;
-        }
+        int pinnedSquare = __builtin_ctzll(inBetween);
+        context.pinned |= inBetween;
+        context.pinRays[pinnedSquare] = pinRay;
     }
+}
 
+static bool isEnpassantCaptureLegal(int pawnSquare, const LegalMoveContext& context, const Board& board) {
+    int enpassantSquare = board.enpassantSquare;
+    int capturedPawnSquare = context.white ? enpassantSquare - 8 : enpassantSquare + 8;
 
+    // two pieces leave the rank at once, so simulate the capture instead of relying on the pin and check masks
+    uint64_t occupancy = context.occupancy;
+    occupancy &= ~((1ULL << pawnSquare) | (1ULL << capturedPawnSquare));
+    occupancy |= (1ULL << enpassantSquare);
 
-    // pawns
-    uint64_t pawnsBoard = board.getPieceBitBoard(white ? Piece::WHITE_PAWN : Piece::BLACK_PAWN);
-
-    while(pawnsBoard) {
-        int pawnSquare = __builtin_ctzll(pawnsBoard);
-        pawnsBoard &= pawnsBoard - 1;
-
-
-        if(pawnLegalMovesOnly) { // caller doesn't want to mark the attack squares, but need legal moves
-            int newRank = white ? pawnSquare/8 + 1 : pawnSquare/8 - 1;
-            int newFile = pawnSquare % 8 - 1;
-
-            uint64_t leftFileAttack = 0, rightFileAttack = 0, steps = 0;
-            
-            if(newFile >= 0 && ((1ULL << (newRank*8 + newFile)) & board.getColorBitBoard(!white)) != 0) leftFileAttack |= (1ULL << (newRank*8 + newFile));
-            
-            newFile += 2;
-
-            if(newFile < 8 && ((1ULL << (newRank*8 + newFile)) & board.getColorBitBoard(!white)) != 0) rightFileAttack |= (1ULL << (newRank*8 + newFile));
-
-            // normal move, first step
-            int oneStepSquare = white ? pawnSquare + 8 : pawnSquare - 8;
-            if(((1ULL << oneStepSquare) & board.getAllPiecesBitBoard()) == 0) steps |= (1ULL << oneStepSquare);
-
-            // second step
-            if((white ? pawnSquare/8 == 1 : pawnSquare/8 == 6)) {
-                int twoStepSquare = white ? pawnSquare + 16 : pawnSquare - 16;
-                if(((1ULL << twoStepSquare) & board.getAllPiecesBitBoard()) == 0) steps |= (1ULL << twoStepSquare);
-            }
-
-            if(checkPins) {
-                PinDirection direction = getPinDirection(white, pawnSquare, const_cast<Board&>(board), false);
-
-                if(direction == PinDirection::NONE) finalAttacks |= (leftFileAttack | rightFileAttack | steps);
-                else if(direction == PinDirection::BOTTOM_TOP_DIAG) finalAttacks |= (white ?  leftFileAttack : rightFileAttack);
-                else if(direction == PinDirection::TOP_BOTTOM_DIAG) finalAttacks |= (white ? rightFileAttack : leftFileAttack);
-            }
-            else finalAttacks |= (leftFileAttack | rightFileAttack | steps);
-        }
-        else { // caller just wants to mark attack squares
-
-            int newRank = white ? pawnSquare/8 + 1 : pawnSquare/8 - 1;
-
-            uint64_t leftFileAttack = 0, rightFileAttack = 0;
-
-            int newFile = (pawnSquare % 8) - 1;
-            
-            if(newFile >= 0) leftFileAttack |= (1ULL << (newRank*8 + newFile));
-            
-            newFile += 2;
-
-            if(newFile < 8) rightFileAttack |= (1ULL << (newRank*8 + newFile));
-
-            if(checkPins) {
-                PinDirection direction = getPinDirection(white, pawnSquare, const_cast<Board&>(board), false);
-
-                if(direction == PinDirection::NONE) finalAttacks |= (leftFileAttack | rightFileAttack);
-                else if(direction == PinDirection::BOTTOM_TOP_DIAG) finalAttacks |= (white ?  leftFileAttack : rightFileAttack);
-                else if(direction == PinDirection::TOP_BOTTOM_DIAG) finalAttacks |= (white ? rightFileAttack : leftFileAttack);
-            }
-            else finalAttacks |= (leftFileAttack | rightFileAttack);
-        }
-    }
-
+    uint64_t attackers = attackersTo(context.kingSquare, occupancy, !context.white, board);
+    attackers &= ~(1ULL << capturedPawnSquare);
 
+    return attackers == 0;
+}
 
-    // king
-    if(includeKing) {
-        uint64_t kingBoard = board.getPieceBitBoard(white ? Piece::WHITE_KING : Piece::BLACK_KING);
-
-        int kingSquare = __builtin_ctzll(kingBoard);
+// the squares between king and rook are empty and the squares the king passes and lands on are not attacked
+static bool isCastlingPathSafe(bool white, bool shortSide, uint64_t occupancy, const Board& board) {
+    int base = white ? 0 : 56;
 
-        finalAttacks |= kingAttackSquares[kingSquare];
+    // king on e-file (base + 3), short side rook on base, long side rook on base + 7
+    if(shortSide) {
+        return (occupancy & ((1ULL << (base + 1)) | (1ULL << (base + 2)))) == 0 &&
+               attackersTo(base + 2, occupancy, !white, board) == 0 &&
+               attackersTo(base + 1, occupancy, !white, board) == 0;
     }
 
-
-    
-    return finalAttacks;
+    return (occupancy & ((1ULL << (base + 4)) | (1ULL << (base + 5)) | (1ULL << (base + 6)))) == 0 &&
+           attackersTo(base + 4, occupancy, !white, board) == 0 &&
+           attackersTo(base + 5, occupancy, !white, board) == 0;
 }
 
-bool isKingUnderCheck(bool white, const Board& board) {
-    uint64_t opponentAttacks = generateLegalAttacksForColor(!white, false, true, false, board);
-    int kingSquare = __builtin_ctzll(board.getPieceBitBoard(white ? Piece::WHITE_KING : Piece::BLACK_KING));
+bool isCastlingPathClear(bool white, bool shortSide, const Board& board) {
+    uint64_t occupancy = board.getAllPiecesBitBoard();
+    int kingSquare = white ? 3 : 59;
 
-    return (((1ULL << kingSquare) & opponentAttacks) != 0);
+    return attackersTo(kingSquare, occupancy, !white, board) == 0 && isCastlingPathSafe(white, shortSide, occupancy, board);
 }
 
-bool canAnyPieceMove(bool white, const Board& board) {
-    // Rooks
-    uint64_t rookBoard = board.getPieceBitBoard(white ? Piece::WHITE_ROOK : Piece::BLACK_ROOK);
-
-    while(rookBoard) {
-        int rookSquare = __builtin_ctzll(rookBoard);
-        rookBoard &= rookBoard-1;
+static uint64_t getCastlingTargets(const LegalMoveContext& context, const Board& board) {
+    if(context.checkers) return 0;
 
-        PinDirection direction = getPinDirection(white, rookSquare, const_cast<Board&>(board), false); 
+    uint64_t targets = 0;
+    int base = context.white ? 0 : 56;
 
-        if(direction == PinDirection::FILE || direction == PinDirection::RANK) return true;
-        if(direction == PinDirection::BOTTOM_TOP_DIAG || direction == PinDirection::TOP_BOTTOM_DIAG) continue;
+    bool canShortCastle = context.white ? board.canWhiteKingShortCastle : board.canBlackKingShortCastle;
+    bool canLongCastle = context.white ? board.canWhiteKingLongCastle : board.canBlackKingLongCastle;
 
-        // if the rook can move freely, see if it is not blocked in any of the directions by it's friend pieces
-        int rank = rookSquare/8, file = rookSquare%8;
-        uint64_t legalAttacksFromSquare = getRookAttacksForSquareAndOccupancy(rookSquare, board.getAllPiecesBitBoard());
-        uint64_t friendOccupancyMask = (legalAttacksFromSquare & board.getColorBitBoard(white));
+    if(canShortCastle && isCastlingPathSafe(context.white, true, context.occupancy, board)) targets |= (1ULL << (base + 1));
+    if(canLongCastle && isCastlingPathSafe(context.white, false, context.occupancy, board)) targets |= (1ULL << (base + 5));
 
-        // check each direction, left, top, right and bottom to see if there are any friendly blockers
-        // left
-        if(rank*8 != rookSquare) { // if rook square is at left edge, it cannot move any further to left
-            int leftMask = rangeMasks[rank*8][rookSquare];
-            leftMask &= ~(1ULL << rookSquare);
-
-            if((friendOccupancyMask & leftMask) == 0 || __builtin_clzll(friendOccupancyMask & leftMask) - rookSquare < 1) return true;
-        }
+    return targets;
+}
 
-        // right
-        if(rank*8 + 7 != rookSquare) { // if rook square is at right edge, it cannot move any further to right
-            int rightMask = rangeMasks[rank*8 + 7][rookSquare];
-            rightMask &= ~(1ULL << rookSquare);
+uint64_t getLegalTargets(int square, const LegalMoveContext& context, const Board& board, bool includeCastling) {
+    int pieceType = (int)board.getPieceOnBoard(square) % 6;
 
-            if((friendOccupancyMask & rightMask) == 0 || __builtin_clzll(friendOccupancyMask & rightMask) - rookSquare > 1) return true;
-        }
+    if(pieceType == 5) {
+        uint64_t kingTargets = kingAttackSquares[square] & ~context.own;
+        uint64_t occupancyWithoutKing = context.occupancy & ~(1ULL << square);
+        uint64_t legalTargets = 0;
 
-        // top
-        if(file != rookSquare) { // if rook square is at top edge, it cannot move any further to top
-            int topMask = rangeMasks[file][rookSquare];
-            topMask &= ~(1ULL << rookSquare);
+        // the king must not hide behind itself on the checking ray, so it is removed from the occupancy
+        while(kingTargets) {
+            int targetSquare = __builtin_ctzll(kingTargets);
+            kingTargets &= kingTargets - 1;
 
-            if((friendOccupancyMask & topMask) == 0 || __builtin_clzll(friendOccupancyMask & topMask) - rookSquare < 8) return true;
+            if(attackersTo(targetSquare, occupancyWithoutKing, !context.white, board) == 0) legalTargets |= (1ULL << targetSquare);
         }
 
-        // bottom
-        if(56+file != rookSquare) { // if rook square is at bottom edge, it cannot move any further to bottom
-            int bottomMask = rangeMasks[56 + file][rookSquare];
-            bottomMask &= ~(1ULL << rookSquare);
+        if(includeCastling) legalTargets |= getCastlingTargets(context, board);
 
-            if((friendOccupancyMask & bottomMask) == 0 || __builtin_clzll(friendOccupancyMask & bottomMask) - rookSquare > 8) return true;
-        }
+        return legalTargets;
     }
 
+    uint64_t targets = 0;
 
-    // Bishops
-    uint64_t bishopBoard = board.getPieceBitBoard(white ? Piece::WHITE_BISHOP : Piece::BLACK_BISHOP);
-
-    while(bishopBoard) {
-        int bishopSquare = __builtin_ctzll(bishopBoard);
-        bishopBoard &= bishopBoard-1;
+    switch(pieceType) {
+        case 0: {
+            uint64_t enemy = context.occupancy & ~context.own;
+            int oneStepSquare = context.white ? square + 8 : square - 8;
 
-        PinDirection direction = getPinDirection(white, bishopSquare, const_cast<Board&>(board), false);
+            targets = pawnAttackSquares[context.white][square] & enemy;
 
-        if(direction == PinDirection::BOTTOM_TOP_DIAG || direction == PinDirection::TOP_BOTTOM_DIAG) return true;
-        if(direction == PinDirection::RANK || direction == PinDirection::FILE) continue;
+            if((context.occupancy & (1ULL << oneStepSquare)) == 0) {
+                targets |= (1ULL << oneStepSquare);
 
-        int rank = bishopSquare/8, file = bishopSquare%8;
-        uint64_t legalAttacksFromSquare = getBishopAttacksForSquareAndOccupancy(bishopSquare, board.getAllPiecesBitBoard());
-        uint64_t friendOccupancyMask = (legalAttacksFromSquare & board.getColorBitBoard(white));
-
-        // check in all directions: top left, top right, bottom left, bottom right to see if there are any friendly blockers
-        // top left
-        int borderSquare = bishopSquare + (-9 * std::min(rank, file));
-
-        if(borderSquare != bishopSquare) { // if bishop is at top left edge, it cannot move any further to top left
-            int topLeftMask = rangeMasks[borderSquare][bishopSquare];
-            topLeftMask &= ~(1ULL << bishopSquare);
-
-            if((friendOccupancyMask & topLeftMask) == 0 || __builtin_clzll(friendOccupancyMask & topLeftMask) - bishopSquare < 9) return true;
-        }
-
-        // top right
-        borderSquare = bishopSquare + (-7 * std::min(rank, 8 - file - 1));
+                int twoStepSquare = context.white ? square + 16 : square - 16;
+                if((context.white ? square / 8 == 1 : square / 8 == 6) && (context.occupancy & (1ULL << twoStepSquare)) == 0) targets |= (1ULL << twoStepSquare);
+            }
 
-        if(borderSquare != bishopSquare) { // if bishop is at top left edge, it cannot move any further to top left
-            int topRightMask = rangeMasks[borderSquare][bishopSquare];
-            topRightMask &= ~(1ULL << bishopSquare);
+            break;
+        }
+        case 1:
+            targets = knightAttackSquares[square] & ~context.own;
+            break;
+        case 2:
+            targets = getBishopAttacksForSquareAndOccupancy(square, context.occupancy) & ~context.own;
+            break;
+        case 3:
+            targets = getRookAttacksForSquareAndOccupancy(square, context.occupancy) & ~context.own;
+            break;
+        case 4:
+            targets = getQueenAttacksForSquareAndOccupancy(square, context.occupancy) & ~context.own;
+            break;
+    }
 
-            if((friendOccupancyMask & topRightMask) == 0 || __builtin_clzll(friendOccupancyMask & topRightMask) - bishopSquare < 7) return true;
-        }
+    targets &= context.checkMask;
+    if(context.pinned & (1ULL << square)) targets &= context.pinRays[square];
 
-        // bottom right
-        borderSquare = bishopSquare + (9 * std::min(8 - rank - 1, 8 - file - 1));
+    if(pieceType == 0 && board.enpassantSquare != 64 && (pawnAttackSquares[context.white][square] & (1ULL << board.enpassantSquare)) && isEnpassantCaptureLegal(square, context, board)) {
+        targets |= (1ULL << board.enpassantSquare);
+    }
 
-        if(borderSquare != bishopSquare) { // if bishop is at top left edge, it cannot move any further to top left
-            int bottomRightMask = rangeMasks[borderSquare][bishopSquare];
-            bottomRightMask &= ~(1ULL << bishopSquare);
+    return targets;
+}
 
-            if((friendOccupancyMask & bottomRightMask) == 0 || __builtin_clzll(friendOccupancyMask & bottomRightMask) - bishopSquare > 9) return true;
-        }
+bool hasAnyLegalMove(const LegalMoveContext& context, const Board& board) {
+    uint64_t pieces = context.own & ~(1ULL << context.kingSquare);
 
-        // bottom left
-        borderSquare = bishopSquare + (7 * std::min(8 - rank - 1, file));
+    // out of check almost any free piece can move and needs no attack lookups, try those before the king
+    if(context.checkers == 0) {
+        uint64_t freePieces = pieces & ~context.pinned;
 
-        if(borderSquare != bishopSquare) { // if bishop is at top left edge, it cannot move any further to top left
-            int bottomLeftMask = rangeMasks[borderSquare][bishopSquare];
-            bottomLeftMask &= ~(1ULL << bishopSquare);
+        while(freePieces) {
+            int pieceSquare = __builtin_ctzll(freePieces);
+            freePieces &= freePieces - 1;
 
-            if((friendOccupancyMask & bottomLeftMask) == 0 || __builtin_clzll(friendOccupancyMask & bottomLeftMask) - bishopSquare > 7) return true;
+            if(getLegalTargets(pieceSquare, context, board, false)) return true;
         }
 
+        pieces &= context.pinned;
     }
 
-    // Knights
-    uint64_t knightsBoard = board.getPieceBitBoard(white ? Piece::WHITE_KNIGHT : Piece::BLACK_KNIGHT);
+    // king moves are the usual way out of a check and the only one out of a double check
+    if(getLegalTargets(context.kingSquare, context, board, false)) return true;
+    if(context.checkMask == 0) return false;
 
-    while(knightsBoard) {
-        int knightSquare = __builtin_ctzll(knightsBoard);
-        knightsBoard &= knightsBoard-1;
+    // pinned pieces can only move along the pin, try the free pieces first
+    uint64_t orderedPieces[2] = {pieces & ~context.pinned, pieces & context.pinned};
 
-        uint64_t legalAttacksFromSquare = knightAttackSquares[knightSquare];
-        uint64_t friendOccupancyMask = (legalAttacksFromSquare & board.getColorBitBoard(white));
+    for(uint64_t piecesToTry : orderedPieces) {
+        while(piecesToTry) {
+            int pieceSquare = __builtin_ctzll(piecesToTry);
+            piecesToTry &= piecesToTry - 1;
 
-        if(friendOccupancyMask < legalAttacksFromSquare) return true;
-    }
-
-    // Pawns
-    uint64_t pawnsBoard = board.getPieceBitBoard(white ? Piece::WHITE_PAWN : Piece::BLACK_PAWN);
-
-    while(pawnsBoard) {
-        int pawnSquare = __builtin_ctzll(pawnsBoard);
-        pawnsBoard &= pawnsBoard - 1;
-
-        // forward movement
-        int forwardSquare = white ? pawnSquare + 8 : pawnSquare - 8;
-        if(((1ULL << forwardSquare) & board.getAllPiecesBitBoard()) == 0) return true;
-
-        int rank = pawnSquare / 8, file = pawnSquare % 8;
-        int leftSquare = white ? pawnSquare + 9 : pawnSquare - 9;
-        // left attack
-        if(file > 0 && ((1ULL << leftSquare) & board.getColorBitBoard(!white)) != 0) return true;
-
-        int rightSquare = white ? pawnSquare + 7 : pawnSquare - 7;
-        // right attack
-        if(file < 7 && ((1ULL << rightSquare) & board.getColorBitBoard(!white)) != 0) return true;
+            if(getLegalTargets(pieceSquare, context, board, false)) return true;
+        }
     }
 
     return false;
 }
 
-
-bool isKingInSameRay(int pieceSquare, int kingSquare, int newKingSquare, Piece attackingPiece) {
-    if((int)attackingPiece % 6 <= 1) return false;
-    if(newKingSquare == pieceSquare) return false;
-
-    int rank1 = pieceSquare/8, rank2 = kingSquare/8, rank3 = newKingSquare/8;
-    int file1 = pieceSquare%8, file2 = kingSquare%8, file3 = newKingSquare%8;
-
-    return (rank1 == rank2 && rank2 == rank3) || (file1 == file2 && file2 == file3) || (abs(rank1 - rank2) == abs(file1 - file2) && abs(rank1 - rank3) == abs(file1 - file3));
-}
-
-
-void calculateMoveResult(CheckType check, uint64_t positionHash, bool isWhiteTurn, Board& board) {
+void calculateMoveResult(uint64_t checkers, bool hasLegalMove, uint64_t positionHash, bool isWhiteTurn, Board& board) {
     // draw by repitition 
-    if(board.positionHashToFreq[positionHash] == 3) {
+    if(board.countRepetitions(positionHash) >= 3) {
         board.setGameResult(GameResult::DRAW_BY_REPITITION);
         board.drawByRepitition = true;
         return;
     }
 
-    // opponentKingPosition
-    int oppKingSquare = __builtin_ctzll(board.getPieceBitBoard(isWhiteTurn ? Piece::BLACK_KING : Piece::WHITE_KING));
-    int oppKingRank = oppKingSquare / 8, oppKingFile = oppKingSquare % 8;
-
-    int myKingSquare = board.getPieceBitBoard(isWhiteTurn ? Piece::WHITE_KING : Piece::BLACK_KING);
-
-    // get friendly pieces position
-    uint64_t friendPiecesOfOppKing = board.getColorBitBoard(!isWhiteTurn);
-    friendPiecesOfOppKing &= ~(1ULL << oppKingSquare);
-
-    // the opp king can only move to a different square
-    // caluclate the attacking color piece attacks
-    uint64_t myAttacks = generateLegalAttacksForColor(isWhiteTurn, false, true, false, board);
-
-
     // the opponent king is not under check
-    if(check == CheckType::NO_CHECK) {
+    if(checkers == 0) {
         // find if it is draw by insufficient material
         // if a pawn is present or a rook is present or a queen is present not insufficient
         if((board.getPieceBitBoard(Piece::WHITE_PAWN) | board.getPieceBitBoard(Piece::BLACK_PAWN) | board.getPieceBitBoard(Piece::WHITE_ROOK) | board.getPieceBitBoard(Piece::BLACK_ROOK) | board.getPieceBitBoard(Piece::WHITE_QUEEN) | board.getPieceBitBoard(Piece::BLACK_QUEEN)) == 0) {
@@ -967,83 +620,21 @@ void calculateMoveResult(CheckType check, uint64_t positionHash, bool isWhiteTur
             
         }
 
-        // find if it is stalemate
-        // iterate all possible king squares
-        for(auto & offSets : kingMoveOffsets) {
-            int8_t newRank = oppKingRank + offSets[0], newFile = oppKingFile + offSets[1];
-
-            if(newRank >= 0 && newRank < 8 && newFile >= 0 && newFile < 8) {
-                int newSquare = newRank*8 + newFile;
-
-                if((friendPiecesOfOppKing & (1ULL << newSquare)) == 0 && ((1ULL << newSquare) & myAttacks) == 0) return;
-            }
-        }
-
-        // if opponent queen is present, it is not a stalemate
-        if((isWhiteTurn ? board.getPieceBitBoard(Piece::BLACK_QUEEN) : board.getPieceBitBoard(Piece::WHITE_QUEEN))) return;
-
-        if(!canAnyPieceMove(!isWhiteTurn, board)) {
+        // stalemate if the opponent has no legal move
+        if(!hasLegalMove) {
             board.stalemate = true;
             board.setGameResult(GameResult::STALEMATE);
-            return;    
         }
 
         return;
     } 
 
-
-    Piece directCheckingPiece = (check == CheckType::DIRECT_CHECK || check == CheckType::DOUBLE_CHECK ? board.getPieceOnBoard(board.directCheckSquare) : Piece::EMPTY);
-    Piece discoveryCheckingPiece = (check == CheckType::DISCOVERY_CHECK || check == CheckType::DOUBLE_CHECK ? board.getPieceOnBoard(board.discoveryCheckSquare) : Piece::EMPTY);
-
-    // opponent king is under check
-    // first see if he can escape
-    for(auto & offSets : kingMoveOffsets) {
-        int8_t newRank = oppKingRank + offSets[0], newFile = oppKingFile + offSets[1];
-
-        if(newRank >= 0 && newRank < 8 && newFile >= 0 && newFile < 8) {
-            int newSquare = newRank*8 + newFile;
-
-            if((friendPiecesOfOppKing & (1ULL << newSquare)) == 0 && ((1ULL << newSquare) & myAttacks) == 0) {
-                // if direct check is there and the piece is not a pawn and not knight, see if the new king square is still in the check direction
-                if((check == CheckType::DIRECT_CHECK || check == CheckType::DOUBLE_CHECK) && !isKingInSameRay(board.directCheckSquare, oppKingSquare, newSquare, directCheckingPiece)) return;
-                // same thing for discovery check
-                if((check == CheckType::DISCOVERY_CHECK || check == CheckType::DOUBLE_CHECK) && !isKingInSameRay(board.directCheckSquare, oppKingSquare, newSquare, directCheckingPiece)) return;
-            }
-        }
-    }
-
-    // he can't escape
-    if(check == CheckType::DOUBLE_CHECK) {
-
+    // opponent king is under check, checkmate if no move gets him out of it
+    if(!hasLegalMove) {
         if(isWhiteTurn) board.blackKingCheckmated = true;
-        board.setGameResult(isWhiteTurn ? GameResult::WHITE_WON_BY_CHECKMATE : GameResult::BLACK_WON_BY_CHECKMATE);
-        return;
-    }
+        else board.whiteKingCheckmated = true;
 
-
-    Piece checkingPiece = (directCheckingPiece == Piece::EMPTY ? discoveryCheckingPiece : directCheckingPiece);
-    int checkingPieceSquare = (directCheckingPiece == Piece::EMPTY ? board.discoveryCheckSquare : board.directCheckSquare);
-
-    uint64_t defenderLegalMoves = generateLegalAttacksForColor(!isWhiteTurn, true, false, true, board);
-
-    // if checking piece is a knight, killing it is the only way to prevent checkmate
-    if((int)checkingPiece % 6 == 1) {
-        if(((1ULL << checkingPieceSquare) & defenderLegalMoves) == 0) {
-            if(isWhiteTurn) board.blackKingCheckmated = true;
-            board.setGameResult(isWhiteTurn ? GameResult::WHITE_WON_BY_CHECKMATE : GameResult::BLACK_WON_BY_CHECKMATE);
-        }
-        return;
-    }
-
-    // see if the opponent pieces can defend their king
-    uint64_t kingToCheckingPieceMask = rangeMasks[oppKingSquare][checkingPieceSquare];
-    kingToCheckingPieceMask &= ~(1ULL << oppKingSquare);
-
-
-    if((defenderLegalMoves & kingToCheckingPieceMask) == 0) {
-        if(isWhiteTurn) board.blackKingCheckmated = true;
         board.setGameResult(isWhiteTurn ? GameResult::WHITE_WON_BY_CHECKMATE : GameResult::BLACK_WON_BY_CHECKMATE);
-        return;
     }
 }
 
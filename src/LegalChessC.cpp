@@ -0,0 +1,226 @@
+#include "LegalChessC.h"
+#include "LegalChess.h"
+#include "MoveManager.h"
+#include "Zobrist.h"
+
+#include <new>
+
+static_assert(LC_FEN_BUFFER_SIZE == LC::LegalChess::FEN_BUFFER_SIZE, "LC_FEN_BUFFER_SIZE differs from LegalChess::FEN_BUFFER_SIZE");
+static_assert(LC_JSON_BUFFER_SIZE == LC::LegalChess::JSON_BUFFER_SIZE, "LC_JSON_BUFFER_SIZE differs from LegalChess::JSON_BUFFER_SIZE");
+static_assert((int)LC_DRAW_BY_50_HALF_MOVES == (int)LC::GameResult::DRAW_BY_50_HALF_MOVES, "lc_result differs from GameResult");
+
+struct lc_game {
+    std::unique_ptr<LC::LegalChess> pGame;
+    std::string error;
+};
+
+namespace {
+
+void initialize() {
+    // the attack tables and the shared singletons are set up once per process, before the first game of any thread
+    static const bool initialized = (LC::compute(), LC::Zobrist::getInstance(), LC::MoveManagerStore::getMoveManagerStore(), true);
+    (void)initialized;
+}
+
+// runs a call that may throw and turns the exception into a status, the message is kept for lc_last_error
+template<typename Call>
+lc_status guard(lc_game* pGame, Call call) {
+    try {
+        call();
+        if(!pGame->error.empty()) pGame->error.clear();
+        return LC_OK;
+    }
+    catch(const LC::InvalidMoveException& e) { pGame->error = e.what(); return LC_ERROR_INVALID_MOVE; }
+    catch(const LC::PlayerTurnException& e) { pGame->error = e.what(); return LC_ERROR_PLAYER_TURN; }
+    catch(const LC::EmptySquareException& e) { pGame->error = e.what(); return LC_ERROR_EMPTY_SQUARE; }
+    catch(const LC::InvalidMovePatternException& e) { pGame->error = e.what(); return LC_ERROR_INVALID_MOVE_PATTERN; }
+    catch(const LC::BlockedMoveException& e) { pGame->error = e.what(); return LC_ERROR_BLOCKED_MOVE; }
+    catch(const LC::KingUnderCheckException& e) { pGame->error = e.what(); return LC_ERROR_KING_UNDER_CHECK; }
+    catch(const LC::KingCastleException& e) { pGame->error = e.what(); return LC_ERROR_KING_CASTLE; }
+    catch(const LC::GameOverException& e) { pGame->error = e.what(); return LC_ERROR_GAME_OVER; }
+    catch(const std::bad_alloc&) { return LC_ERROR_OUT_OF_MEMORY; }
+    catch(const std::exception& e) { pGame->error = e.what(); return LC_ERROR_INTERNAL; }
+    catch(...) { return LC_ERROR_INTERNAL; }
+}
+
+lc_status writeOutput(size_t length, size_t size, size_t* pLength) {
+    if(pLength) *pLength = length;
+
+    return length < size ? LC_OK : LC_ERROR_BUFFER_TOO_SMALL;
+}
+
+}
+
+extern "C" {
+
+const char* lc_status_string(lc_status status) {
+    switch(status) {
+        case LC_OK: return "LC_OK";
+        case LC_ERROR_INVALID_ARGUMENT: return "LC_ERROR_INVALID_ARGUMENT";
+        case LC_ERROR_INVALID_MOVE: return "LC_ERROR_INVALID_MOVE";
+        case LC_ERROR_PLAYER_TURN: return "LC_ERROR_PLAYER_TURN";
+        case LC_ERROR_EMPTY_SQUARE: return "LC_ERROR_EMPTY_SQUARE";
+        case LC_ERROR_INVALID_MOVE_PATTERN: return "LC_ERROR_INVALID_MOVE_PATTERN";
+        case LC_ERROR_BLOCKED_MOVE: return "LC_ERROR_BLOCKED_MOVE";
+        case LC_ERROR_KING_UNDER_CHECK: return "LC_ERROR_KING_UNDER_CHECK";
+        case LC_ERROR_KING_CASTLE: return "LC_ERROR_KING_CASTLE";
+        case LC_ERROR_GAME_OVER: return "LC_ERROR_GAME_OVER";
+        case LC_ERROR_BUFFER_TOO_SMALL: return "LC_ERROR_BUFFER_TOO_SMALL";
+        case LC_ERROR_OUT_OF_MEMORY: return "LC_ERROR_OUT_OF_MEMORY";
+        case LC_ERROR_INTERNAL: return "LC_ERROR_INTERNAL";
+    }
+
+    return "LC_UNKNOWN_STATUS";
+}
+
+lc_status lc_game_new(lc_game** ppGame) {
+    if(!ppGame) return LC_ERROR_INVALID_ARGUMENT;
+
+    *ppGame = nullptr;
+
+    try {
+        initialize();
+
+        std::unique_ptr<lc_game> pGame(new lc_game());
+        pGame->pGame = std::make_unique<LC::LegalChess>();
+
+        *ppGame = pGame.release();
+        return LC_OK;
+    }
+    catch(const std::bad_alloc&) { return LC_ERROR_OUT_OF_MEMORY; }
+    catch(...) { return LC_ERROR_INTERNAL; }
+}
+
+lc_status lc_game_fork(const lc_game* pGame, lc_game** ppFork) {
+    if(!pGame || !ppFork) return LC_ERROR_INVALID_ARGUMENT;
+
+    *ppFork = nullptr;
+
+    try {
+        std::unique_ptr<lc_game> pFork(new lc_game());
+        pFork->pGame = pGame->pGame->fork();
+
+        *ppFork = pFork.release();
+        return LC_OK;
+    }
+    catch(const std::bad_alloc&) { return LC_ERROR_OUT_OF_MEMORY; }
+    catch(...) { return LC_ERROR_INTERNAL; }
+}
+
+void lc_game_free(lc_game* pGame) {
+    delete pGame;
+}
+
+lc_status lc_apply_move(lc_game* pGame, const char* move, size_t length, lc_result* pResult) {
+    if(!pGame || (!move && length != 0)) return LC_ERROR_INVALID_ARGUMENT;
+
+    lc_status status = guard(pGame, [&]() {
+        pGame->pGame->makeMove(std::string(move, length));
+    });
+
+    if(pResult) *pResult = (lc_result)pGame->pGame->getGameResult();
+
+    return status;
+}
+
+lc_status lc_apply_moves_batch(lc_game* pGame, const char* moves, size_t length, size_t* pApplied, lc_result* pResult) {
+    if(pApplied) *pApplied = 0;
+    if(!pGame || (!moves && length != 0)) return LC_ERROR_INVALID_ARGUMENT;
+
+    size_t applied = 0;
+
+    lc_status status = guard(pGame, [&]() {
+        std::string move;
+
+        for(size_t start = 0; start < length;) {
+            if(moves[start] == ' ') {
+                start++;
+                continue;
+            }
+
+            size_t end = start;
+            while(end < length && moves[end] != ' ') end++;
+
+            move.assign(moves + start, end - start);
+            pGame->pGame->makeMove(move);
+
+            applied++;
+            start = end;
+        }
+    });
+
+    if(pApplied) *pApplied = applied;
+    if(pResult) *pResult = (lc_result)pGame->pGame->getGameResult();
+
+    return status;
+}
+
+size_t lc_apply_move_requests(lc_move_request* pRequests, size_t count) {
+    if(!pRequests) return 0;
+
+    size_t accepted = 0;
+
+    for(size_t i = 0; i < count; i++) {
+        lc_move_request& request = pRequests[i];
+
+        request.status = lc_apply_move(request.game, request.move, request.length, &request.result);
+        if(request.status == LC_OK) accepted++;
+    }
+
+    return accepted;
+}
+
+lc_status lc_is_legal(const lc_game* pGame, const char* move, size_t length, int* pLegal) {
+    if(!pGame || !pLegal || (!move && length != 0)) return LC_ERROR_INVALID_ARGUMENT;
+
+    try {
+        *pLegal = pGame->pGame->getGameResult() == LC::GameResult::IN_PROGRESS && pGame->pGame->isLegal(std::string(move, length));
+        return LC_OK;
+    }
+    catch(const std::bad_alloc&) { return LC_ERROR_OUT_OF_MEMORY; }
+    catch(...) { return LC_ERROR_INTERNAL; }
+}
+
+lc_status lc_get_result(const lc_game* pGame, lc_result* pResult) {
+    if(!pGame || !pResult) return LC_ERROR_INVALID_ARGUMENT;
+
+    *pResult = (lc_result)pGame->pGame->getGameResult();
+    return LC_OK;
+}
+
+lc_status lc_get_move_number(const lc_game* pGame, uint32_t* pMoveNumber) {
+    if(!pGame || !pMoveNumber) return LC_ERROR_INVALID_ARGUMENT;
+
+    *pMoveNumber = pGame->pGame->getMoveNumber();
+    return LC_OK;
+}
+
+lc_status lc_write_fen(const lc_game* pGame, char* buffer, size_t size, size_t* pLength) {
+    if(!pGame || (!buffer && size != 0)) return LC_ERROR_INVALID_ARGUMENT;
+
+    return writeOutput(pGame->pGame->writeFEN(buffer, size), size, pLength);
+}
+
+lc_status lc_write_fen_batch(const lc_game* const* pGames, size_t count, char* buffer) {
+    if((!pGames || !buffer) && count != 0) return LC_ERROR_INVALID_ARGUMENT;
+
+    for(size_t i = 0; i < count; i++) {
+        if(!pGames[i]) return LC_ERROR_INVALID_ARGUMENT;
+    }
+
+    for(size_t i = 0; i < count; i++) pGames[i]->pGame->writeFEN(buffer + i*LC_FEN_BUFFER_SIZE, LC_FEN_BUFFER_SIZE);
+
+    return LC_OK;
+}
+
+lc_status lc_write_json(const lc_game* pGame, char* buffer, size_t size, size_t* pLength) {
+    if(!pGame || (!buffer && size != 0)) return LC_ERROR_INVALID_ARGUMENT;
+
+    return writeOutput(pGame->pGame->writeJSON(buffer, size), size, pLength);
+}
+
+const char* lc_last_error(const lc_game* pGame) {
+    return pGame ? pGame->error.c_str() : "";
+}
+
+}
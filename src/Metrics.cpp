@@ -0,0 +1,208 @@
+#include "Metrics.h"
+#include "Board.h"
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <chrono>
+
+namespace LC {
+
+const char* const metricsPhaseToString[(int)MetricsPhase::COUNT] = {"Make_Move", "Parse", "Piece_Validation", "Self_Check", "Repetition_Hash", "Game_Result"};
+const char* const rejectReasonToString[(int)RejectReason::COUNT] = {"Invalid_Move", "Player_Turn", "Empty_Square", "Invalid_Move_Pattern", "Blocked_Move", "King_Under_Check", "King_Castle", "Game_Over", "Other"};
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Metrics::ThreadCounters>> counters;
+    // counters of exited threads keep their counts and go to the next thread that registers, so a thread per
+    // connection doesn't add a block per connection
+    std::vector<Metrics::ThreadCounters*> released;
+
+    // reference point to convert ticks to nanoseconds
+    uint64_t startTicks = Metrics::readTicks();
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+};
+
+Registry& getRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+uint64_t load(const std::atomic<uint64_t>& counter) {
+    return counter.load(std::memory_order_relaxed);
+}
+
+void clear(std::atomic<uint64_t>& counter) {
+    counter.store(0, std::memory_order_relaxed);
+}
+
+}
+
+struct Metrics::ThreadRelease {
+    ~ThreadRelease() {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        registry.released.push_back(t_pCounters);
+        t_pCounters = nullptr;
+    }
+};
+
+void Metrics::registerThread() {
+    Registry& registry = getRegistry();
+
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        if(registry.released.empty()) {
+            registry.counters.push_back(std::make_unique<ThreadCounters>());
+            t_pCounters = registry.counters.back().get();
+        }
+        else {
+            t_pCounters = registry.released.back();
+            registry.released.pop_back();
+        }
+    }
+
+    // destroyed when the thread exits
+    static thread_local ThreadRelease release;
+    (void)release;
+}
+
+void Metrics::recordSample(int phase, uint64_t startTicks, uint64_t endTicks) {
+    ThreadCounters& counters = local();
+    uint64_t ticks = endTicks - startTicks;
+
+    if(phase == (int)MetricsPhase::MAKE_MOVE) add(counters.sampledMoves, 1);
+
+    add(counters.phaseSamples[phase], 1);
+    add(counters.phaseTicks[phase], ticks);
+    add(counters.histogram[phase][bucketForTicks(ticks)], 1);
+}
+
+void Metrics::setLatencySampleInterval(uint32_t interval) {
+    uint32_t mask = 1;
+    while(mask < interval && mask < (1U << 31)) mask <<= 1;
+
+    m_sampleMask.store(mask - 1, std::memory_order_relaxed);
+}
+
+void Metrics::recordRejection(const std::exception& e) {
+    RejectReason reason = RejectReason::OTHER;
+
+    if(dynamic_cast<const InvalidMoveException*>(&e)) reason = RejectReason::INVALID_MOVE;
+    else if(dynamic_cast<const PlayerTurnException*>(&e)) reason = RejectReason::PLAYER_TURN;
+    else if(dynamic_cast<const EmptySquareException*>(&e)) reason = RejectReason::EMPTY_SQUARE;
+    else if(dynamic_cast<const InvalidMovePatternException*>(&e)) reason = RejectReason::INVALID_MOVE_PATTERN;
+    else if(dynamic_cast<const BlockedMoveException*>(&e)) reason = RejectReason::BLOCKED_MOVE;
+    else if(dynamic_cast<const KingUnderCheckException*>(&e)) reason = RejectReason::KING_UNDER_CHECK;
+    else if(dynamic_cast<const KingCastleException*>(&e)) reason = RejectReason::KING_CASTLE;
+    else if(dynamic_cast<const GameOverException*>(&e)) reason = RejectReason::GAME_OVER;
+
+    add(local().rejected[(int)reason], 1);
+}
+
+int Metrics::bucketForTicks(uint64_t ticks) {
+    if(ticks < (1ULL << SUB_BUCKET_BITS)) return (int)ticks;
+
+    int msb = 63 - __builtin_clzll(ticks);
+    int subBucket = (int)((ticks >> (msb - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1));
+
+    return ((msb - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + subBucket;
+}
+
+uint64_t Metrics::ticksForBucket(int bucket) {
+    if(bucket < (1 << SUB_BUCKET_BITS)) return bucket;
+
+    int msb = (bucket >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+    uint64_t subBucket = bucket & ((1 << SUB_BUCKET_BITS) - 1);
+
+    // middle of the bucket range
+    uint64_t lower = (1ULL << msb) | (subBucket << (msb - SUB_BUCKET_BITS));
+    return lower + ((1ULL << (msb - SUB_BUCKET_BITS)) >> 1);
+}
+
+MetricsSnapshot Metrics::snapshot() {
+    MetricsSnapshot snapshot = {};
+
+#ifdef LC_ENABLE_METRICS
+    snapshot.enabled = true;
+#endif
+
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    uint64_t elapsedTicks = readTicks() - registry.startTicks;
+    auto elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry.startTime).count();
+    snapshot.ticksPerNanosecond = elapsedTime > 0 ? (double)elapsedTicks / elapsedTime : 1.0;
+
+    uint64_t histogram[(int)MetricsPhase::COUNT][NUM_BUCKETS] = {};
+
+    for(auto& pCounters : registry.counters) {
+        snapshot.acceptedMoves += load(pCounters->acceptedMoves);
+        snapshot.sampledMoves += load(pCounters->sampledMoves);
+        snapshot.positionCacheProbes += load(pCounters->positionCacheProbes);
+        snapshot.positionCacheHits += load(pCounters->positionCacheHits);
+
+        for(int phase = 0; phase < (int)MetricsPhase::COUNT; phase++) {
+            snapshot.phases[phase].samples += load(pCounters->phaseSamples[phase]);
+            snapshot.phases[phase].totalTicks += load(pCounters->phaseTicks[phase]);
+
+            for(int bucket = 0; bucket < NUM_BUCKETS; bucket++) histogram[phase][bucket] += load(pCounters->histogram[phase][bucket]);
+        }
+
+        for(int reason = 0; reason < (int)RejectReason::COUNT; reason++) snapshot.rejected[reason] += load(pCounters->rejected[reason]);
+    }
+
+    for(int phase = 0; phase < (int)MetricsPhase::COUNT; phase++) {
+        PhaseSnapshot& phaseSnapshot = snapshot.phases[phase];
+
+        // the histogram is read without stopping the writers, use its own total for the ranks
+        uint64_t total = 0;
+        for(int bucket = 0; bucket < NUM_BUCKETS; bucket++) total += histogram[phase][bucket];
+        if(total == 0) continue;
+
+        uint64_t p50Rank = (total * 50 + 99) / 100, p90Rank = (total * 90 + 99) / 100, p99Rank = (total * 99 + 99) / 100;
+        uint64_t seen = 0;
+
+        for(int bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+            if(histogram[phase][bucket] == 0) continue;
+
+            uint64_t ticks = ticksForBucket(bucket);
+            if(seen < p50Rank && seen + histogram[phase][bucket] >= p50Rank) phaseSnapshot.p50Ticks = ticks;
+            if(seen < p90Rank && seen + histogram[phase][bucket] >= p90Rank) phaseSnapshot.p90Ticks = ticks;
+            if(seen < p99Rank && seen + histogram[phase][bucket] >= p99Rank) phaseSnapshot.p99Ticks = ticks;
+
+            seen += histogram[phase][bucket];
+            phaseSnapshot.maxTicks = ticks;
+        }
+    }
+
+    return snapshot;
+}
+
+// counters are cleared from the calling thread, an increment racing with the reset can survive it
+void Metrics::reset() {
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for(auto& pCounters : registry.counters) {
+        clear(pCounters->acceptedMoves);
+        clear(pCounters->sampledMoves);
+        clear(pCounters->positionCacheProbes);
+        clear(pCounters->positionCacheHits);
+
+        for(int phase = 0; phase < (int)MetricsPhase::COUNT; phase++) {
+            clear(pCounters->phaseSamples[phase]);
+            clear(pCounters->phaseTicks[phase]);
+
+            for(auto& bucket : pCounters->histogram[phase]) clear(bucket);
+        }
+
+        for(auto& reason : pCounters->rejected) clear(reason);
+    }
+}
+
+};
@@ -0,0 +1,224 @@
+#include "MoveDelta.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+namespace LC {
+
+namespace {
+
+constexpr uint8_t HAS_DETAIL = 0x40;
+constexpr uint8_t HAS_RESULT = 0x80;
+
+enum DeltaKind : uint8_t {
+    PLAIN = 0,
+    CASTLING = 1,
+    ENPASSANT = 2,
+    PROMOTION = 3
+};
+
+const char promotionPieces[4] = {'n', 'b', 'r', 'q'};
+
+}
+
+size_t encodeMoveDelta(const MoveDelta& delta, uint8_t* pOutput) {
+    uint8_t kind = PLAIN, promotion = 0;
+
+    if(delta.rookFromSquare != 64) kind = CASTLING;
+    else if(delta.capturedPiece != Piece::EMPTY && delta.captureSquare != delta.toSquare) kind = ENPASSANT;
+    else if(delta.choosenPiece) {
+        kind = PROMOTION;
+        while(promotionPieces[promotion] != delta.choosenPiece) promotion++;
+    }
+
+    bool hasDetail = kind != PLAIN || delta.capturedPiece != Piece::EMPTY;
+    bool hasResult = delta.result != GameResult::IN_PROGRESS;
+
+    size_t size = 2;
+
+    pOutput[0] = delta.fromSquare | ((uint8_t)delta.checkType << 6);
+    pOutput[1] = delta.toSquare | (hasDetail ? HAS_DETAIL : 0) | (hasResult ? HAS_RESULT : 0);
+
+    if(hasDetail) pOutput[size++] = (uint8_t)delta.capturedPiece | (kind << 4) | (promotion << 6);
+    if(hasResult) pOutput[size++] = (uint8_t)delta.result;
+
+    return size;
+}
+
+size_t decodeMoveDelta(const uint8_t* pData, size_t size, MoveDelta& delta) {
+    if(size < 2) return 0;
+
+    size_t length = 2 + ((pData[1] & HAS_DETAIL) != 0) + ((pData[1] & HAS_RESULT) != 0);
+    if(size < length) return 0;
+
+    delta.fromSquare = pData[0] & 63;
+    delta.toSquare = pData[1] & 63;
+    delta.checkType = (CheckType)(pData[0] >> 6);
+    delta.capturedPiece = Piece::EMPTY;
+    delta.captureSquare = delta.rookFromSquare = delta.rookToSquare = 64;
+    delta.choosenPiece = 0;
+    delta.result = GameResult::IN_PROGRESS;
+
+    if(delta.fromSquare == delta.toSquare) return 0;
+
+    size_t offset = 2;
+
+    if(pData[1] & HAS_DETAIL) {
+        uint8_t detail = pData[offset++];
+        uint8_t kind = (detail >> 4) & 3;
+
+        if((detail & 15) > (int)Piece::EMPTY) return 0;
+
+        delta.capturedPiece = (Piece)(detail & 15);
+        if(delta.capturedPiece != Piece::EMPTY) delta.captureSquare = delta.toSquare;
+
+        if(kind == CASTLING) {
+            bool shortSide = delta.toSquare%8 == 1;
+
+            delta.rookFromSquare = shortSide ? delta.toSquare - 1 : delta.toSquare + 2;
+            delta.rookToSquare = shortSide ? delta.toSquare + 1 : delta.toSquare - 1;
+        }
+        else if(kind == ENPASSANT) {
+            if(delta.capturedPiece != Piece::WHITE_PAWN && delta.capturedPiece != Piece::BLACK_PAWN) return 0;
+
+            // the victim stands next to the pawn's from square on the file of the to square
+            delta.captureSquare = (delta.fromSquare/8)*8 + delta.toSquare%8;
+        }
+        else if(kind == PROMOTION) delta.choosenPiece = promotionPieces[detail >> 6];
+    }
+
+    if(pData[1] & HAS_RESULT) {
+        if(pData[offset] > (int)GameResult::DRAW_BY_50_HALF_MOVES) return 0;
+
+        delta.result = (GameResult)pData[offset++];
+    }
+
+    return length;
+}
+
+
+MoveDeltaApplier::MoveDeltaApplier() {
+    loadFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+}
+
+MoveDeltaApplier::MoveDeltaApplier(const std::string& fen) {
+    loadFEN(fen);
+}
+
+size_t MoveDeltaApplier::apply(const uint8_t* pData, size_t size) {
+    MoveDelta delta;
+    size_t length = decodeMoveDelta(pData, size, delta);
+
+    if(length == 0) throw MoveDeltaException("Incomplete or invalid move delta. Move number: " + std::to_string(m_movesCount + 1));
+
+    apply(delta);
+
+    return length;
+}
+
+void MoveDeltaApplier::apply(const MoveDelta& delta) {
+    char piece = m_board[delta.fromSquare];
+
+    if(m_result != GameResult::IN_PROGRESS) {
+        throw MoveDeltaException("Game is Over. Cannot apply move delta. Move number: " + std::to_string(m_movesCount + 1));
+    }
+
+    if(piece == '.' || (isupper(piece) != 0) != m_whiteTurn) {
+        throw MoveDeltaException("The move delta doesn't start on a piece of the side to move. Move number: " + std::to_string(m_movesCount + 1));
+    }
+
+    bool isPawn = piece == 'P' || piece == 'p';
+
+    if(delta.captureSquare != 64) m_board[delta.captureSquare] = '.';
+
+    m_board[delta.fromSquare] = '.';
+    m_board[delta.toSquare] = delta.choosenPiece ? (m_whiteTurn ? toupper(delta.choosenPiece) : delta.choosenPiece) : piece;
+
+    if(delta.rookFromSquare != 64) {
+        m_board[delta.rookToSquare] = m_board[delta.rookFromSquare];
+        m_board[delta.rookFromSquare] = '.';
+    }
+
+    if(isPawn || delta.capturedPiece != Piece::EMPTY) m_halfMovesCount = 0;
+    else m_halfMovesCount++;
+
+    m_enpassantSquare = isPawn && abs(delta.fromSquare - delta.toSquare) == 16 ? (delta.fromSquare + delta.toSquare)/2 : 64;
+
+    // same rules as Board::updateCastlingRights
+    if(delta.fromSquare == 3) m_castlingRights &= ~3;
+    if(delta.fromSquare == 59) m_castlingRights &= ~12;
+
+    if(delta.fromSquare == 0 || delta.toSquare == 0) m_castlingRights &= ~1;
+    if(delta.fromSquare == 7 || delta.toSquare == 7) m_castlingRights &= ~2;
+    if(delta.fromSquare == 56 || delta.toSquare == 56) m_castlingRights &= ~4;
+    if(delta.fromSquare == 63 || delta.toSquare == 63) m_castlingRights &= ~8;
+
+    m_movesCount++;
+    m_whiteTurn = !m_whiteTurn;
+    m_checkType = delta.checkType;
+    m_result = delta.result;
+}
+
+std::string MoveDeltaApplier::getFENString() const {
+    char fen[Board::FEN_BUFFER_SIZE];
+
+    return std::string(fen, formatFEN(m_board.data(), m_whiteTurn, m_castlingRights, m_enpassantSquare, m_halfMovesCount, m_movesCount, fen));
+}
+
+void MoveDeltaApplier::loadFEN(const std::string& fen) {
+    std::stringstream ss(fen);
+    std::string placement, turn, castling, enpassant;
+    int halfMoves = 0, fullMoves = 1;
+
+    ss >> placement >> turn >> castling >> enpassant >> halfMoves >> fullMoves;
+
+    if(ss.fail() || (turn != "w" && turn != "b") || halfMoves < 0 || halfMoves > UINT16_MAX || fullMoves < 1 || fullMoves > 32768) throw MoveDeltaException("Invalid FEN: " + fen);
+
+    // ranks from 8, files from a
+    int rank = 7, file = 0;
+
+    m_board.fill('.');
+
+    for(char c : placement) {
+        if(c == '/') {
+            if(file != 8 || rank == 0) throw MoveDeltaException("Invalid FEN: " + fen);
+
+            rank--;
+            file = 0;
+        }
+        else if(c >= '1' && c <= '8') file += c - '0';
+        else if(std::string("PNBRQKpnbrqk").find(c) != std::string::npos && file < 8) m_board[rank*8 + 7 - file++] = c;
+        else throw MoveDeltaException("Invalid FEN: " + fen);
+
+        if(file > 8) throw MoveDeltaException("Invalid FEN: " + fen);
+    }
+
+    if(rank != 0 || file != 8) throw MoveDeltaException("Invalid FEN: " + fen);
+
+    m_castlingRights = 0;
+
+    if(castling != "-") {
+        for(char c : castling) {
+            if(c == 'K') m_castlingRights |= 1;
+            else if(c == 'Q') m_castlingRights |= 2;
+            else if(c == 'k') m_castlingRights |= 4;
+            else if(c == 'q') m_castlingRights |= 8;
+            else throw MoveDeltaException("Invalid FEN: " + fen);
+        }
+    }
+
+    if(enpassant == "-") m_enpassantSquare = 64;
+    else if(enpassant.length() == 2 && enpassant[0] >= 'a' && enpassant[0] <= 'h' && (enpassant[1] == '3' || enpassant[1] == '6')) {
+        m_enpassantSquare = (enpassant[1] - '1')*8 + ('h' - enpassant[0]);
+    }
+    else throw MoveDeltaException("Invalid FEN: " + fen);
+
+    m_whiteTurn = turn == "w";
+    m_halfMovesCount = halfMoves;
+    m_movesCount = (fullMoves - 1)*2 + !m_whiteTurn;
+    m_checkType = CheckType::NO_CHECK;
+    m_result = GameResult::IN_PROGRESS;
+}
+
+};
@@ -0,0 +1,214 @@
+#include "MoveExecutor.h"
+
+namespace LC {
+
+namespace {
+
+// smaller submissions are applied on the calling thread
+constexpr size_t INLINE_MOVES = 64;
+
+// tasks per worker, more tasks balance uneven games better and cost more queue operations
+constexpr size_t TASKS_PER_WORKER = 8;
+
+inline uint32_t getBucket(const LegalChess* pGame, uint32_t bucketCount) {
+    uint64_t key = (uint64_t)pGame;
+    key ^= key >> 29;
+    key *= 0xBF58476D1CE4E5B9ULL;
+
+    return (key >> 32) % bucketCount;
+}
+
+}
+
+struct MoveExecutor::Job {
+    const GameMove* pMoves;
+    std::vector<uint32_t> order;    // indices of the moves grouped by task
+    MoveOutcome* pOutcomes;
+    const std::function<void(size_t, const MoveOutcome&)>* pOnComplete;
+
+    std::mutex mutex;
+    std::condition_variable done;
+    uint32_t pendingTasks;          // guarded by mutex
+};
+
+MoveExecutor::MoveExecutor(unsigned threadCount) {
+    if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for(unsigned index = 0; index < threadCount; index++) m_workers.push_back(std::make_unique<Worker>());
+
+    for(unsigned index = 0; index < threadCount; index++) {
+        m_workers[index]->thread = std::thread(&MoveExecutor::runWorker, this, index);
+    }
+}
+
+MoveExecutor::~MoveExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+
+    m_wakeUp.notify_all();
+
+    for(auto& pWorker : m_workers) pWorker->thread.join();
+}
+
+void MoveExecutor::submitMoves(const GameMove* pMoves, size_t count, std::vector<MoveOutcome>& outcomes) {
+    outcomes.resize(count);
+
+    Job job;
+    job.pMoves = pMoves;
+    job.order.resize(count);
+    job.pOutcomes = outcomes.data();
+    job.pOnComplete = nullptr;
+
+    submit(job);
+}
+
+void MoveExecutor::submitMoves(const GameMove* pMoves, size_t count, const std::function<void(size_t index, const MoveOutcome& outcome)>& onComplete) {
+    Job job;
+    job.pMoves = pMoves;
+    job.order.resize(count);
+    job.pOutcomes = nullptr;
+    job.pOnComplete = &onComplete;
+
+    submit(job);
+}
+
+void MoveExecutor::submit(Job& job) {
+    uint32_t count = job.order.size();
+    if(count == 0) return;
+
+    if(count < INLINE_MOVES) {
+        for(uint32_t index = 0; index < count; index++) job.order[index] = index;
+
+        job.pendingTasks = 1;
+        runTask({&job, 0, count});
+        return;
+    }
+
+    // all moves of a game hash to the same task and keep their order in it
+    uint32_t bucketCount = std::min<size_t>(count, m_workers.size() * TASKS_PER_WORKER);
+    std::vector<uint32_t> bucketStart(bucketCount + 1, 0);
+
+    for(uint32_t index = 0; index < count; index++) bucketStart[getBucket(job.pMoves[index].game, bucketCount) + 1]++;
+    for(uint32_t bucket = 0; bucket < bucketCount; bucket++) bucketStart[bucket + 1] += bucketStart[bucket];
+
+    std::vector<uint32_t> position(bucketStart.begin(), bucketStart.end() - 1);
+    for(uint32_t index = 0; index < count; index++) job.order[position[getBucket(job.pMoves[index].game, bucketCount)]++] = index;
+
+    std::vector<Task> tasks;
+
+    for(uint32_t bucket = 0; bucket < bucketCount; bucket++) {
+        if(bucketStart[bucket] != bucketStart[bucket + 1]) tasks.push_back({&job, bucketStart[bucket], bucketStart[bucket + 1]});
+    }
+
+    job.pendingTasks = tasks.size();
+
+    // counted before they are queued, so a worker that takes one never sees the count below zero
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queuedTasks += tasks.size();
+    }
+
+    for(size_t index = 0; index < tasks.size(); index++) {
+        Worker& worker = *m_workers[index % m_workers.size()];
+
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(tasks[index]);
+    }
+
+    m_wakeUp.notify_all();
+
+    // help instead of waiting, the caller has no queue of its own and only steals
+    Task task;
+    while(takeTask(m_workers.size(), task)) runTask(task);
+
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.done.wait(lock, [&job]() {
+        return job.pendingTasks == 0;
+    });
+}
+
+void MoveExecutor::runWorker(unsigned index) {
+    Task task;
+
+    while(true) {
+        if(takeTask(index, task)) {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wakeUp.wait(lock, [this]() {
+            return m_stopping || m_queuedTasks.load(std::memory_order_relaxed) != 0;
+        });
+
+        if(m_stopping) return;
+    }
+}
+
+bool MoveExecutor::takeTask(unsigned index, Task& task) {
+    unsigned workerCount = m_workers.size();
+
+    if(index < workerCount) {
+        Worker& worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+
+        if(!worker.tasks.empty()) {
+            task = worker.tasks.back();
+            worker.tasks.pop_back();
+            m_queuedTasks--;
+            return true;
+        }
+    }
+
+    for(unsigned offset = 1; offset <= workerCount; offset++) {
+        Worker& victim = *m_workers[(index + offset) % workerCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if(!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            m_queuedTasks--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void MoveExecutor::runTask(const Task& task) {
+    Job& job = *task.pJob;
+
+    for(uint32_t position = task.begin; position < task.end; position++) {
+        // games are spread over the heap, fetch the next game and board while this move is validated
+        if(position + 2 < task.end) __builtin_prefetch(job.pMoves[job.order[position + 2]].game);
+
+        if(position + 1 < task.end) {
+            const char* pBoard = (const char*)job.pMoves[job.order[position + 1]].game->m_pBoard.get();
+            for(size_t offset = 0; offset < sizeof(Board); offset += 64) __builtin_prefetch(pBoard + offset);
+        }
+
+        uint32_t index = job.order[position];
+        const GameMove& gameMove = job.pMoves[index];
+        MoveOutcome outcome;
+
+        try {
+            outcome.result = gameMove.game->makeMove(gameMove.move);
+            outcome.accepted = true;
+        }
+        catch(const std::exception& e) {
+            outcome.result = gameMove.game->getGameResult();
+            outcome.accepted = false;
+            outcome.error = e.what();
+        }
+
+        if(job.pOutcomes != nullptr) job.pOutcomes[index] = std::move(outcome);
+        else (*job.pOnComplete)(index, outcome);
+    }
+
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if(--job.pendingTasks == 0) job.done.notify_all();
+}
+
+};
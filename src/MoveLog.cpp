@@ -0,0 +1,323 @@
+#include "MoveLog.h"
+#include "LegalChess.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace LC {
+
+namespace {
+
+// the writer starts a batch early once this much is queued
+constexpr size_t MAX_BATCH_BYTES = 1 << 20;
+
+// records read at once during recovery
+constexpr size_t READ_RECORDS = 1 << 16;
+
+// records replayed at once during recovery, a chunk is sorted by game (16 bytes per record while sorting)
+constexpr size_t REPLAY_RECORDS = 1 << 25;
+
+constexpr uint32_t CHECK_SALT = 0x4C434D4C;
+
+// a record is game id (4 bytes), ply (2), move (2) and a check of the other fields (4), little endian.
+// a record with ply 0 and move 0 closes its game. in memory the first three fields are one payload
+inline uint64_t getPayload(uint32_t gameId, uint16_t ply, PackedMove move) {
+    return gameId | ((uint64_t)ply << 32) | ((uint64_t)move << 48);
+}
+
+inline uint32_t getCheck(uint64_t payload) {
+    return (uint32_t)((payload * 0x9E3779B97F4A7C15ULL) >> 32) ^ CHECK_SALT;
+}
+
+inline void encodeRecord(uint64_t payload, char* pData) {
+    uint32_t check = getCheck(payload);
+
+    std::memcpy(pData, &payload, 8);
+    std::memcpy(pData + 8, &check, 4);
+}
+
+// false if the bytes are not a record written by encodeRecord, e.g. the unwritten tail of a torn batch
+inline bool decodeRecord(const char* pData, uint64_t& payload) {
+    uint32_t check;
+
+    std::memcpy(&payload, pData, 8);
+    std::memcpy(&check, pData + 8, 4);
+
+    return check == getCheck(payload);
+}
+
+std::string getErrorMessage(const std::string& what, const std::string& path) {
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+// calls onRecord for every record from the start of the file up to the first damaged one and returns the
+// size of that valid part
+template<typename OnRecord>
+size_t readRecords(int fd, const std::string& path, OnRecord onRecord) {
+    std::vector<char> buffer(READ_RECORDS*MoveLog::RECORD_SIZE);
+    size_t validSize = 0, filled = 0;
+
+    if(lseek(fd, 0, SEEK_SET) < 0) throw MoveLogException(getErrorMessage("Cannot seek in move log", path));
+
+    while(true) {
+        ssize_t bytesRead = read(fd, buffer.data() + filled, buffer.size() - filled);
+
+        if(bytesRead < 0) {
+            if(errno == EINTR) continue;
+            throw MoveLogException(getErrorMessage("Cannot read move log", path));
+        }
+
+        if(bytesRead == 0) return validSize;
+
+        filled += bytesRead;
+
+        size_t offset = 0;
+        uint64_t payload;
+
+        for(; offset + MoveLog::RECORD_SIZE <= filled; offset += MoveLog::RECORD_SIZE) {
+            if(!decodeRecord(buffer.data() + offset, payload)) return validSize;
+
+            onRecord(payload);
+            validSize += MoveLog::RECORD_SIZE;
+        }
+
+        // keep a partial record for the next read
+        std::memmove(buffer.data(), buffer.data() + offset, filled - offset);
+        filled -= offset;
+    }
+}
+
+// stable radix sort on the game id, a byte all game ids share (e.g. the high bytes of small ids) costs one counting pass
+void sortByGame(std::vector<uint64_t>& records) {
+    std::vector<uint64_t> sorted(records.size());
+
+    for(int shift = 0; shift < 32; shift += 8) {
+        size_t starts[257] = {};
+
+        for(uint64_t payload : records) starts[((payload >> shift) & 255) + 1]++;
+        if(std::find(starts + 1, starts + 257, records.size()) != starts + 257) continue;
+
+        for(int byte = 0; byte < 256; byte++) starts[byte + 1] += starts[byte];
+        for(uint64_t payload : records) sorted[starts[(payload >> shift) & 255]++] = payload;
+
+        records.swap(sorted);
+    }
+}
+
+}
+
+MoveLog::MoveLog(const std::string& path, std::chrono::microseconds commitBudget) : m_commitBudget(commitBudget) {
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(m_fd < 0) throw MoveLogException(getErrorMessage("Cannot open move log", path));
+
+    try {
+        size_t validSize = readRecords(m_fd, path, [](uint64_t) {});
+
+        // new records go right after the last valid one, so recover never stops in front of them
+        if(ftruncate(m_fd, validSize) != 0 || fdatasync(m_fd) != 0) throw MoveLogException(getErrorMessage("Cannot truncate move log", path));
+        if(lseek(m_fd, validSize, SEEK_SET) < 0) throw MoveLogException(getErrorMessage("Cannot seek in move log", path));
+
+        // a newly created log has to survive a crash as well
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+
+        int directoryFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(directoryFd >= 0) {
+            fsync(directoryFd);
+            close(directoryFd);
+        }
+    }
+    catch(...) {
+        close(m_fd);
+        throw;
+    }
+
+    m_queue.reserve(MAX_BATCH_BYTES);
+    m_writer = std::thread(&MoveLog::runWriter, this);
+}
+
+MoveLog::~MoveLog() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_recordsQueued.notify_one();
+    m_writer.join();
+
+    close(m_fd);
+}
+
+uint64_t MoveLog::append(uint32_t gameId, uint16_t ply, PackedMove move) {
+    char data[RECORD_SIZE];
+    encodeRecord(getPayload(gameId, ply, move), data);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(!m_error.empty()) throw MoveLogException(m_error);
+
+    // the writer sleeps until the first record of a batch arrives, then at most the commit budget
+    if(m_queue.empty()) {
+        m_oldestQueued = std::chrono::steady_clock::now();
+        m_recordsQueued.notify_one();
+    }
+
+    m_queue.insert(m_queue.end(), data, data + RECORD_SIZE);
+
+    if(m_queue.size() >= MAX_BATCH_BYTES) m_recordsQueued.notify_one();
+
+    return ++m_appendedSequence;
+}
+
+uint64_t MoveLog::closeGame(uint32_t gameId) {
+    return append(gameId, 0, 0);
+}
+
+void MoveLog::waitDurable(uint64_t sequence) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_recordsDurable.wait(lock, [this, sequence]() {
+        return m_durableSequence >= sequence || !m_error.empty();
+    });
+
+    if(m_durableSequence < sequence) throw MoveLogException(m_error);
+}
+
+uint64_t MoveLog::getDurableSequence() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_durableSequence;
+}
+
+void MoveLog::runWriter() {
+    std::vector<char> batch;
+    batch.reserve(MAX_BATCH_BYTES);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(true) {
+        m_recordsQueued.wait(lock, [this]() {
+            return m_stopping || !m_queue.empty();
+        });
+
+        if(m_queue.empty()) return;
+
+        // records queued while the previous batch was synced may already be past their budget
+        m_recordsQueued.wait_until(lock, m_oldestQueued + m_commitBudget, [this]() {
+            return m_stopping || m_queue.size() >= MAX_BATCH_BYTES;
+        });
+
+        batch.swap(m_queue);
+        uint64_t sequence = m_appendedSequence;
+
+        lock.unlock();
+
+        std::string error;
+
+        for(size_t offset = 0; offset < batch.size() && error.empty();) {
+            ssize_t written = write(m_fd, batch.data() + offset, batch.size() - offset);
+
+            if(written >= 0) offset += written;
+            else if(errno != EINTR) error = std::string("Cannot write move log: ") + std::strerror(errno);
+        }
+
+        // one sync for the whole batch, this is what makes many moves per sync possible
+        if(error.empty() && fdatasync(m_fd) != 0) error = std::string("Cannot sync move log: ") + std::strerror(errno);
+
+        batch.clear();
+
+        lock.lock();
+
+        if(error.empty()) m_durableSequence = sequence;
+        else if(m_error.empty()) {
+            m_error = error;
+            m_failed.store(true, std::memory_order_release);
+        }
+
+        m_recordsDurable.notify_all();
+    }
+}
+
+uint64_t MoveLog::recover(const std::string& path, std::unordered_map<uint32_t, std::unique_ptr<LegalChess>>& games) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0) {
+        if(errno == ENOENT) return 0;
+        throw MoveLogException(getErrorMessage("Cannot open move log", path));
+    }
+
+    std::vector<uint64_t> records;
+    uint64_t recordCount = 0;
+
+    try {
+        readRecords(fd, path, [&](uint64_t payload) {
+            records.push_back(payload);
+            recordCount++;
+
+            if(records.size() == REPLAY_RECORDS) replayRecords(records, games);
+        });
+
+        replayRecords(records, games);
+    }
+    catch(...) {
+        close(fd);
+        throw;
+    }
+
+    close(fd);
+
+    // finished games are not live anymore
+    for(auto it = games.begin(); it != games.end();) {
+        if(it->second->detectGameResult() != GameResult::IN_PROGRESS) it = games.erase(it);
+        else ++it;
+    }
+
+    return recordCount;
+}
+
+void MoveLog::replayRecords(std::vector<uint64_t>& records, std::unordered_map<uint32_t, std::unique_ptr<LegalChess>>& games) {
+    // the records of a live server alternate between thousands of games, replayed in log order every move would
+    // fetch another board from memory. sorted by game (keeping the order within a game) all moves of a game are
+    // replayed while its board is in cache
+    sortByGame(records);
+
+    LegalChess* pGame = nullptr;
+    uint32_t lastGameId = 0;
+
+    for(uint64_t payload : records) {
+        uint32_t gameId = (uint32_t)payload;
+        uint16_t ply = payload >> 32;
+        PackedMove move = payload >> 48;
+
+        if(ply == 0 && move == 0) {
+            games.erase(gameId);
+            pGame = nullptr;
+            continue;
+        }
+
+        if(pGame == nullptr || gameId != lastGameId) {
+            auto& pEntry = games[gameId];
+            if(!pEntry) pEntry = std::make_unique<LegalChess>();
+
+            pGame = pEntry.get();
+            lastGameId = gameId;
+        }
+
+        // a record is appended once per accepted move, a gap means the log doesn't belong to these games
+        uint16_t expectedPly = pGame->m_pBoard->getMoveNumber() + 1;
+
+        if(ply != expectedPly) {
+            throw MoveLogException("Move log record out of order. Game: " + std::to_string(gameId) + ". Ply: " + std::to_string(ply) + ". Expected ply: " + std::to_string(expectedPly));
+        }
+
+        pGame->makeTrustedMove(unpackMove(move));
+    }
+
+    records.clear();
+}
+
+};
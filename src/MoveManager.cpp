@@ -4,7 +4,7 @@
 
 namespace LC {
 
-CheckType PawnMoveManager::handlePromotion(Piece newPiece, bool isPieceWhite, const Move& move, Board& board) {
+void PawnMoveManager::handlePromotion(Piece newPiece, bool isPieceWhite, const Move& move, Board& board) {
     // check move pattern
     if((isPieceWhite ? move.fromRow != 6 : move.fromRow != 1) || (isPieceWhite ? move.toRow != 7 : move.toRow != 0) || abs(move.fromCol - move.toCol) > 1) {
         // throw error
@@ -21,7 +21,7 @@ CheckType PawnMoveManager::handlePromotion(Piece newPiece, bool isPieceWhite, co
         throw InvalidMovePatternException("Invalid move pattern for a pawn. New square doesn't have an opponent piece to capture. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove));
     }
 
-    if(capturedPiece != Piece::EMPTY && isPieceWhite == (int)capturedPiece < 6) {
+    if(capturedPiece != Piece::EMPTY && (move.fromCol == move.toCol || isPieceWhite == (int)capturedPiece < 6)) {
         // throw error
         throw BlockedMoveException("The pawn is blocked. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove));
     }
@@ -47,37 +47,21 @@ CheckType PawnMoveManager::handlePromotion(Piece newPiece, bool isPieceWhite, co
         // throw error
         throw KingUnderCheckException("Cannot move piece. It is either pinned or the king is under check. Move number: " + std::to_string(board.getMoveNumber() + 1) + ". Move: " + std::string(move.uciMove));
     }
+}
 
-    uint64_t pieceAttacks = 0;
-
-    if(newPiece == Piece::WHITE_QUEEN || newPiece == Piece::BLACK_QUEEN) pieceAttacks = getQueenAttacksForSquareAndOccupancy(move.toSquare, board.getAllPiecesBitBoard());
-    else if(newPiece == Piece::WHITE_KNIGHT || newPiece == Piece::BLACK_KNIGHT) pieceAttacks = knightAttackSquares[move.toSquare];
-    else if(newPiece == Piece::WHITE_BISHOP || newPiece == Piece::BLACK_BISHOP) pieceAttacks = getBishopAttacksForSquareAndOccupancy(move.toSquare, board.getAllPiecesBitBoard());
-    else if(newPiece == Piece::WHITE_ROOK || newPiece == Piece::BLACK_ROOK) pieceAttacks = getRookAttacksForSquareAndOccupancy(move.toSquare, board.getAllPiecesBitBoard());
-
-
-    CheckType check = CheckType::NO_CHECK;
-
-    // Return the check type the move results in
-    if((pieceAttacks & (1ULL << __builtin_ctzll(board.getPieceBitBoard(isPieceWhite ? Piece::BLACK_KING : Piece::WHITE_KING))))) { // if the new piece directly checks the opponent king
-        // update the direct check square
-        board.directCheckSquare = move.toSquare;
-
-        check = CheckType::DIRECT_CHECK;
-    }
+void PawnMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
+    int rowStep = isPieceWhite ? move.toRow - move.fromRow : move.fromRow - move.toRow;
+    int colStep = abs(move.fromCol - move.toCol);
 
-    if(getPinDirection(!isPieceWhite, move.fromSquare, board, true) != PinDirection::NONE) { // if the move results in discovery check
-        check = check == CheckType::NO_CHECK ? CheckType::DISCOVERY_CHECK : CheckType::DOUBLE_CHECK;
+    // check move pattern, one step forward (straight or diagonal) or two steps straight from the starting rank
+    if(!((rowStep == 1 && colStep <= 1) || (rowStep == 2 && colStep == 0 && move.fromRow == (isPieceWhite ? 1 : 6)))) {
+        // throw error
+        throw InvalidMovePatternException("Invalid move pattern for a pawn. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove)); 
     }
 
-    return check;
-}
-
-CheckType PawnMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
-    // check move pattern
-    if((isPieceWhite ? move.fromRow - move.toRow > 0 : move.fromRow - move.toRow < 0) || (abs(move.fromRow - move.toRow) == 2 && (move.fromRow != 6 && move.fromRow != 1)) || abs(move.fromRow - move.toRow) > 2) {
+    if(move.toRow == (isPieceWhite ? 7 : 0)) {
         // throw error
-        throw InvalidMovePatternException("Invalid move pattern for a pawn. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove)); 
+        throw InvalidMovePatternException("The pawn has to be promoted on the last rank. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove)); 
     }
 
     Piece capturedPiece = board.getPieceOnBoard(move.toSquare);
@@ -88,20 +72,23 @@ CheckType PawnMoveManager::handleMove(bool isPieceWhite, const Move& move, Board
     pathMask &= ~(1ULL << move.fromSquare);
     pathMask &= ~(1ULL << move.toSquare);
 
+    bool isEnpassant = move.fromCol != move.toCol && move.toSquare == board.enpassantSquare;
+
     // if capture
-    if(move.fromCol != move.toCol && (capturedPiece == Piece::EMPTY && move.toSquare != board.enpassantSquare)) {
+    if(move.fromCol != move.toCol && (capturedPiece == Piece::EMPTY && !isEnpassant)) {
         // throw error
         throw InvalidMovePatternException("Invalid move pattern for a pawn. New square doesn't have an opponent piece to capture. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove));
     }
 
-    if((pathMask & board.getAllPiecesBitBoard()) != 0 || (capturedPiece != Piece::EMPTY && isPieceWhite == (int)capturedPiece < 6)) {
+    // a straight move can't capture
+    if((pathMask & board.getAllPiecesBitBoard()) != 0 || (capturedPiece != Piece::EMPTY && (move.fromCol == move.toCol || isPieceWhite == (int)capturedPiece < 6))) {
         // throw error
         throw BlockedMoveException("The pawn is blocked. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove));
     }
 
     // if capture, update the captured piece on board (don't have check for the validity of toSquare as it is taken care in board.move())
     if(capturedPiece != Piece::EMPTY) board.updatePieceCountOnBoard(capturedPiece, move.toSquare, false);
-    if(move.toSquare == board.enpassantSquare) board.updatePieceCountOnBoard(isPieceWhite ? Piece::BLACK_PAWN : Piece::WHITE_PAWN, move.fromRow*8 + move.toCol, false);
+    if(isEnpassant) board.updatePieceCountOnBoard(isPieceWhite ? Piece::BLACK_PAWN : Piece::WHITE_PAWN, move.fromRow*8 + move.toCol, false);
 
     // update the move on board
     board.updatePieceMoveOnBoard(movedPiece, move.fromSquare, move.toSquare);
@@ -109,7 +96,7 @@ CheckType PawnMoveManager::handleMove(bool isPieceWhite, const Move& move, Board
 
     if(isKingUnderCheck(isPieceWhite, board)) { // is my king under check after my move is made
         // undo the move
-        if(move.toSquare == board.enpassantSquare) board.updatePieceCountOnBoard(isPieceWhite ? Piece::BLACK_PAWN : Piece::WHITE_PAWN, move.fromRow*8 + move.toCol, true);
+        if(isEnpassant) board.updatePieceCountOnBoard(isPieceWhite ? Piece::BLACK_PAWN : Piece::WHITE_PAWN, move.fromRow*8 + move.toCol, true);
 
         board.updatePieceMoveOnBoard(movedPiece, move.toSquare, move.fromSquare);
 
@@ -123,35 +110,13 @@ CheckType PawnMoveManager::handleMove(bool isPieceWhite, const Move& move, Board
     if(abs(move.fromRow - move.toRow) == 2) {
         board.enpassantSquare = isPieceWhite ? move.fromSquare + 8 : move.fromSquare - 8;
     }
-    else if(move.toSquare == board.enpassantSquare) {
+    else if(isEnpassant) {
         // update grid
-        board.setPieceOnBoard(Piece::EMPTY, move.fromSquare*8 + move.toCol);
+        board.setPieceOnBoard(Piece::EMPTY, move.fromRow*8 + move.toCol);
     }
-
-    uint64_t pieceAttacks = 0; 
-
-    int newRank = isPieceWhite ? move.fromRow + 1 : move.fromRow - 1;
-    if(move.fromCol > 0) pieceAttacks |= (1ULL << (newRank*8 + move.fromCol - 1));
-    if(move.fromCol < 7) pieceAttacks |= (1ULL << (newRank*8 + move.fromCol + 1));
-
-    CheckType check = CheckType::NO_CHECK;
-
-    // Return the check type the move results in
-    if((pieceAttacks & (1ULL << __builtin_ctzll(board.getPieceBitBoard(isPieceWhite ? Piece::BLACK_KING : Piece::WHITE_KING))))) { // if the new piece directly checks the opponent king
-        // update the direct check square
-        board.directCheckSquare = move.toSquare;
-
-        check = CheckType::DIRECT_CHECK;
-    }
-
-    if(getPinDirection(!isPieceWhite, move.fromSquare, board, true) != PinDirection::NONE) { // if the move results in discovery check
-        check = check == CheckType::NO_CHECK ? CheckType::DISCOVERY_CHECK : CheckType::DOUBLE_CHECK;
-    }
-
-    return check;
 }
 
-CheckType KnightMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
+void KnightMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
     // check move pattern
     if((abs(move.fromRow - move.toRow) == 1 && abs(move.fromCol - move.toCol) == 2) || (abs(move.fromRow - move.toRow) == 2 && abs(move.fromCol - move.toCol) == 1)) {
         Piece capturedPiece = board.getPieceOnBoard(move.toSquare);
@@ -179,30 +144,14 @@ CheckType KnightMoveManager::handleMove(bool isPieceWhite, const Move& move, Boa
             throw KingUnderCheckException("Cannot move piece. It is either pinned or the king is under check. Move number: " + std::to_string(board.getMoveNumber() + 1) + ". Move: " + std::string(move.uciMove));
         }
 
-        uint64_t pieceAttacks = knightAttackSquares[move.toSquare];
-
-        CheckType check = CheckType::NO_CHECK;
-
-        // Return the check type the move results in
-        if((pieceAttacks & (1ULL << __builtin_ctzll(board.getPieceBitBoard(isPieceWhite ? Piece::BLACK_KING : Piece::WHITE_KING))))) { // if the new piece directly checks the opponent king
-            // update the direct check square
-            board.directCheckSquare = move.toSquare;
-
-            check = CheckType::DIRECT_CHECK;
-        }
-
-        if(getPinDirection(!isPieceWhite, move.fromSquare, board, true) != PinDirection::NONE) { // if the move results in discovery check
-            check = check == CheckType::NO_CHECK ? CheckType::DISCOVERY_CHECK : CheckType::DOUBLE_CHECK;
-        }
-
-        return check;
+        return;
     }
 
     // throw error
     throw InvalidMovePatternException("Invalid move pattern for a knight. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove)); 
 }
 
-CheckType BishopMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
+void BishopMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
     // check move pattern
     if(abs(move.fromRow - move.toRow) != abs(move.fromCol - move.toCol)) {
         // throw error
@@ -239,27 +188,9 @@ CheckType BishopMoveManager::handleMove(bool isPieceWhite, const Move& move, Boa
         // throw error
         throw KingUnderCheckException("Cannot move piece. It is either pinned or the king is under check. Move number: " + std::to_string(board.getMoveNumber() + 1) + ". Move: " + std::string(move.uciMove));
     }
-
-    uint64_t pieceAttacks = getBishopAttacksForSquareAndOccupancy(move.toSquare, board.getAllPiecesBitBoard());
-
-    CheckType check = CheckType::NO_CHECK;
-
-    // Return the check type the move results in
-    if((pieceAttacks & (1ULL << __builtin_ctzll(board.getPieceBitBoard(isPieceWhite ? Piece::BLACK_KING : Piece::WHITE_KING))))) { // if the new piece directly checks the opponent king
-        // update the direct check square
-        board.directCheckSquare = move.toSquare;
-
-        check = CheckType::DIRECT_CHECK;
-    }
-
-    if(getPinDirection(!isPieceWhite, move.fromSquare, board, true) != PinDirection::NONE) { // if the move results in discovery check
-        check = check == CheckType::NO_CHECK ? CheckType::DISCOVERY_CHECK : CheckType::DOUBLE_CHECK;
-    }
-
-    return check;
 }
 
-CheckType RookMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
+void RookMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
     if(move.fromRow != move.toRow && move.fromCol != move.toCol) {
         // throw error
         throw InvalidMovePatternException("Invalid move pattern for a rook. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove)); 
@@ -294,36 +225,9 @@ CheckType RookMoveManager::handleMove(bool isPieceWhite, const Move& move, Board
         // throw error
         throw KingUnderCheckException("Cannot move piece. It is either pinned or the king is under check. Move number: " + std::to_string(board.getMoveNumber() + 1) + ". Move: " + std::string(move.uciMove));
     }
-    
-    if(isPieceWhite) {
-        if(board.canWhiteKingShortCastle && move.fromSquare == 0) board.canWhiteKingShortCastle = false;
-        else if(board.canWhiteKingLongCastle && move.fromSquare == 7) board.canWhiteKingLongCastle = false;
-    }
-    else  {
-        if(board.canBlackKingShortCastle && move.fromSquare == 0) board.canBlackKingShortCastle = false;
-        else if(board.canBlackKingLongCastle && move.fromSquare == 7) board.canBlackKingLongCastle = false;
-    }
-
-    uint64_t pieceAttacks = getRookAttacksForSquareAndOccupancy(move.toSquare, board.getAllPiecesBitBoard());
-
-    CheckType check = CheckType::NO_CHECK;
-
-    // Return the check type the move results in
-    if((pieceAttacks & (1ULL << __builtin_ctzll(board.getPieceBitBoard(isPieceWhite ? Piece::BLACK_KING : Piece::WHITE_KING))))) { // if the new piece directly checks the opponent king
-        // update the direct check square
-        board.directCheckSquare = move.toSquare;
-
-        check = CheckType::DIRECT_CHECK;
-    }
-
-    if(getPinDirection(!isPieceWhite, move.fromSquare, board, true) != PinDirection::NONE) { // if the move results in discovery check
-        check = check == CheckType::NO_CHECK ? CheckType::DISCOVERY_CHECK : CheckType::DOUBLE_CHECK;
-    }
-
-    return check;
 }
 
-CheckType QueenMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
+void QueenMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
     if(move.fromRow != move.toRow && move.fromCol != move.toCol && abs(move.fromRow - move.toRow) != abs(move.fromCol - move.toCol)) {
         // throw error
         throw InvalidMovePatternException("Invalid move pattern for a queen. Move number: " + std::to_string(board.getMoveNumber() + 1) + std::string(". Move: ") + std::string(move.uciMove)); 
@@ -358,30 +262,13 @@ CheckType QueenMoveManager::handleMove(bool isPieceWhite, const Move& move, Boar
         // throw error
         throw KingUnderCheckException("Cannot move piece. It is either pinned or the king is under check. Move number: " + std::to_string(board.getMoveNumber() + 1) + ". Move: " + std::string(move.uciMove));
     }
-
-    uint64_t pieceAttacks = getQueenAttacksForSquareAndOccupancy(move.toSquare, board.getAllPiecesBitBoard());
-
-    CheckType check = CheckType::NO_CHECK;
-
-    // Return the check type the move results in
-    if((pieceAttacks & (1ULL << __builtin_ctzll(board.getPieceBitBoard(isPieceWhite ? Piece::BLACK_KING : Piece::WHITE_KING))))) { // if the new piece directly checks the opponent king
-        // update the direct check square
-        board.directCheckSquare = move.toSquare;
-
-        check = CheckType::DIRECT_CHECK;
-    }
-
-    if(getPinDirection(!isPieceWhite, move.fromSquare, board, true) != PinDirection::NONE) { // if the move results in discovery check
-        check = check == CheckType::NO_CHECK ? CheckType::DISCOVERY_CHECK : CheckType::DOUBLE_CHECK;
-    }
-
-    return check;
 }
 
-CheckType KingMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
+void KingMoveManager::handleMove(bool isPieceWhite, const Move& move, Board& board) {
     // check move pattern
     if(abs(move.fromCol - move.toCol) == 2 && move.fromRow == move.toRow && (isPieceWhite ? move.fromSquare == 3 : move.fromSquare == 59)) {
-        return handleKingCastle(move.toCol == 1, isPieceWhite, board);
+        handleKingCastle(move.toCol == 1, isPieceWhite, board);
+        return;
     }
 
     if(abs(move.fromRow - move.toRow) > 1 || abs(move.fromCol - move.toCol) > 1) {
@@ -413,19 +300,9 @@ CheckType KingMoveManager::handleMove(bool isPieceWhite, const Move& move, Board
         // throw error
         throw KingUnderCheckException("Cannot move the " + std::string(isPieceWhite ? "white king." : "black king.") + " The new square is attacked." + std::string(" Move number: ") + std::to_string(board.getMoveNumber() + 1) + ". Move: " + std::string(move.uciMove));
     }
-
-    if(isPieceWhite && board.canWhiteKingShortCastle) board.canWhiteKingShortCastle = board.canWhiteKingLongCastle = false;
-    else if(!isPieceWhite && board.canBlackKingShortCastle) board.canBlackKingShortCastle = board.canBlackKingLongCastle = false; 
-
-    // a king move can only deliver a discovery check
-    if(getPinDirection(!isPieceWhite, move.fromSquare, board, true) != PinDirection::NONE) { // if the move results in discovery check
-        return CheckType::DISCOVERY_CHECK;
-    }
-
-    return CheckType::NO_CHECK;
 }
 
-CheckType KingMoveManager::handleKingCastle(bool shortSide, bool isPieceWhite, Board& board) {
+void KingMoveManager::handleKingCastle(bool shortSide, bool isPieceWhite, Board& board) {
     if(isPieceWhite ? (shortSide ? !board.canWhiteKingShortCastle : !board.canWhiteKingLongCastle) : (shortSide ? !board.canBlackKingShortCastle : !board.canBlackKingLongCastle) ) {
         // throw error
         throw KingCastleException(std::string(isPieceWhite ? "White King " : "Black King ") +  "lost castling rights on " + std::string(shortSide ? "king side." : "queen side.") + "Move number: " + std::to_string(board.getMoveNumber() + 1)); 
@@ -435,14 +312,10 @@ CheckType KingMoveManager::handleKingCastle(bool shortSide, bool isPieceWhite, B
     int rookSquare = isPieceWhite ? (shortSide ? 0 : 7) : (shortSide ? 56 : 63);
     int rookToSquare = shortSide ? kingToSquare + 1 : kingToSquare - 1;
 
-    // mask from king square to destination king square
-    uint64_t inBetweenMask = rangeMasks[kingSquare][kingToSquare];
-    inBetweenMask &= ~(1ULL << kingToSquare);
-
-    // if the king path squares are attacked, castling is not possible, throw error
-    if((inBetweenMask & generateLegalAttacksForColor(!isPieceWhite, false, true, false, board) != 0)) {
+    // the squares up to the rook have to be empty and the king can't castle out of, through or into a check
+    if(!isCastlingPathClear(isPieceWhite, shortSide, board)) {
         // throw error
-        throw KingCastleException("There are pieces attacking " + std::string(isPieceWhite ? "White King " : "Black King ") + "on it's path of castling." + std::string("Move number: " + std::to_string(board.getMoveNumber() + 1)));
+        throw KingCastleException("The castling path of " + std::string(isPieceWhite ? "White King " : "Black King ") + "is blocked or attacked. " + std::string("Move number: " + std::to_string(board.getMoveNumber() + 1)));
     }
 
     // update king move
@@ -457,23 +330,8 @@ CheckType KingMoveManager::handleKingCastle(bool shortSide, bool isPieceWhite, B
     // only update the rooks in grid
     board.setPieceOnBoard(isPieceWhite ? Piece::WHITE_ROOK : Piece::BLACK_ROOK, rookToSquare);
     board.setPieceOnBoard(Piece::EMPTY, rookSquare);
-
-    uint64_t pieceAttacks = getRookAttacksForSquareAndOccupancy(rookToSquare, board.getAllPiecesBitBoard());
-
-    // castling can result only in direct checks
-    //  Return the check type the move results in
-    if((pieceAttacks & (1ULL << __builtin_ctzll(board.getPieceBitBoard(isPieceWhite ? Piece::BLACK_KING : Piece::WHITE_KING))))) { // if the piece directly checks the opponent king
-        // update the direct check square
-        board.directCheckSquare = rookToSquare;
-
-        return CheckType::DIRECT_CHECK;
-    }
-
-    return CheckType::NO_CHECK;
 }
 
-std::shared_ptr<const MoveManagerStore> MoveManagerStore::m_pInstance = nullptr;
-
 MoveManagerStore::MoveManagerStore() {
     m_MoveManagers[0] = std::make_shared<PawnMoveManager>();
     m_MoveManagers[1] = std::make_shared<KnightMoveManager>();
@@ -484,9 +342,10 @@ MoveManagerStore::MoveManagerStore() {
 }
 
 std::shared_ptr<const MoveManagerStore> MoveManagerStore::getMoveManagerStore() {
-    if(m_pInstance == nullptr) return m_pInstance = std::shared_ptr<const MoveManagerStore>(new MoveManagerStore());
+    // created thread safe, like the Zobrist keys
+    static std::shared_ptr<const MoveManagerStore> pInstance(new MoveManagerStore());
 
-    return m_pInstance;
+    return pInstance;
 }
 
 
@@ -0,0 +1,104 @@
+#include "MoveQueue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace LC {
+
+void MoveCompletion::wait() const {
+    // the owner is usually a few moves away, sleeping would cost more than the move
+    for(int spin = 0; !isDone(); spin++) {
+        if(spin >= 64) std::this_thread::yield();
+#if defined(__x86_64__) || defined(__i386__)
+        else __builtin_ia32_pause();
+#endif
+    }
+}
+
+MoveQueue::MoveQueue(LegalChess& game, size_t capacity) : m_game(game) {
+    if(capacity == 0 || capacity > (1ULL << 31)) throw MoveQueueException("The capacity must be between 1 and 2^31. Capacity: " + std::to_string(capacity));
+
+    size_t slotCount = 1;
+    while(slotCount < capacity) slotCount <<= 1;
+
+    m_pSlots = std::make_unique<Slot[]>(slotCount);
+    m_mask = slotCount - 1;
+
+    for(size_t index = 0; index < slotCount; index++) m_pSlots[index].sequence.store(index, std::memory_order_relaxed);
+}
+
+SubmitStatus MoveQueue::submit(const std::string& uciMove, MoveCompletion* pCompletion) {
+    uint64_t position = m_tail.load(std::memory_order_relaxed);
+    Slot* pSlot;
+
+    // take the slot of position, another producer may take it first
+    for(;;) {
+        pSlot = &m_pSlots[position & m_mask];
+        int64_t lap = (int64_t)(pSlot->sequence.load(std::memory_order_acquire) - position);
+
+        if(lap == 0) {
+            if(m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+        }
+        else if(lap < 0) return SubmitStatus::FULL;
+        else position = m_tail.load(std::memory_order_relaxed);
+    }
+
+    pSlot->pCompletion = pCompletion;
+    pSlot->length = std::min(uciMove.length(), MAX_MOVE_LENGTH);
+    memcpy(pSlot->move, uciMove.data(), pSlot->length);
+
+    pSlot->sequence.store(position + 1, std::memory_order_release);
+
+    // after the move is visible, see drain
+    return m_scheduled.exchange(true) ? SubmitStatus::QUEUED : SubmitStatus::SCHEDULE;
+}
+
+size_t MoveQueue::drain(size_t maxMoves) {
+    size_t applied = 0;
+
+    for(;;) {
+        for(; applied < maxMoves; applied++) {
+            Slot& slot = m_pSlots[m_head & m_mask];
+
+            // a producer that took the slot may still be writing it, it schedules the queue again when it is done
+            if(slot.sequence.load(std::memory_order_acquire) != m_head + 1) break;
+
+            apply(slot);
+
+            slot.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+            m_head++;
+        }
+
+        if(applied == maxMoves) return applied;
+
+        // once the flag is cleared a producer that gets SCHEDULE may drain and move m_head, only the copy is read after it
+        uint64_t head = m_head;
+        m_scheduled.store(false);
+
+        // a move written before the flag was cleared got QUEUED, it is taken here unless a producer scheduled the queue since
+        if(m_pSlots[head & m_mask].sequence.load(std::memory_order_acquire) != head + 1 || m_scheduled.exchange(true)) return applied;
+    }
+}
+
+void MoveQueue::apply(Slot& slot) {
+    MoveOutcome outcome;
+
+    try {
+        outcome.result = m_game.makeMove(std::string(slot.move, slot.length));
+        outcome.accepted = true;
+    }
+    catch(const std::exception& e) {
+        outcome.result = m_game.getGameResult();
+        outcome.accepted = false;
+        outcome.error = e.what();
+    }
+
+    if(slot.pCompletion != nullptr) {
+        slot.pCompletion->m_outcome = std::move(outcome);
+        slot.pCompletion->m_sequence = m_head;
+        slot.pCompletion->m_done.store(true, std::memory_order_release);
+    }
+}
+
+};
@@ -0,0 +1,381 @@
+#include "OpeningExplorer.h"
+#include "PositionIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace LC {
+
+namespace {
+
+// games read from the stream before the threads replay them
+constexpr size_t BATCH_GAMES = 8192;
+
+// games a thread claims at a time
+constexpr size_t CHUNK_SIZE = 64;
+
+enum class KnownResult {
+    UNKNOWN,
+    WHITE_WIN,
+    DRAW,
+    BLACK_WIN
+};
+
+struct MoveKey {
+    uint64_t key;
+    PackedMove move;
+
+    inline bool operator==(const MoveKey& other) const {
+        return key == other.key && move == other.move;
+    }
+
+    inline bool operator<(const MoveKey& other) const {
+        return key != other.key ? key < other.key : move < other.move;
+    }
+};
+
+struct MoveKeyHash {
+    inline size_t operator()(const MoveKey& moveKey) const {
+        return moveKey.key ^ (moveKey.move * 0x9E3779B97F4A7C15ULL);
+    }
+};
+
+struct MoveCounters {
+    uint32_t games = 0;
+    uint32_t whiteWins = 0;
+    uint32_t draws = 0;
+    uint32_t blackWins = 0;
+    uint32_t positionGames = 0;     // games counted for the position under this move, each game under one of its moves
+};
+
+typedef std::pair<MoveKey, MoveCounters> CountedMove;
+
+KnownResult toKnownResult(GameResult result) {
+    switch(result) {
+        case GameResult::IN_PROGRESS: return KnownResult::UNKNOWN;
+        case GameResult::WHITE_WON_BY_CHECKMATE: return KnownResult::WHITE_WIN;
+        case GameResult::BLACK_WON_BY_CHECKMATE: return KnownResult::BLACK_WIN;
+        default: return KnownResult::DRAW;
+    }
+}
+
+// true if the token is a result tag, which ends the moves of a game
+bool parseResultTag(const std::string& token, KnownResult& result) {
+    if(token == "1-0") result = KnownResult::WHITE_WIN;
+    else if(token == "0-1") result = KnownResult::BLACK_WIN;
+    else if(token == "1/2-1/2") result = KnownResult::DRAW;
+    else if(token == "*") result = KnownResult::UNKNOWN;
+    else return false;
+
+    return true;
+}
+
+// counts the moves of one game into table
+void countGame(const std::string& line, int maxDepth, std::unordered_map<MoveKey, MoveCounters, MoveKeyHash>& table,
+               std::vector<std::string>& moves, std::vector<MoveKey>& played) {
+    moves.clear();
+    played.clear();
+
+    for(size_t end = 0, start = line.find_first_not_of(" \t\r\n"); start != std::string::npos; start = line.find_first_not_of(" \t\r\n", end)) {
+        end = line.find_first_of(" \t\r\n", start);
+        moves.emplace_back(line, start, end == std::string::npos ? std::string::npos : end - start);
+    }
+
+    KnownResult result = KnownResult::UNKNOWN;
+    bool tagged = !moves.empty() && parseResultTag(moves.back(), result);
+
+    if(tagged) moves.pop_back();
+
+    LegalChess game;
+    size_t ply = 0;
+
+    for(; ply < moves.size() && ply < (size_t)maxDepth; ply++) {
+        uint64_t key = game.getPositionKey().hash;
+
+        try {
+            game.makeMove(moves[ply]);
+        }
+        catch(const std::exception&) {
+            break;
+        }
+
+        played.push_back({key, packMove(moves[ply])});
+    }
+
+    bool complete = ply == moves.size();
+
+    // without a tag the result needs the rest of the game, an illegal move leaves it unknown
+    if(!tagged && !complete && ply == (size_t)maxDepth) {
+        try {
+            for(; ply < moves.size(); ply++) game.makeMove(moves[ply]);
+            complete = true;
+        }
+        catch(const std::exception&) {}
+    }
+
+    if(!tagged && complete) result = toKnownResult(game.getGameResult());
+
+    // a game that repeats a position counts once for it
+    std::sort(played.begin(), played.end());
+    played.erase(std::unique(played.begin(), played.end()), played.end());
+
+    for(size_t index = 0; index < played.size(); index++) {
+        MoveCounters& counters = table[played[index]];
+
+        // a game that played several moves from a repeated position reached it once
+        if(index == 0 || played[index].key != played[index - 1].key) counters.positionGames++;
+
+        counters.games++;
+        if(result == KnownResult::WHITE_WIN) counters.whiteWins++;
+        if(result == KnownResult::DRAW) counters.draws++;
+        if(result == KnownResult::BLACK_WIN) counters.blackWins++;
+    }
+}
+
+}
+
+OpeningExplorer::~OpeningExplorer() {
+    release();
+}
+
+OpeningExplorerStats OpeningExplorer::build(std::istream& games, const std::string& path, int maxDepth, uint32_t minGames, unsigned threadCount) {
+    if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::unordered_map<MoveKey, MoveCounters, MoveKeyHash>> tables(threadCount);
+    std::vector<std::string> batch;
+    std::string line;
+
+    OpeningExplorerStats stats;
+
+    // map: every thread counts the games it claims into its own table
+    for(bool more = true; more;) {
+        batch.clear();
+
+        while(batch.size() < BATCH_GAMES && (more = (bool)std::getline(games, line))) batch.push_back(line);
+
+        std::atomic<size_t> next{0};
+
+        auto worker = [&](unsigned thread) {
+            std::vector<std::string> moves;
+            std::vector<MoveKey> played;
+
+            for(size_t begin = next.fetch_add(CHUNK_SIZE); begin < batch.size(); begin = next.fetch_add(CHUNK_SIZE)) {
+                for(size_t index = begin; index < std::min(batch.size(), begin + CHUNK_SIZE); index++) {
+                    countGame(batch[index], maxDepth, tables[thread], moves, played);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        unsigned helperCount = std::min<size_t>(threadCount, (batch.size() + CHUNK_SIZE - 1)/CHUNK_SIZE);
+
+        for(unsigned thread = 1; thread < helperCount; thread++) threads.emplace_back(worker, thread);
+
+        worker(0);
+
+        for(auto& thread : threads) thread.join();
+
+        for(const std::string& game : batch) stats.games += game.find_first_not_of(" \t\r\n") != std::string::npos;
+    }
+
+    // reduce: the threads sort their own tables, a k-way merge adds up the counters of the same move
+    std::vector<std::vector<CountedMove>> sorted(threadCount);
+
+    {
+        std::vector<std::thread> threads;
+
+        auto sortTable = [&](unsigned thread) {
+            sorted[thread].assign(tables[thread].begin(), tables[thread].end());
+            std::unordered_map<MoveKey, MoveCounters, MoveKeyHash>().swap(tables[thread]);
+
+            std::sort(sorted[thread].begin(), sorted[thread].end(), [](const CountedMove& a, const CountedMove& b) {
+                return a.first < b.first;
+            });
+        };
+
+        for(unsigned thread = 1; thread < threadCount; thread++) threads.emplace_back(sortTable, thread);
+
+        sortTable(0);
+
+        for(auto& thread : threads) thread.join();
+    }
+
+    std::vector<size_t> positions(threadCount, 0);
+
+    auto greater = [&](unsigned a, unsigned b) {
+        return sorted[b][positions[b]].first < sorted[a][positions[a]].first;
+    };
+
+    std::priority_queue<unsigned, std::vector<unsigned>, decltype(greater)> heap(greater);
+
+    for(unsigned thread = 0; thread < threadCount; thread++) {
+        if(!sorted[thread].empty()) heap.push(thread);
+    }
+
+    std::vector<Position> outputPositions;
+    std::vector<ExplorerMove> outputMoves, positionMoves;
+    uint64_t currentKey = 0;
+    uint64_t positionGames = 0;
+
+    auto finishPosition = [&]() {
+        if(positionMoves.empty()) return;
+
+        if(positionGames >= minGames) {
+            std::sort(positionMoves.begin(), positionMoves.end(), [](const ExplorerMove& a, const ExplorerMove& b) {
+                return a.games != b.games ? a.games > b.games : a.move < b.move;
+            });
+
+            outputPositions.push_back({currentKey, (uint32_t)outputMoves.size(), (uint32_t)positionMoves.size()});
+            outputMoves.insert(outputMoves.end(), positionMoves.begin(), positionMoves.end());
+        }
+
+        positionMoves.clear();
+        positionGames = 0;
+    };
+
+    while(!heap.empty()) {
+        unsigned thread = heap.top();
+        heap.pop();
+
+        const CountedMove& counted = sorted[thread][positions[thread]++];
+
+        if(counted.first.key != currentKey) finishPosition();
+
+        currentKey = counted.first.key;
+
+        if(positionMoves.empty() || positionMoves.back().move != counted.first.move) {
+            ExplorerMove move = {};
+            move.move = counted.first.move;
+
+            positionMoves.push_back(move);
+        }
+
+        ExplorerMove& move = positionMoves.back();
+
+        move.games += counted.second.games;
+        move.whiteWins += counted.second.whiteWins;
+        move.draws += counted.second.draws;
+        move.blackWins += counted.second.blackWins;
+
+        positionGames += counted.second.positionGames;
+
+        if(positions[thread] < sorted[thread].size()) heap.push(thread);
+    }
+
+    finishPosition();
+
+    Header header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.positionCount = outputPositions.size();
+    header.moveCount = outputMoves.size();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(Header));
+    file.write((const char*)outputPositions.data(), outputPositions.size()*sizeof(Position));
+    file.write((const char*)outputMoves.data(), outputMoves.size()*sizeof(ExplorerMove));
+
+    if(!file) throw OpeningExplorerException("Can't write the opening explorer to " + path + ".");
+
+    stats.positions = outputPositions.size();
+    stats.moves = outputMoves.size();
+
+    return stats;
+}
+
+void OpeningExplorer::load(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) throw OpeningExplorerException("Can't open the opening explorer " + path + ".");
+
+    struct stat fileStat;
+
+    if(fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(Header)) {
+        close(fd);
+        throw OpeningExplorerException(path + " is not an opening explorer.");
+    }
+
+    void* pMapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(pMapping == MAP_FAILED) throw OpeningExplorerException("Can't map the opening explorer " + path + ".");
+
+    release();
+    m_pMapping = pMapping;
+    m_mappingSize = fileStat.st_size;
+
+    const Header* pHeader = (const Header*)m_pMapping;
+    const Position* pPositions = (const Position*)((const char*)m_pMapping + sizeof(Header));
+    const ExplorerMove* pMoves = (const ExplorerMove*)(pPositions + pHeader->positionCount);
+
+    bool valid = memcmp(pHeader->magic, MAGIC, sizeof(MAGIC)) == 0 && pHeader->positionCount <= m_mappingSize/sizeof(Position) &&
+                 pHeader->moveCount <= m_mappingSize/sizeof(ExplorerMove) &&
+                 m_mappingSize == sizeof(Header) + pHeader->positionCount*sizeof(Position) + pHeader->moveCount*sizeof(ExplorerMove);
+
+    // find returns the moves between these bounds, so a damaged file must not point outside of it
+    for(uint64_t index = 0; valid && index < pHeader->positionCount; index++) {
+        if((uint64_t)pPositions[index].firstMove + pPositions[index].moveCount > pHeader->moveCount) valid = false;
+        if(index != 0 && pPositions[index].key <= pPositions[index - 1].key) valid = false;
+    }
+
+    if(!valid) {
+        release();
+        throw OpeningExplorerException("The data is not an opening explorer of this version.");
+    }
+
+    m_pHeader = pHeader;
+    m_pPositions = pPositions;
+    m_pMoves = pMoves;
+}
+
+size_t OpeningExplorer::find(uint64_t key, std::vector<ExplorerMove>& moves) const {
+    moves.clear();
+
+    if(m_pHeader == nullptr) return 0;
+
+    const Position* pEnd = m_pPositions + m_pHeader->positionCount;
+    const Position* pPosition = std::lower_bound(m_pPositions, pEnd, key, [](const Position& position, uint64_t value) {
+        return position.key < value;
+    });
+
+    if(pPosition == pEnd || pPosition->key != key) return 0;
+
+    moves.assign(m_pMoves + pPosition->firstMove, m_pMoves + pPosition->firstMove + pPosition->moveCount);
+
+    return moves.size();
+}
+
+size_t OpeningExplorer::find(const std::string& fen, std::vector<ExplorerMove>& moves) const {
+    uint64_t key;
+
+    try {
+        key = PositionIndex::computeKey(fen);
+    }
+    catch(const PositionIndexException& e) {
+        throw OpeningExplorerException(e.what());
+    }
+
+    return find(key, moves);
+}
+
+void OpeningExplorer::release() {
+    if(m_pMapping != nullptr) munmap(m_pMapping, m_mappingSize);
+
+    m_pMapping = nullptr;
+    m_mappingSize = 0;
+
+    m_pHeader = nullptr;
+    m_pPositions = nullptr;
+    m_pMoves = nullptr;
+}
+
+};
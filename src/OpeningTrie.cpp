@@ -0,0 +1,274 @@
+#include "OpeningTrie.h"
+#include "LegalChess.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace LC {
+
+namespace {
+
+// node of the trie while it is built
+struct BuildNode {
+    PackedMove move;
+    uint32_t parent;
+    uint32_t gameCount;
+    uint16_t depth;
+    BoardSnapshot snapshot;
+    std::vector<uint32_t> children;
+};
+
+}
+
+OpeningTrie::~OpeningTrie() {
+    release();
+}
+
+void OpeningTrie::build(std::istream& games, size_t maxNodes, int maxDepth, int minGames) {
+    std::vector<BuildNode> nodes(1);
+    nodes[0].move = 0;
+    nodes[0].parent = NO_PARENT;
+    nodes[0].gameCount = 0;
+    nodes[0].depth = 0;
+    Board().saveSnapshot(nodes[0].snapshot);
+
+    std::string line;
+
+    while(std::getline(games, line)) {
+        LegalChess game;
+        std::stringstream ss(line);
+        std::string move;
+        uint32_t node = 0;
+
+        nodes[0].gameCount++;
+
+        for(int depth = 1; depth <= maxDepth && ss >> move; depth++) {
+            PackedMove packedMove = packMove(move);
+            if(packedMove == 0) break;
+
+            // every game is validated up to maxDepth, the position history decides draws by repetition
+            try {
+                game.makeMove(move);
+            }
+            catch(const std::exception&) {
+                break;
+            }
+
+            // a finished game is restored up to its last move, replaying that move detects the result
+            if(game.getGameResult() != GameResult::IN_PROGRESS) break;
+
+            uint32_t child = NO_PARENT;
+
+            for(uint32_t index : nodes[node].children) {
+                if(nodes[index].move == packedMove) child = index;
+            }
+
+            if(child == NO_PARENT) {
+                child = nodes.size();
+                nodes[node].children.push_back(child);
+
+                nodes.emplace_back();
+                nodes[child].move = packedMove;
+                nodes[child].parent = node;
+                nodes[child].gameCount = 0;
+                nodes[child].depth = depth;
+                game.m_pBoard->saveSnapshot(nodes[child].snapshot);
+            }
+
+            nodes[child].gameCount++;
+            node = child;
+        }
+    }
+
+    // a parent is played at least as often as its children and is less deep, so the
+    // nodes taken in this order always include the whole path up to the start position
+    std::vector<uint32_t> order(nodes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&nodes](uint32_t a, uint32_t b) {
+        if(nodes[a].gameCount != nodes[b].gameCount) return nodes[a].gameCount > nodes[b].gameCount;
+        if(nodes[a].depth != nodes[b].depth) return nodes[a].depth < nodes[b].depth;
+        return a < b;
+    });
+
+    std::vector<bool> kept(nodes.size(), false);
+    size_t nodeCount = 0;
+
+    for(uint32_t index : order) {
+        if(nodeCount != 0 && (nodeCount >= maxNodes || nodes[index].gameCount < (uint32_t)minGames)) break;
+
+        kept[index] = true;
+        nodeCount++;
+    }
+
+    release();
+    m_buffer.assign(sizeof(Header) + nodeCount*sizeof(Node), 0);
+
+    Header* pHeader = (Header*)m_buffer.data();
+    memcpy(pHeader->magic, MAGIC, sizeof(MAGIC));
+    pHeader->nodeSize = sizeof(Node);
+    pHeader->nodeCount = nodeCount;
+
+    Node* pNodes = (Node*)(m_buffer.data() + sizeof(Header));
+
+    // breadth first, so the children of a node are stored next to each other
+    std::vector<uint32_t> queue = {0};
+    pNodes[0].parent = NO_PARENT;
+    pNodes[0].snapshot = nodes[0].snapshot;
+
+    for(uint32_t position = 0; position < queue.size(); position++) {
+        std::vector<uint32_t> children;
+
+        for(uint32_t child : nodes[queue[position]].children) {
+            if(kept[child]) children.push_back(child);
+        }
+
+        std::sort(children.begin(), children.end(), [&nodes](uint32_t a, uint32_t b) {
+            return nodes[a].move < nodes[b].move;
+        });
+
+        pNodes[position].firstChild = queue.size();
+        pNodes[position].childCount = children.size();
+
+        for(uint32_t child : children) {
+            Node& out = pNodes[queue.size()];
+            out.parent = position;
+            out.move = nodes[child].move;
+            out.snapshot = nodes[child].snapshot;
+
+            queue.push_back(child);
+        }
+    }
+
+    attach(m_buffer.data(), m_buffer.size());
+}
+
+void OpeningTrie::save(const std::string& path) const {
+    if(m_pHeader == nullptr) throw OpeningTrieException("The opening trie is empty, build or load it before saving.");
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)m_pHeader, sizeof(Header) + getNodeCount()*sizeof(Node));
+
+    if(!file) throw OpeningTrieException("Can't write the opening trie to " + path + ".");
+}
+
+void OpeningTrie::load(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) throw OpeningTrieException("Can't open the opening trie " + path + ".");
+
+    struct stat fileStat;
+
+    if(fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(Header)) {
+        close(fd);
+        throw OpeningTrieException(path + " is not an opening trie.");
+    }
+
+    void* pMapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(pMapping == MAP_FAILED) throw OpeningTrieException("Can't map the opening trie " + path + ".");
+
+    release();
+    m_pMapping = pMapping;
+    m_mappingSize = fileStat.st_size;
+
+    attach((const char*)m_pMapping, m_mappingSize);
+}
+
+size_t OpeningTrie::restore(const std::vector<std::string>& moves, Board& board) const {
+    if(m_pNodes == nullptr) return 0;
+
+    uint32_t node = 0;
+    size_t depth = 0;
+
+    for(; depth < moves.size(); depth++) {
+        PackedMove move = packMove(moves[depth]);
+        if(move == 0) break;
+
+        const Node* pFirst = m_pNodes + m_pNodes[node].firstChild;
+        const Node* pLast = pFirst + m_pNodes[node].childCount;
+        const Node* pChild = std::lower_bound(pFirst, pLast, move, [](const Node& child, PackedMove value) {
+            return child.move < value;
+        });
+
+        if(pChild == pLast || pChild->move != move) break;
+
+        node = pChild - m_pNodes;
+    }
+
+    if(depth == 0) return 0;
+
+    board.loadSnapshot(m_pNodes[node].snapshot);
+
+    // the history holds every move of the prefix and the position after it, oldest first
+    std::vector<uint32_t> path(depth);
+
+    for(uint32_t index = node, ply = depth; index != 0 && ply != 0; index = m_pNodes[index].parent) path[--ply] = index;
+
+    for(uint32_t index : path) board.positionHistory.push(m_pNodes[index].snapshot.positionHash, m_pNodes[index].move);
+
+    return depth;
+}
+
+void OpeningTrie::release() {
+    if(m_pMapping != nullptr) munmap(m_pMapping, m_mappingSize);
+
+    m_pMapping = nullptr;
+    m_mappingSize = 0;
+    std::vector<char>().swap(m_buffer);
+
+    m_pHeader = nullptr;
+    m_pNodes = nullptr;
+}
+
+void OpeningTrie::attach(const char* pData, size_t size) {
+    const Header* pHeader = (const Header*)pData;
+    const Node* pNodes = (const Node*)(pData + sizeof(Header));
+
+    bool valid = memcmp(pHeader->magic, MAGIC, sizeof(MAGIC)) == 0 && pHeader->nodeSize == sizeof(Node) &&
+                 pHeader->nodeCount != 0 && size == sizeof(Header) + (size_t)pHeader->nodeCount*sizeof(Node);
+
+    // restore follows these links and loads the snapshots into a board, so a damaged file must not point outside of
+    // it or outside of the board's arrays
+    for(uint32_t index = 0; valid && index < pHeader->nodeCount; index++) {
+        const Node& node = pNodes[index];
+        const BoardSnapshot& snapshot = node.snapshot;
+
+        if((uint64_t)node.firstChild + node.childCount > pHeader->nodeCount) valid = false;
+        if(index != 0 && node.parent >= index) valid = false;
+
+        int kings[2] = {0, 0};
+
+        for(int square = 0; valid && square < 64; square++) {
+            if(snapshot.grid[square] > (uint8_t)Piece::EMPTY) valid = false;
+            else if(snapshot.grid[square] % 6 == 5) kings[snapshot.grid[square] / 6]++;
+        }
+
+        // the move generation takes the square of each king and the square of the pawn to capture from the en passant
+        // square, which is on the sixth rank of the side to move
+        if(kings[0] != 1 || kings[1] != 1 || snapshot.castlingRights > 15 || snapshot.isWhiteTurn > 1) valid = false;
+        if(snapshot.enpassantSquare != 64 && snapshot.enpassantSquare / 8 != (snapshot.isWhiteTurn ? 5 : 2)) valid = false;
+
+        // a child is one ply below the node that lists it, so the parent chain of a node at depth d has d links
+        for(uint32_t child = node.firstChild; valid && child < node.firstChild + node.childCount; child++) {
+            if(child == 0 || pNodes[child].parent != index || pNodes[child].snapshot.isWhiteTurn == snapshot.isWhiteTurn) valid = false;
+        }
+    }
+
+    if(!valid) {
+        release();
+        throw OpeningTrieException("The data is not an opening trie of this version.");
+    }
+
+    m_pHeader = pHeader;
+    m_pNodes = pNodes;
+}
+
+};
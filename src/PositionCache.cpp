@@ -0,0 +1,85 @@
+#include "PositionCache.h"
+#include "Metrics.h"
+
+namespace LC {
+
+namespace {
+
+constexpr uint64_t FLAG_HAS_LEGAL_MOVE = 1ULL << 40;
+constexpr uint64_t FLAG_HAS_DESTINATION_SUMMARY = 1ULL << 41;
+
+}
+
+std::shared_ptr<PositionCache> PositionCache::getInstance() {
+    // boards of different threads ask for the cache, so the instance is created thread safe
+    static std::shared_ptr<PositionCache> pInstance(new PositionCache());
+
+    return pInstance;
+}
+
+void PositionCache::resize(size_t sizeInBytes) {
+    if(sizeInBytes < ENTRY_SIZE) {
+        m_pEntries.reset();
+        m_mask = 0;
+        return;
+    }
+
+    size_t entryCount = 1;
+    while(entryCount * 2 * ENTRY_SIZE <= sizeInBytes) entryCount *= 2;
+
+    m_pEntries.reset(new Entry[entryCount]);
+    m_mask = entryCount - 1;
+}
+
+bool PositionCache::probe(uint64_t key, uint32_t verificationKey, PositionFacts& facts) const {
+    if(!isEnabled()) return false;
+
+    const Entry& entry = m_pEntries[key & m_mask];
+
+    uint64_t check = entry.check.load(std::memory_order_relaxed);
+    uint64_t checkers = entry.checkers.load(std::memory_order_relaxed);
+    uint64_t movablePieces = entry.movablePieces.load(std::memory_order_relaxed);
+    uint64_t info = entry.info.load(std::memory_order_relaxed);
+
+    bool hit = (check ^ checkers ^ movablePieces ^ info) == key && (uint32_t)info == verificationKey;
+    LC_METRICS_CACHE_PROBE(hit);
+
+    if(!hit) return false;
+
+    facts.checkers = checkers;
+    facts.movablePieces = movablePieces;
+    facts.destinationCount = (uint8_t)(info >> 32);
+    facts.hasLegalMove = (info & FLAG_HAS_LEGAL_MOVE) != 0;
+    facts.hasDestinationSummary = (info & FLAG_HAS_DESTINATION_SUMMARY) != 0;
+
+    return true;
+}
+
+void PositionCache::store(uint64_t key, uint32_t verificationKey, const PositionFacts& facts) {
+    if(!isEnabled()) return;
+
+    Entry& entry = m_pEntries[key & m_mask];
+
+    uint64_t info = verificationKey | ((uint64_t)facts.destinationCount << 32);
+    if(facts.hasLegalMove) info |= FLAG_HAS_LEGAL_MOVE;
+    if(facts.hasDestinationSummary) info |= FLAG_HAS_DESTINATION_SUMMARY;
+
+    // always replace, the newest position is the most likely one to be seen again
+    entry.checkers.store(facts.checkers, std::memory_order_relaxed);
+    entry.movablePieces.store(facts.movablePieces, std::memory_order_relaxed);
+    entry.info.store(info, std::memory_order_relaxed);
+    entry.check.store(key ^ facts.checkers ^ facts.movablePieces ^ info, std::memory_order_relaxed);
+}
+
+void PositionCache::clear() {
+    for(uint64_t index = 0; index < getEntryCount(); index++) {
+        Entry& entry = m_pEntries[index];
+
+        entry.check.store(0, std::memory_order_relaxed);
+        entry.checkers.store(0, std::memory_order_relaxed);
+        entry.movablePieces.store(0, std::memory_order_relaxed);
+        entry.info.store(0, std::memory_order_relaxed);
+    }
+}
+
+};
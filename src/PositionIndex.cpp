@@ -0,0 +1,490 @@
+#include "PositionIndex.h"
+#include "Zobrist.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace LC {
+
+namespace {
+
+// games read from the stream before the threads replay them
+constexpr size_t BATCH_GAMES = 8192;
+
+// games a thread claims at a time
+constexpr size_t CHUNK_SIZE = 64;
+
+// postings read from a run file at a time while merging
+constexpr size_t RUN_READ_SIZE = 8192;
+
+struct BuildPosting {
+    uint64_t key;
+    uint32_t gameId;
+    uint16_t ply;
+
+    inline bool operator<(const BuildPosting& other) const {
+        if(key != other.key) return key < other.key;
+        if(gameId != other.gameId) return gameId < other.gameId;
+        return ply < other.ply;
+    }
+};
+
+// a sorted sequence of postings, either the buffer of a thread or a run file read in pieces
+struct MergeSource {
+    std::vector<BuildPosting> postings;
+    size_t position = 0;
+    FILE* pFile = nullptr;
+
+    ~MergeSource() {
+        if(pFile != nullptr) fclose(pFile);
+    }
+
+    // false once the source is exhausted
+    bool fill() {
+        if(position < postings.size()) return true;
+        if(pFile == nullptr) return false;
+
+        postings.resize(RUN_READ_SIZE);
+        postings.resize(fread(postings.data(), sizeof(BuildPosting), RUN_READ_SIZE, pFile));
+        position = 0;
+
+        return !postings.empty();
+    }
+};
+
+inline void writeVarint(std::string& output, uint64_t value) {
+    while(value >= 0x80) {
+        output.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+
+    output.push_back((char)value);
+}
+
+// false if the varint runs past pEnd
+inline bool readVarint(const uint8_t*& pData, const uint8_t* pEnd, uint64_t& value) {
+    value = 0;
+
+    for(int shift = 0; pData < pEnd && shift < 64; shift += 7) {
+        uint8_t byte = *pData++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+
+        if((byte & 0x80) == 0) return true;
+    }
+
+    return false;
+}
+
+std::string getRunPath(const std::string& path, uint64_t run) {
+    return path + ".run" + std::to_string(run);
+}
+
+}
+
+PositionIndex::~PositionIndex() {
+    release();
+}
+
+PositionIndexStats PositionIndex::build(std::istream& games, const std::string& path, size_t memoryBudget, unsigned threadCount) {
+    if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    size_t bufferSize = std::max<size_t>(memoryBudget/threadCount/sizeof(BuildPosting), 1024);
+    uint64_t startKey = LegalChess().getPositionKey().hash;
+
+    std::vector<std::vector<BuildPosting>> buffers(threadCount);
+    std::atomic<uint64_t> runCount{0};
+    std::atomic<bool> writeFailed{false};
+
+    PositionIndexStats stats;
+
+    auto spill = [&](std::vector<BuildPosting>& buffer) {
+        std::sort(buffer.begin(), buffer.end());
+
+        std::string runPath = getRunPath(path, runCount++);
+        FILE* pFile = fopen(runPath.c_str(), "wb");
+
+        if(pFile == nullptr || fwrite(buffer.data(), sizeof(BuildPosting), buffer.size(), pFile) != buffer.size()) writeFailed = true;
+        if(pFile != nullptr && fclose(pFile) != 0) writeFailed = true;
+
+        buffer.clear();
+    };
+
+    std::vector<std::string> batch;
+    std::string line;
+
+    for(bool more = true; more;) {
+        batch.clear();
+
+        while(batch.size() < BATCH_GAMES && (more = (bool)std::getline(games, line))) batch.push_back(line);
+
+        if(stats.games + batch.size() > UINT32_MAX) throw PositionIndexException("Too many games for 32-bit game ids.");
+
+        uint32_t firstId = stats.games;
+        std::atomic<size_t> next{0};
+
+        auto worker = [&](unsigned thread) {
+            std::vector<BuildPosting>& buffer = buffers[thread];
+
+            for(size_t begin = next.fetch_add(CHUNK_SIZE); begin < batch.size(); begin = next.fetch_add(CHUNK_SIZE)) {
+                for(size_t index = begin; index < std::min(batch.size(), begin + CHUNK_SIZE); index++) {
+                    // an empty line keeps its game id but has no game
+                    if(batch[index].find_first_not_of(" \t\r\n") == std::string::npos) continue;
+
+                    LegalChess game;
+                    std::stringstream ss(batch[index]);
+                    std::string move;
+                    uint32_t gameId = firstId + index;
+
+                    buffer.push_back({startKey, gameId, 0});
+
+                    for(uint16_t ply = 1; ply != UINT16_MAX && ss >> move; ply++) {
+                        try {
+                            game.makeMove(move);
+                        }
+                        catch(const std::exception&) {
+                            break;
+                        }
+
+                        buffer.push_back({game.getPositionKey().hash, gameId, ply});
+                    }
+
+                    if(buffer.size() >= bufferSize) spill(buffer);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        unsigned helperCount = std::min<size_t>(threadCount, (batch.size() + CHUNK_SIZE - 1)/CHUNK_SIZE);
+
+        for(unsigned thread = 1; thread < helperCount; thread++) threads.emplace_back(worker, thread);
+
+        worker(0);
+
+        for(auto& thread : threads) thread.join();
+
+        stats.games += batch.size();
+    }
+
+    stats.runs = runCount;
+
+    // the postings still in the buffers are merged from memory
+    std::vector<std::unique_ptr<MergeSource>> sources;
+
+    for(auto& buffer : buffers) {
+        if(buffer.empty()) continue;
+
+        std::sort(buffer.begin(), buffer.end());
+
+        sources.push_back(std::make_unique<MergeSource>());
+        sources.back()->postings.swap(buffer);
+    }
+
+    for(uint64_t run = 0; run < stats.runs; run++) {
+        sources.push_back(std::make_unique<MergeSource>());
+        sources.back()->pFile = fopen(getRunPath(path, run).c_str(), "rb");
+
+        if(sources.back()->pFile == nullptr) writeFailed = true;
+    }
+
+    auto removeRuns = [&]() {
+        for(uint64_t run = 0; run < stats.runs; run++) unlink(getRunPath(path, run).c_str());
+    };
+
+    if(writeFailed) {
+        removeRuns();
+        throw PositionIndexException("Can't write the sorted runs of the position index next to " + path + ".");
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    Header header = {};
+
+    file.write((const char*)&header, sizeof(Header));
+
+    // the smallest posting of every source on top
+    auto greater = [&](size_t a, size_t b) {
+        return sources[b]->postings[sources[b]->position] < sources[a]->postings[sources[a]->position];
+    };
+
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+
+    for(size_t source = 0; source < sources.size(); source++) {
+        if(sources[source]->fill()) heap.push(source);
+    }
+
+    std::vector<DirectoryEntry> directory;
+    std::string block, group;
+    uint64_t offset = sizeof(Header), blockKey = 0, previousKey = 0, groupCount = 0;
+    uint32_t previousGame = 0;
+
+    auto finishGroup = [&]() {
+        if(groupCount == 0) return;
+
+        if(stats.positions % BLOCK_KEYS == 0) {
+            file.write(block.data(), block.size());
+            offset += block.size();
+            block.clear();
+
+            directory.push_back({previousKey, offset});
+            blockKey = previousKey;
+        }
+
+        writeVarint(block, previousKey - blockKey);
+        writeVarint(block, groupCount);
+        writeVarint(block, group.size());
+        block += group;
+
+        blockKey = previousKey;
+        stats.positions++;
+        stats.postings += groupCount;
+
+        group.clear();
+        groupCount = 0;
+    };
+
+    while(!heap.empty()) {
+        size_t source = heap.top();
+        heap.pop();
+
+        MergeSource& merged = *sources[source];
+        const BuildPosting& posting = merged.postings[merged.position++];
+
+        if(groupCount != 0 && posting.key != previousKey) finishGroup();
+
+        if(groupCount == 0) {
+            previousKey = posting.key;
+            previousGame = 0;
+        }
+
+        writeVarint(group, posting.gameId - previousGame);
+        writeVarint(group, posting.ply);
+
+        previousGame = posting.gameId;
+        groupCount++;
+
+        if(merged.fill()) heap.push(source);
+    }
+
+    finishGroup();
+
+    file.write(block.data(), block.size());
+    offset += block.size();
+
+    // the directory is read as an array of 8 byte words
+    std::string padding((8 - offset%8)%8, '\0');
+    file.write(padding.data(), padding.size());
+    offset += padding.size();
+
+    file.write((const char*)directory.data(), directory.size()*sizeof(DirectoryEntry));
+
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.positionCount = stats.positions;
+    header.postingCount = stats.postings;
+    header.blockCount = directory.size();
+    header.directoryOffset = offset;
+
+    file.seekp(0);
+    file.write((const char*)&header, sizeof(Header));
+    file.close();
+
+    sources.clear();
+    removeRuns();
+
+    if(!file) throw PositionIndexException("Can't write the position index to " + path + ".");
+
+    return stats;
+}
+
+void PositionIndex::load(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) throw PositionIndexException("Can't open the position index " + path + ".");
+
+    struct stat fileStat;
+
+    if(fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(Header)) {
+        close(fd);
+        throw PositionIndexException(path + " is not a position index.");
+    }
+
+    void* pMapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(pMapping == MAP_FAILED) throw PositionIndexException("Can't map the position index " + path + ".");
+
+    release();
+    m_pMapping = pMapping;
+    m_mappingSize = fileStat.st_size;
+
+    const Header* pHeader = (const Header*)m_pMapping;
+    const uint8_t* pData = (const uint8_t*)m_pMapping;
+    const DirectoryEntry* pDirectory = (const DirectoryEntry*)(pData + pHeader->directoryOffset);
+
+    bool valid = memcmp(pHeader->magic, MAGIC, sizeof(MAGIC)) == 0 && pHeader->directoryOffset % 8 == 0 &&
+                 pHeader->directoryOffset <= m_mappingSize && pHeader->blockCount == (m_mappingSize - pHeader->directoryOffset)/sizeof(DirectoryEntry) &&
+                 m_mappingSize == pHeader->directoryOffset + pHeader->blockCount*sizeof(DirectoryEntry);
+
+    // find decodes between consecutive offsets, so a damaged file must not point outside of the blocks
+    for(uint64_t index = 0; valid && index < pHeader->blockCount; index++) {
+        uint64_t blockOffset = pDirectory[index].offset;
+
+        if(blockOffset < sizeof(Header) || blockOffset > pHeader->directoryOffset) valid = false;
+        if(index != 0 && (blockOffset < pDirectory[index - 1].offset || pDirectory[index].firstKey <= pDirectory[index - 1].firstKey)) valid = false;
+    }
+
+    if(!valid) {
+        release();
+        throw PositionIndexException("The data is not a position index of this version.");
+    }
+
+    m_pHeader = pHeader;
+    m_pDirectory = pDirectory;
+    m_pData = pData;
+}
+
+size_t PositionIndex::find(uint64_t key, std::vector<PositionPosting>& postings) const {
+    postings.clear();
+
+    if(m_pHeader == nullptr) return 0;
+
+    // the last block starting at or before the key
+    const DirectoryEntry* pEnd = m_pDirectory + m_pHeader->blockCount;
+    const DirectoryEntry* pBlock = std::upper_bound(m_pDirectory, pEnd, key, [](uint64_t value, const DirectoryEntry& entry) {
+        return value < entry.firstKey;
+    });
+
+    if(pBlock == m_pDirectory) return 0;
+    pBlock--;
+
+    const uint8_t* pData = m_pData + pBlock->offset;
+    const uint8_t* pBlockEnd = m_pData + (pBlock + 1 == pEnd ? m_pHeader->directoryOffset : (pBlock + 1)->offset);
+    uint64_t groupKey = pBlock->firstKey;
+
+    while(pData < pBlockEnd) {
+        uint64_t keyDelta, count, size;
+
+        if(!readVarint(pData, pBlockEnd, keyDelta) || !readVarint(pData, pBlockEnd, count) || !readVarint(pData, pBlockEnd, size)) break;
+        if(size > (uint64_t)(pBlockEnd - pData)) break;
+
+        groupKey += keyDelta;
+
+        if(groupKey > key) break;
+
+        if(groupKey < key) {
+            pData += size;
+            continue;
+        }
+
+        const uint8_t* pGroupEnd = pData + size;
+        uint64_t gameId = 0, gameDelta, ply;
+
+        postings.reserve(count);
+
+        while(postings.size() < count && readVarint(pData, pGroupEnd, gameDelta) && readVarint(pData, pGroupEnd, ply)) {
+            gameId += gameDelta;
+            postings.push_back({(uint32_t)gameId, (uint16_t)ply});
+        }
+
+        break;
+    }
+
+    return postings.size();
+}
+
+uint64_t PositionIndex::computeKey(const std::string& fen) {
+    std::stringstream ss(fen);
+    std::string placement, turn, castling, enpassant;
+
+    ss >> placement >> turn >> castling >> enpassant;
+
+    if(ss.fail() || (turn != "w" && turn != "b")) throw PositionIndexException("Invalid FEN: " + fen);
+
+    Piece grid[8][8];
+    uint64_t pawns[2] = {0, 0};
+    int rank = 7, file = 0;
+
+    for(auto& row : grid) std::fill(row, row + 8, Piece::EMPTY);
+
+    // ranks from 8, files from a, the grid counts columns from the h-file
+    for(char c : placement) {
+        const char* pPiece = c != '.' ? strchr(pieceToChar, c) : nullptr;
+
+        if(c == '/') {
+            if(file != 8 || rank == 0) throw PositionIndexException("Invalid FEN: " + fen);
+
+            rank--;
+            file = 0;
+        }
+        else if(c >= '1' && c <= '8') file += c - '0';
+        else if(pPiece != nullptr && *pPiece != '\0' && file < 8) {
+            Piece piece = (Piece)(pPiece - pieceToChar);
+
+            grid[rank][7 - file] = piece;
+
+            if(piece == Piece::WHITE_PAWN) pawns[0] |= 1ULL << (rank*8 + 7 - file);
+            if(piece == Piece::BLACK_PAWN) pawns[1] |= 1ULL << (rank*8 + 7 - file);
+
+            file++;
+        }
+        else throw PositionIndexException("Invalid FEN: " + fen);
+
+        if(file > 8) throw PositionIndexException("Invalid FEN: " + fen);
+    }
+
+    if(rank != 0 || file != 8) throw PositionIndexException("Invalid FEN: " + fen);
+
+    int castlingRights = 0;
+
+    if(castling != "-") {
+        for(char c : castling) {
+            if(c == 'K') castlingRights |= 1;
+            else if(c == 'Q') castlingRights |= 2;
+            else if(c == 'k') castlingRights |= 4;
+            else if(c == 'q') castlingRights |= 8;
+            else throw PositionIndexException("Invalid FEN: " + fen);
+        }
+    }
+
+    bool whiteToMove = turn == "w";
+    int enpassantFile = 8;
+
+    if(enpassant != "-") {
+        if(enpassant.length() != 2 || enpassant[0] < 'a' || enpassant[0] > 'h' || enpassant[1] != (whiteToMove ? '6' : '3')) {
+            throw PositionIndexException("Invalid FEN: " + fen);
+        }
+
+        // same rule as Board::getEnpassantKeyFile, the file only counts if a pawn of the side to move can capture
+        int row = (enpassant[1] - '1') + (whiteToMove ? -1 : 1), col = 'h' - enpassant[0];
+        uint64_t capturers = 0;
+
+        if(col > 0) capturers |= 1ULL << (row*8 + col - 1);
+        if(col < 7) capturers |= 1ULL << (row*8 + col + 1);
+
+        if(capturers & pawns[whiteToMove ? 0 : 1]) enpassantFile = col;
+    }
+
+    return Zobrist::getInstance()->computeHash(grid, whiteToMove, castlingRights, enpassantFile);
+}
+
+void PositionIndex::release() {
+    if(m_pMapping != nullptr) munmap(m_pMapping, m_mappingSize);
+
+    m_pMapping = nullptr;
+    m_mappingSize = 0;
+
+    m_pHeader = nullptr;
+    m_pDirectory = nullptr;
+    m_pData = nullptr;
+}
+
+};
@@ -0,0 +1,186 @@
+#include "VariationTree.h"
+
+#include <algorithm>
+
+namespace LC {
+
+VariationTree::VariationTree(int snapshotInterval) : m_snapshotInterval(snapshotInterval), m_pGame(std::make_unique<LegalChess>()) {
+    if(m_snapshotInterval < 0) throw VariationTreeException("The snapshot interval can't be negative. Interval: " + std::to_string(snapshotInterval));
+
+    // the root always has a snapshot, every line can start from it
+    m_nodes.push_back({NO_NODE, NO_NODE, NO_NODE, 0, 0, 0, GameResult::IN_PROGRESS});
+    m_snapshots.emplace_back();
+    m_pGame->m_pBoard->saveSnapshot(m_snapshots.back().board);
+
+    m_path.push_back(ROOT);
+}
+
+VariationTree::NodeId VariationTree::addMove(NodeId parent, const std::string& uciMove) {
+    checkNode(parent);
+
+    PackedMove packedMove = packMove(uciMove);
+
+    for(NodeId child = m_nodes[parent].firstChild; child != NO_NODE; child = m_nodes[child].nextSibling) {
+        if(m_nodes[child].move == packedMove) {
+            goTo(child);
+            return child;
+        }
+    }
+
+    goTo(parent);
+
+    if(packedMove == 0 || m_pGame->getGameResult() != GameResult::IN_PROGRESS || !m_pGame->isLegal(uciMove)) {
+        // makeMove throws the reason the move is rejected and leaves the board as it was
+        m_pGame->makeMove(uciMove);
+
+        throw InvalidMoveException("The move is invalid. Move number: " + std::to_string(m_pGame->getMoveNumber() + 1) + ". Move: " + uciMove);
+    }
+
+    NodeId child = m_nodes.size();
+    uint16_t depth = m_nodes[parent].depth + 1;
+
+    m_nodes.push_back({parent, NO_NODE, NO_NODE, NO_SNAPSHOT, packedMove, depth, GameResult::IN_PROGRESS});
+
+    // a position has few moves, appending after the last sibling keeps the order the lines were added in
+    NodeId* pLink = &m_nodes[parent].firstChild;
+    while(*pLink != NO_NODE) pLink = &m_nodes[*pLink].nextSibling;
+    *pLink = child;
+
+    makeMove(child);
+    m_nodes[child].result = m_pGame->detectGameResult();
+
+    if(m_snapshotInterval != 0 && depth % m_snapshotInterval == 0) {
+        m_nodes[child].snapshot = m_snapshots.size();
+        m_snapshots.emplace_back();
+        m_pGame->m_pBoard->saveSnapshot(m_snapshots.back().board);
+        m_snapshots.back().history = m_pGame->m_pBoard->positionHistory;
+    }
+
+    return child;
+}
+
+VariationTree::NodeId VariationTree::addLine(NodeId parent, const std::string& uciMoves) {
+    NodeId node = parent;
+
+    for(size_t end = 0, start = uciMoves.find_first_not_of(" \t\r\n"); start != std::string::npos; start = uciMoves.find_first_not_of(" \t\r\n", end)) {
+        end = uciMoves.find_first_of(" \t\r\n", start);
+        node = addMove(node, uciMoves.substr(start, end == std::string::npos ? std::string::npos : end - start));
+    }
+
+    return node;
+}
+
+const LegalChess& VariationTree::goTo(NodeId node) {
+    checkNode(node);
+
+    if(node == m_path.back()) return *m_pGame;
+
+    int currentDepth = m_path.size() - 1;
+    int targetDepth = m_nodes[node].depth;
+
+    // the nodes of the target's line below the common ancestor with the current line, top down
+    m_targetPath.clear();
+
+    NodeId ancestor = node;
+
+    while(m_nodes[ancestor].depth > currentDepth || m_path[m_nodes[ancestor].depth] != ancestor) {
+        m_targetPath.push_back(ancestor);
+        ancestor = m_nodes[ancestor].parent;
+    }
+
+    std::reverse(m_targetPath.begin(), m_targetPath.end());
+
+    int commonDepth = m_nodes[ancestor].depth;
+
+    // every node on a multiple of the interval has a snapshot. the deepest one above the target is used, a move is
+    // made after it so the last move delta is known
+    int snapshotDepth = targetDepth == 0 || m_snapshotInterval == 0 ? 0 : (targetDepth - 1)/m_snapshotInterval*m_snapshotInterval;
+
+    int walkCost = (currentDepth - commonDepth)*UNMAKE_COST + (targetDepth - commonDepth)*MAKE_COST;
+    int snapshotCost = RESTORE_COST + (targetDepth - snapshotDepth)*MAKE_COST;
+
+    // the board restored at m_undoBase doesn't know the move that led to it, a walk has to end below it
+    bool canWalk = commonDepth > m_undoBase || (commonDepth == m_undoBase && (targetDepth > commonDepth || m_undoBase == 0));
+
+    if(!canWalk || snapshotCost < walkCost) {
+        // a snapshot above the common ancestor replays part of the current line as well
+        if(snapshotDepth < commonDepth) {
+            m_targetPath.insert(m_targetPath.begin(), m_path.begin() + snapshotDepth + 1, m_path.begin() + commonDepth + 1);
+            commonDepth = snapshotDepth;
+        }
+
+        restoreSnapshot(snapshotDepth, commonDepth);
+    }
+    else {
+        while((int)m_path.size() > commonDepth + 1) unmakeMove();
+    }
+
+    // the moves were validated when they were added, the positions on the way are in progress
+    for(int depth = m_path.size(); depth <= targetDepth; depth++) makeMove(m_targetPath[depth - commonDepth - 1]);
+
+    // sets the result and its flags on the board, a position in progress needs no detection
+    if(m_nodes[node].result != GameResult::IN_PROGRESS) m_pGame->detectGameResult();
+
+    return *m_pGame;
+}
+
+std::string VariationTree::getLine(NodeId node) const {
+    checkNode(node);
+
+    std::vector<PackedMove> moves;
+    for(NodeId index = node; index != ROOT; index = m_nodes[index].parent) moves.push_back(m_nodes[index].move);
+
+    std::string line;
+
+    for(auto it = moves.rbegin(); it != moves.rend(); ++it) {
+        if(!line.empty()) line.push_back(' ');
+        line += unpackMove(*it);
+    }
+
+    return line;
+}
+
+size_t VariationTree::getMemoryUsage() const {
+    return m_nodes.capacity()*sizeof(Node) + m_snapshots.capacity()*sizeof(Snapshot);
+}
+
+void VariationTree::checkNode(NodeId node) const {
+    if(node >= m_nodes.size()) throw VariationTreeException("Node " + std::to_string(node) + " is not in the tree. Nodes: " + std::to_string(m_nodes.size()));
+}
+
+void VariationTree::makeMove(NodeId node) {
+    PackedMove packedMove = m_nodes[node].move;
+    int fromSquare = packedMove & 63, toSquare = (packedMove >> 6) & 63, promotion = packedMove >> 12;
+
+    Move move(fromSquare/8, fromSquare%8, toSquare/8, toSquare%8, fromSquare, toSquare, std::string_view());
+
+    m_undo.emplace_back();
+    m_pGame->m_pBoard->applyTrustedMove(move, promotion ? " nbrq"[promotion] : 0, false, m_undo.back());
+    m_path.push_back(node);
+}
+
+void VariationTree::unmakeMove() {
+    m_pGame->m_pBoard->unmakeMove(m_undo.back());
+
+    m_undo.pop_back();
+    m_path.pop_back();
+}
+
+void VariationTree::restoreSnapshot(int depth, int commonDepth) {
+    NodeId node = depth == commonDepth ? m_path[depth] : m_targetPath[depth - commonDepth - 1];
+
+    const Snapshot& snapshot = m_snapshots[m_nodes[node].snapshot];
+    Board& board = *m_pGame->m_pBoard;
+
+    board.loadSnapshot(snapshot.board);
+    board.positionHistory = snapshot.history;
+
+    // the line down to the snapshot, its moves can't be taken back
+    m_path.resize(commonDepth + 1);
+    for(int index = commonDepth + 1; index <= depth; index++) m_path.push_back(m_targetPath[index - commonDepth - 1]);
+
+    m_undo.resize(depth);
+    m_undoBase = depth;
+}
+
+};
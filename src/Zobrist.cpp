@@ -1,17 +1,18 @@
 #include "Zobrist.h"
 
-namespace LC {
+#include <algorithm>
 
-std::shared_ptr<const Zobrist> Zobrist::m_pInstance = nullptr;
+namespace LC {
 
 Zobrist::Zobrist() {
     initRandomKeys();
 }
 
 std::shared_ptr<const Zobrist> Zobrist::getInstance() {
-    if(m_pInstance == nullptr) return m_pInstance = std::shared_ptr<const Zobrist>(new Zobrist());
+    // the first boards of the process may be built by several threads at once, so the instance is created thread safe
+    static std::shared_ptr<const Zobrist> pInstance(new Zobrist());
 
-    return m_pInstance;
+    return pInstance;
 }
 
 // Call this once to initialize the random hash values
@@ -34,10 +35,35 @@ void Zobrist::initRandomKeys() {
     }
 
     sideToMoveHash = dist(rng);
+
+    // appended after the keys above, which stay as they were
+    std::mt19937_64 extendedRng(0x5A0B12C3D4E5F607);
+
+    for (auto& pieceArray : extendedPieceHash) {
+        for (auto& square : pieceArray) {
+            square = dist(extendedRng);
+        }
+    }
+
+    for (auto& val : extendedCastlingHash) {
+        val = dist(extendedRng);
+    }
+
+    for (auto& val : extendedEnPassantHash) {
+        val = dist(extendedRng);
+    }
+
+    extendedSideToMoveHash = dist(extendedRng);
+
+    for (auto& countArray : materialHash) {
+        for (auto& count : countArray) {
+            count = dist(extendedRng);
+        }
+    }
 }
 
 // Compute the Zobrist hash for a given position
-uint64_t Zobrist::computeHash(Piece board[8][8], bool whiteToMove, int castlingRights, int enPassantFile) const {
+uint64_t Zobrist::computeHash(const Piece board[8][8], bool whiteToMove, int castlingRights, int enPassantFile) const {
     uint64_t hash = 0;
 
     for (int i = 0; i<8; i++) {
@@ -64,4 +90,23 @@ uint64_t Zobrist::computeHash(Piece board[8][8], bool whiteToMove, int castlingR
     return hash;
 }
 
+uint64_t Zobrist::computeMaterialKey(const uint64_t pieceBoards[NUM_PIECE_TYPES]) const {
+    uint64_t key = 0;
+
+    for (int index = 0; index < NUM_PIECE_TYPES; index++) {
+        key ^= materialHash[index][std::min(__builtin_popcountll(pieceBoards[index]), 10)];
+    }
+
+    return key;
+}
+
+uint64_t Zobrist::computePawnKey(uint64_t whitePawns, uint64_t blackPawns) const {
+    uint64_t key = 0;
+
+    for (; whitePawns; whitePawns &= whitePawns - 1) key ^= pieceHash[(int)Piece::WHITE_PAWN][__builtin_ctzll(whitePawns)];
+    for (; blackPawns; blackPawns &= blackPawns - 1) key ^= pieceHash[(int)Piece::BLACK_PAWN][__builtin_ctzll(blackPawns)];
+
+    return key;
+}
+
 };
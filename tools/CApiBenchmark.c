@@ -0,0 +1,406 @@
+#include "LegalChessC.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * cost of a move through the C API when the moves cross it one at a time or in batches:
+ *   lc_capi_bench games.txt [--games N] [--rounds N]
+ * every line of games.txt is a game of space separated legal uci moves. for every batch size from 1 to 1024 it replays
+ * the games with lc_apply_moves_batch (many moves of one game per call) and with lc_apply_move_requests (one move of
+ * many games per call), and prints the time per move and per call, the best of the rounds. the error paths are
+ * checked first, a failed check exits with 1
+ */
+
+typedef struct Game {
+    const char* text;
+    size_t* starts;     /* offset of every move in text */
+    size_t* lengths;
+    size_t moveCount;
+} Game;
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec*1e-9;
+}
+
+static int usage(const char* pProgram) {
+    fprintf(stderr, "usage: %s GAMES [--games N] [--rounds N]\n", pProgram);
+    return 1;
+}
+
+static size_t loadGames(const char* pPath, size_t maxGames, Game** ppGames) {
+    FILE* pFile = fopen(pPath, "r");
+    if(!pFile) return 0;
+
+    Game* pGames = malloc(maxGames*sizeof(Game));
+    size_t gameCount = 0, capacity = 0;
+    char* line = NULL;
+    ssize_t length;
+
+    while(gameCount < maxGames && (length = getline(&line, &capacity, pFile)) > 0) {
+        while(length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) line[--length] = 0;
+
+        Game* pGame = &pGames[gameCount];
+        pGame->text = strdup(line);
+        pGame->starts = malloc((length/2 + 1)*sizeof(size_t));
+        pGame->lengths = malloc((length/2 + 1)*sizeof(size_t));
+        pGame->moveCount = 0;
+
+        for(size_t start = 0; start < (size_t)length;) {
+            if(line[start] == ' ') {
+                start++;
+                continue;
+            }
+
+            size_t end = start;
+            while(end < (size_t)length && line[end] != ' ') end++;
+
+            pGame->starts[pGame->moveCount] = start;
+            pGame->lengths[pGame->moveCount] = end - start;
+            pGame->moveCount++;
+            start = end;
+        }
+
+        if(pGame->moveCount != 0) gameCount++;
+    }
+
+    free(line);
+    fclose(pFile);
+
+    *ppGames = pGames;
+    return gameCount;
+}
+
+static size_t checkCount = 0, failedCount = 0;
+
+static void expect(int condition, const char* what) {
+    checkCount++;
+
+    if(!condition) {
+        failedCount++;
+        fprintf(stderr, "FAILED: %s\n", what);
+    }
+}
+
+/* a new game with the moves applied, NULL if one was rejected */
+static lc_game* playMoves(const char* moves) {
+    lc_game* pGame;
+    if(lc_game_new(&pGame) != LC_OK) return NULL;
+
+    if(lc_apply_moves_batch(pGame, moves, strlen(moves), NULL, NULL) != LC_OK) {
+        lc_game_free(pGame);
+        return NULL;
+    }
+
+    return pGame;
+}
+
+/* every exception of a rejected move comes out as its status with a message, and the game keeps its position */
+static void checkRejectedMoves() {
+    static const struct {
+        const char* moves;
+        const char* move;
+        lc_status status;
+    } cases[] = {
+        {"", "e2e9", LC_ERROR_INVALID_MOVE},
+        {"", "e7e5", LC_ERROR_PLAYER_TURN},
+        {"", "e3e4", LC_ERROR_EMPTY_SQUARE},
+        {"", "g1g3", LC_ERROR_INVALID_MOVE_PATTERN},
+        {"", "a1a3", LC_ERROR_BLOCKED_MOVE},
+        {"e2e4 f7f6 d1h5", "a7a6", LC_ERROR_KING_UNDER_CHECK},
+        {"", "e1g1", LC_ERROR_KING_CASTLE},
+        {"f2f3 e7e5 g2g4 d8h4", "a2a3", LC_ERROR_GAME_OVER}
+    };
+
+    for(size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); i++) {
+        char what[128];
+        lc_game* pGame = playMoves(cases[i].moves);
+        lc_result result = (lc_result)-1;
+        uint32_t before = 0, after = 0;
+
+        snprintf(what, sizeof(what), "%s after \"%s\" is %s", cases[i].move, cases[i].moves, lc_status_string(cases[i].status));
+
+        if(!pGame) {
+            expect(0, what);
+            continue;
+        }
+
+        lc_get_move_number(pGame, &before);
+
+        lc_status status = lc_apply_move(pGame, cases[i].move, strlen(cases[i].move), &result);
+        lc_get_move_number(pGame, &after);
+
+        expect(status == cases[i].status && *lc_last_error(pGame) != 0 && after == before, what);
+        expect(result == (cases[i].status == LC_ERROR_GAME_OVER ? LC_BLACK_WON_BY_CHECKMATE : LC_IN_PROGRESS), "result of a rejected move");
+
+        lc_game_free(pGame);
+    }
+}
+
+/* a buffer too small for the output still gets the length, also a NULL buffer of size 0 */
+static void checkSmallBuffers() {
+    lc_game* pGame = playMoves("e2e4 c7c5");
+    char fen[LC_FEN_BUFFER_SIZE], json[LC_JSON_BUFFER_SIZE], small[8];
+    size_t fenLength = 0, jsonLength = 0, length = 0;
+
+    if(!pGame) {
+        expect(0, "small buffers");
+        return;
+    }
+
+    expect(lc_write_fen(pGame, fen, sizeof(fen), &fenLength) == LC_OK && fenLength == strlen(fen), "fen length");
+    expect(lc_write_json(pGame, json, sizeof(json), &jsonLength) == LC_OK && jsonLength == strlen(json), "json length");
+
+    expect(lc_write_fen(pGame, small, sizeof(small), &length) == LC_ERROR_BUFFER_TOO_SMALL && length == fenLength, "fen in a small buffer");
+    length = 0;
+    expect(lc_write_fen(pGame, NULL, 0, &length) == LC_ERROR_BUFFER_TOO_SMALL && length == fenLength, "fen length without a buffer");
+    length = 0;
+    expect(lc_write_fen(pGame, fen, fenLength, &length) == LC_ERROR_BUFFER_TOO_SMALL && length == fenLength, "fen without room for the NUL");
+    length = 0;
+    expect(lc_write_json(pGame, small, sizeof(small), &length) == LC_ERROR_BUFFER_TOO_SMALL && length == jsonLength, "json in a small buffer");
+    length = 0;
+    expect(lc_write_json(pGame, NULL, 0, &length) == LC_ERROR_BUFFER_TOO_SMALL && length == jsonLength, "json length without a buffer");
+
+    lc_game_free(pGame);
+}
+
+static void checkNullArguments() {
+    lc_game* pGame = playMoves("e2e4");
+    lc_game* pOther = NULL;
+    const lc_game* games[2];
+    char fen[2*LC_FEN_BUFFER_SIZE];
+    size_t applied = 99;
+    uint32_t moveNumber;
+    lc_result result;
+    int legal;
+
+    if(!pGame) {
+        expect(0, "null arguments");
+        return;
+    }
+
+    games[0] = pGame;
+    games[1] = NULL;
+
+    expect(lc_game_new(NULL) == LC_ERROR_INVALID_ARGUMENT, "lc_game_new without a handle");
+    expect(lc_game_fork(NULL, &pOther) == LC_ERROR_INVALID_ARGUMENT && pOther == NULL, "lc_game_fork of no game");
+    expect(lc_game_fork(pGame, NULL) == LC_ERROR_INVALID_ARGUMENT, "lc_game_fork without a handle");
+    expect(lc_apply_move(NULL, "e7e5", 4, &result) == LC_ERROR_INVALID_ARGUMENT, "lc_apply_move without a game");
+    expect(lc_apply_move(pGame, NULL, 4, &result) == LC_ERROR_INVALID_ARGUMENT, "lc_apply_move without a move");
+    expect(lc_apply_moves_batch(NULL, "e7e5", 4, &applied, &result) == LC_ERROR_INVALID_ARGUMENT && applied == 0, "lc_apply_moves_batch without a game");
+    applied = 99;
+    expect(lc_apply_moves_batch(pGame, NULL, 4, &applied, &result) == LC_ERROR_INVALID_ARGUMENT && applied == 0, "lc_apply_moves_batch without moves");
+    expect(lc_apply_move_requests(NULL, 3) == 0, "lc_apply_move_requests without requests");
+    expect(lc_is_legal(NULL, "e7e5", 4, &legal) == LC_ERROR_INVALID_ARGUMENT, "lc_is_legal without a game");
+    expect(lc_is_legal(pGame, "e7e5", 4, NULL) == LC_ERROR_INVALID_ARGUMENT, "lc_is_legal without an output");
+    expect(lc_get_result(NULL, &result) == LC_ERROR_INVALID_ARGUMENT && lc_get_result(pGame, NULL) == LC_ERROR_INVALID_ARGUMENT, "lc_get_result");
+    expect(lc_get_move_number(NULL, &moveNumber) == LC_ERROR_INVALID_ARGUMENT && lc_get_move_number(pGame, NULL) == LC_ERROR_INVALID_ARGUMENT, "lc_get_move_number");
+    expect(lc_write_fen(NULL, fen, sizeof(fen), NULL) == LC_ERROR_INVALID_ARGUMENT && lc_write_fen(pGame, NULL, 10, NULL) == LC_ERROR_INVALID_ARGUMENT, "lc_write_fen");
+    expect(lc_write_json(NULL, fen, sizeof(fen), NULL) == LC_ERROR_INVALID_ARGUMENT && lc_write_json(pGame, NULL, 10, NULL) == LC_ERROR_INVALID_ARGUMENT, "lc_write_json");
+    expect(lc_write_fen_batch(NULL, 1, fen) == LC_ERROR_INVALID_ARGUMENT && lc_write_fen_batch(games, 1, NULL) == LC_ERROR_INVALID_ARGUMENT, "lc_write_fen_batch without games or buffer");
+    expect(lc_write_fen_batch(games, 2, fen) == LC_ERROR_INVALID_ARGUMENT, "lc_write_fen_batch with a null game");
+    expect(lc_write_fen_batch(NULL, 0, NULL) == LC_OK, "lc_write_fen_batch of no games");
+    expect(*lc_last_error(NULL) == 0, "lc_last_error without a game");
+
+    /* none of them touched the game */
+    expect(lc_get_move_number(pGame, &moveNumber) == LC_OK && moveNumber == 1 && *lc_last_error(pGame) == 0, "game after null arguments");
+
+    lc_game_free(NULL);
+    lc_game_free(pGame);
+}
+
+/* the message of a rejected call is kept until a call succeeds, a rejected batch says how many moves it applied */
+static void checkLastErrorAndBatches() {
+    lc_game* pGame;
+    lc_game* pOther;
+    const char* moves = "e2e4 e7e5 e1e3 g1f3";
+    size_t applied = 99;
+    uint32_t moveNumber = 0;
+    lc_result result;
+
+    if(lc_game_new(&pGame) != LC_OK || lc_game_new(&pOther) != LC_OK) {
+        expect(0, "last error");
+        return;
+    }
+
+    expect(*lc_last_error(pGame) == 0, "no error on a new game");
+    expect(lc_apply_move(pGame, "e2e5", 4, &result) != LC_OK && *lc_last_error(pGame) != 0, "error kept after a rejected move");
+    expect(lc_is_legal(pGame, "e2e4", 4, NULL) == LC_ERROR_INVALID_ARGUMENT && *lc_last_error(pGame) != 0, "error kept after an invalid argument");
+    expect(lc_apply_move(pGame, "e2e4", 4, &result) == LC_OK && *lc_last_error(pGame) == 0, "error cleared after an accepted move");
+
+    lc_game_free(pGame);
+
+    if(lc_game_new(&pGame) != LC_OK) {
+        expect(0, "batches");
+        lc_game_free(pOther);
+        return;
+    }
+
+    expect(lc_apply_moves_batch(pGame, moves, strlen(moves), &applied, &result) == LC_ERROR_INVALID_MOVE_PATTERN && applied == 2, "batch stops at the rejected move");
+    expect(lc_get_move_number(pGame, &moveNumber) == LC_OK && moveNumber == 2 && result == LC_IN_PROGRESS, "moves before the rejected one applied");
+    expect(lc_apply_moves_batch(pGame, "g1f3 b8c6", 9, &applied, &result) == LC_OK && applied == 2 && *lc_last_error(pGame) == 0, "batch after the rejected move");
+
+    lc_move_request requests[3] = {
+        {pGame, "f1c4", 4, LC_OK, LC_IN_PROGRESS},
+        {pOther, "e7e5", 4, LC_OK, LC_IN_PROGRESS},
+        {NULL, "e2e4", 4, LC_OK, LC_IN_PROGRESS}
+    };
+
+    expect(lc_apply_move_requests(requests, 3) == 1, "requests accepted");
+    expect(requests[0].status == LC_OK && requests[1].status == LC_ERROR_PLAYER_TURN && requests[2].status == LC_ERROR_INVALID_ARGUMENT, "status of every request");
+    expect(*lc_last_error(pOther) != 0, "error of a rejected request");
+
+    for(lc_status status = LC_OK; status <= LC_ERROR_INTERNAL; status++) expect(strncmp(lc_status_string(status), "LC_", 3) == 0, "status string");
+    expect(strcmp(lc_status_string((lc_status)100), "LC_UNKNOWN_STATUS") == 0, "unknown status string");
+
+    lc_game_free(pGame);
+    lc_game_free(pOther);
+}
+
+static int newGames(lc_game** pHandles, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        if(lc_game_new(&pHandles[i]) != LC_OK) return 0;
+    }
+
+    return 1;
+}
+
+static void freeGames(lc_game** pHandles, size_t count) {
+    for(size_t i = 0; i < count; i++) lc_game_free(pHandles[i]);
+}
+
+/* every game alone, batch moves per call. the moves of a call are a slice of the game's line, nothing is copied */
+static double runMoveBatches(const Game* pGames, size_t gameCount, lc_game** pHandles, size_t batch, size_t* pCalls) {
+    size_t calls = 0;
+    double start = now();
+
+    for(size_t g = 0; g < gameCount; g++) {
+        const Game* pGame = &pGames[g];
+
+        for(size_t first = 0; first < pGame->moveCount; first += batch) {
+            size_t last = first + batch < pGame->moveCount ? first + batch - 1 : pGame->moveCount - 1;
+            size_t begin = pGame->starts[first], end = pGame->starts[last] + pGame->lengths[last];
+            size_t applied;
+
+            lc_status status = batch == 1 ? lc_apply_move(pHandles[g], pGame->text + begin, end - begin, NULL) : lc_apply_moves_batch(pHandles[g], pGame->text + begin, end - begin, &applied, NULL);
+
+            if(status != LC_OK) {
+                fprintf(stderr, "game %lu: %s\n", (unsigned long)g + 1, lc_last_error(pHandles[g]));
+                exit(1);
+            }
+
+            calls++;
+        }
+    }
+
+    *pCalls = calls;
+    return now() - start;
+}
+
+/* batch games side by side, one move of each per call */
+static double runGameBatches(const Game* pGames, size_t gameCount, lc_game** pHandles, size_t batch, lc_move_request* pRequests, size_t* pCalls) {
+    size_t calls = 0;
+    double start = now();
+
+    for(size_t first = 0; first < gameCount; first += batch) {
+        size_t last = first + batch < gameCount ? first + batch : gameCount;
+
+        for(size_t ply = 0;; ply++) {
+            size_t count = 0;
+
+            for(size_t g = first; g < last; g++) {
+                if(ply >= pGames[g].moveCount) continue;
+
+                lc_move_request* pRequest = &pRequests[count++];
+                pRequest->game = pHandles[g];
+                pRequest->move = pGames[g].text + pGames[g].starts[ply];
+                pRequest->length = pGames[g].lengths[ply];
+            }
+
+            if(count == 0) break;
+
+            if(lc_apply_move_requests(pRequests, count) != count) {
+                for(size_t i = 0; i < count; i++) {
+                    if(pRequests[i].status != LC_OK) fprintf(stderr, "%s\n", lc_last_error(pRequests[i].game));
+                }
+
+                exit(1);
+            }
+
+            calls++;
+        }
+    }
+
+    *pCalls = calls;
+    return now() - start;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) return usage(argv[0]);
+
+    size_t maxGames = 2000, rounds = 3;
+
+    for(int i = 2; i < argc; i++) {
+        if(!strcmp(argv[i], "--games") && i + 1 < argc) maxGames = strtoul(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = strtoul(argv[++i], NULL, 10);
+        else return usage(argv[0]);
+    }
+
+    if(maxGames == 0 || rounds == 0) return usage(argv[0]);
+
+    checkRejectedMoves();
+    checkSmallBuffers();
+    checkNullArguments();
+    checkLastErrorAndBatches();
+
+    printf("error paths: %lu checks, %lu failed\n", (unsigned long)checkCount, (unsigned long)failedCount);
+    if(failedCount != 0) return 1;
+
+    Game* pGames;
+    size_t gameCount = loadGames(argv[1], maxGames, &pGames);
+
+    if(gameCount == 0) {
+        fprintf(stderr, "no games in %s\n", argv[1]);
+        return 1;
+    }
+
+    size_t moveCount = 0;
+    for(size_t g = 0; g < gameCount; g++) moveCount += pGames[g].moveCount;
+
+    lc_game** pHandles = malloc(gameCount*sizeof(lc_game*));
+    lc_move_request* pRequests = malloc(gameCount*sizeof(lc_move_request));
+
+    printf("%lu games, %lu moves\n\n", (unsigned long)gameCount, (unsigned long)moveCount);
+    printf("%6s  %32s  %32s\n", "", "many moves of one game per call", "one move of many games per call");
+    printf("%6s  %10s %10s %10s  %10s %10s %10s\n", "batch", "calls", "ns/move", "ns/call", "calls", "ns/move", "ns/call");
+
+    for(size_t batch = 1; batch <= 1024; batch *= 2) {
+        double bestMoves = 1e30, bestGames = 1e30;
+        size_t moveCalls = 0, gameCalls = 0;
+
+        for(size_t round = 0; round < rounds; round++) {
+            double seconds;
+
+            if(!newGames(pHandles, gameCount)) return 1;
+            seconds = runMoveBatches(pGames, gameCount, pHandles, batch, &moveCalls);
+            if(seconds < bestMoves) bestMoves = seconds;
+            freeGames(pHandles, gameCount);
+
+            if(!newGames(pHandles, gameCount)) return 1;
+            seconds = runGameBatches(pGames, gameCount, pHandles, batch, pRequests, &gameCalls);
+            if(seconds < bestGames) bestGames = seconds;
+            freeGames(pHandles, gameCount);
+        }
+
+        printf("%6lu  %10lu %10.1f %10.1f  %10lu %10.1f %10.1f\n", (unsigned long)batch,
+               (unsigned long)moveCalls, bestMoves*1e9/moveCount, bestMoves*1e9/moveCalls,
+               (unsigned long)gameCalls, bestGames*1e9/moveCount, bestGames*1e9/gameCalls);
+    }
+
+    return 0;
+}
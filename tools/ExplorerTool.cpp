@@ -0,0 +1,92 @@
+#include "OpeningExplorer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// builds an opening explorer file from a games file and queries it:
+//   lc_explorer build --games games.txt --out explorer.bin [--depth N] [--min-games N] [--threads N]
+//   lc_explorer query --explorer explorer.bin --fen "FEN"
+namespace {
+
+int usage(const char* pProgram) {
+    std::cerr << "usage: " << pProgram << " build --games FILE --out FILE [--depth N] [--min-games N] [--threads N]" << std::endl;
+    std::cerr << "       " << pProgram << " query --explorer FILE --fen FEN" << std::endl;
+    return 1;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) return usage(argv[0]);
+
+    std::string command = argv[1], gamesPath, outputPath, explorerPath, fen;
+    int depth = 30, minGames = 2, threads = 0;
+
+    for(int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(arg == "--games" && hasValue) gamesPath = argv[++i];
+        else if(arg == "--out" && hasValue) outputPath = argv[++i];
+        else if(arg == "--explorer" && hasValue) explorerPath = argv[++i];
+        else if(arg == "--fen" && hasValue) fen = argv[++i];
+        else if(arg == "--depth" && hasValue) depth = atoi(argv[++i]);
+        else if(arg == "--min-games" && hasValue) minGames = atoi(argv[++i]);
+        else if(arg == "--threads" && hasValue) threads = atoi(argv[++i]);
+        else return usage(argv[0]);
+    }
+
+    LC::compute();
+
+    try {
+        if(command == "build" && !gamesPath.empty() && !outputPath.empty() && depth > 0 && minGames > 0 && threads >= 0) {
+            std::ifstream games(gamesPath);
+
+            if(!games) {
+                std::cerr << "Can't open " << gamesPath << std::endl;
+                return 1;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            LC::OpeningExplorerStats stats = LC::OpeningExplorer::build(games, outputPath, depth, minGames, threads);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            printf("%lu games, %lu positions, %lu moves in %.2fs\n", (unsigned long)stats.games, (unsigned long)stats.positions, (unsigned long)stats.moves, seconds);
+            return 0;
+        }
+
+        if(command == "query" && !explorerPath.empty() && !fen.empty()) {
+            LC::OpeningExplorer explorer;
+            std::vector<LC::ExplorerMove> moves;
+
+            explorer.load(explorerPath);
+            explorer.find(fen, moves);
+
+            for(const LC::ExplorerMove& move : moves) {
+                uint32_t decided = move.whiteWins + move.draws + move.blackWins;
+
+                printf("%-6s %9u games", LC::unpackMove(move.move).c_str(), move.games);
+
+                if(decided != 0) {
+                    printf("  white %5.1f%%  draw %5.1f%%  black %5.1f%%", 100.0*move.whiteWins/decided, 100.0*move.draws/decided, 100.0*move.blackWins/decided);
+                }
+
+                printf("\n");
+            }
+
+            if(moves.empty()) printf("position not in the explorer\n");
+            return 0;
+        }
+    }
+    catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return usage(argv[0]);
+}
@@ -0,0 +1,456 @@
+#include "LegalChess.h"
+#include "Protocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// reference front end for LegalChess: one epoll event loop per core, every game lives on the loop that created it,
+// so the games are used without locks. see Protocol.h for the frames and the README for usage
+namespace LC {
+
+namespace {
+
+constexpr int MAX_EVENTS = 256;
+constexpr size_t READ_CHUNK = 64 * 1024;
+
+// a game id holds the loop in its low 8 bits and the slot on that loop above them
+constexpr int LOOP_BITS = 8;
+constexpr int MAX_LOOPS = 1 << LOOP_BITS;
+
+struct Connection {
+    int fd;
+    std::string in;
+    std::string out;
+    size_t outOffset = 0;
+    bool dirty = false;                 // has replies waiting for the end of the loop iteration
+    bool waitingForWrite = false;       // the socket buffer is full, epoll reports when it drains
+    bool watchingWrite = false;         // registered for EPOLLOUT
+    bool closed = false;
+    std::vector<uint32_t> games;        // slots of the games it created
+};
+
+struct GameSlot {
+    std::unique_ptr<LegalChess> game;
+    Connection* owner = nullptr;        // the game is closed with the connection that created it
+    uint32_t ownerPosition = 0;         // index of the slot in owner->games
+};
+
+void fail(const char* what) {
+    perror(what);
+    exit(1);
+}
+
+int createTcpListener(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) fail("socket");
+
+    // every loop binds its own listener to the port and the kernel spreads the connections over them
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) fail("tcp listener");
+
+    return fd;
+}
+
+int createUnixListener(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) fail("socket");
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    if(path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Unix socket path is too long: " << path << std::endl;
+        exit(1);
+    }
+
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    unlink(path.c_str());
+
+    if(bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) fail("unix listener");
+
+    return fd;
+}
+
+class EventLoop {
+public:
+    // a shared listener (unix socket) is watched by all loops, epoll wakes only one of them per connection
+    EventLoop(int index, int listenFd, bool sharedListener) : m_index(index), m_listenFd(listenFd) {
+        m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if(m_epollFd < 0) fail("epoll_create1");
+
+        epoll_event event = {};
+        event.events = (uint32_t)EPOLLIN | (sharedListener ? (uint32_t)EPOLLEXCLUSIVE : 0);
+        event.data.ptr = nullptr;
+
+        if(epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &event) != 0) fail("epoll_ctl listener");
+    }
+
+    void run() {
+        epoll_event events[MAX_EVENTS];
+
+        while(true) {
+            int count = epoll_wait(m_epollFd, events, MAX_EVENTS, -1);
+
+            if(count < 0) {
+                if(errno == EINTR) continue;
+                fail("epoll_wait");
+            }
+
+            for(int i = 0; i < count; i++) {
+                if(events[i].data.ptr == nullptr) {
+                    acceptConnections();
+                    continue;
+                }
+
+                Connection& connection = *(Connection*)events[i].data.ptr;
+                if(connection.closed) continue;
+
+                if(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) readConnection(connection);
+
+                if(!connection.closed && (events[i].events & EPOLLOUT)) {
+                    connection.waitingForWrite = false;
+                    markDirty(connection);
+                }
+            }
+
+            // the replies of this iteration go out with one write per connection
+            for(Connection* pConnection : m_dirty) flush(*pConnection);
+            m_dirty.clear();
+
+            if(m_hasClosedConnections) {
+                m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(), [](const std::unique_ptr<Connection>& pConnection) {
+                    return pConnection->closed;
+                }), m_connections.end());
+
+                m_hasClosedConnections = false;
+            }
+        }
+    }
+
+private:
+    void acceptConnections() {
+        while(true) {
+            int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+            if(fd < 0) {
+                if(errno == EINTR) continue;
+                return;     // no more pending connections, or another loop took them
+            }
+
+            // replies are batched by the loop, don't let the kernel delay them further (fails harmlessly on unix sockets)
+            int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+            std::unique_ptr<Connection> pConnection = std::make_unique<Connection>();
+            pConnection->fd = fd;
+
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.ptr = pConnection.get();
+
+            if(epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                close(fd);
+                continue;
+            }
+
+            m_connections.push_back(std::move(pConnection));
+        }
+    }
+
+    void readConnection(Connection& connection) {
+        while(true) {
+            ssize_t size = read(connection.fd, m_readBuffer, READ_CHUNK);
+
+            if(size > 0) {
+                connection.in.append(m_readBuffer, size);
+                if((size_t)size < READ_CHUNK) break;
+                continue;
+            }
+
+            if(size < 0 && errno == EINTR) continue;
+            if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+
+            closeConnection(connection);
+            return;
+        }
+
+        size_t offset = 0;
+
+        while(connection.in.size() - offset >= sizeof(uint32_t)) {
+            uint32_t length = readUint32(connection.in.data() + offset);
+
+            if(length < FRAME_HEADER_SIZE || length > MAX_FRAME_LENGTH) {
+                closeConnection(connection);
+                return;
+            }
+
+            if(connection.in.size() - offset - sizeof(uint32_t) < length) break;
+
+            handleFrame(connection, connection.in.data() + offset + sizeof(uint32_t), length);
+            offset += sizeof(uint32_t) + length;
+        }
+
+        connection.in.erase(0, offset);
+    }
+
+    void handleFrame(Connection& connection, const char* pFrame, uint32_t length) {
+        RequestType type = (RequestType)pFrame[0];
+        uint32_t requestId = readUint32(pFrame + 1);
+        const char* pPayload = pFrame + FRAME_HEADER_SIZE;
+        uint32_t payloadSize = length - FRAME_HEADER_SIZE;
+
+        if(type == RequestType::CREATE_GAME) {
+            uint32_t slot;
+
+            if(m_freeSlots.empty()) {
+                slot = m_games.size();
+                m_games.emplace_back();
+            }
+            else {
+                slot = m_freeSlots.back();
+                m_freeSlots.pop_back();
+            }
+
+            m_games[slot].game = std::make_unique<LegalChess>();
+            m_games[slot].owner = &connection;
+            m_games[slot].ownerPosition = connection.games.size();
+            connection.games.push_back(slot);
+
+            uint32_t gameId = (slot << LOOP_BITS) | m_index;
+            reply(connection, ReplyStatus::OK, requestId, (const char*)&gameId, sizeof(gameId));
+            return;
+        }
+
+        if(type != RequestType::MAKE_MOVE && type != RequestType::GET_FEN && type != RequestType::CLOSE_GAME) {
+            reply(connection, ReplyStatus::BAD_REQUEST, requestId, nullptr, 0);
+            return;
+        }
+
+        if(payloadSize < sizeof(uint32_t)) {
+            reply(connection, ReplyStatus::BAD_REQUEST, requestId, nullptr, 0);
+            return;
+        }
+
+        uint32_t gameId = readUint32(pPayload);
+        uint32_t slot = gameId >> LOOP_BITS;
+
+        if((int)(gameId & (MAX_LOOPS - 1)) != m_index) {
+            reply(connection, ReplyStatus::WRONG_LOOP, requestId, nullptr, 0);
+            return;
+        }
+
+        if(slot >= m_games.size() || m_games[slot].game == nullptr) {
+            reply(connection, ReplyStatus::UNKNOWN_GAME, requestId, nullptr, 0);
+            return;
+        }
+
+        LegalChess& game = *m_games[slot].game;
+
+        if(type == RequestType::MAKE_MOVE) {
+            std::string move(pPayload + sizeof(uint32_t), payloadSize - sizeof(uint32_t));
+
+            try {
+                uint8_t result = (uint8_t)game.makeMove(move);
+                reply(connection, ReplyStatus::OK, requestId, (const char*)&result, sizeof(result));
+            }
+            catch(const std::exception& e) {
+                reply(connection, ReplyStatus::ILLEGAL_MOVE, requestId, e.what(), strlen(e.what()));
+            }
+        }
+        else if(type == RequestType::GET_FEN) {
+            char fen[LC::LegalChess::FEN_BUFFER_SIZE];
+            size_t length = game.writeFEN(fen, sizeof(fen));
+            reply(connection, ReplyStatus::OK, requestId, fen, length);
+        }
+        else if(m_games[slot].owner != &connection) {
+            reply(connection, ReplyStatus::NOT_OWNER, requestId, nullptr, 0);
+        }
+        else {
+            freeGame(slot);
+            reply(connection, ReplyStatus::OK, requestId, nullptr, 0);
+        }
+    }
+
+    void reply(Connection& connection, ReplyStatus status, uint32_t requestId, const char* pPayload, uint32_t payloadSize) {
+        appendFrame(connection.out, (uint8_t)status, requestId, pPayload, payloadSize);
+        markDirty(connection);
+    }
+
+    void markDirty(Connection& connection) {
+        if(connection.dirty) return;
+
+        connection.dirty = true;
+        m_dirty.push_back(&connection);
+    }
+
+    void flush(Connection& connection) {
+        connection.dirty = false;
+        if(connection.closed || connection.waitingForWrite) return;
+
+        while(connection.outOffset < connection.out.size()) {
+            ssize_t size = send(connection.fd, connection.out.data() + connection.outOffset, connection.out.size() - connection.outOffset, MSG_NOSIGNAL);
+
+            if(size > 0) {
+                connection.outOffset += size;
+                continue;
+            }
+
+            if(size < 0 && errno == EINTR) continue;
+
+            if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                connection.waitingForWrite = true;
+
+                if(!connection.watchingWrite) {
+                    connection.watchingWrite = true;
+                    watch(connection, EPOLLIN | EPOLLOUT);
+                }
+
+                return;
+            }
+
+            closeConnection(connection);
+            return;
+        }
+
+        connection.out.clear();
+        connection.outOffset = 0;
+
+        if(connection.watchingWrite) {
+            connection.watchingWrite = false;
+            watch(connection, EPOLLIN);
+        }
+    }
+
+    void watch(Connection& connection, uint32_t events) {
+        if(connection.closed) return;
+
+        epoll_event event = {};
+        event.events = events;
+        event.data.ptr = &connection;
+
+        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+
+    void closeConnection(Connection& connection) {
+        if(connection.closed) return;
+
+        connection.closed = true;
+        m_hasClosedConnections = true;
+
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+        close(connection.fd);
+
+        while(!connection.games.empty()) freeGame(connection.games.back());
+    }
+
+    void freeGame(uint32_t slot) {
+        GameSlot& gameSlot = m_games[slot];
+        std::vector<uint32_t>& ownerGames = gameSlot.owner->games;
+
+        // the owner's last game takes the place of this one in its list
+        ownerGames[gameSlot.ownerPosition] = ownerGames.back();
+        m_games[ownerGames.back()].ownerPosition = gameSlot.ownerPosition;
+        ownerGames.pop_back();
+
+        gameSlot.game.reset();
+        gameSlot.owner = nullptr;
+        m_freeSlots.push_back(slot);
+    }
+
+    int m_index;
+    int m_listenFd;
+    int m_epollFd;
+
+    std::vector<std::unique_ptr<Connection>> m_connections;
+    std::vector<Connection*> m_dirty;
+    bool m_hasClosedConnections = false;
+
+    std::vector<GameSlot> m_games;
+    std::vector<uint32_t> m_freeSlots;
+
+    char m_readBuffer[READ_CHUNK];
+};
+
+}
+
+};
+
+int main(int argc, char** argv) {
+    int port = 7070;
+    std::string unixPath;
+    int loops = std::max(1u, std::thread::hardware_concurrency());
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if(arg == "--port" && i + 1 < argc) port = atoi(argv[++i]);
+        else if(arg == "--unix" && i + 1 < argc) unixPath = argv[++i];
+        else if(arg == "--loops" && i + 1 < argc) loops = atoi(argv[++i]);
+        else {
+            std::cerr << "usage: " << argv[0] << " [--port PORT | --unix PATH] [--loops N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if(loops < 1 || loops > LC::MAX_LOOPS) {
+        std::cerr << "--loops must be between 1 and " << LC::MAX_LOOPS << std::endl;
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    LC::compute();
+
+    int sharedListener = unixPath.empty() ? -1 : LC::createUnixListener(unixPath);
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::unique_ptr<LC::EventLoop>> eventLoops;
+    std::vector<std::thread> threads;
+
+    for(int index = 0; index < loops; index++) {
+        int listenFd = sharedListener >= 0 ? sharedListener : LC::createTcpListener(port);
+        eventLoops.push_back(std::make_unique<LC::EventLoop>(index, listenFd, sharedListener >= 0));
+    }
+
+    for(int index = 0; index < loops; index++) {
+        threads.emplace_back([&eventLoops, index]() {
+            eventLoops[index]->run();
+        });
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % cores, &cpus);
+        pthread_setaffinity_np(threads.back().native_handle(), sizeof(cpus), &cpus);
+    }
+
+    std::cout << "Serving " << (unixPath.empty() ? "127.0.0.1:" + std::to_string(port) : unixPath) << " with " << loops << " event loops" << std::endl;
+
+    for(std::thread& thread : threads) thread.join();
+
+    return 0;
+}
@@ -0,0 +1,444 @@
+#include "Protocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// load generator for tools/GameServer.cpp: keeps a fixed number of games open, every game replays a line of the
+// games file with one request in flight, and reports moves per second and the move reply latency
+namespace LC {
+
+namespace {
+
+constexpr int MAX_EVENTS = 256;
+constexpr size_t READ_CHUNK = 64 * 1024;
+constexpr uint8_t IN_PROGRESS = 0;      // GameResult::IN_PROGRESS
+
+struct Options {
+    int port = 7070;
+    std::string unixPath;
+    uint32_t games = 10000;
+    int connections = 64;
+    int threads = 1;
+    double warmupSeconds = 1;
+    double seconds = 5;
+    std::string gamesFile = "UCI.txt";
+};
+
+struct ClientConnection {
+    int fd;
+    std::string in;
+    std::string out;
+    size_t outOffset = 0;
+    bool dirty = false;
+    bool watchingWrite = false;
+};
+
+enum class GameState : uint8_t {
+    CREATING,
+    MOVING,
+    CLOSING
+};
+
+struct ClientGame {
+    uint32_t connection;
+    uint32_t gameId;
+    uint32_t line;
+    uint32_t ply;
+    GameState state;
+    int64_t sentAt;
+};
+
+void fail(const char* what) {
+    perror(what);
+    exit(1);
+}
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int connectToServer(const Options& options) {
+    int fd;
+
+    if(options.unixPath.empty()) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if(fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0) fail("connect");
+
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+    else {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        snprintf(address.sun_path, sizeof(address.sun_path), "%s", options.unixPath.c_str());
+
+        if(fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0) fail("connect");
+    }
+
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    return fd;
+}
+
+// one thread of the load generator with its own connections and games
+class LoadWorker {
+public:
+    LoadWorker(const Options& options, const std::vector<std::vector<std::string>>& lines, int index, uint32_t gameCount, int connectionCount)
+        : m_options(options), m_lines(lines), m_index(index) {
+        m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if(m_epollFd < 0) fail("epoll_create1");
+
+        m_connections.resize(connectionCount);
+
+        for(int i = 0; i < connectionCount; i++) {
+            m_connections[i].fd = connectToServer(options);
+
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u32 = i;
+
+            if(epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_connections[i].fd, &event) != 0) fail("epoll_ctl");
+        }
+
+        m_games.resize(gameCount);
+
+        for(uint32_t i = 0; i < gameCount; i++) {
+            m_games[i].connection = i % connectionCount;
+            m_games[i].line = (index + i * options.threads) % lines.size();
+        }
+    }
+
+    void run(const std::atomic<bool>& measuring, const std::atomic<bool>& stopping) {
+        for(uint32_t i = 0; i < m_games.size(); i++) createGame(i);
+        flushAll();
+
+        epoll_event events[MAX_EVENTS];
+
+        while(!stopping.load(std::memory_order_relaxed)) {
+            m_measuring = measuring.load(std::memory_order_relaxed);
+
+            int count = epoll_wait(m_epollFd, events, MAX_EVENTS, 100);
+
+            if(count < 0) {
+                if(errno == EINTR) continue;
+                fail("epoll_wait");
+            }
+
+            for(int i = 0; i < count; i++) {
+                ClientConnection& connection = m_connections[events[i].data.u32];
+
+                if(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) readReplies(connection);
+                if(events[i].events & EPOLLOUT) markDirty(events[i].data.u32);
+            }
+
+            flushAll();
+        }
+
+        for(ClientConnection& connection : m_connections) close(connection.fd);
+    }
+
+    std::vector<uint32_t> latencies;   // ns from queueing a move to reading its reply
+    uint64_t moves = 0;
+    uint64_t errors = 0;
+
+private:
+    void createGame(uint32_t game) {
+        m_games[game].state = GameState::CREATING;
+        send(game, RequestType::CREATE_GAME, nullptr, 0);
+    }
+
+    void sendMove(uint32_t game) {
+        ClientGame& clientGame = m_games[game];
+        const std::string& move = m_lines[clientGame.line][clientGame.ply];
+
+        char payload[sizeof(uint32_t) + 8];
+        memcpy(payload, &clientGame.gameId, sizeof(uint32_t));
+        memcpy(payload + sizeof(uint32_t), move.data(), std::min<size_t>(move.size(), 8));
+
+        clientGame.state = GameState::MOVING;
+        clientGame.sentAt = nowNs();
+        send(game, RequestType::MAKE_MOVE, payload, sizeof(uint32_t) + std::min<size_t>(move.size(), 8));
+    }
+
+    void closeGame(uint32_t game) {
+        m_games[game].state = GameState::CLOSING;
+        send(game, RequestType::CLOSE_GAME, (const char*)&m_games[game].gameId, sizeof(uint32_t));
+    }
+
+    // the request id is the index of the game, every game has at most one request in flight
+    void send(uint32_t game, RequestType type, const char* pPayload, uint32_t payloadSize) {
+        uint32_t connection = m_games[game].connection;
+
+        appendFrame(m_connections[connection].out, (uint8_t)type, game, pPayload, payloadSize);
+        markDirty(connection);
+    }
+
+    void handleReply(ReplyStatus status, uint32_t game, const char* pPayload, uint32_t payloadSize) {
+        if(game >= m_games.size()) {
+            std::cerr << "Reply for an unknown request " << game << std::endl;
+            exit(1);
+        }
+
+        ClientGame& clientGame = m_games[game];
+
+        if(clientGame.state == GameState::CREATING) {
+            if(status != ReplyStatus::OK || payloadSize < sizeof(uint32_t)) {
+                std::cerr << "Can't create a game, status " << (int)status << std::endl;
+                exit(1);
+            }
+
+            clientGame.gameId = readUint32(pPayload);
+            clientGame.ply = 0;
+            sendMove(game);
+            return;
+        }
+
+        if(clientGame.state == GameState::CLOSING) {
+            clientGame.line = (clientGame.line + m_options.threads) % m_lines.size();
+            createGame(game);
+            return;
+        }
+
+        if(m_measuring) {
+            latencies.push_back((uint32_t)std::min<int64_t>(nowNs() - clientGame.sentAt, UINT32_MAX));
+            moves++;
+            if(status != ReplyStatus::OK) errors++;
+        }
+
+        clientGame.ply++;
+
+        bool finished = status != ReplyStatus::OK || payloadSize < 1 || (uint8_t)pPayload[0] != IN_PROGRESS ||
+                        clientGame.ply == m_lines[clientGame.line].size();
+
+        if(finished) closeGame(game);
+        else sendMove(game);
+    }
+
+    void readReplies(ClientConnection& connection) {
+        while(true) {
+            ssize_t size = read(connection.fd, m_readBuffer, READ_CHUNK);
+
+            if(size > 0) {
+                connection.in.append(m_readBuffer, size);
+                if((size_t)size < READ_CHUNK) break;
+                continue;
+            }
+
+            if(size < 0 && errno == EINTR) continue;
+            if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+
+            std::cerr << "The server closed the connection" << std::endl;
+            exit(1);
+        }
+
+        size_t offset = 0;
+
+        while(connection.in.size() - offset >= sizeof(uint32_t)) {
+            uint32_t length = readUint32(connection.in.data() + offset);
+            if(connection.in.size() - offset - sizeof(uint32_t) < length) break;
+
+            const char* pFrame = connection.in.data() + offset + sizeof(uint32_t);
+            handleReply((ReplyStatus)pFrame[0], readUint32(pFrame + 1), pFrame + FRAME_HEADER_SIZE, length - FRAME_HEADER_SIZE);
+
+            offset += sizeof(uint32_t) + length;
+        }
+
+        connection.in.erase(0, offset);
+    }
+
+    void markDirty(uint32_t connection) {
+        if(m_connections[connection].dirty) return;
+
+        m_connections[connection].dirty = true;
+        m_dirty.push_back(connection);
+    }
+
+    // requests queued while handling the replies of one epoll_wait go out with one write per connection
+    void flushAll() {
+        for(uint32_t index : m_dirty) {
+            ClientConnection& connection = m_connections[index];
+            connection.dirty = false;
+
+            while(connection.outOffset < connection.out.size()) {
+                ssize_t size = ::send(connection.fd, connection.out.data() + connection.outOffset, connection.out.size() - connection.outOffset, MSG_NOSIGNAL);
+
+                if(size > 0) {
+                    connection.outOffset += size;
+                    continue;
+                }
+
+                if(size < 0 && errno == EINTR) continue;
+                if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+
+                fail("send");
+            }
+
+            bool pending = connection.outOffset < connection.out.size();
+
+            if(!pending) {
+                connection.out.clear();
+                connection.outOffset = 0;
+            }
+
+            if(pending != connection.watchingWrite) {
+                epoll_event event = {};
+                event.events = (uint32_t)EPOLLIN | (pending ? (uint32_t)EPOLLOUT : 0);
+                event.data.u32 = index;
+
+                epoll_ctl(m_epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+                connection.watchingWrite = pending;
+            }
+        }
+
+        m_dirty.clear();
+    }
+
+    const Options& m_options;
+    const std::vector<std::vector<std::string>>& m_lines;
+    int m_index;
+    int m_epollFd;
+    bool m_measuring = false;
+
+    std::vector<ClientConnection> m_connections;
+    std::vector<uint32_t> m_dirty;
+    std::vector<ClientGame> m_games;
+
+    char m_readBuffer[READ_CHUNK];
+};
+
+}
+
+};
+
+int main(int argc, char** argv) {
+    LC::Options options;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(arg == "--port" && hasValue) options.port = atoi(argv[++i]);
+        else if(arg == "--unix" && hasValue) options.unixPath = argv[++i];
+        else if(arg == "--games" && hasValue) options.games = atoi(argv[++i]);
+        else if(arg == "--connections" && hasValue) options.connections = atoi(argv[++i]);
+        else if(arg == "--threads" && hasValue) options.threads = atoi(argv[++i]);
+        else if(arg == "--warmup" && hasValue) options.warmupSeconds = atof(argv[++i]);
+        else if(arg == "--seconds" && hasValue) options.seconds = atof(argv[++i]);
+        else if(arg == "--file" && hasValue) options.gamesFile = argv[++i];
+        else {
+            std::cerr << "usage: " << argv[0] << " [--port PORT | --unix PATH] [--games N] [--connections N] [--threads N] "
+                      << "[--warmup SECONDS] [--seconds SECONDS] [--file UCI.txt]" << std::endl;
+            return 1;
+        }
+    }
+
+    if(options.threads < 1 || options.connections < options.threads || options.games < (uint32_t)options.connections) {
+        std::cerr << "Need at least one connection per thread and one game per connection" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<std::string>> lines;
+    std::ifstream gamesFile(options.gamesFile);
+    std::string line;
+
+    while(std::getline(gamesFile, line)) {
+        std::stringstream ss(line);
+        std::vector<std::string> moves;
+        std::string move;
+
+        while(ss >> move) moves.push_back(move);
+        if(!moves.empty()) lines.push_back(moves);
+    }
+
+    if(lines.empty()) {
+        std::cerr << "No games in " << options.gamesFile << std::endl;
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::unique_ptr<LC::LoadWorker>> workers;
+
+    for(int index = 0; index < options.threads; index++) {
+        uint32_t gameCount = options.games / options.threads + (index < (int)(options.games % options.threads));
+        int connectionCount = options.connections / options.threads + (index < options.connections % options.threads);
+
+        workers.push_back(std::make_unique<LC::LoadWorker>(options, lines, index, gameCount, connectionCount));
+    }
+
+    std::atomic<bool> measuring(false), stopping(false);
+    std::vector<std::thread> threads;
+
+    for(auto& pWorker : workers) {
+        LC::LoadWorker* pRawWorker = pWorker.get();
+        threads.emplace_back([pRawWorker, &measuring, &stopping]() {
+            pRawWorker->run(measuring, stopping);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.warmupSeconds));
+    measuring = true;
+    auto start = std::chrono::steady_clock::now();
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    measuring = false;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    stopping = true;
+    for(std::thread& thread : threads) thread.join();
+
+    std::vector<uint32_t> latencies;
+    uint64_t moves = 0, errors = 0;
+
+    for(auto& pWorker : workers) {
+        latencies.insert(latencies.end(), pWorker->latencies.begin(), pWorker->latencies.end());
+        moves += pWorker->moves;
+        errors += pWorker->errors;
+    }
+
+    if(latencies.empty()) {
+        std::cerr << "No replies while measuring" << std::endl;
+        return 1;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))] / 1000.0;
+    };
+
+    std::cout << options.games << " games, " << options.connections << " connections, " << options.threads << " threads: "
+              << (uint64_t)(moves / elapsed) << " moves/s, latency p50 " << percentile(0.5) << "us p99 " << percentile(0.99)
+              << "us max " << latencies.back() / 1000.0 << "us, " << errors << " rejected moves" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,366 @@
+#include "MoveQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// checks the per game move queues under contention and compares their latency with a mutex per game:
+//   lc_queue_bench stress [--producers N] [--games N] [--moves N] [--capacity N]
+//   lc_queue_bench bench [--producers N,N,...] [--games N] [--rounds N] [--capacity N]
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+int usage(const char* pProgram) {
+    std::cerr << "usage: " << pProgram << " stress [--producers N] [--games N] [--moves N] [--capacity N]" << std::endl;
+    std::cerr << "       " << pProgram << " bench [--producers N,N,...] [--games N] [--rounds N] [--capacity N]" << std::endl;
+    return 1;
+}
+
+// a random game that stays in progress, so every move of it can be played in order
+std::vector<std::string> makeScript(std::mt19937& rng, int plies) {
+    LC::LegalChess game;
+    LC::PackedMove moves[LC::LegalChess::MAX_LEGAL_MOVES];
+    std::vector<std::string> script;
+
+    while((int)script.size() < plies) {
+        size_t count = game.getLegalMoves(moves);
+        if(count == 0) break;
+
+        std::string move = LC::unpackMove(moves[rng() % count]);
+
+        std::unique_ptr<LC::LegalChess> pNext = game.fork();
+        if(pNext->makeMove(move) != LC::GameResult::IN_PROGRESS) break;
+
+        game.makeMove(move);
+        script.push_back(move);
+    }
+
+    return script;
+}
+
+// the games of a run, each with its queue and its mutex
+struct Games {
+    std::vector<std::unique_ptr<LC::LegalChess>> games;
+    std::vector<std::unique_ptr<LC::MoveQueue>> queues;
+    std::vector<std::unique_ptr<std::mutex>> mutexes;
+    std::vector<std::vector<std::string>> scripts;
+    std::unique_ptr<std::atomic<uint32_t>[]> tickets;      // next script move handed out per game
+    std::unique_ptr<std::atomic<bool>[]> scheduled;        // set by the producer that got SCHEDULE
+
+    Games(int count, int capacity, std::mt19937& rng, int plies) : tickets(new std::atomic<uint32_t>[count]), scheduled(new std::atomic<bool>[count]) {
+        for(int index = 0; index < count; index++) {
+            games.push_back(std::make_unique<LC::LegalChess>());
+            queues.push_back(std::make_unique<LC::MoveQueue>(*games.back(), capacity));
+            mutexes.push_back(std::make_unique<std::mutex>());
+            scripts.push_back(makeScript(rng, plies));
+            tickets[index] = 0;
+            scheduled[index] = false;
+        }
+    }
+
+    // drainInline = false hands a scheduled queue to runOwner, true drains it on the submitting thread
+    void submit(int game, const std::string& move, LC::MoveCompletion* pCompletion, bool drainInline = false) {
+        LC::SubmitStatus status;
+
+        // the owner is capacity moves behind, wait for it like a network thread would stop reading
+        while((status = queues[game]->submit(move, pCompletion)) == LC::SubmitStatus::FULL) std::this_thread::yield();
+
+        if(status != LC::SubmitStatus::SCHEDULE) return;
+
+        if(drainInline) queues[game]->drain();
+        else scheduled[game].store(true, std::memory_order_release);
+    }
+};
+
+// the single owner of all games, drains the queues handed to it until stop is set and nothing is scheduled
+void runOwner(Games& games, const std::atomic<bool>& stop) {
+    for(;;) {
+        bool idle = true;
+
+        for(size_t game = 0; game < games.queues.size(); game++) {
+            if(!games.scheduled[game].exchange(false, std::memory_order_acquire)) continue;
+
+            idle = false;
+
+            // a long queue gives the other games a turn
+            if(games.queues[game]->drain(32) == 32) games.scheduled[game].store(true, std::memory_order_relaxed);
+        }
+
+        if(idle) {
+            if(stop.load()) return;
+            std::this_thread::yield();
+        }
+    }
+}
+
+int runStress(int producerCount, int gameCount, int movesPerProducer, int capacity) {
+    std::mt19937 rng(1);
+    Games games(gameCount, capacity, rng, 300);
+
+    struct Submission {
+        int game;
+        std::string move;
+        std::unique_ptr<LC::MoveCompletion> pCompletion;
+    };
+
+    std::vector<std::vector<Submission>> submissions(producerCount);
+    std::atomic<bool> stop{false};
+
+    std::thread owner(runOwner, std::ref(games), std::cref(stop));
+    std::vector<std::thread> producers;
+
+    for(int producer = 0; producer < producerCount; producer++) {
+        producers.emplace_back([&, producer]() {
+            std::mt19937 random(100 + producer);
+            std::vector<Submission>& mine = submissions[producer];
+            mine.reserve(movesPerProducer);
+
+            for(int index = 0; index < movesPerProducer; index++) {
+                int game = random() % gameCount;
+                const std::vector<std::string>& script = games.scripts[game];
+
+                // the producers race for the order, the moves that lose are rejected and checked as well
+                uint32_t ticket = games.tickets[game].fetch_add(1);
+
+                mine.push_back({game, script[ticket % script.size()], std::make_unique<LC::MoveCompletion>()});
+                games.submit(game, mine.back().move, mine.back().pCompletion.get());
+
+                // most moves are not waited for, the queues fill up
+                if(index % 8 == 0) mine.back().pCompletion->wait();
+            }
+        });
+    }
+
+    for(std::thread& producer : producers) producer.join();
+
+    stop = true;
+    owner.join();
+
+    // every move completed once, the moves of a producer were applied in its order, and replaying the moves in the
+    // order of the queue gives the same outcomes and the same final position
+    size_t errors = 0, accepted = 0;
+    std::vector<std::vector<std::pair<uint64_t, const Submission*>>> applied(gameCount);
+
+    for(int producer = 0; producer < producerCount; producer++) {
+        std::vector<int64_t> lastSequence(gameCount, -1);
+
+        for(const Submission& submission : submissions[producer]) {
+            if(!submission.pCompletion->isDone()) {
+                errors++;
+                continue;
+            }
+
+            int64_t sequence = submission.pCompletion->getSequence();
+            if(sequence <= lastSequence[submission.game]) errors++;
+
+            lastSequence[submission.game] = sequence;
+            applied[submission.game].push_back({sequence, &submission});
+        }
+    }
+
+    for(int game = 0; game < gameCount; game++) {
+        std::sort(applied[game].begin(), applied[game].end());
+
+        if(applied[game].size() != games.tickets[game].load()) errors++;
+
+        LC::LegalChess replay;
+
+        for(size_t index = 0; index < applied[game].size(); index++) {
+            const LC::MoveOutcome& outcome = applied[game][index].second->pCompletion->getOutcome();
+
+            if(applied[game][index].first != index) errors++;
+
+            bool replayed = true;
+
+            try {
+                replay.makeMove(applied[game][index].second->move);
+            }
+            catch(const std::exception&) {
+                replayed = false;
+            }
+
+            if(replayed != outcome.accepted || replay.getGameResult() != outcome.result) errors++;
+            accepted += outcome.accepted;
+        }
+
+        char fen[LC::LegalChess::FEN_BUFFER_SIZE], replayFen[LC::LegalChess::FEN_BUFFER_SIZE];
+        games.games[game]->writeFEN(fen, sizeof(fen));
+        replay.writeFEN(replayFen, sizeof(replayFen));
+
+        if(std::string(fen) != replayFen) errors++;
+    }
+
+    printf("%d producers, %d games, capacity %d: %lu moves, %lu accepted, %lu errors\n", producerCount, gameCount, capacity,
+           (unsigned long)producerCount*movesPerProducer, (unsigned long)accepted, (unsigned long)errors);
+
+    return errors == 0 ? 0 : 1;
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t)(fraction*sorted.size()))];
+}
+
+enum class Mode {
+    MUTEX,      // the producer takes the game's mutex and makes the move
+    OWNER,      // the producer queues the move, one owner thread drains all queues
+    INLINE      // the producer queues the move, the one that scheduled the queue drains it
+};
+
+// every producer plays the next move of a random game and waits until it is applied, like a network thread that
+// answers the move
+void runBench(int producerCount, int gameCount, int rounds, int capacity, Mode mode) {
+    bool useQueues = mode != Mode::MUTEX;
+
+    std::vector<std::vector<double>> latencies(producerCount);
+    size_t moves = 0, accepted = 0;
+    double seconds = 0;
+
+    for(int round = 0; round < rounds; round++) {
+        std::mt19937 rng(round);
+        Games games(gameCount, capacity, rng, 200);
+
+        std::atomic<bool> stop{false};
+        std::atomic<int> finishedGames{0};
+        std::atomic<size_t> acceptedMoves{0};
+        std::unique_ptr<std::atomic<bool>[]> finished(new std::atomic<bool>[gameCount]);
+        for(int game = 0; game < gameCount; game++) finished[game] = false;
+
+        std::thread owner;
+        if(mode == Mode::OWNER) owner = std::thread(runOwner, std::ref(games), std::cref(stop));
+
+        auto start = Clock::now();
+        std::vector<std::thread> producers;
+
+        for(int producer = 0; producer < producerCount; producer++) {
+            producers.emplace_back([&, producer]() {
+                std::mt19937 random(round*1000 + producer);
+                LC::MoveCompletion completion;
+                size_t mine = 0;
+
+                while(finishedGames.load(std::memory_order_relaxed) < gameCount) {
+                    int game = random() % gameCount;
+                    const std::vector<std::string>& script = games.scripts[game];
+
+                    auto begin = Clock::now();
+                    bool applied;
+
+                    if(useQueues) {
+                        uint32_t ticket = games.tickets[game].fetch_add(1);
+                        applied = ticket < script.size();
+
+                        if(applied) {
+                            completion.reset();
+                            games.submit(game, script[ticket], &completion, mode == Mode::INLINE);
+                            completion.wait();
+
+                            mine += completion.getOutcome().accepted;
+                        }
+                    }
+                    else {
+                        std::lock_guard<std::mutex> lock(*games.mutexes[game]);
+
+                        size_t ply = games.games[game]->getMoveNumber();
+                        applied = ply < script.size();
+
+                        if(applied) {
+                            games.games[game]->makeMove(script[ply]);
+                            mine++;
+                        }
+                    }
+
+                    if(!applied) {
+                        if(!finished[game].exchange(true)) finishedGames++;
+                        continue;
+                    }
+
+                    latencies[producer].push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+                }
+
+                acceptedMoves += mine;
+            });
+        }
+
+        for(std::thread& producer : producers) producer.join();
+
+        seconds += std::chrono::duration<double>(Clock::now() - start).count();
+
+        stop = true;
+        if(mode == Mode::OWNER) owner.join();
+
+        accepted += acceptedMoves;
+    }
+
+    std::vector<double> all;
+    for(const std::vector<double>& mine : latencies) all.insert(all.end(), mine.begin(), mine.end());
+    std::sort(all.begin(), all.end());
+    moves = all.size();
+
+    printf("%3d producers  %-6s %8.0f moves/s  p50 %7.1fus  p99 %8.1fus  p99.9 %8.1fus  accepted %5.1f%%\n", producerCount, mode == Mode::MUTEX ? "mutex" : mode == Mode::OWNER ? "owner" : "inline",
+           moves/seconds, percentile(all, 0.5), percentile(all, 0.99), percentile(all, 0.999), 100.0*accepted/std::max<size_t>(moves, 1));
+}
+
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) return usage(argv[0]);
+
+    std::string command = argv[1];
+    std::vector<int> producerCounts;
+    int games = 0, moves = 100000, rounds = 20, capacity = 0;
+
+    for(int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(arg == "--producers" && hasValue) {
+            for(char* pValue = argv[++i]; *pValue; ) {
+                producerCounts.push_back(strtol(pValue, &pValue, 10));
+                if(*pValue == ',') pValue++;
+                else if(*pValue) return usage(argv[0]);
+            }
+        }
+        else if(arg == "--games" && hasValue) games = atoi(argv[++i]);
+        else if(arg == "--moves" && hasValue) moves = atoi(argv[++i]);
+        else if(arg == "--rounds" && hasValue) rounds = atoi(argv[++i]);
+        else if(arg == "--capacity" && hasValue) capacity = atoi(argv[++i]);
+        else return usage(argv[0]);
+    }
+
+    LC::compute();
+
+    if(command == "stress" && moves > 0 && games >= 0 && capacity >= 0) {
+        if(producerCounts.empty()) producerCounts = {16};
+
+        int result = 0;
+
+        for(int producerCount : producerCounts) {
+            if(producerCount < 1) return usage(argv[0]);
+            result |= runStress(producerCount, games ? games : 4, moves, capacity ? capacity : 8);
+        }
+
+        return result;
+    }
+
+    if(command == "bench" && rounds > 0 && games >= 0 && capacity >= 0) {
+        if(producerCounts.empty()) producerCounts = {4, 8, 16, 32};
+
+        for(int producerCount : producerCounts) {
+            if(producerCount < 1) return usage(argv[0]);
+
+            for(Mode mode : {Mode::MUTEX, Mode::OWNER, Mode::INLINE}) runBench(producerCount, games ? games : 8, rounds, capacity ? capacity : 64, mode);
+        }
+
+        return 0;
+    }
+
+    return usage(argv[0]);
+}
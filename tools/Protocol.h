@@ -0,0 +1,56 @@
+#ifndef __PROTOCOL_H__
+#define __PROTOCOL_H__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace LC {
+
+// frames of the game server, integers are in host byte order (little endian on the x86 and arm hosts we run on)
+//   request: uint32 length | uint8 type   | uint32 requestId | payload
+//   reply:   uint32 length | uint8 status | uint32 requestId | payload
+// length counts the bytes after the length field, a reply carries the requestId of its request
+enum class RequestType : uint8_t {
+    CREATE_GAME = 1,    // no payload, replies uint32 gameId
+    MAKE_MOVE = 2,      // uint32 gameId and the uci move, replies uint8 GameResult
+    GET_FEN = 3,        // uint32 gameId, replies the fen string
+    CLOSE_GAME = 4      // uint32 gameId, empty reply
+};
+
+enum class ReplyStatus : uint8_t {
+    OK = 0,
+    ILLEGAL_MOVE = 1,   // payload is the exception message
+    UNKNOWN_GAME = 2,
+    WRONG_LOOP = 3,     // the game belongs to an event loop that doesn't serve this connection
+    BAD_REQUEST = 4,
+    NOT_OWNER = 5       // CLOSE_GAME of a game another connection created
+};
+
+constexpr uint32_t FRAME_HEADER_SIZE = 5;           // type or status and requestId
+constexpr uint32_t MAX_FRAME_LENGTH = 1 << 16;
+
+inline uint32_t readUint32(const char* pData) {
+    uint32_t value;
+    memcpy(&value, pData, sizeof(value));
+
+    return value;
+}
+
+inline void appendUint32(std::string& buffer, uint32_t value) {
+    char bytes[sizeof(value)];
+    memcpy(bytes, &value, sizeof(value));
+
+    buffer.append(bytes, sizeof(value));
+}
+
+inline void appendFrame(std::string& buffer, uint8_t code, uint32_t requestId, const char* pPayload, uint32_t payloadSize) {
+    appendUint32(buffer, FRAME_HEADER_SIZE + payloadSize);
+    buffer.push_back((char)code);
+    appendUint32(buffer, requestId);
+    buffer.append(pPayload, payloadSize);
+}
+
+};
+
+#endif
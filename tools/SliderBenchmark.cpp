@@ -0,0 +1,200 @@
+#include "Helper.h"
+#include "LegalChess.h"
+#include "SlidingAttacks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// compares the slider backend of this build (occupancy tables, or fills with LC_TABLE_FREE_SLIDERS) with the fills of
+// SlidingAttacks.h while other work evicts the caches between queries:
+//   lc_slider_bench [--pressure KB,KB,...] [--games N] [--moves N]
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+int usage(const char* pProgram) {
+    std::cerr << "usage: " << pProgram << " [--pressure KB,KB,...] [--games N] [--moves N]" << std::endl;
+    return 1;
+}
+
+// walks the rays square by square, shares nothing with either backend
+uint64_t walkRays(int square, uint64_t occupancy, const int (*pDirections)[2]) {
+    uint64_t attacks = 0;
+
+    for(int direction = 0; direction < 4; direction++) {
+        int row = square/8 + pDirections[direction][0], col = square%8 + pDirections[direction][1];
+
+        for(; row >= 0 && row < 8 && col >= 0 && col < 8; row += pDirections[direction][0], col += pDirections[direction][1]) {
+            attacks |= 1ULL << (row*8 + col);
+            if(occupancy & (1ULL << (row*8 + col))) break;
+        }
+    }
+
+    return attacks;
+}
+
+const int ROOK_DIRECTIONS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+const int BISHOP_DIRECTIONS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+// other work of the server between two queries, writes kilobytes of a buffer larger than the caches
+class CachePressure {
+public:
+    explicit CachePressure(size_t kilobytes) : m_bytes(kilobytes*1024), m_buffer(64 << 20) {}
+
+    inline void touch() {
+        for(size_t offset = 0; offset < m_bytes; offset += 64) m_buffer[(m_position + offset) % m_buffer.size()]++;
+
+        m_position = (m_position + m_bytes) % m_buffer.size();
+    }
+
+private:
+    size_t m_bytes;
+    size_t m_position = 0;
+    std::vector<char> m_buffer;
+};
+
+// ns per rook and bishop query of f, the pressure is applied before every batch of 16 dependent queries
+template<class F>
+double timeQueries(const std::vector<uint64_t>& occupancies, CachePressure& pressure, F f) {
+    double best = 1e18;
+
+    for(int repetition = 0; repetition < 5; repetition++) {
+        double total = 0;
+        uint64_t chain = 0;
+
+        for(size_t index = 0; index < occupancies.size(); index += 16) {
+            pressure.touch();
+
+            auto start = Clock::now();
+
+            // every query depends on the last one, like the rays of a move generator walking a position
+            for(size_t query = index; query < index + 16; query++) {
+                uint64_t occupancy = occupancies[query] ^ (chain & 1);
+                chain += f(occupancies[query] >> 58, occupancy);
+            }
+
+            total += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        }
+
+        if(chain == 1) printf(" ");
+        best = std::min(best, total/occupancies.size());
+    }
+
+    return best;
+}
+
+// ns per move of random games played side by side, each move lists the legal moves and makes one of them
+double timeGames(int gameCount, int moveCount, CachePressure& pressure) {
+    std::mt19937 rng(11);
+    std::vector<std::unique_ptr<LC::LegalChess>> games;
+    for(int game = 0; game < gameCount; game++) games.push_back(std::make_unique<LC::LegalChess>());
+
+    LC::PackedMove moves[LC::LegalChess::MAX_LEGAL_MOVES];
+    double total = 0;
+
+    for(int move = 0; move < moveCount; move++) {
+        std::unique_ptr<LC::LegalChess>& pGame = games[move % gameCount];
+
+        pressure.touch();
+
+        auto start = Clock::now();
+
+        size_t count = pGame->getLegalMoves(moves);
+
+        if(count == 0 || pGame->getGameResult() != LC::GameResult::IN_PROGRESS) pGame = std::make_unique<LC::LegalChess>();
+        else pGame->makeMove(LC::unpackMove(moves[rng() % count]));
+
+        total += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    return total/moveCount;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> pressures;
+    int games = 1000, moves = 200000;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(arg == "--pressure" && hasValue) {
+            for(char* pValue = argv[++i]; *pValue; ) {
+                pressures.push_back(strtol(pValue, &pValue, 10));
+                if(*pValue == ',') pValue++;
+                else if(*pValue) return usage(argv[0]);
+            }
+        }
+        else if(arg == "--games" && hasValue) games = atoi(argv[++i]);
+        else if(arg == "--moves" && hasValue) moves = atoi(argv[++i]);
+        else return usage(argv[0]);
+    }
+
+    if(pressures.empty()) pressures = {0, 256, 1024, 4096};
+    if(games < 1 || moves < 1) return usage(argv[0]);
+
+#if defined(__AVX2__)
+    const char* pFills = "kogge-stone, four directions per avx2 register";
+#else
+    const char* pFills = "hyperbola quintessence";
+#endif
+
+    auto start = Clock::now();
+    LC::compute();
+    double computeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+#ifdef LC_TABLE_FREE_SLIDERS
+    printf("backend: fills, compute() %.1fms\n", computeMs);
+#else
+    size_t tableBytes = 0;
+    for(int square = 0; square < 64; square++) tableBytes += (LC::rookAttacksForOccupancy[square].size() + LC::bishopAttacksForOccupancy[square].size())*sizeof(uint64_t);
+
+    printf("backend: occupancy tables (%.1f MB), compute() %.1fms\n", tableBytes/1048576.0, computeMs);
+#endif
+
+    printf("fills: %s\n", pFills);
+
+    // the slider square rides in the top bits of the occupancy
+    std::mt19937_64 rng(5);
+    std::vector<uint64_t> occupancies(1 << 16);
+    for(uint64_t& occupancy : occupancies) occupancy = rng() & rng();
+
+    size_t errors = 0;
+
+    for(uint64_t occupancy : occupancies) {
+        int square = occupancy >> 58;
+
+        if(LC::getRookAttacksForSquareAndOccupancy(square, occupancy) != walkRays(square, occupancy, ROOK_DIRECTIONS)) errors++;
+        if(LC::getBishopAttacksForSquareAndOccupancy(square, occupancy) != walkRays(square, occupancy, BISHOP_DIRECTIONS)) errors++;
+        if(LC::rookAttacksFrom(square, occupancy) != walkRays(square, occupancy, ROOK_DIRECTIONS)) errors++;
+        if(LC::bishopAttacksFrom(square, occupancy) != walkRays(square, occupancy, BISHOP_DIRECTIONS)) errors++;
+    }
+
+    printf("%lu queries checked against the rays, %lu errors\n\n", (unsigned long)occupancies.size()*4, (unsigned long)errors);
+    printf("pressure KB   backend ns/query   fills ns/query   ns/move (%d games)\n", games);
+
+    for(int kilobytes : pressures) {
+        CachePressure pressure(kilobytes);
+
+        double backend = timeQueries(occupancies, pressure, [](int square, uint64_t occupancy) {
+            return LC::getRookAttacksForSquareAndOccupancy(square, occupancy) ^ LC::getBishopAttacksForSquareAndOccupancy(square, occupancy);
+        });
+
+        double fills = timeQueries(occupancies, pressure, [](int square, uint64_t occupancy) {
+            return LC::rookAttacksFrom(square, occupancy) ^ LC::bishopAttacksFrom(square, occupancy);
+        });
+
+        printf("%11d   %16.1f   %14.1f   %15.0f\n", kilobytes, backend, fills, timeGames(games, moves, pressure));
+    }
+
+    return errors == 0 ? 0 : 1;
+}
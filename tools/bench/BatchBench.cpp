@@ -0,0 +1,186 @@
+#include "Bench.h"
+#include "BatchValidator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <memory>
+
+namespace LC {
+
+namespace {
+
+// a position of the corpus and the move played from it
+struct BatchPosition {
+    std::unique_ptr<LegalChess> pGame;
+    std::string nextMove;
+};
+
+std::vector<BatchPosition> replayPositions(const std::vector<std::string>& games) {
+    std::vector<BatchPosition> positions;
+
+    for(const std::string& line : games) {
+        LegalChess game;
+
+        for(const std::string& move : splitMoves(line)) {
+            positions.push_back({game.fork(), move});
+            game.makeTrustedMove(move, true);
+        }
+    }
+
+    return positions;
+}
+
+bool acceptedByMakeMove(const LegalChess& game, const std::string& move) {
+    std::unique_ptr<LegalChess> pCopy = game.fork();
+
+    try {
+        pCopy->makeMove(move);
+    }
+    catch(const std::exception&) {
+        return false;
+    }
+
+    return true;
+}
+
+std::string squareName(int square) {
+    return {(char)('h' - square%8), (char)('1' + square/8)};
+}
+
+}
+
+// the batch on the simd and the scalar path against makeMove, and makeMove against the legal move generator. the
+// candidates are every to square from the pieces of the side to move and from some empty squares, with and without
+// promotion suffixes, plus malformed moves
+int runBatchBench(const BenchOptions& options) {
+    std::vector<std::string> games = readGames(options.getString("corpus", "UCI.txt"));
+    size_t stride = std::max(1L, options.getInt("stride", 4));
+    int rounds = options.getInt("rounds", 400000);
+
+    std::vector<BatchPosition> positions = replayPositions(games);
+
+    BenchChecks checks;
+    size_t candidates = 0, accepted = 0;
+    PackedMove legalMoves[LegalChess::MAX_LEGAL_MOVES];
+
+    for(size_t index = 0; index < positions.size(); index += stride) {
+        const LegalChess& game = *positions[index].pGame;
+        std::array<char, 64> board = game.getBoardArray();
+        bool whiteTurn = game.getMoveNumber() % 2 == 0;
+
+        std::vector<std::string> moves = {"", "e2", "e2e4e", "i2i4", "e0e1", "e2e4qq"};
+
+        for(int fromSquare = 0; fromSquare < 64; fromSquare++) {
+            bool own = board[fromSquare] != '.' && (isupper(board[fromSquare]) != 0) == whiteTurn;
+            if(!own && fromSquare % 9 != 0) continue;
+
+            for(int toSquare = 0; toSquare < 64; toSquare++) {
+                for(const char* pSuffix : {"", "q", "n", "k"}) moves.push_back(squareName(fromSquare) + squareName(toSquare) + pSuffix);
+            }
+        }
+
+        size_t legalCount = game.getLegalMoves(legalMoves);
+
+        MoveBatch batch(moves.size());
+        for(size_t i = 0; i < moves.size(); i++) batch.set(i, game, moves[i]);
+
+        std::vector<uint8_t> simd, scalar;
+        validateMoveBatch(batch, simd);
+        validateMoveBatch(batch, scalar, false);
+
+        for(size_t i = 0; i < moves.size(); i++) {
+            bool reference = acceptedByMakeMove(game, moves[i]);
+            PackedMove packed = packMove(moves[i]);
+            bool generated = packed != 0 && std::find(legalMoves, legalMoves + legalCount, packed) != legalMoves + legalCount;
+
+            std::string what = "position " + std::to_string(index) + ", move '" + moves[i] + "'";
+
+            checks.expect(simd[i] == reference && scalar[i] == reference, what + ", batch against makeMove");
+            checks.expect(generated == reference, what + ", makeMove against getLegalMoves");
+
+            candidates++;
+            accepted += reference;
+        }
+    }
+
+    // finished games reject every move
+    for(const std::string& line : games) {
+        LegalChess game(line, ReplayMode::VALIDATED);
+        if(!game.isGameOver()) continue;
+
+        MoveBatch batch(64*64);
+        for(int i = 0; i < 64*64; i++) batch.set(i, game, squareName(i/64) + squareName(i%64));
+
+        std::vector<uint8_t> legal;
+        validateMoveBatch(batch, legal);
+
+        checks.expect(std::count(legal.begin(), legal.end(), 1) == 0, "finished game " + line.substr(0, 40));
+    }
+
+    int status = checks.report(std::to_string(candidates) + " candidate moves (" + std::to_string(accepted) + " legal)");
+
+    // the next move of consecutive positions. makeMove also applies the move and detects the result, the fork it
+    // needs to keep the position is timed on its own and subtracted
+    printf("next moves from the corpus, ns per game (%d lanes):\n", BATCH_LANES);
+    printf("  batch size   makeMove   MoveBatch::set   scalar kernel   simd kernel\n");
+
+    for(size_t size = 8; size <= 4096; size *= 8) {
+        size_t reps = std::max<size_t>(1, rounds/size), total = reps*size;
+        volatile size_t sink = 0;
+
+        BenchClock::time_point start = BenchClock::now();
+
+        for(size_t rep = 0; rep < reps; rep++) {
+            for(size_t i = 0; i < size; i++) {
+                const BatchPosition& position = positions[(rep*size + i) % positions.size()];
+                sink += acceptedByMakeMove(*position.pGame, position.nextMove);
+            }
+        }
+
+        double makeMove = nanosecondsSince(start)/total;
+
+        start = BenchClock::now();
+
+        for(size_t rep = 0; rep < reps; rep++) {
+            for(size_t i = 0; i < size; i++) sink += positions[(rep*size + i) % positions.size()].pGame->fork()->getMoveNumber();
+        }
+
+        double fork = nanosecondsSince(start)/total;
+
+        std::vector<MoveBatch> batches(std::min<size_t>(reps, 64), MoveBatch(size));
+
+        start = BenchClock::now();
+
+        for(size_t rep = 0; rep < reps; rep++) {
+            MoveBatch& batch = batches[rep % batches.size()];
+
+            for(size_t i = 0; i < size; i++) {
+                const BatchPosition& position = positions[(rep*size + i) % positions.size()];
+                batch.set(i, *position.pGame, position.nextMove);
+            }
+        }
+
+        double set = nanosecondsSince(start)/total;
+
+        std::vector<uint8_t> legal;
+        double kernel[2];
+
+        for(int simd = 0; simd < 2; simd++) {
+            start = BenchClock::now();
+
+            for(size_t rep = 0; rep < reps; rep++) {
+                validateMoveBatch(batches[rep % batches.size()], legal, simd == 1);
+                sink += legal[0];
+            }
+
+            kernel[simd] = nanosecondsSince(start)/total;
+        }
+
+        printf("  %10lu %10.0f %16.1f %15.1f %13.1f\n", (unsigned long)size, makeMove - fork, set, kernel[0], kernel[1]);
+    }
+
+    return status;
+}
+
+};
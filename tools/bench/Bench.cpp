@@ -0,0 +1,238 @@
+#include "Bench.h"
+#include "Helper.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <new>
+#include <stdexcept>
+
+// runs the measurements and cross-checks behind the numbers in the README, one suite per feature:
+//   lc_bench SUITE [--option value ...]
+namespace {
+
+struct Suite {
+    const char* pName;
+    const char* pOptions;
+    const char* pDescription;
+    int (*pRun)(const LC::BenchOptions&);
+};
+
+const Suite SUITES[] = {
+    {"replay", "[--corpus UCI.txt] [--rounds 200]", "validated and trusted replays end in the same state, us per game", LC::runReplayBench},
+    {"perft", "[--corpus UCI.txt] [--rounds 200]", "perft counts of the standard positions, ns per detectGameResult by outcome", LC::runPerftBench},
+    {"batch", "[--corpus UCI.txt] [--stride 4] [--rounds 400000]", "MoveBatch on the simd and scalar paths against makeMove, ns per game by batch size", LC::runBatchBench},
+    {"destinations", "[--corpus UCI.txt] [--stride 5] [--rounds 20]", "games with and without cached destinations agree, ns per query and per makeMove", LC::runDestinationsBench},
+    {"cache", "[--corpus UCI.txt] [--threads 4] [--sizes 0,65536,262144,1048576] [--rounds 50] [--variations 20]", "same results with every position cache size, hit rates in metrics builds", LC::runCacheBench},
+    {"trie", "[--corpus UCI.txt] [--games 4000] [--nodes 65536] [--rounds 3] [--file lc_bench_trie.bin]", "restores through a saved trie end like full replays, us per restore", LC::runTrieBench},
+    {"executor", "[--corpus UCI.txt] [--games 20000]", "MoveExecutor ends like a serial loop, moves/s against a serial loop and a thread per batch", LC::runExecutorBench},
+    {"fork", "[--corpus UCI.txt] [--games 200] [--plies 200] [--forks 100] [--rounds 10]", "forks continue like replays, us and bytes per fork against a replay", LC::runForkBench},
+    {"output", "[--corpus UCI.txt] [--rounds 2000]", "FENs parse back to the board, calls/s and allocations of the state writers", LC::runOutputBench},
+    {"delta", "[--corpus UCI.txt] [--games 3000] [--rounds 50]", "a client applying the deltas follows every ply, bytes and ns per move against the FEN", LC::runDeltaBench},
+    {"keys", "[--corpus UCI.txt] [--positions 1000000]", "incremental keys match keys computed from scratch, collisions by key width, ns per move", LC::runKeysBench},
+    {"import", "[--games 40000] [--threads 0] [--rounds 3]", "import statuses match a serial pass, seconds against validating every game", LC::runImportBench},
+    {"index", "[--games 200000] [--budget 64] [--file lc_bench_index.bin]", "postings of every key match a brute-force replay, build seconds, bytes per posting, us per query", LC::runIndexBench},
+    {"explorer", "[--games 100000] [--depth 30] [--min-games 2] [--file lc_bench_explorer.bin]", "counters match a brute-force count on 1, 2 and 4 threads, build seconds, ns per lookup", LC::runExplorerBench},
+    {"codec", "[--corpus UCI.txt] [--games 20000] [--rounds 3] [--file lc_bench_codec.txt]", "games round trip with both codings, bytes per ply against UCI text, gzip and xz, plies/s", LC::runCodecBench},
+    {"timeline", "[--games 200] [--plies 300]", "seeks match validated replays at every checkpoint interval, bytes per ply, ns per seek and step", LC::runTimelineBench},
+    {"variations", "[--nodes 10000] [--navigations 3000]", "goTo matches validated replays with and without snapshots, heap bytes per node, ns per navigation", LC::runVariationBench},
+    {"table", "[--games 1000000] [--plies 120] [--half-moves 20] [--repetitions 2]", "sweeps and continued games match each game, ms per sweep against a LegalChess per game", LC::runTableBench},
+    {"metrics", "[--corpus UCI.txt] [--rounds 100] [--repeats 5] [--threads 200]", "with LC_ENABLE_METRICS every move is counted once and exited threads leave no counters behind, us/game to compare builds", LC::runMetricsBench},
+    {"wal", "[--games 1000] [--plies 80] [--slots 64] [--cuts 100] [--clients 1,8,256] [--seconds 2] [--chunk-records 34000000] [--chunk-games 20000] [--recover-games 1000000] [--recover-plies 20] [--file lc_bench_wal.log]", "move logs cut at random bytes rebuild the games of their whole records, durable moves/s with clients waiting for each move, time to rebuild a million games", LC::runWalBench},
+};
+
+std::atomic<size_t> allocationCount(0), liveBytes(0);
+
+// the size of a block is kept in front of it, so delete knows how much is freed
+constexpr size_t ALLOCATION_HEADER = 16;
+
+void* allocate(size_t size) {
+    char* pBlock = (char*)malloc(size + ALLOCATION_HEADER);
+    if(!pBlock) throw std::bad_alloc();
+
+    *(size_t*)pBlock = size;
+
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    liveBytes.fetch_add(size, std::memory_order_relaxed);
+
+    return pBlock + ALLOCATION_HEADER;
+}
+
+void deallocate(void* p) {
+    if(!p) return;
+
+    char* pBlock = (char*)p - ALLOCATION_HEADER;
+    liveBytes.fetch_sub(*(size_t*)pBlock, std::memory_order_relaxed);
+
+    free(pBlock);
+}
+
+int usage(const char* pProgram) {
+    std::cerr << "usage: " << pProgram << " SUITE [--option value ...]" << std::endl;
+
+    for(const Suite& suite : SUITES) {
+        std::cerr << "  " << suite.pName << " " << suite.pOptions << std::endl;
+        std::cerr << "      " << suite.pDescription << std::endl;
+    }
+
+    return 1;
+}
+
+}
+
+namespace LC {
+
+bool BenchOptions::parse(int argc, char** argv, int first) {
+    for(int i = first; i < argc; i += 2) {
+        std::string name = argv[i];
+        if(name.size() < 3 || name.compare(0, 2, "--") != 0 || i + 1 >= argc) return false;
+
+        m_values[name.substr(2)] = argv[i + 1];
+    }
+
+    return true;
+}
+
+long BenchOptions::getInt(const std::string& name, long fallback) const {
+    auto it = m_values.find(name);
+    return it == m_values.end() ? fallback : strtol(it->second.c_str(), nullptr, 10);
+}
+
+double BenchOptions::getDouble(const std::string& name, double fallback) const {
+    auto it = m_values.find(name);
+    return it == m_values.end() ? fallback : strtod(it->second.c_str(), nullptr);
+}
+
+std::string BenchOptions::getString(const std::string& name, const std::string& fallback) const {
+    auto it = m_values.find(name);
+    return it == m_values.end() ? fallback : it->second;
+}
+
+void BenchChecks::expect(bool condition, const std::string& what) {
+    m_checked++;
+    if(condition) return;
+
+    if(m_failed++ < 10) std::cout << "FAILED: " << what << std::endl;
+}
+
+int BenchChecks::report(const std::string& what) const {
+    printf("%s: %lu checks, %lu failed\n", what.c_str(), (unsigned long)m_checked, (unsigned long)m_failed);
+
+    return m_failed == 0 ? 0 : 1;
+}
+
+std::vector<std::string> readGames(const std::string& path) {
+    std::ifstream file(path);
+    if(!file) throw std::runtime_error("Can't open " + path);
+
+    std::vector<std::string> games;
+    std::string line;
+
+    while(std::getline(file, line)) {
+        if(line.find_first_not_of(" \t\r\n") != std::string::npos) games.push_back(line);
+    }
+
+    return games;
+}
+
+std::vector<std::string> splitMoves(const std::string& line) {
+    std::vector<std::string> moves;
+
+    for(size_t end = 0, start = line.find_first_not_of(" \t\r\n"); start != std::string::npos; start = line.find_first_not_of(" \t\r\n", end)) {
+        end = line.find_first_of(" \t\r\n", start);
+        moves.emplace_back(line, start, end == std::string::npos ? std::string::npos : end - start);
+    }
+
+    return moves;
+}
+
+std::vector<std::string> generateGames(size_t count, int maxPlies, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    PackedMove moves[LegalChess::MAX_LEGAL_MOVES];
+    std::vector<std::string> games(count);
+
+    for(std::string& line : games) {
+        LegalChess game;
+
+        for(int ply = 0; ply < maxPlies && game.getGameResult() == GameResult::IN_PROGRESS; ply++) {
+            size_t legalCount = game.getLegalMoves(moves);
+            if(legalCount == 0) break;
+
+            std::string move = unpackMove(moves[rng() % legalCount]);
+            game.makeTrustedMove(move, true);
+
+            if(!line.empty()) line += ' ';
+            line += move;
+        }
+    }
+
+    return games;
+}
+
+AllocationCounters getAllocationCounters() {
+    return {allocationCount.load(std::memory_order_relaxed), liveBytes.load(std::memory_order_relaxed)};
+}
+
+double percentile(std::vector<double>& values, double fraction) {
+    if(values.empty()) return 0;
+
+    std::sort(values.begin(), values.end());
+
+    return values[std::min(values.size() - 1, (size_t)(fraction*values.size()))];
+}
+
+};
+
+// counted for AllocationCounters, the over-aligned versions keep the default implementation
+void* operator new(size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void* p) noexcept {
+    deallocate(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    deallocate(p);
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) return usage(argv[0]);
+
+    std::string name = argv[1];
+    LC::BenchOptions options;
+
+    if(!options.parse(argc, argv, 2)) return usage(argv[0]);
+
+    for(const Suite& suite : SUITES) {
+        if(name != suite.pName) continue;
+
+        LC::compute();
+
+        try {
+            return suite.pRun(options);
+        }
+        catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    return usage(argv[0]);
+}
@@ -0,0 +1,100 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "LegalChess.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// shared by the suites of lc_bench. a suite cross-checks a feature against a reference and prints the numbers the
+// README quotes for it, it returns 1 if a check failed
+namespace LC {
+
+typedef std::chrono::steady_clock BenchClock;
+
+inline double secondsSince(BenchClock::time_point start) {
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+inline double nanosecondsSince(BenchClock::time_point start) {
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+}
+
+// the --name value options after the suite name
+class BenchOptions {
+public:
+    // false if an argument is not a --name followed by a value
+    bool parse(int argc, char** argv, int first);
+
+    long getInt(const std::string& name, long fallback) const;
+    double getDouble(const std::string& name, double fallback) const;
+    std::string getString(const std::string& name, const std::string& fallback) const;
+
+private:
+    std::map<std::string, std::string> m_values;
+};
+
+// counts the checks of a suite and prints the first failures
+class BenchChecks {
+public:
+    void expect(bool condition, const std::string& what);
+
+    inline size_t getFailures() const {
+        return m_failed;
+    }
+
+    // prints the number of checks and failures, returns the exit code of the suite
+    int report(const std::string& what) const;
+
+private:
+    size_t m_checked = 0;
+    size_t m_failed = 0;
+};
+
+// the non empty lines of a file, throws std::runtime_error if it can't be read
+std::vector<std::string> readGames(const std::string& path);
+
+std::vector<std::string> splitMoves(const std::string& line);
+
+// random games of at most maxPlies plies, every move drawn from the legal moves. the same seed gives the same games
+std::vector<std::string> generateGames(size_t count, int maxPlies, uint64_t seed);
+
+// allocations through operator new of all threads since the start of the process
+struct AllocationCounters {
+    size_t count;       // calls of operator new
+    size_t liveBytes;   // requested and not yet deleted
+};
+
+AllocationCounters getAllocationCounters();
+
+// sorts values, fraction 0.5 is the median
+double percentile(std::vector<double>& values, double fraction);
+
+// suites
+int runReplayBench(const BenchOptions& options);
+int runPerftBench(const BenchOptions& options);
+int runBatchBench(const BenchOptions& options);
+int runDestinationsBench(const BenchOptions& options);
+int runCacheBench(const BenchOptions& options);
+int runTrieBench(const BenchOptions& options);
+int runExecutorBench(const BenchOptions& options);
+int runForkBench(const BenchOptions& options);
+int runOutputBench(const BenchOptions& options);
+int runDeltaBench(const BenchOptions& options);
+int runKeysBench(const BenchOptions& options);
+int runImportBench(const BenchOptions& options);
+int runIndexBench(const BenchOptions& options);
+int runExplorerBench(const BenchOptions& options);
+int runCodecBench(const BenchOptions& options);
+int runTimelineBench(const BenchOptions& options);
+int runVariationBench(const BenchOptions& options);
+int runTableBench(const BenchOptions& options);
+int runMetricsBench(const BenchOptions& options);
+int runWalBench(const BenchOptions& options);
+
+};
+
+#endif
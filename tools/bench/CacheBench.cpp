@@ -0,0 +1,144 @@
+#include "Bench.h"
+#include "Metrics.h"
+#include "PositionCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace LC {
+
+namespace {
+
+// FEN and result of every game a thread played, the same at every cache size
+typedef std::vector<std::string> CacheOutcome;
+
+std::string describe(LegalChess& game) {
+    return std::string(gameResultToString[(int)game.getGameResult()]) + " " + game.getFENString();
+}
+
+// validated replays of the corpus, rounds times per thread
+CacheOutcome replayGames(const std::vector<std::string>& games, int rounds) {
+    CacheOutcome outcome;
+
+    for(int round = 0; round < rounds; round++) {
+        for(const std::string& line : games) {
+            LegalChess game(line, ReplayMode::VALIDATED);
+            if(round == 0) outcome.push_back(describe(game));
+        }
+    }
+
+    return outcome;
+}
+
+// a random prefix of a corpus game continued with random moves picked through legalDestinations, as a client
+// highlighting moves would
+CacheOutcome continueGames(const std::vector<std::string>& games, int variations, int thread, int threads) {
+    CacheOutcome outcome;
+
+    for(int item = thread; item < (int)games.size()*variations; item += threads) {
+        std::vector<std::string> moves = splitMoves(games[item/variations]);
+        std::mt19937 rng(item*7919 + 1);
+
+        LegalChess game;
+        size_t prefix = rng() % (moves.size() + 1);
+
+        for(size_t ply = 0; ply < prefix && !game.isGameOver(); ply++) game.makeMove(moves[ply]);
+
+        for(int ply = 0; ply < 80 && !game.isGameOver(); ply++) {
+            std::vector<std::string> candidates;
+
+            for(int square = 0; square < 64; square++) {
+                std::string from = {(char)('h' - square%8), (char)('1' + square/8)};
+
+                for(const std::string& to : game.legalDestinations(from)) {
+                    candidates.push_back(game.isLegal(from + to) ? from + to : from + to + "q");
+                }
+            }
+
+            if(candidates.empty()) break;
+
+            game.makeMove(candidates[rng() % candidates.size()]);
+        }
+
+        outcome.push_back(describe(game));
+    }
+
+    return outcome;
+}
+
+}
+
+// the same games on threads sharing caches of several sizes (the first one should be 0, the cache disabled) have to
+// end the same way. hit rates and the game result latency need a LC_ENABLE_METRICS build
+int runCacheBench(const BenchOptions& options) {
+    std::vector<std::string> games = readGames(options.getString("corpus", "UCI.txt"));
+    int threads = options.getInt("threads", 4);
+    int rounds = options.getInt("rounds", 50);
+    int variations = options.getInt("variations", 20);
+
+    std::vector<size_t> sizes;
+    std::stringstream ss(options.getString("sizes", "0,65536,262144,1048576"));
+
+    for(std::string size; std::getline(ss, size, ',');) sizes.push_back(strtoul(size.c_str(), nullptr, 10));
+
+    Metrics::setLatencySampleInterval(1);
+
+    BenchChecks checks;
+    std::shared_ptr<PositionCache> pCache = PositionCache::getInstance();
+
+    for(const char* pWorkload : {"replay", "continuations"}) {
+        bool replay = pWorkload[0] == 'r';
+        std::vector<CacheOutcome> reference;
+
+        printf("%s of the corpus on %d threads:\n", replay ? "validated replays" : "random continuations", threads);
+
+        for(size_t size : sizes) {
+            pCache->resize(size);
+            pCache->clear();
+            Metrics::reset();
+
+            std::vector<CacheOutcome> outcomes(threads);
+            std::vector<std::thread> workers;
+
+            BenchClock::time_point start = BenchClock::now();
+
+            for(int thread = 0; thread < threads; thread++) {
+                workers.emplace_back([&, thread]() {
+                    outcomes[thread] = replay ? replayGames(games, rounds) : continueGames(games, variations, thread, threads);
+                });
+            }
+
+            for(std::thread& worker : workers) worker.join();
+
+            double seconds = secondsSince(start);
+
+            if(reference.empty()) reference = outcomes;
+            checks.expect(outcomes == reference, std::string(pWorkload) + " with a cache of " + std::to_string(size) + " bytes");
+
+            printf("  %8lu bytes %6lu entries  %.2fs", (unsigned long)size, (unsigned long)pCache->getEntryCount(), seconds);
+
+            MetricsSnapshot snapshot = Metrics::snapshot();
+
+            if(snapshot.enabled) {
+                const PhaseSnapshot& result = snapshot.phases[(int)MetricsPhase::GAME_RESULT];
+                double hitRate = snapshot.positionCacheProbes == 0 ? 0 : 100.0*snapshot.positionCacheHits/snapshot.positionCacheProbes;
+
+                printf("  hit rate %.0f%%  GAME_RESULT mean %.0fns p50 %.0fns", hitRate,
+                    result.samples == 0 ? 0 : result.totalTicks/snapshot.ticksPerNanosecond/result.samples, result.p50Ticks/snapshot.ticksPerNanosecond);
+            }
+
+            printf("\n");
+        }
+    }
+
+    pCache->resize(0);
+
+    if(!Metrics::snapshot().enabled) printf("hit rates and latencies need -DLC_ENABLE_METRICS=ON\n");
+
+    return checks.report("same results with every cache size");
+}
+
+};
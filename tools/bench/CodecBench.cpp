@@ -0,0 +1,162 @@
+#include "Bench.h"
+#include "GameCodec.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace LC {
+
+namespace {
+
+// bytes of the output of a compressor run on the file, 0 if it isn't installed
+size_t compressedSize(const char* pCommand, const std::string& path) {
+    std::string command = std::string(pCommand) + " -c '" + path + "' 2>/dev/null | wc -c";
+    FILE* pPipe = popen(command.c_str(), "r");
+    if(!pPipe) return 0;
+
+    unsigned long size = 0;
+    if(fscanf(pPipe, "%lu", &size) != 1) size = 0;
+
+    return pclose(pPipe) == 0 ? size : 0;
+}
+
+std::string formatSize(size_t bytes) {
+    char text[32];
+
+    if(bytes == 0) snprintf(text, sizeof(text), "n/a");
+    else if(bytes >= 10000000) snprintf(text, sizeof(text), "%.1f MB", bytes/1e6);
+    else snprintf(text, sizeof(text), "%.0f KB", bytes/1e3);
+
+    return text;
+}
+
+// encodes and decodes the games with each coding, every game has to come back with the moves, FEN and result of a replay
+void benchCorpus(BenchChecks& checks, const std::vector<std::string>& games, const std::string& name, const std::string& path, int rounds) {
+    size_t plies = 0, textBytes = 0;
+
+    for(const std::string& line : games) {
+        plies += splitMoves(line).size();
+        textBytes += line.size() + 1;
+    }
+
+    std::vector<std::string> expected;
+
+    for(const std::string& line : games) {
+        LegalChess game(line, ReplayMode::VALIDATED);
+        expected.push_back(std::string(gameResultToString[(int)game.getGameResult()]) + " " + game.getFENString());
+    }
+
+    printf("%s: %lu games, %lu plies, UCI text %s\n", name.c_str(), (unsigned long)games.size(), (unsigned long)plies, formatSize(textBytes).c_str());
+
+    for(MoveCoding coding : {MoveCoding::INDEX_BYTES, MoveCoding::ARITHMETIC}) {
+        const char* pCoding = coding == MoveCoding::ARITHMETIC ? "arithmetic" : "index bytes";
+        std::string encoded;
+        double encode = 1e18, decode = 1e18;
+
+        for(int round = 0; round < rounds; round++) {
+            std::ostringstream output;
+            BenchClock::time_point start = BenchClock::now();
+
+            GameEncoder encoder(output, coding);
+            for(const std::string& line : games) encoder.encodeGame(line);
+            encoder.finish();
+
+            encode = std::min(encode, secondsSince(start));
+            encoded = output.str();
+        }
+
+        for(int round = 0; round < rounds; round++) {
+            std::istringstream input(encoded);
+            std::string moves;
+            size_t index = 0;
+
+            BenchClock::time_point start = BenchClock::now();
+            GameDecoder decoder(input);
+
+            while(decoder.decodeGame(moves)) {
+                if(round == 0 && index < games.size()) {
+                    LegalChess& game = const_cast<LegalChess&>(decoder.getGame());
+                    std::string what = name + ", " + pCoding + ", game " + std::to_string(index + 1);
+
+                    checks.expect(splitMoves(moves) == splitMoves(games[index]), what + ", moves");
+                    checks.expect(std::string(gameResultToString[(int)game.getGameResult()]) + " " + game.getFENString() == expected[index], what + ", FEN and result");
+                }
+
+                index++;
+            }
+
+            decode = std::min(decode, secondsSince(start));
+            checks.expect(index == games.size(), name + ", " + pCoding + ", number of games");
+        }
+
+        printf("  %-12s %9s, %.2f bytes/ply, encode %.2fM plies/s, decode %.2fM plies/s\n", pCoding, formatSize(encoded.size()).c_str(),
+            (double)encoded.size()/plies, plies/encode/1e6, plies/decode/1e6);
+    }
+
+    // the general purpose compressors on the same text
+    {
+        std::ofstream text(path);
+        for(const std::string& line : games) text << line << "\n";
+    }
+
+    printf("  %-12s %9s\n", "gzip -9", formatSize(compressedSize("gzip -9", path)).c_str());
+    printf("  %-12s %9s\n", "xz -9", formatSize(compressedSize("xz -9", path)).c_str());
+
+    remove(path.c_str());
+}
+
+}
+
+// every game encoded with either coding has to decode to its moves and end in the position of a replay, an illegal
+// move has to be rejected without changing the game, and a stream of another format has to be refused
+int runCodecBench(const BenchOptions& options) {
+    std::vector<std::string> corpus = readGames(options.getString("corpus", "UCI.txt"));
+    int rounds = options.getInt("rounds", 3);
+    std::string path = options.getString("file", "lc_bench_codec.txt");
+
+    BenchChecks checks;
+
+    // an illegal move throws what makeMove throws and the game stays as it was
+    {
+        std::ostringstream output;
+        GameEncoder encoder(output);
+
+        encoder.addMove("e2e4");
+        std::string before = const_cast<LegalChess&>(encoder.getGame()).getFENString();
+
+        bool rejected = false;
+
+        try {
+            encoder.addMove("e2e4");
+        }
+        catch(const std::exception&) {
+            rejected = true;
+        }
+
+        checks.expect(rejected && const_cast<LegalChess&>(encoder.getGame()).getFENString() == before, "illegal move rejected");
+    }
+
+    // a stream that wasn't written by GameEncoder
+    {
+        std::istringstream input("e2e4 e7e5\n");
+        bool refused = false;
+
+        try {
+            GameDecoder decoder(input);
+        }
+        catch(const GameCodecException&) {
+            refused = true;
+        }
+
+        checks.expect(refused, "stream of another format refused");
+    }
+
+    benchCorpus(checks, corpus, "corpus", path, rounds);
+    benchCorpus(checks, generateGames(options.getInt("games", 20000), 200, 53), "random games", path, rounds);
+
+    return checks.report("games round trip with both codings");
+}
+
+};
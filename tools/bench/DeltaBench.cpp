@@ -0,0 +1,210 @@
+#include "Bench.h"
+#include "MoveDelta.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace LC {
+
+namespace {
+
+// true if a piece of the given color attacks square on the board, scanned square by square without the library
+bool isAttacked(const std::array<char, 64>& board, int square, bool byWhite) {
+    int row = square/8, col = square%8;
+
+    auto pieceAt = [&](int r, int c) -> char {
+        if(r < 0 || r > 7 || c < 0 || c > 7) return 0;
+
+        char piece = board[r*8 + c];
+        if(piece == '.' || (isupper(piece) != 0) != byWhite) return 0;
+
+        return (char)tolower(piece);
+    };
+
+    // a white pawn attacks the next rank, a black one the previous rank
+    int pawnRow = byWhite ? row - 1 : row + 1;
+    if(pieceAt(pawnRow, col - 1) == 'p' || pieceAt(pawnRow, col + 1) == 'p') return true;
+
+    const int knight[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    for(const int* pOffset : knight) if(pieceAt(row + pOffset[0], col + pOffset[1]) == 'n') return true;
+
+    for(int dr = -1; dr <= 1; dr++) {
+        for(int dc = -1; dc <= 1; dc++) {
+            if(dr == 0 && dc == 0) continue;
+            if(pieceAt(row + dr, col + dc) == 'k') return true;
+
+            bool diagonal = dr != 0 && dc != 0;
+
+            for(int r = row + dr, c = col + dc; r >= 0 && r <= 7 && c >= 0 && c <= 7; r += dr, c += dc) {
+                if(board[r*8 + c] == '.') continue;
+
+                char piece = pieceAt(r, c);
+                if(piece == 'q' || piece == (diagonal ? 'b' : 'r')) return true;
+
+                break;
+            }
+        }
+    }
+
+    return false;
+}
+
+// the check type the last move should report: the pieces attacking the king of the side to move, one of them on the
+// square the move brought a piece to (the rook's square for castling) is a direct check
+CheckType expectedCheckType(const std::array<char, 64>& board, bool whiteToMove, const MoveDelta& delta) {
+    int kingSquare = 0;
+    while(board[kingSquare] != (whiteToMove ? 'K' : 'k')) kingSquare++;
+
+    int checkers = 0;
+    bool direct = false;
+    int movedToSquare = delta.rookToSquare != 64 ? delta.rookToSquare : delta.toSquare;
+
+    for(int square = 0; square < 64; square++) {
+        char piece = board[square];
+        if(piece == '.' || (isupper(piece) != 0) == whiteToMove) continue;
+
+        // the piece alone, every other piece only blocks: pieces of the side to move never attack its own king
+        std::array<char, 64> single;
+
+        for(int other = 0; other < 64; other++) single[other] = board[other] == '.' ? '.' : whiteToMove ? 'N' : 'n';
+        single[square] = piece;
+
+        if(isAttacked(single, kingSquare, !whiteToMove)) {
+            checkers++;
+            direct = direct || square == movedToSquare;
+        }
+    }
+
+    if(checkers == 0) return CheckType::NO_CHECK;
+    if(checkers > 1) return CheckType::DOUBLE_CHECK;
+
+    return direct ? CheckType::DIRECT_CHECK : CheckType::DISCOVERY_CHECK;
+}
+
+// what the checked deltas covered
+struct DeltaCoverage {
+    size_t moves = 0, castlings = 0, enpassants = 0, promotions = 0, capturingPromotions = 0;
+    size_t checks[4] = {};
+    size_t results[7] = {};
+    size_t deltaBytes = 0, fenBytes = 0;
+};
+
+}
+
+// a client applying the decoded deltas of every move has to end up in the FEN, result and check type of the game after
+// every ply, on the validated and the trusted move path, also when it joins a game in progress from its FEN
+int runDeltaBench(const BenchOptions& options) {
+    std::vector<std::string> corpus = readGames(options.getString("corpus", "UCI.txt"));
+    int rounds = options.getInt("rounds", 50);
+
+    std::vector<std::string> games = corpus;
+    for(const std::string& line : generateGames(options.getInt("games", 3000), 300, 19)) games.push_back(line);
+
+    BenchChecks checks;
+    DeltaCoverage coverage;
+    uint8_t record[MAX_MOVE_DELTA_SIZE];
+
+    for(size_t index = 0; index < games.size(); index++) {
+        std::vector<std::string> moves = splitMoves(games[index]);
+
+        for(ReplayMode mode : {ReplayMode::VALIDATED, ReplayMode::TRUSTED}) {
+            LegalChess game;
+            MoveDeltaApplier client;
+            std::unique_ptr<MoveDeltaApplier> pJoined;
+
+            for(size_t ply = 0; ply < moves.size(); ply++) {
+                if(mode == ReplayMode::VALIDATED) game.makeMove(moves[ply]);
+                else game.makeTrustedMove(moves[ply], true);
+
+                std::string what = "game " + std::to_string(index + 1) + ", ply " + std::to_string(ply + 1) + (mode == ReplayMode::VALIDATED ? ", validated" : ", trusted");
+
+                size_t size = game.writeMoveDelta(record, sizeof(record));
+
+                MoveDelta delta;
+                checks.expect(size != 0 && decodeMoveDelta(record, size, delta) == size, what + ", decode");
+                checks.expect(client.apply(record, size) == size, what + ", apply");
+
+                std::string fen = game.getFENString();
+                std::array<char, 64> board = game.getBoardArray();
+                bool whiteToMove = game.getMoveNumber() % 2 == 0;
+
+                checks.expect(client.getFENString() == fen, what + ", FEN");
+                checks.expect(client.getBoardArray() == board, what + ", board");
+                checks.expect(client.getGameResult() == game.getGameResult(), what + ", result");
+                checks.expect(client.getCheckType() == expectedCheckType(board, whiteToMove, delta), what + ", check type");
+
+                if(pJoined) {
+                    pJoined->apply(record, size);
+                    checks.expect(pJoined->getFENString() == fen, what + ", client joined at ply 20");
+                }
+
+                if(ply + 1 == 20) pJoined = std::make_unique<MoveDeltaApplier>(fen);
+
+                if(mode == ReplayMode::TRUSTED) continue;
+
+                coverage.moves++;
+                coverage.castlings += delta.rookFromSquare != 64;
+                coverage.enpassants += delta.captureSquare != 64 && delta.captureSquare != delta.toSquare;
+                coverage.promotions += delta.choosenPiece != 0;
+                coverage.capturingPromotions += delta.choosenPiece != 0 && delta.capturedPiece != Piece::EMPTY;
+                coverage.checks[(int)delta.checkType]++;
+                coverage.results[(int)delta.result]++;
+                coverage.deltaBytes += size;
+                coverage.fenBytes += fen.length();
+            }
+        }
+    }
+
+    checks.expect(coverage.castlings != 0 && coverage.enpassants != 0 && coverage.promotions != 0 && coverage.capturingPromotions != 0, "coverage of special moves");
+    checks.expect(coverage.checks[1] != 0 && coverage.checks[2] != 0 && coverage.checks[3] != 0, "coverage of check types");
+    checks.expect(coverage.results[1] + coverage.results[2] != 0 && coverage.results[3] + coverage.results[4] + coverage.results[5] + coverage.results[6] != 0, "coverage of result bytes");
+
+    int status = checks.report(std::to_string(games.size()) + " games on both move paths, the client follows every ply");
+
+    printf("%lu moves: %lu castlings, %lu en passant, %lu promotions (%lu capturing), checks %lu direct, %lu discovered, %lu double\n",
+        (unsigned long)coverage.moves, (unsigned long)coverage.castlings, (unsigned long)coverage.enpassants, (unsigned long)coverage.promotions,
+        (unsigned long)coverage.capturingPromotions, (unsigned long)coverage.checks[1], (unsigned long)coverage.checks[2], (unsigned long)coverage.checks[3]);
+
+    printf("result bytes:");
+    for(int result = 1; result < 7; result++) printf(" %s %lu", gameResultToString[result], (unsigned long)coverage.results[result]);
+    printf("\n");
+
+    printf("bytes per move: %.2f for the delta, %.1f for the FEN\n", (double)coverage.deltaBytes/coverage.moves, (double)coverage.fenBytes/coverage.moves);
+
+    // a trusted replay of the corpus with and without writing the delta or the FEN of every new position
+    std::vector<std::vector<std::string>> lines;
+    for(const std::string& line : corpus) lines.push_back(splitMoves(line));
+
+    char fen[Board::FEN_BUFFER_SIZE];
+    double perMove[3];
+
+    for(int output = 0; output < 3; output++) {
+        size_t moves = 0;
+        BenchClock::time_point start = BenchClock::now();
+
+        for(int round = 0; round < rounds; round++) {
+            for(const std::vector<std::string>& line : lines) {
+                LegalChess game;
+
+                for(const std::string& move : line) {
+                    game.makeTrustedMove(move, true);
+
+                    if(output == 1) game.writeMoveDelta(record, sizeof(record));
+                    else if(output == 2) game.writeFEN(fen, sizeof(fen));
+
+                    moves++;
+                }
+            }
+        }
+
+        perMove[output] = nanosecondsSince(start)/moves;
+    }
+
+    printf("ns per move on top of a trusted replay: writeMoveDelta %.0f, writeFEN %.0f\n", perMove[1] - perMove[0], perMove[2] - perMove[0]);
+
+    return status;
+}
+
+};
@@ -0,0 +1,156 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <typeinfo>
+
+namespace LC {
+
+namespace {
+
+// what makeMove did with a move: the exception type or the FEN and result after it
+std::string tryMove(LegalChess& game, const std::string& move) {
+    try {
+        game.makeMove(move);
+    }
+    catch(const std::exception& e) {
+        return typeid(e).name();
+    }
+
+    return game.getFENString() + " " + gameResultToString[(int)game.getGameResult()];
+}
+
+std::string squareName(int square) {
+    return {(char)('h' - square%8), (char)('1' + square/8)};
+}
+
+// a position of the corpus without and with computed destinations, and the move played from it
+struct DestinationsPosition {
+    std::unique_ptr<LegalChess> pCold, pWarm;
+    std::string nextMove;
+};
+
+// ns per call of f on every position
+template<class F>
+double timePerPosition(const std::vector<DestinationsPosition>& positions, int rounds, F f) {
+    volatile size_t sink = 0;
+    BenchClock::time_point start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(const DestinationsPosition& position : positions) sink += f(position);
+    }
+
+    return nanosecondsSince(start)/((double)rounds*positions.size());
+}
+
+}
+
+// a game with warm destinations (after a pickup) has to behave like a cold one on every move: same exception type or
+// same state after it, and isLegal has to agree with makeMove
+int runDestinationsBench(const BenchOptions& options) {
+    std::vector<std::string> games = readGames(options.getString("corpus", "UCI.txt"));
+    size_t stride = std::max(1L, options.getInt("stride", 5));
+    int rounds = options.getInt("rounds", 20);
+
+    std::vector<std::unique_ptr<LegalChess>> positions;
+
+    for(const std::string& line : games) {
+        LegalChess game;
+        positions.push_back(game.fork());
+
+        for(const std::string& move : splitMoves(line)) {
+            game.makeTrustedMove(move, true);
+            positions.push_back(game.fork());
+        }
+    }
+
+    BenchChecks checks;
+    size_t candidates = 0;
+
+    for(size_t index = 0; index < positions.size(); index += stride) {
+        const LegalChess& position = *positions[index];
+
+        for(int fromSquare = 0; fromSquare < 64; fromSquare++) {
+            for(int toSquare = 0; toSquare < 64; toSquare++) {
+                for(const char* pSuffix : {"", "q", "n"}) {
+                    std::string move = squareName(fromSquare) + squareName(toSquare) + pSuffix;
+
+                    std::unique_ptr<LegalChess> pCold = position.fork(), pWarm = position.fork();
+                    pWarm->legalDestinations(squareName(fromSquare));
+
+                    bool legal = pWarm->isLegal(move);
+                    std::string cold = tryMove(*pCold, move), warm = tryMove(*pWarm, move);
+
+                    std::string what = "position " + std::to_string(index) + ", move " + move;
+
+                    checks.expect(cold == warm, what + ", warm and cold makeMove");
+                    checks.expect(legal == (cold.find(' ') != std::string::npos), what + ", isLegal against makeMove");
+
+                    candidates++;
+                }
+            }
+        }
+    }
+
+    // a pickup before every move of every game
+    for(const std::string& line : games) {
+        LegalChess validated(line, ReplayMode::VALIDATED), pickedUp;
+
+        for(const std::string& move : splitMoves(line)) {
+            pickedUp.legalDestinations(move.substr(0, 2));
+            pickedUp.makeMove(move);
+        }
+
+        checks.expect(pickedUp.getFENString() == validated.getFENString() && pickedUp.getGameResult() == validated.getGameResult(), "game with pickups " + line.substr(0, 40));
+    }
+
+    int status = checks.report(std::to_string(candidates) + " candidate moves, warm and cold games agree");
+
+    std::vector<DestinationsPosition> timed;
+
+    for(const std::string& line : games) {
+        LegalChess game;
+
+        for(const std::string& move : splitMoves(line)) {
+            timed.push_back({game.fork(), game.fork(), move});
+            timed.back().pWarm->legalDestinations(move.substr(0, 2));
+
+            game.makeTrustedMove(move, true);
+        }
+    }
+
+    // the queries are isLegal, legalDestinations adds the vector of square names. makeMove and the first query run on
+    // a fork to keep the position, its cost is subtracted
+    double coldFork = timePerPosition(timed, rounds, [](const DestinationsPosition& position) {
+        return (size_t)position.pCold->fork()->getMoveNumber();
+    });
+
+    double warmFork = timePerPosition(timed, rounds, [](const DestinationsPosition& position) {
+        return (size_t)position.pWarm->fork()->getMoveNumber();
+    });
+
+    double firstQuery = timePerPosition(timed, rounds, [](const DestinationsPosition& position) {
+        return (size_t)position.pCold->fork()->isLegal(position.nextMove);
+    });
+
+    double warmQuery = timePerPosition(timed, rounds, [](const DestinationsPosition& position) {
+        return (size_t)position.pWarm->isLegal(position.nextMove);
+    });
+
+    double coldMove = timePerPosition(timed, rounds, [](const DestinationsPosition& position) {
+        return (size_t)position.pCold->fork()->makeMove(position.nextMove);
+    });
+
+    double warmMove = timePerPosition(timed, rounds, [](const DestinationsPosition& position) {
+        return (size_t)position.pWarm->fork()->makeMove(position.nextMove);
+    });
+
+    printf("%lu positions, ns per call:\n", (unsigned long)timed.size());
+    printf("  isLegal   first query %.0f, warm %.0f\n", firstQuery - coldFork, warmQuery);
+    printf("  makeMove  cold %.0f, warm %.0f\n", coldMove - coldFork, warmMove - warmFork);
+
+    return status;
+}
+
+};
@@ -0,0 +1,142 @@
+#include "Bench.h"
+#include "MoveExecutor.h"
+
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+namespace LC {
+
+namespace {
+
+enum class ExecutorMode {
+    SERIAL,
+    EXECUTOR,
+    THREAD_PER_BATCH
+};
+
+// live games that each play a corpus game, every batch holds the next movesPerGame moves of every unfinished game
+struct ExecutorRun {
+    std::vector<std::unique_ptr<LegalChess>> games;
+    std::vector<size_t> plies;
+    size_t moves = 0, rejected = 0;
+};
+
+std::vector<GameMove> nextBatch(ExecutorRun& run, const std::vector<std::vector<std::string>>& lines, int movesPerGame) {
+    std::vector<GameMove> batch;
+
+    for(int repeat = 0; repeat < movesPerGame; repeat++) {
+        for(size_t index = 0; index < run.games.size(); index++) {
+            const std::vector<std::string>& line = lines[index % lines.size()];
+            if(run.plies[index] < line.size()) batch.push_back({run.games[index].get(), line[run.plies[index]++]});
+        }
+    }
+
+    return batch;
+}
+
+// moves per second, the final state of every game goes to finals
+double runBatches(const std::vector<std::vector<std::string>>& lines, size_t gameCount, int movesPerGame, ExecutorMode mode, unsigned threads, std::vector<std::string>& finals) {
+    ExecutorRun run;
+
+    for(size_t index = 0; index < gameCount; index++) {
+        run.games.push_back(std::make_unique<LegalChess>());
+        run.plies.push_back(0);
+    }
+
+    std::unique_ptr<MoveExecutor> pExecutor;
+    if(mode == ExecutorMode::EXECUTOR) pExecutor = std::make_unique<MoveExecutor>(threads);
+
+    std::vector<MoveOutcome> outcomes;
+    BenchClock::time_point start = BenchClock::now();
+
+    for(std::vector<GameMove> batch = nextBatch(run, lines, movesPerGame); !batch.empty(); batch = nextBatch(run, lines, movesPerGame)) {
+        run.moves += batch.size();
+
+        if(mode == ExecutorMode::SERIAL) {
+            for(GameMove& move : batch) {
+                try {
+                    move.game->makeMove(move.move);
+                }
+                catch(const std::exception&) {
+                    run.rejected++;
+                }
+            }
+        }
+        else if(mode == ExecutorMode::EXECUTOR) {
+            pExecutor->submitMoves(batch, outcomes);
+            for(const MoveOutcome& outcome : outcomes) run.rejected += !outcome.accepted;
+        }
+        else {
+            // the plain alternative: one std::thread per slice of games for every batch
+            std::vector<std::thread> workers;
+            std::vector<size_t> rejected(threads);
+
+            for(unsigned thread = 0; thread < threads; thread++) {
+                workers.emplace_back([&, thread]() {
+                    for(GameMove& move : batch) {
+                        if(((uintptr_t)move.game >> 4) % threads != thread) continue;
+
+                        try {
+                            move.game->makeMove(move.move);
+                        }
+                        catch(const std::exception&) {
+                            rejected[thread]++;
+                        }
+                    }
+                });
+            }
+
+            for(std::thread& worker : workers) worker.join();
+            for(size_t count : rejected) run.rejected += count;
+        }
+    }
+
+    double seconds = secondsSince(start);
+
+    finals.clear();
+    for(std::unique_ptr<LegalChess>& pGame : run.games) finals.push_back(std::string(gameResultToString[(int)pGame->getGameResult()]) + " " + pGame->getFENString());
+
+    return run.moves/seconds;
+}
+
+}
+
+// games submitted through the executor with several workers, and several moves per game per batch, have to end like
+// a serial loop over the same batches
+int runExecutorBench(const BenchOptions& options) {
+    std::vector<std::string> games = readGames(options.getString("corpus", "UCI.txt"));
+    size_t gameCount = options.getInt("games", 20000);
+
+    std::vector<std::vector<std::string>> lines;
+    for(const std::string& line : games) lines.push_back(splitMoves(line));
+
+    BenchChecks checks;
+
+    printf("%lu games, %u hardware threads, moves/s:\n", (unsigned long)gameCount, std::thread::hardware_concurrency());
+
+    for(int movesPerGame : {1, 4}) {
+        std::vector<std::string> reference, finals;
+
+        printf("  %d move(s) per game per batch\n", movesPerGame);
+        printf("    %-26s %9.0f\n", "serial loop", runBatches(lines, gameCount, movesPerGame, ExecutorMode::SERIAL, 1, reference));
+
+        for(unsigned threads : {1u, 2u, 4u}) {
+            double rate = runBatches(lines, gameCount, movesPerGame, ExecutorMode::EXECUTOR, threads, finals);
+            checks.expect(finals == reference, "executor with " + std::to_string(threads) + " workers, " + std::to_string(movesPerGame) + " moves per game");
+
+            printf("    %-26s %9.0f\n", ("executor, " + std::to_string(threads) + " workers").c_str(), rate);
+        }
+
+        for(unsigned threads : {1u, 2u, 4u}) {
+            double rate = runBatches(lines, gameCount, movesPerGame, ExecutorMode::THREAD_PER_BATCH, threads, finals);
+            checks.expect(finals == reference, "std::thread per batch with " + std::to_string(threads) + " threads, " + std::to_string(movesPerGame) + " moves per game");
+
+            printf("    %-26s %9.0f\n", ("std::thread per batch, " + std::to_string(threads)).c_str(), rate);
+        }
+    }
+
+    return checks.report("same final FEN and result as the serial loop");
+}
+
+};
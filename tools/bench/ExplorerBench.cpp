@@ -0,0 +1,302 @@
+#include "Bench.h"
+#include "OpeningExplorer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+#include <tuple>
+
+namespace LC {
+
+namespace {
+
+const char* const RESULT_TAGS[4] = {"1-0", "1/2-1/2", "0-1", "*"};
+
+// a move played from a position by a game, and how the game ended (an index of RESULT_TAGS)
+struct ReferenceMove {
+    uint64_t key;
+    PackedMove move;
+    int result;
+
+    inline bool operator<(const ReferenceMove& other) const {
+        return std::tie(key, move) < std::tie(other.key, other.move);
+    }
+};
+
+// the counters of every move and the number of games of every position from a brute-force replay, a game counts once
+// per position and once per move from it
+struct ExplorerReference {
+    std::vector<ReferenceMove> moves;
+    std::vector<uint64_t> positions;
+};
+
+ExplorerReference countGames(const std::vector<std::string>& games, int maxDepth) {
+    ExplorerReference reference;
+
+    for(const std::string& line : games) {
+        std::vector<std::string> moves = splitMoves(line);
+        int result = -1;
+
+        if(!moves.empty() && std::find(RESULT_TAGS, RESULT_TAGS + 4, moves.back()) != RESULT_TAGS + 4) {
+            result = (int)(std::find(RESULT_TAGS, RESULT_TAGS + 4, moves.back()) - RESULT_TAGS);
+            moves.pop_back();
+        }
+
+        LegalChess game;
+        std::vector<ReferenceMove> played;
+        bool legal = true;
+
+        for(size_t ply = 0; ply < moves.size(); ply++) {
+            uint64_t key = game.getPositionKey().hash;
+
+            try {
+                game.makeMove(moves[ply]);
+            }
+            catch(const std::exception&) {
+                legal = false;
+                break;
+            }
+
+            if((int)ply < maxDepth) played.push_back({key, packMove(moves[ply]), 0});
+        }
+
+        if(result == -1) {
+            GameResult gameResult = legal ? game.getGameResult() : GameResult::IN_PROGRESS;
+
+            if(gameResult == GameResult::IN_PROGRESS) result = 3;
+            else if(gameResult == GameResult::WHITE_WON_BY_CHECKMATE) result = 0;
+            else if(gameResult == GameResult::BLACK_WON_BY_CHECKMATE) result = 2;
+            else result = 1;
+        }
+
+        std::sort(played.begin(), played.end());
+        played.erase(std::unique(played.begin(), played.end(), [](const ReferenceMove& a, const ReferenceMove& b) {
+            return a.key == b.key && a.move == b.move;
+        }), played.end());
+
+        for(size_t index = 0; index < played.size(); index++) {
+            reference.moves.push_back({played[index].key, played[index].move, result});
+            if(index == 0 || played[index].key != played[index - 1].key) reference.positions.push_back(played[index].key);
+        }
+    }
+
+    std::sort(reference.moves.begin(), reference.moves.end());
+    std::sort(reference.positions.begin(), reference.positions.end());
+
+    return reference;
+}
+
+// every position of at least minGames games has the counters of the reference with the most played move first, the
+// others are left out. returns the number of positions left out although they have minGames move counters
+size_t expectExplorer(BenchChecks& checks, const ExplorerReference& reference, const OpeningExplorer& explorer, uint32_t minGames, const std::string& what) {
+    std::vector<ExplorerMove> found;
+    size_t kept = 0, position = 0, repeated = 0;
+
+    for(size_t start = 0, end = 0; start < reference.moves.size(); start = end) {
+        uint64_t key = reference.moves[start].key;
+        while(end < reference.moves.size() && reference.moves[end].key == key) end++;
+
+        size_t games = 0;
+        while(position < reference.positions.size() && reference.positions[position] <= key) games += reference.positions[position++] == key;
+
+        explorer.find(key, found);
+
+        if(games < minGames) {
+            size_t counters = 1;
+            for(size_t index = start + 1; index < end; index++) counters += reference.moves[index].move != reference.moves[index - 1].move;
+
+            repeated += counters >= minGames;
+            checks.expect(found.empty(), what + ", position " + std::to_string(key) + " of " + std::to_string(games) + " games left out");
+            continue;
+        }
+
+        // the counters of each distinct move
+        std::vector<ExplorerMove> expected;
+
+        for(size_t index = start; index < end; index++) {
+            if(expected.empty() || expected.back().move != reference.moves[index].move) expected.push_back({reference.moves[index].move, 0, 0, 0, 0});
+
+            ExplorerMove& move = expected.back();
+            move.games++;
+            move.whiteWins += reference.moves[index].result == 0;
+            move.draws += reference.moves[index].result == 1;
+            move.blackWins += reference.moves[index].result == 2;
+        }
+
+        bool same = found.size() == expected.size();
+
+        for(size_t index = 0; same && index < found.size(); index++) {
+            auto match = std::find_if(expected.begin(), expected.end(), [&](const ExplorerMove& move) {
+                return move.move == found[index].move;
+            });
+
+            same = match != expected.end() && match->games == found[index].games && match->whiteWins == found[index].whiteWins
+                && match->draws == found[index].draws && match->blackWins == found[index].blackWins
+                && (index == 0 || found[index].games <= found[index - 1].games);
+        }
+
+        checks.expect(same, what + ", position " + std::to_string(key));
+        kept++;
+    }
+
+    checks.expect(explorer.getPositionCount() == kept, what + ", position count");
+
+    return repeated;
+}
+
+// the line with a move of each side and their way back inserted after ply, so the position at ply repeats and the game
+// plays two moves from it. unchanged if no such pair of moves is found
+std::string withRepetition(const std::string& line, size_t ply) {
+    std::vector<std::string> moves = splitMoves(line);
+    if(moves.size() <= ply) return line;
+
+    LegalChess game;
+    for(size_t index = 0; index < ply; index++) game.makeMove(moves[index]);
+
+    auto reverse = [](const std::string& move) {
+        return move.substr(2, 2) + move.substr(0, 2);
+    };
+
+    PackedMove legalMoves[LegalChess::MAX_LEGAL_MOVES];
+    size_t count = game.getLegalMoves(legalMoves);
+
+    for(size_t first = 0; first < count; first++) {
+        std::unique_ptr<LegalChess> pOut = game.fork();
+        std::string out = unpackMove(legalMoves[first]);
+
+        pOut->makeMove(out);
+        if(out.length() != 4 || pOut->getGameResult() != GameResult::IN_PROGRESS) continue;
+
+        PackedMove replies[LegalChess::MAX_LEGAL_MOVES];
+        size_t replyCount = pOut->getLegalMoves(replies);
+
+        for(size_t second = 0; second < replyCount; second++) {
+            std::string reply = unpackMove(replies[second]);
+            if(reply.length() != 4) continue;
+
+            std::unique_ptr<LegalChess> pBack = pOut->fork();
+
+            try {
+                pBack->makeMove(reply);
+                pBack->makeMove(reverse(out));
+                pBack->makeMove(reverse(reply));
+            }
+            catch(const std::exception&) {
+                continue;
+            }
+
+            if(pBack->getPositionKey() != game.getPositionKey()) continue;
+
+            moves.insert(moves.begin() + ply, {out, reply, reverse(out), reverse(reply)});
+
+            std::string repeated = moves[0];
+            for(size_t index = 1; index < moves.size(); index++) repeated += " " + moves[index];
+
+            return repeated;
+        }
+    }
+
+    return line;
+}
+
+// builds the explorer from the games and reports how long it took
+void buildExplorer(const std::vector<std::string>& games, const std::string& path, int maxDepth, uint32_t minGames, unsigned threads, const std::string& label) {
+    std::string corpus;
+    for(const std::string& line : games) corpus += line + "\n";
+
+    std::istringstream stream(corpus);
+    BenchClock::time_point start = BenchClock::now();
+
+    OpeningExplorerStats stats = OpeningExplorer::build(stream, path, maxDepth, minGames, threads);
+
+    struct stat file;
+    stat(path.c_str(), &file);
+
+    printf("  %-22s %5.1fs, %lu positions, %lu moves, %.1f MB\n", label.c_str(), secondsSince(start), (unsigned long)stats.positions, (unsigned long)stats.moves, file.st_size/1e6);
+}
+
+}
+
+// explorers built on 1, 2 and 4 threads, from games with and without result tags, have to hold the counters of a
+// brute-force count of every move and of the distinct games of every position
+int runExplorerBench(const BenchOptions& options) {
+    size_t count = options.getInt("games", 100000);
+    int maxDepth = options.getInt("depth", 30);
+    uint32_t minGames = options.getInt("min-games", 2);
+    std::string path = options.getString("file", "lc_bench_explorer.bin");
+
+    // every 10th game repeats its position at ply 10 and plays another move from it the first time, a position only
+    // this game reached must still be left out. every 50th has an illegal move
+    std::vector<std::string> untagged = generateGames(count, 90, 43);
+
+    for(size_t index = 0; index < untagged.size(); index++) {
+        if(index % 10 == 3) untagged[index] = withRepetition(untagged[index], 10);
+
+        if(index % 50 == 7) {
+            std::vector<std::string> moves = splitMoves(untagged[index]);
+            untagged[index] = moves[0] + " " + moves[1] + " " + moves[0];
+            for(size_t ply = 3; ply < moves.size(); ply++) untagged[index] += " " + moves[ply];
+        }
+    }
+
+    std::mt19937 random(47);
+    std::vector<std::string> tagged = untagged;
+    for(std::string& line : tagged) line += std::string(" ") + RESULT_TAGS[random() % 4];
+
+    BenchChecks checks;
+    ExplorerReference reference = countGames(untagged, maxDepth);
+
+    printf("%lu games, first %d moves, positions of at least %u games:\n", (unsigned long)count, maxDepth, minGames);
+
+    for(unsigned threads : {1u, 2u, 4u}) {
+        buildExplorer(untagged, path, maxDepth, minGames, threads, "untagged, " + std::to_string(threads) + " thread(s)");
+
+        OpeningExplorer explorer;
+        explorer.load(path);
+
+        size_t repeated = expectExplorer(checks, reference, explorer, minGames, "untagged, " + std::to_string(threads) + " thread(s)");
+        checks.expect(repeated != 0, "positions of too few games with enough moves, " + std::to_string(threads) + " thread(s)");
+    }
+
+    buildExplorer(tagged, path, maxDepth, minGames, 0, "tagged");
+
+    OpeningExplorer explorer;
+    explorer.load(path);
+
+    expectExplorer(checks, countGames(tagged, maxDepth), explorer, minGames, "tagged");
+
+    int status = checks.report("counters match a brute-force count");
+
+    // positions of random games before maxDepth
+    std::vector<double> latencies;
+    std::vector<ExplorerMove> moves;
+    size_t hits = 0;
+
+    for(int query = 0; query < 100000; query++) {
+        std::vector<std::string> line = splitMoves(untagged[random() % untagged.size()]);
+        LegalChess game;
+
+        try {
+            for(size_t ply = 0, stop = random() % maxDepth; ply < stop && ply < line.size(); ply++) game.makeMove(line[ply]);
+        }
+        catch(const std::exception&) {
+        }
+
+        uint64_t key = game.getPositionKey().hash;
+        BenchClock::time_point start = BenchClock::now();
+
+        hits += explorer.find(key, moves) != 0;
+        latencies.push_back(nanosecondsSince(start));
+    }
+
+    printf("lookup: median %.0f ns, p99 %.0f ns, %.0f%% of the positions found\n", percentile(latencies, 0.5), percentile(latencies, 0.99), 100.0*hits/latencies.size());
+
+    remove(path.c_str());
+
+    return status;
+}
+
+};
@@ -0,0 +1,141 @@
+#include "Bench.h"
+
+#include <cstdio>
+#include <memory>
+
+namespace LC {
+
+namespace {
+
+std::string describe(LegalChess& game) {
+    return std::string(gameResultToString[(int)game.getGameResult()]) + " " + game.getFENString() + " " + game.getMoveHistory();
+}
+
+std::string joinMoves(const std::vector<std::string>& moves, size_t count) {
+    std::string line;
+
+    for(size_t ply = 0; ply < count; ply++) {
+        if(!line.empty()) line += ' ';
+        line += moves[ply];
+    }
+
+    return line;
+}
+
+// the first legal move, the history chunk of a fork is allocated by its first move
+void makeFirstMove(LegalChess& game) {
+    PackedMove moves[LegalChess::MAX_LEGAL_MOVES];
+    if(game.getLegalMoves(moves) != 0) game.makeMove(unpackMove(moves[0]));
+}
+
+}
+
+// a fork has to continue like a replay of the same moves, and the game it was forked from must not see its moves
+int runForkBench(const BenchOptions& options) {
+    size_t count = options.getInt("games", 200);
+    int plies = options.getInt("plies", 200);
+    int forks = options.getInt("forks", 100);
+    int rounds = options.getInt("rounds", 10);
+
+    std::vector<std::string> games;
+
+    // random games that didn't end before plies
+    for(const std::string& line : generateGames(count*4, plies, 7)) {
+        if(games.size() < count && splitMoves(line).size() == (size_t)plies) games.push_back(line);
+    }
+
+    BenchChecks checks;
+
+    // games of the corpus too, most random games end in a repetition draw if they end at all
+    std::vector<std::string> checked = readGames(options.getString("corpus", "UCI.txt"));
+    checked.insert(checked.end(), games.begin(), games.end());
+    for(const std::string& line : generateGames(1000, 400, 11)) checked.push_back(line);
+
+    for(size_t index = 0; index < checked.size(); index++) {
+        std::vector<std::string> moves = splitMoves(checked[index]);
+        LegalChess replayed(checked[index], ReplayMode::VALIDATED);
+        std::string expected = describe(replayed);
+
+        // a chain of forks every 10 plies, each one continues the game of the previous one
+        LegalChess parent;
+        std::unique_ptr<LegalChess> pGame = parent.fork();
+
+        for(size_t ply = 0; ply < moves.size(); ply++) {
+            if(ply % 10 == 5) {
+                std::unique_ptr<LegalChess> pFork = pGame->fork();
+                std::string before = describe(*pGame);
+
+                pFork->makeMove(moves[ply]);
+                checks.expect(describe(*pGame) == before, "game " + std::to_string(index + 1) + ", parent after a move on its fork at ply " + std::to_string(ply));
+
+                pGame = std::move(pFork);
+            }
+            else pGame->makeMove(moves[ply]);
+        }
+
+        checks.expect(describe(*pGame) == expected, "game " + std::to_string(index + 1) + ", forked every 10 plies");
+        checks.expect(pGame->getMoveHistory() == joinMoves(moves, moves.size()), "game " + std::to_string(index + 1) + ", move history");
+    }
+
+    int status = checks.report(std::to_string(checked.size()) + " games, forks continue like replays");
+
+    std::vector<std::unique_ptr<LegalChess>> live;
+    for(const std::string& line : games) live.push_back(std::make_unique<LegalChess>(line, ReplayMode::VALIDATED));
+
+    // replaying the moves is what opening an analysis board costs without fork
+    BenchClock::time_point start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(const std::string& line : games) LegalChess game(line, ReplayMode::VALIDATED);
+    }
+
+    double validated = secondsSince(start)*1e6/((double)rounds*games.size());
+
+    start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(const std::string& line : games) LegalChess game(line, ReplayMode::TRUSTED);
+    }
+
+    double trusted = secondsSince(start)*1e6/((double)rounds*games.size());
+
+    std::vector<std::unique_ptr<LegalChess>> forked;
+    forked.reserve(live.size()*forks);
+
+    AllocationCounters before = getAllocationCounters();
+    start = BenchClock::now();
+
+    for(int round = 0; round < forks; round++) {
+        for(std::unique_ptr<LegalChess>& pGame : live) forked.push_back(pGame->fork());
+    }
+
+    double fork = secondsSince(start)*1e6/forked.size();
+    AllocationCounters after = getAllocationCounters();
+
+    double forkBytes = (double)(after.liveBytes - before.liveBytes)/forked.size();
+    double forkAllocations = (double)(after.count - before.count)/forked.size();
+
+    before = getAllocationCounters();
+    for(std::unique_ptr<LegalChess>& pFork : forked) makeFirstMove(*pFork);
+    after = getAllocationCounters();
+
+    double firstMoveBytes = (double)(after.liveBytes - before.liveBytes)/forked.size();
+
+    forked.clear();
+    live.clear();
+
+    before = getAllocationCounters();
+    for(const std::string& line : games) live.push_back(std::make_unique<LegalChess>(line, ReplayMode::VALIDATED));
+    after = getAllocationCounters();
+
+    double replayedBytes = (double)(after.liveBytes - before.liveBytes)/games.size();
+
+    printf("%lu games of %d plies:\n", (unsigned long)games.size(), plies);
+    printf("  fork                       %.2f us, %.0f bytes in %.1f allocations, %.0f bytes more after the first move on it\n", fork, forkBytes, forkAllocations, firstMoveBytes);
+    printf("  replay instead of fork     %.0f us validated, %.0f us trusted\n", validated, trusted);
+    printf("  memory of a replayed game  %.0f bytes\n", replayedBytes);
+
+    return status;
+}
+
+};
@@ -0,0 +1,227 @@
+#include "Bench.h"
+#include "GameImporter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <sstream>
+
+namespace LC {
+
+namespace {
+
+std::string joinMoves(const std::vector<std::string>& moves) {
+    std::string line;
+
+    for(const std::string& move : moves) {
+        if(!line.empty()) line += ' ';
+        line += move;
+    }
+
+    return line;
+}
+
+// what a transposition has to share with its first game: placement, side to move, castling rights, the en passant file
+// if a pawn can capture there, the number of plies and the result
+std::string finalPosition(LegalChess& game) {
+    std::istringstream ss(game.getFENString());
+    std::string placement, turn, castling, enpassant;
+    ss >> placement >> turn >> castling >> enpassant;
+
+    if(enpassant != "-") {
+        std::array<char, 64> board = game.getBoardArray();
+        int square = (enpassant[1] - '1')*8 + ('h' - enpassant[0]);
+        int row = square/8 + (turn == "w" ? -1 : 1), col = square%8;
+        char pawn = turn == "w" ? 'P' : 'p';
+
+        if(!((col > 0 && board[row*8 + col - 1] == pawn) || (col < 7 && board[row*8 + col + 1] == pawn))) enpassant = "-";
+    }
+
+    return placement + " " + turn + " " + castling + " " + enpassant + " " + std::to_string(game.getMoveNumber()) + " " + gameResultToString[(int)game.getGameResult()];
+}
+
+// an archive of generated games, transpositions of some of them, corrupted copies of others and copiesPercent of exact
+// copies, shuffled
+std::vector<std::string> buildArchive(size_t count, int copiesPercent, uint64_t seed) {
+    std::vector<std::string> games = generateGames(count, 80, seed);
+    std::vector<std::string> archive = games;
+
+    // white's and black's first two moves swapped, kept if the game stays legal and ends in the same position
+    for(size_t index = 0, added = 0; index < games.size() && added < count/10; index++) {
+        std::vector<std::string> moves = splitMoves(games[index]);
+        if(moves.size() < 4) continue;
+
+        std::vector<std::string> swapped = moves;
+        std::swap(swapped[0], swapped[2]);
+        std::swap(swapped[1], swapped[3]);
+
+        if(swapped == moves) continue;
+
+        try {
+            LegalChess original(games[index], ReplayMode::VALIDATED), transposed(joinMoves(swapped), ReplayMode::VALIDATED);
+
+            if(finalPosition(original) == finalPosition(transposed)) {
+                archive.push_back(joinMoves(swapped));
+                added++;
+            }
+        }
+        catch(const std::exception&) {
+        }
+    }
+
+    // 1% with an illegal move in the middle: the move before it again, from a square it left empty. it has to be a uci
+    // move, a game with a malformed move has no fingerprint and is never a copy
+    for(size_t index = 0; index < count/100; index++) {
+        std::vector<std::string> moves = splitMoves(games[index]);
+        moves[moves.size()/2] = moves[moves.size()/2 - 1];
+        archive.push_back(joinMoves(moves));
+    }
+
+    std::mt19937_64 random(seed);
+    size_t firsts = archive.size(), copies = firsts*copiesPercent/(100 - copiesPercent);
+
+    for(size_t index = 0; index < copies; index++) archive.push_back(archive[random() % firsts]);
+
+    std::shuffle(archive.begin(), archive.end(), random);
+
+    return archive;
+}
+
+// the status of every game from a serial pass in import order that compares move sequences and final positions as text
+void expectStatuses(BenchChecks& checks, const std::vector<std::string>& archive, const std::vector<ImportedGame>& results, const std::string& what) {
+    std::map<std::string, size_t> sequences, positions;
+    std::vector<ImportedGame> expected(archive.size());
+
+    for(size_t index = 0; index < archive.size(); index++) {
+        ImportedGame& game = expected[index];
+        std::string moves = joinMoves(splitMoves(archive[index]));
+
+        auto sequence = sequences.emplace(moves, index);
+
+        if(!sequence.second) {
+            const ImportedGame& first = expected[sequence.first->second];
+
+            game = {first.status == ImportStatus::INVALID ? ImportStatus::INVALID : ImportStatus::DUPLICATE, first.result, sequence.first->second, ""};
+            continue;
+        }
+
+        try {
+            LegalChess replayed(moves, ReplayMode::VALIDATED);
+            auto position = positions.emplace(finalPosition(replayed), index);
+
+            game = {position.second ? ImportStatus::VALID : ImportStatus::TRANSPOSITION, replayed.getGameResult(), position.second ? 0 : position.first->second, ""};
+        }
+        catch(const std::exception&) {
+            game = {ImportStatus::INVALID, GameResult::IN_PROGRESS, index, ""};
+        }
+    }
+
+    for(size_t index = 0; index < archive.size(); index++) {
+        const ImportedGame& game = expected[index];
+        const ImportedGame& result = results[index];
+
+        // the first game of an invalid sequence has no duplicateOf
+        bool firstInvalid = game.status == ImportStatus::INVALID && game.duplicateOf == index;
+
+        checks.expect(result.status == game.status && result.result == game.result && (game.status == ImportStatus::VALID || firstInvalid || result.duplicateOf == game.duplicateOf),
+            what + ", game " + std::to_string(index + 1));
+    }
+}
+
+// the smallest time of f over rounds runs
+template<class F>
+double minSeconds(int rounds, F f) {
+    double best = 1e18;
+
+    for(int round = 0; round < rounds; round++) {
+        BenchClock::time_point start = BenchClock::now();
+        f();
+        best = std::min(best, secondsSince(start));
+    }
+
+    return best;
+}
+
+}
+
+// the importer has to give every game the status of a serial pass that compares moves and final positions as text,
+// whatever the number of threads and however the archive is split into batches
+int runImportBench(const BenchOptions& options) {
+    size_t count = options.getInt("games", 40000);
+    unsigned threads = options.getInt("threads", 0);
+    int rounds = options.getInt("rounds", 3);
+
+    BenchChecks checks;
+    size_t transpositions = 0;
+
+    for(int copiesPercent : {30, 50, 0}) {
+        std::vector<std::string> archive = buildArchive(count, copiesPercent, 31 + copiesPercent);
+        std::string what = std::to_string(copiesPercent) + "% copies";
+
+        size_t bytes = 0;
+        for(const std::string& line : archive) bytes += line.size();
+
+        std::vector<ImportedGame> results;
+        ImportStats stats;
+
+        double import = minSeconds(rounds, [&]() {
+            GameImporter importer(threads);
+            stats = importer.import(archive, results);
+        });
+
+        double validate = minSeconds(rounds, [&]() {
+            for(const std::string& line : archive) {
+                try {
+                    LegalChess game(line, ReplayMode::VALIDATED);
+                }
+                catch(const std::exception&) {
+                }
+            }
+        });
+
+        expectStatuses(checks, archive, results, what);
+        transpositions += stats.transpositions;
+
+        // 7 batches on 3 threads
+        GameImporter batched(3);
+        std::vector<ImportedGame> batch;
+        size_t batchSize = archive.size()/7 + 1;
+
+        for(size_t begin = 0; begin < archive.size(); begin += batchSize) {
+            std::vector<std::string> games(archive.begin() + begin, archive.begin() + std::min(archive.size(), begin + batchSize));
+            batched.import(games, batch);
+
+            for(size_t index = 0; index < games.size(); index++) {
+                const ImportedGame& result = results[begin + index];
+
+                checks.expect(batch[index].status == result.status && batch[index].result == result.result && batch[index].duplicateOf == result.duplicateOf,
+                    what + ", game " + std::to_string(begin + index + 1) + " imported in 7 batches");
+            }
+        }
+
+        printf("%lu games with %d%% copies, %.1f MB: %lu valid, %lu invalid, %lu duplicates, %lu transpositions\n", (unsigned long)archive.size(), copiesPercent,
+            bytes/1e6, (unsigned long)stats.valid, (unsigned long)stats.invalid, (unsigned long)stats.duplicates, (unsigned long)stats.transpositions);
+        printf("  import %.2fs, validating every game %.2fs\n", import, validate);
+
+        if(copiesPercent != 30) continue;
+
+        GameFingerprint fingerprint;
+
+        double fingerprints = minSeconds(5, [&]() {
+            FingerprintSet set;
+
+            for(size_t index = 0; index < archive.size(); index++) {
+                if(fingerprintMoves(archive[index], fingerprint)) set.insert(fingerprint, index);
+            }
+        });
+
+        printf("  fingerprints and set inserts %.2fM games/s, %.0f MB/s\n", archive.size()/fingerprints/1e6, bytes/fingerprints/1e6);
+    }
+
+    checks.expect(transpositions != 0, "transpositions found");
+
+    return checks.report("statuses match a serial pass on 3 archives");
+}
+
+};
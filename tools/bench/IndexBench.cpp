@@ -0,0 +1,179 @@
+#include "Bench.h"
+#include "PositionIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+#include <tuple>
+
+namespace LC {
+
+namespace {
+
+// a posting of the brute-force reference
+struct ReferencePosting {
+    uint64_t key;
+    uint32_t gameId;
+    uint16_t ply;
+
+    inline bool operator<(const ReferencePosting& other) const {
+        return std::tie(key, gameId, ply) < std::tie(other.key, other.gameId, other.ply);
+    }
+};
+
+// builds the index from the games and reports how long it took
+PositionIndexStats buildIndex(const std::string& corpus, const std::string& path, size_t memoryBudget, unsigned threads, const char* pLabel) {
+    std::istringstream games(corpus);
+    BenchClock::time_point start = BenchClock::now();
+
+    PositionIndexStats stats = PositionIndex::build(games, path, memoryBudget, threads);
+
+    struct stat file;
+    stat(path.c_str(), &file);
+
+    printf("  %-28s %5.1fs, %lu runs, %.0f MB (%.1f bytes/posting)\n", pLabel, secondsSince(start), (unsigned long)stats.runs, file.st_size/1e6, (double)file.st_size/stats.postings);
+
+    return stats;
+}
+
+}
+
+// every key of a brute-force replay of the games has to return exactly its postings, in game and ply order, from indexes
+// built in memory and through run files; the key of the FEN has to be the key of the game
+int runIndexBench(const BenchOptions& options) {
+    size_t count = options.getInt("games", 200000);
+    size_t budget = (size_t)options.getInt("budget", 64) << 20;
+    std::string path = options.getString("file", "lc_bench_index.bin");
+
+    // every 50th game repeats a move in the middle, the index stops at the illegal move
+    std::vector<std::string> games = generateGames(count, 100, 37);
+
+    for(size_t index = 49; index < games.size(); index += 50) {
+        std::vector<std::string> moves = splitMoves(games[index]);
+        if(moves.size() < 2) continue;
+
+        moves[moves.size()/2] = moves[moves.size()/2 - 1];
+
+        games[index].clear();
+        for(const std::string& move : moves) games[index] += (games[index].empty() ? "" : " ") + move;
+    }
+
+    std::string corpus;
+    for(const std::string& line : games) corpus += line + "\n";
+
+    BenchChecks checks;
+    std::vector<ReferencePosting> reference;
+    size_t fenKeys = 0;
+
+    for(uint32_t gameId = 0; gameId < games.size(); gameId++) {
+        LegalChess game;
+        uint16_t ply = 0;
+
+        reference.push_back({game.getPositionKey().hash, gameId, ply});
+
+        try {
+            for(const std::string& move : splitMoves(games[gameId])) {
+                game.makeMove(move);
+                reference.push_back({game.getPositionKey().hash, gameId, ++ply});
+
+                // FENs of every 10th game, computing the key of each is slower than the replay
+                if(gameId % 10 == 0) {
+                    checks.expect(PositionIndex::computeKey(game.getFENString()) == game.getPositionKey().hash, "game " + std::to_string(gameId) + ", ply " + std::to_string(ply) + ", key of the FEN");
+                    fenKeys++;
+                }
+            }
+        }
+        catch(const std::exception&) {
+        }
+    }
+
+    std::sort(reference.begin(), reference.end());
+
+    printf("%lu games, %lu postings:\n", (unsigned long)games.size(), (unsigned long)reference.size());
+
+    PositionIndexStats stats;
+    std::vector<PositionPosting> postings;
+
+    for(size_t memoryBudget : {(size_t)1 << 34, budget}) {
+        std::string what = memoryBudget == budget ? "with a " + std::to_string(budget >> 20) + " MB budget" : "in memory";
+        stats = buildIndex(corpus, path, memoryBudget, 0, ("built " + what).c_str());
+
+        PositionIndex index;
+        index.load(path);
+
+        checks.expect(stats.postings == reference.size() && index.getPostingCount() == reference.size(), "posting count, built " + what);
+
+        size_t keys = 0;
+
+        for(size_t start = 0, end = 0; start < reference.size(); start = end) {
+            while(end < reference.size() && reference[end].key == reference[start].key) end++;
+
+            bool same = index.find(reference[start].key, postings) == end - start;
+
+            for(size_t posting = 0; same && posting < postings.size(); posting++) {
+                same = postings[posting].gameId == reference[start + posting].gameId && postings[posting].ply == reference[start + posting].ply;
+            }
+
+            checks.expect(same, "key " + std::to_string(reference[start].key) + ", built " + what);
+            keys++;
+        }
+
+        checks.expect(stats.positions == keys && index.getPositionCount() == keys, "distinct positions, built " + what);
+
+        // random keys that no game reached
+        std::mt19937_64 random(41);
+        size_t hits = 0;
+
+        for(int probe = 0; probe < 1000000; probe++) {
+            uint64_t key = random();
+            ReferencePosting first = {key, 0, 0};
+            auto found = std::lower_bound(reference.begin(), reference.end(), first);
+
+            if(found == reference.end() || found->key != key) hits += index.find(key, postings) != 0;
+        }
+
+        checks.expect(hits == 0, "absent keys, built " + what);
+    }
+
+    buildIndex(corpus, path, budget, 4, ("built on 4 threads, " + std::to_string(budget >> 20) + " MB").c_str());
+
+    int status = checks.report(std::to_string(stats.positions) + " distinct positions, " + std::to_string(fenKeys) + " FEN keys");
+
+    // positions of random games in their first 30 plies
+    PositionIndex index;
+    index.load(path);
+
+    std::mt19937 random(3);
+    std::vector<double> latencies;
+    size_t found = 0;
+
+    for(int query = 0; query < 20000; query++) {
+        std::vector<std::string> moves = splitMoves(games[random() % games.size()]);
+        LegalChess game;
+
+        try {
+            for(size_t ply = 0, stop = random() % 30; ply < stop && ply < moves.size(); ply++) game.makeMove(moves[ply]);
+        }
+        catch(const std::exception&) {
+        }
+
+        BenchClock::time_point start = BenchClock::now();
+        found += index.find(game, postings);
+        latencies.push_back(nanosecondsSince(start)/1e3);
+    }
+
+    printf("query, random position of the first 30 plies: median %.1f us, p99 %.0f us, %.0f postings on average\n", percentile(latencies, 0.5), percentile(latencies, 0.99), (double)found/latencies.size());
+
+    BenchClock::time_point start = BenchClock::now();
+    size_t starting = index.find(LegalChess(), postings);
+
+    printf("starting position: %lu postings in %.1f ms\n", (unsigned long)starting, secondsSince(start)*1e3);
+
+    remove(path.c_str());
+
+    return status;
+}
+
+};
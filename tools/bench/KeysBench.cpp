@@ -0,0 +1,246 @@
+#include "Bench.h"
+#include "Zobrist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace LC {
+
+namespace {
+
+// a position reduced to what its key covers: pieces, side to move, castling rights and the en passant file when a pawn
+// can capture there
+struct KeyedPosition {
+    PositionKey key;
+    std::array<uint8_t, 34> position;
+};
+
+const char* const PIECES = "PNBRQKpnbrqk";
+
+// the key computed from scratch with the Zobrist tables, position gets the reduced position
+PositionKey computeKey(const std::array<char, 64>& board, const std::string& fen, std::array<uint8_t, 34>& position) {
+    std::shared_ptr<const Zobrist> pZobrist = Zobrist::getInstance();
+
+    std::istringstream ss(fen);
+    std::string placement, turn, castling, enpassant;
+    ss >> placement >> turn >> castling >> enpassant;
+
+    bool whiteToMove = turn == "w";
+    int castlingRights = 0;
+
+    if(castling.find('K') != std::string::npos) castlingRights |= 1;
+    if(castling.find('Q') != std::string::npos) castlingRights |= 2;
+    if(castling.find('k') != std::string::npos) castlingRights |= 4;
+    if(castling.find('q') != std::string::npos) castlingRights |= 8;
+
+    // the file only counts if a pawn of the side to move stands next to the pawn that just moved two squares
+    int enpassantFile = 8;
+
+    if(enpassant != "-") {
+        int square = (enpassant[1] - '1')*8 + ('h' - enpassant[0]);
+        int row = square/8 + (whiteToMove ? -1 : 1), col = square%8;
+        char pawn = whiteToMove ? 'P' : 'p';
+
+        if((col > 0 && board[row*8 + col - 1] == pawn) || (col < 7 && board[row*8 + col + 1] == pawn)) enpassantFile = col;
+    }
+
+    Piece grid[8][8];
+    uint64_t extendedHash = 0;
+
+    position.fill(0);
+
+    for(int square = 0; square < 64; square++) {
+        const char* pPiece = board[square] == '.' ? nullptr : strchr(PIECES, board[square]);
+        grid[square/8][square%8] = pPiece ? (Piece)(pPiece - PIECES) : Piece::EMPTY;
+
+        if(pPiece) extendedHash ^= pZobrist->getExtendedPieceKey(grid[square/8][square%8], square);
+
+        position[square/2] |= (uint8_t)((int)grid[square/8][square%8] << (square % 2 == 0 ? 0 : 4));
+    }
+
+    position[32] = (uint8_t)(whiteToMove | (castlingRights << 1));
+    position[33] = (uint8_t)enpassantFile;
+
+    uint64_t hash = pZobrist->computeHash(grid, whiteToMove, castlingRights, enpassantFile);
+    extendedHash ^= pZobrist->getExtendedStateKey(whiteToMove, castlingRights, enpassantFile);
+
+    return {hash, extendedHash};
+}
+
+// pairs of different positions with the same key, positions are distinct
+template<class F>
+size_t countCollisions(std::vector<KeyedPosition>& positions, F key) {
+    std::sort(positions.begin(), positions.end(), [&](const KeyedPosition& a, const KeyedPosition& b) {
+        return key(a) < key(b);
+    });
+
+    size_t pairs = 0;
+
+    for(size_t start = 0, end = 0; start < positions.size(); start = end) {
+        while(end < positions.size() && key(positions[end]) == key(positions[start])) end++;
+        pairs += (end - start)*(end - start - 1)/2;
+    }
+
+    return pairs;
+}
+
+// ns per move of replaying the games, the minimum of 5 runs
+double timeMoves(const std::vector<std::vector<std::string>>& lines, ReplayMode mode) {
+    double best = 1e18;
+
+    for(int run = 0; run < 5; run++) {
+        size_t moves = 0;
+        BenchClock::time_point start = BenchClock::now();
+
+        for(const std::vector<std::string>& line : lines) {
+            LegalChess game;
+
+            for(const std::string& move : line) {
+                if(mode == ReplayMode::VALIDATED) game.makeMove(move);
+                else game.makeTrustedMove(move, false);
+            }
+
+            moves += line.size();
+        }
+
+        best = std::min(best, nanosecondsSince(start)/moves);
+    }
+
+    return best;
+}
+
+}
+
+// the keys the board updates move by move have to match keys computed from scratch, on both move paths. distinct
+// positions then give the collision counts of each lane and of truncated keys against the birthday estimate
+int runKeysBench(const BenchOptions& options) {
+    std::vector<std::string> corpus = readGames(options.getString("corpus", "UCI.txt"));
+    size_t target = options.getInt("positions", 1000000);
+
+#ifdef LC_WIDE_POSITION_KEYS
+    const bool wide = true;
+#else
+    const bool wide = false;
+#endif
+
+    BenchChecks checks;
+    std::vector<KeyedPosition> positions;
+    std::map<std::string, uint64_t> materialKeys, pawnKeys;
+    size_t checked = 0;
+
+    // the corpus, then batches of random games until there are enough positions
+    std::vector<std::string> games = corpus;
+    size_t next = 0;
+
+    for(uint64_t seed = 23; positions.size() < target; seed++) {
+        for(const std::string& line : generateGames(1000, 300, seed)) games.push_back(line);
+
+        for(size_t index = next; index < games.size(); index++) {
+            std::vector<std::string> moves = splitMoves(games[index]);
+
+            for(ReplayMode mode : {ReplayMode::VALIDATED, ReplayMode::TRUSTED}) {
+                LegalChess game;
+
+                for(size_t ply = 0; ply <= moves.size(); ply++) {
+                    std::array<char, 64> board = game.getBoardArray();
+                    KeyedPosition keyed;
+
+                    PositionKey expected = computeKey(board, game.getFENString(), keyed.position);
+                    keyed.key = game.getPositionKey();
+
+                    std::string what = "game " + std::to_string(index + 1) + ", ply " + std::to_string(ply);
+
+                    checks.expect(keyed.key.hash == expected.hash, what + ", hash");
+                    checks.expect(keyed.key.extendedHash == (wide ? expected.extendedHash : 0), what + ", extended hash");
+
+                    // positions with the same material or pawns share the key
+                    std::string material(12, '0'), pawns(64, '.');
+
+                    for(int square = 0; square < 64; square++) {
+                        const char* pPiece = board[square] == '.' ? nullptr : strchr(PIECES, board[square]);
+                        if(pPiece) material[pPiece - PIECES]++;
+                        if(board[square] == 'P' || board[square] == 'p') pawns[square] = board[square];
+                    }
+
+                    checks.expect(materialKeys.emplace(material, game.getMaterialKey()).first->second == game.getMaterialKey(), what + ", material key");
+                    checks.expect(pawnKeys.emplace(pawns, game.getPawnKey()).first->second == game.getPawnKey(), what + ", pawn key");
+
+                    if(mode == ReplayMode::VALIDATED) positions.push_back(keyed);
+                    checked++;
+
+                    if(ply == moves.size()) break;
+
+                    if(mode == ReplayMode::VALIDATED) game.makeMove(moves[ply]);
+                    else game.makeTrustedMove(moves[ply], true);
+                }
+            }
+        }
+
+        next = games.size();
+    }
+
+    // different material or pawns get different keys
+    std::set<uint64_t> distinctMaterial, distinctPawns;
+    for(const auto& entry : materialKeys) distinctMaterial.insert(entry.second);
+    for(const auto& entry : pawnKeys) distinctPawns.insert(entry.second);
+
+    checks.expect(distinctMaterial.size() == materialKeys.size(), "distinct material keys");
+    checks.expect(distinctPawns.size() == pawnKeys.size(), "distinct pawn keys");
+
+    std::sort(positions.begin(), positions.end(), [](const KeyedPosition& a, const KeyedPosition& b) {
+        return a.position < b.position;
+    });
+
+    positions.erase(std::unique(positions.begin(), positions.end(), [](const KeyedPosition& a, const KeyedPosition& b) {
+        return a.position == b.position;
+    }), positions.end());
+
+    size_t full = countCollisions(positions, [](const KeyedPosition& p) { return p.key.hash; });
+    checks.expect(full == 0, "collisions of the 64 bit hash");
+
+    if(wide) {
+        size_t extended = countCollisions(positions, [](const KeyedPosition& p) { return p.key.extendedHash; });
+        checks.expect(extended == 0, "collisions of the 64 bit extended hash");
+    }
+
+    int status = checks.report(std::to_string(checked) + " positions checked, " + std::to_string(materialKeys.size()) + " material signatures, " + std::to_string(pawnKeys.size()) + " pawn structures");
+
+    double n = (double)positions.size();
+    printf("%lu distinct positions (%s keys), colliding pairs:\n", (unsigned long)positions.size(), wide ? "wide" : "narrow");
+    printf("  64 bits  lane 1 %lu\n", (unsigned long)full);
+
+    for(int bits : {32, 40}) {
+        uint64_t mask = (1ULL << bits) - 1;
+        double expected = n*(n - 1)/2/std::ldexp(1.0, bits);
+
+        printf("  %d bits  lane 1 %lu", bits, (unsigned long)countCollisions(positions, [mask](const KeyedPosition& p) { return p.key.hash & mask; }));
+
+        if(wide) {
+            printf(", lane 2 %lu", (unsigned long)countCollisions(positions, [mask](const KeyedPosition& p) { return p.key.extendedHash & mask; }));
+            printf(", half of each %lu", (unsigned long)countCollisions(positions, [bits, mask](const KeyedPosition& p) {
+                return ((p.key.hash & ((1ULL << bits/2) - 1)) | (p.key.extendedHash << bits/2)) & mask;
+            }));
+        }
+
+        printf(", expected %.0f\n", expected);
+    }
+
+    // 200-ply games
+    std::vector<std::vector<std::string>> lines;
+
+    for(const std::string& line : generateGames(500, 200, 29)) {
+        std::vector<std::string> moves = splitMoves(line);
+        if(moves.size() == 200) lines.push_back(moves);
+    }
+
+    printf("200-ply games, ns per move (min of 5): trusted replay %.0f, validated moves %.0f\n", timeMoves(lines, ReplayMode::TRUSTED), timeMoves(lines, ReplayMode::VALIDATED));
+
+    return status;
+}
+
+};
@@ -0,0 +1,97 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+namespace LC {
+
+namespace {
+
+// the best us per game of replaying every game of the corpus rounds times, out of repeats runs
+double timeReplay(const std::vector<std::string>& games, int rounds, int repeats, ReplayMode mode) {
+    double best = 1e18;
+
+    for(int repeat = 0; repeat < repeats; repeat++) {
+        BenchClock::time_point start = BenchClock::now();
+
+        for(int round = 0; round < rounds; round++) {
+            for(const std::string& line : games) LegalChess game(line, mode);
+        }
+
+        best = std::min(best, secondsSince(start)*1e6/((double)rounds*games.size()));
+    }
+
+    return best;
+}
+
+}
+
+// with LC_ENABLE_METRICS every accepted and rejected move is counted once, also by threads that exited, and the counters
+// of an exited thread are reused instead of adding a block per thread. run it in a build with and without the option
+// to compare the replay times
+int runMetricsBench(const BenchOptions& options) {
+    std::vector<std::string> games = readGames(options.getString("corpus", "UCI.txt"));
+    int rounds = options.getInt("rounds", 100), repeats = options.getInt("repeats", 5);
+    int threads = options.getInt("threads", 200);
+
+    BenchChecks checks;
+    bool enabled = Metrics::snapshot().enabled;
+
+    size_t plies = 0;
+    for(const std::string& line : games) plies += splitMoves(line).size();
+
+    if(enabled) {
+        Metrics::reset();
+
+        for(const std::string& line : games) LegalChess game(line, ReplayMode::VALIDATED);
+
+        // a move of the wrong side and a move from an empty square
+        LegalChess game;
+
+        for(const char* pMove : {"e7e5", "e2e4", "e2e4", "f7f6", "d1h5", "g7g6"}) {
+            try {
+                game.makeMove(pMove);
+            }
+            catch(const std::exception&) {
+            }
+        }
+
+        MetricsSnapshot snapshot = Metrics::snapshot();
+
+        checks.expect(snapshot.acceptedMoves == plies + 4, "accepted moves of this thread");
+        checks.expect(snapshot.rejected[(int)RejectReason::PLAYER_TURN] == 1 && snapshot.rejected[(int)RejectReason::EMPTY_SQUARE] == 1, "rejected moves by reason");
+        checks.expect(snapshot.sampledMoves != 0 && snapshot.sampledMoves <= (plies + 6)/32, "one in about 64 moves timed");
+
+        // threads one after the other, each replays one game and exits
+        Metrics::reset();
+        AllocationCounters before = getAllocationCounters();
+
+        for(int thread = 0; thread < threads; thread++) {
+            std::thread([&games, thread]() {
+                LegalChess game(games[thread % games.size()], ReplayMode::VALIDATED);
+            }).join();
+        }
+
+        size_t grown = getAllocationCounters().liveBytes - before.liveBytes;
+        size_t threadPlies = 0;
+
+        for(int thread = 0; thread < threads; thread++) threadPlies += splitMoves(games[thread % games.size()]).size();
+
+        checks.expect(Metrics::snapshot().acceptedMoves == threadPlies, "accepted moves of exited threads");
+        checks.expect(grown < 2*sizeof(Metrics::ThreadCounters), "counters of exited threads reused");
+
+        printf("%d threads: %lu heap bytes kept, %lu per block of counters\n", threads, (unsigned long)grown, (unsigned long)sizeof(Metrics::ThreadCounters));
+    }
+
+    int status = checks.report(enabled ? "metrics count every move" : "metrics are not compiled in, nothing to check");
+
+    double validated = timeReplay(games, rounds, repeats, ReplayMode::VALIDATED);
+    double trusted = timeReplay(games, rounds, repeats, ReplayMode::TRUSTED);
+
+    printf("LC_ENABLE_METRICS %s: validated %.1f us/game, trusted %.1f us/game, best of %d runs\n", enabled ? "on" : "off", validated, trusted, repeats);
+
+    return status;
+}
+
+};
@@ -0,0 +1,153 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace LC {
+
+namespace {
+
+// the squares of a FEN placement in the order of getBoardArray, empty if it is malformed
+std::string parsePlacement(const std::string& fen) {
+    std::string board(64, '.');
+    int rank = 7, file = 0;
+
+    for(char c : fen.substr(0, fen.find(' '))) {
+        if(c == '/') {
+            if(file != 8) return "";
+
+            rank--;
+            file = 0;
+        }
+        else if(c >= '1' && c <= '8') file += c - '0';
+        else {
+            if(rank < 0 || file > 7) return "";
+
+            board[rank*8 + 7 - file] = c;
+            file++;
+        }
+    }
+
+    return rank == 0 && file == 8 ? board : "";
+}
+
+// calls per second of f on every game, and allocations per call
+template<class F>
+void timeOutput(const char* pName, std::vector<std::unique_ptr<LegalChess>>& games, int rounds, F f) {
+    volatile size_t sink = 0;
+
+    AllocationCounters before = getAllocationCounters();
+    BenchClock::time_point start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(std::unique_ptr<LegalChess>& pGame : games) sink += f(*pGame);
+    }
+
+    double seconds = secondsSince(start);
+    AllocationCounters after = getAllocationCounters();
+    double calls = (double)rounds*games.size();
+
+    printf("  %-14s %6.1fM calls/s, %.1f allocations/call\n", pName, calls/seconds/1e6, (after.count - before.count)/calls);
+}
+
+}
+
+// the FEN of every position has to parse back to the board, writeFEN has to match getFENString and handle short
+// buffers like snprintf, and writeJSON has to carry the same FEN
+int runOutputBench(const BenchOptions& options) {
+    std::vector<std::string> corpus = readGames(options.getString("corpus", "UCI.txt"));
+    int rounds = options.getInt("rounds", 2000);
+
+    std::vector<std::string> games = corpus;
+    for(const std::string& line : generateGames(1000, 200, 13)) games.push_back(line);
+
+    BenchChecks checks;
+    size_t positions = 0;
+    char fen[Board::FEN_BUFFER_SIZE], json[Board::JSON_BUFFER_SIZE];
+
+    for(size_t index = 0; index < games.size(); index++) {
+        LegalChess game;
+
+        for(const std::string& move : splitMoves(games[index])) {
+            game.makeMove(move);
+
+            std::string expected = game.getFENString();
+            std::array<char, 64> board = game.getBoardArray();
+            std::string what = "game " + std::to_string(index + 1) + ", ply " + std::to_string(game.getMoveNumber());
+
+            size_t length = game.writeFEN(fen, sizeof(fen));
+            size_t jsonLength = game.writeJSON(json, sizeof(json));
+
+            checks.expect(parsePlacement(expected) == std::string(board.begin(), board.end()), what + ", placement");
+            checks.expect(length == expected.length() && expected == fen, what + ", writeFEN");
+            checks.expect(jsonLength < sizeof(json) && strstr(json, ("\"fen\":\"" + expected + "\"").c_str()) != nullptr, what + ", writeJSON");
+
+            // one byte short of the NUL only writes the NUL
+            char shortBuffer[Board::FEN_BUFFER_SIZE];
+            memset(shortBuffer, 'x', sizeof(shortBuffer));
+
+            checks.expect(game.writeFEN(shortBuffer, length) == length && shortBuffer[0] == 0, what + ", writeFEN into a short buffer");
+
+            positions++;
+        }
+    }
+
+    int status = checks.report(std::to_string(positions) + " positions");
+
+    // 200-ply games, a server broadcasting a position to spectators reads it many times between moves
+    std::vector<std::unique_ptr<LegalChess>> live;
+
+    for(const std::string& line : generateGames(1000, 200, 17)) {
+        if(splitMoves(line).size() == 200) live.push_back(std::make_unique<LegalChess>(line, ReplayMode::VALIDATED));
+    }
+
+    printf("%lu games of 200 plies:\n", (unsigned long)live.size());
+
+    timeOutput("getFENString", live, rounds, [](LegalChess& game) {
+        return game.getFENString().length();
+    });
+
+    timeOutput("writeFEN", live, rounds, [&fen](LegalChess& game) {
+        return game.writeFEN(fen, sizeof(fen));
+    });
+
+    timeOutput("writeJSON", live, rounds, [&json](LegalChess& game) {
+        return game.writeJSON(json, sizeof(json));
+    });
+
+    timeOutput("getBoardArray", live, rounds, [](LegalChess& game) {
+        return (size_t)game.getBoardArray()[0];
+    });
+
+    timeOutput("getBoard", live, rounds, [](LegalChess& game) {
+        return (size_t)game.getBoard()[0][0];
+    });
+
+    // every move of the corpus followed by 10 reads of the FEN
+    std::vector<std::vector<std::string>> lines;
+    for(const std::string& line : corpus) lines.push_back(splitMoves(line));
+
+    BenchClock::time_point start = BenchClock::now();
+    size_t moves = 0;
+
+    for(int round = 0; round < std::max(rounds/100, 1); round++) {
+        for(const std::vector<std::string>& line : lines) {
+            LegalChess game;
+
+            for(const std::string& move : line) {
+                game.makeMove(move);
+                for(int read = 0; read < 10; read++) game.getFENString();
+
+                moves++;
+            }
+        }
+    }
+
+    printf("move + 10 FEN reads: %.2f us per move\n", secondsSince(start)*1e6/moves);
+
+    return status;
+}
+
+};
@@ -0,0 +1,183 @@
+#include "Bench.h"
+
+#include <cstdio>
+#include <sstream>
+
+namespace LC {
+
+namespace {
+
+struct PerftPosition {
+    const char* pFEN;
+    int depth;
+    uint64_t nodes;
+};
+
+// the standard perft positions (start, kiwipete and positions 3 to 6) with their reference node counts
+const PerftPosition PERFT_POSITIONS[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 3, 89890},
+};
+
+struct PerftCount {
+    uint64_t nodes = 0;
+    uint64_t mates = 0;
+};
+
+void loadFEN(Board& board, const std::string& fen) {
+    std::stringstream ss(fen);
+    std::string placement, turn, castling, enpassant;
+    int halfMoves = 0, fullMoves = 1;
+
+    ss >> placement >> turn >> castling >> enpassant >> halfMoves >> fullMoves;
+
+    BoardSnapshot snapshot = {};
+    const char* pPieces = "PNBRQKpnbrqk";
+
+    for(int square = 0; square < 64; square++) snapshot.grid[square] = (uint8_t)Piece::EMPTY;
+
+    // ranks from 8, files from a
+    int rank = 7, file = 0;
+
+    for(char c : placement) {
+        if(c == '/') {
+            rank--;
+            file = 0;
+        }
+        else if(c >= '1' && c <= '8') file += c - '0';
+        else {
+            for(int piece = 0; piece < 12; piece++) {
+                if(pPieces[piece] == c) snapshot.grid[rank*8 + 7 - file] = (uint8_t)piece;
+            }
+
+            file++;
+        }
+    }
+
+    snapshot.isWhiteTurn = turn == "w";
+    snapshot.enpassantSquare = enpassant == "-" ? 64 : (enpassant[1] - '1')*8 + ('h' - enpassant[0]);
+    snapshot.halfMovesCount = halfMoves;
+    snapshot.movesCount = (fullMoves - 1)*2 + (turn == "w" ? 0 : 1);
+
+    for(char c : castling) {
+        if(c == 'K') snapshot.castlingRights |= 1;
+        if(c == 'Q') snapshot.castlingRights |= 2;
+        if(c == 'k') snapshot.castlingRights |= 4;
+        if(c == 'q') snapshot.castlingRights |= 8;
+    }
+
+    board.loadSnapshot(snapshot);
+}
+
+// counts the leaves depth plies below the position and the checkmates among them. the moves come from
+// getLegalMoves, the mates from the result detection run on the last ply
+void perft(Board& board, int depth, PerftCount& count) {
+    PackedMove moves[Board::MAX_LEGAL_MOVES];
+    size_t legalCount = board.getLegalMoves(moves);
+
+    for(size_t i = 0; i < legalCount; i++) {
+        int fromSquare = moves[i] & 63, toSquare = (moves[i] >> 6) & 63, promotion = (moves[i] >> 12) & 7;
+        std::string uciMove = unpackMove(moves[i]);
+        Move move(fromSquare/8, fromSquare%8, toSquare/8, toSquare%8, fromSquare, toSquare, uciMove);
+
+        MoveUndo undo;
+        board.applyTrustedMove(move, promotion == 0 ? 0 : " nbrq"[promotion], depth == 1, undo);
+
+        if(depth == 1) {
+            count.nodes++;
+
+            GameResult result = board.getGameResult();
+            if(result == GameResult::WHITE_WON_BY_CHECKMATE || result == GameResult::BLACK_WON_BY_CHECKMATE) count.mates++;
+        }
+        else perft(board, depth - 1, count);
+
+        board.unmakeMove(undo);
+    }
+}
+
+// ns per detectGameResult call on copies of the positions
+double timeDetection(const std::vector<Board>& positions, int rounds) {
+    if(positions.empty()) return 0;
+
+    std::vector<Board> boards = positions;
+    BenchClock::time_point start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(Board& board : boards) {
+            board.setGameResult(GameResult::IN_PROGRESS);
+            board.detectGameResult();
+        }
+    }
+
+    return nanosecondsSince(start)/((double)rounds*boards.size());
+}
+
+}
+
+// the legal move generator and the mate and stalemate detection (hasAnyLegalMove) against the reference perft counts,
+// then the cost of the detection by outcome of the position
+int runPerftBench(const BenchOptions& options) {
+    std::vector<std::string> games = readGames(options.getString("corpus", "UCI.txt"));
+    int rounds = options.getInt("rounds", 200);
+
+    BenchChecks checks;
+
+    for(const PerftPosition& position : PERFT_POSITIONS) {
+        Board board;
+        loadFEN(board, position.pFEN);
+
+        PerftCount count;
+        perft(board, position.depth, count);
+
+        printf("depth %d: %llu nodes  %s\n", position.depth, (unsigned long long)count.nodes, position.pFEN);
+        checks.expect(count.nodes == position.nodes, std::string("perft of ") + position.pFEN);
+    }
+
+    Board start;
+    PerftCount count;
+    perft(start, 5, count);
+
+    printf("start position depth 5: %llu nodes, %llu mates\n", (unsigned long long)count.nodes, (unsigned long long)count.mates);
+    checks.expect(count.nodes == 4865609 && count.mates == 347, "perft of the start position at depth 5");
+
+    int status = checks.report("perft");
+
+    // every position of the corpus, grouped by what the detection finds
+    std::vector<Board> quiet, inCheck, checkmate, stalemate;
+
+    for(const std::string& line : games) {
+        Board board;
+
+        for(const std::string& uciMove : splitMoves(line)) {
+            PackedMove packed = packMove(uciMove);
+            int fromSquare = packed & 63, toSquare = (packed >> 6) & 63;
+            Move move(fromSquare/8, fromSquare%8, toSquare/8, toSquare%8, fromSquare, toSquare, uciMove);
+
+            board.applyTrustedMove(move, uciMove.size() == 5 ? uciMove[4] : 0, false);
+
+            Board detected = board;
+            detected.detectGameResult();
+
+            GameResult result = detected.getGameResult();
+
+            if(result == GameResult::WHITE_WON_BY_CHECKMATE || result == GameResult::BLACK_WON_BY_CHECKMATE) checkmate.push_back(board);
+            else if(result == GameResult::STALEMATE) stalemate.push_back(board);
+            else if(board.isKingUnderCheck(board.isWhiteTurn)) inCheck.push_back(board);
+            else quiet.push_back(board);
+        }
+    }
+
+    printf("detectGameResult, ns per call:\n");
+    printf("  quiet      (%5lu) %6.0f\n", (unsigned long)quiet.size(), timeDetection(quiet, rounds));
+    printf("  in check   (%5lu) %6.0f\n", (unsigned long)inCheck.size(), timeDetection(inCheck, rounds));
+    printf("  checkmate  (%5lu) %6.0f\n", (unsigned long)checkmate.size(), timeDetection(checkmate, rounds*100));
+    printf("  stalemate  (%5lu) %6.0f\n", (unsigned long)stalemate.size(), timeDetection(stalemate, rounds*100));
+
+    return status;
+}
+
+};
@@ -0,0 +1,52 @@
+#include "Bench.h"
+
+#include <cstdio>
+
+namespace LC {
+
+namespace {
+
+// us per game of replaying every game of the corpus rounds times
+double timeReplay(const std::vector<std::string>& games, int rounds, ReplayMode mode) {
+    BenchClock::time_point start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(const std::string& line : games) LegalChess game(line, mode);
+    }
+
+    return secondsSince(start)*1e6/((double)rounds*games.size());
+}
+
+}
+
+// trusted replay skips the legality checks and detects the result on the last position only, it has to end in the
+// state of a validated replay
+int runReplayBench(const BenchOptions& options) {
+    std::vector<std::string> games = readGames(options.getString("corpus", "UCI.txt"));
+    int rounds = options.getInt("rounds", 200);
+
+    BenchChecks checks;
+
+    for(size_t index = 0; index < games.size(); index++) {
+        LegalChess validated(games[index], ReplayMode::VALIDATED);
+        LegalChess trusted(games[index], ReplayMode::TRUSTED);
+        LegalChess everyPly(games[index], ReplayMode::TRUSTED, true);
+
+        std::string fen = validated.getFENString();
+        std::string what = "game " + std::to_string(index + 1);
+
+        checks.expect(trusted.getFENString() == fen && trusted.getGameResult() == validated.getGameResult(), what + ", trusted replay");
+        checks.expect(everyPly.getFENString() == fen && everyPly.getGameResult() == validated.getGameResult(), what + ", trusted replay with detection on every ply");
+    }
+
+    int status = checks.report(std::to_string(games.size()) + " games, same FEN and result in all three modes");
+
+    double validated = timeReplay(games, rounds, ReplayMode::VALIDATED);
+    double trusted = timeReplay(games, rounds, ReplayMode::TRUSTED);
+
+    printf("validated %.1f us/game, trusted %.1f us/game (%.1fx)\n", validated, trusted, validated/trusted);
+
+    return status;
+}
+
+};
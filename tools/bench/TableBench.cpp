@@ -0,0 +1,283 @@
+#include "Bench.h"
+#include "GameTable.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+
+namespace LC {
+
+namespace {
+
+std::string describe(const LegalChess& game) {
+    LegalChess& state = const_cast<LegalChess&>(game);
+    return std::string(gameResultToString[(int)state.getGameResult()]) + " " + state.getFENString() + " " + game.getMoveHistory();
+}
+
+// the sweeps of the table computed from each game: in check, material balance, half moves and repetitions
+struct TableReference {
+    std::vector<size_t> checks;
+    std::vector<int> balances;
+    std::vector<int> halfMoves;
+    std::vector<int> repetitions;
+};
+
+int materialBalance(const LegalChess& game) {
+    int balance = 0;
+
+    for(char piece : game.getBoardArray()) {
+        int value = 0;
+
+        switch(piece | 0x20) {
+            case 'p': value = 1; break;
+            case 'n': case 'b': value = 3; break;
+            case 'r': value = 5; break;
+            case 'q': value = 9; break;
+        }
+
+        balance += piece == '.' ? 0 : (piece & 0x20) ? -value : value;
+    }
+
+    return balance;
+}
+
+// the half move clock, the fifth field of the FEN
+int halfMoveClock(const LegalChess& game) {
+    char fen[Board::FEN_BUFFER_SIZE];
+    game.writeFEN(fen, sizeof(fen));
+
+    const char* pField = fen;
+    for(int field = 0; field < 4; field++) pField = strchr(pField, ' ') + 1;
+
+    return atoi(pField);
+}
+
+// a validated replay of every game, repetitions counted from the keys since the last capture or pawn move. like the
+// draw rule they count the positions reached by a move, not the start position
+TableReference computeReference(const std::vector<std::string>& lines) {
+    TableReference reference;
+    std::vector<uint64_t> keys;
+
+    for(size_t row = 0; row < lines.size(); row++) {
+        LegalChess game;
+        keys.clear();
+
+        for(const std::string& move : splitMoves(lines[row])) {
+            game.makeMove(move);
+
+            if(halfMoveClock(game) == 0) keys.clear();
+            keys.push_back(game.getPositionKey().hash);
+        }
+
+        MoveDelta delta;
+        bool check = game.getLastMoveDelta(delta) && delta.checkType != CheckType::NO_CHECK;
+
+        if(check && game.getGameResult() == GameResult::IN_PROGRESS) reference.checks.push_back(row);
+
+        reference.balances.push_back(materialBalance(game));
+        reference.halfMoves.push_back(halfMoveClock(game));
+        reference.repetitions.push_back(game.getMoveNumber() == 0 ? 0 : std::count(keys.begin(), keys.end(), keys.back()));
+    }
+
+    return reference;
+}
+
+// the best of rounds runs of sweep, in ms
+template<class F>
+double timeSweep(int rounds, F sweep) {
+    double best = 1e18;
+
+    for(int round = 0; round < rounds; round++) {
+        BenchClock::time_point start = BenchClock::now();
+        sweep();
+        best = std::min(best, secondsSince(start));
+    }
+
+    return best*1e3;
+}
+
+}
+
+// the sweeps of a table filled from random games have to give the checks, material and clocks of each game, and games
+// continued through the table or copied into it with updateGame have to end in the FEN, history and result of the same
+// games continued on their own
+int runTableBench(const BenchOptions& options) {
+    size_t count = options.getInt("games", 1000000);
+    int plies = options.getInt("plies", 120);
+    int minHalfMoves = options.getInt("half-moves", 20), minRepetitions = options.getInt("repetitions", 2);
+    int rounds = options.getInt("rounds", 5);
+
+    // random games cut after 0 to plies plies
+    std::vector<std::string> lines = generateGames(count, plies, 71);
+    std::mt19937 random(73);
+
+    for(std::string& line : lines) {
+        std::vector<std::string> moves = splitMoves(line);
+        moves.resize(std::min(moves.size(), (size_t)(random() % (plies + 1))));
+
+        line.clear();
+        for(const std::string& move : moves) line += (line.empty() ? "" : " ") + move;
+    }
+
+    AllocationCounters before = getAllocationCounters();
+    std::vector<std::unique_ptr<LegalChess>> games;
+
+    for(const std::string& line : lines) games.push_back(std::make_unique<LegalChess>(line, ReplayMode::TRUSTED));
+
+    size_t objectBytes = getAllocationCounters().liveBytes - before.liveBytes;
+
+    GameTable table;
+    table.reserve(games.size());
+
+    for(const std::unique_ptr<LegalChess>& pGame : games) table.addGame(*pGame);
+
+    BenchChecks checks;
+    TableReference reference = computeReference(lines);
+    size_t inProgress = 0, byHalfMoves = 0, byRepetitions = 0;
+
+    std::vector<size_t> nearDraws;
+
+    for(size_t row = 0; row < games.size(); row++) {
+        std::string what = "game " + std::to_string(row + 1);
+        bool playing = games[row]->getGameResult() == GameResult::IN_PROGRESS;
+
+        checks.expect(table.getHalfMovesColumn()[row] == reference.halfMoves[row] && table.getRepetitionColumn()[row] == reference.repetitions[row], what + ", clocks");
+        checks.expect(table.getMoveNumberColumn()[row] == games[row]->getMoveNumber() && table.getResultColumn()[row] == games[row]->getGameResult(), what + ", move number and result");
+
+        inProgress += playing;
+        byHalfMoves += playing && reference.halfMoves[row] >= minHalfMoves;
+        byRepetitions += playing && reference.repetitions[row] >= minRepetitions;
+
+        if(playing && (reference.halfMoves[row] >= minHalfMoves || reference.repetitions[row] >= minRepetitions)) nearDraws.push_back(row);
+    }
+
+    std::vector<size_t> rows;
+    std::vector<int> balances;
+
+    table.findChecks(rows);
+    checks.expect(rows == reference.checks, "in check");
+
+    table.computeMaterialBalance(balances);
+    checks.expect(balances == reference.balances, "material balance");
+
+    table.findNearDraws(minHalfMoves, minRepetitions, rows);
+    checks.expect(rows == nearDraws && byHalfMoves != 0 && byRepetitions != 0, "near draws");
+
+    printf("%lu random games of 0 to %d plies, %lu in progress, %lu in check, %lu near draws (%lu by %d+ half moves, %lu by %d+ occurrences)\n",
+        (unsigned long)games.size(), plies, (unsigned long)inProgress, (unsigned long)reference.checks.size(), (unsigned long)nearDraws.size(),
+        (unsigned long)byHalfMoves, minHalfMoves, (unsigned long)byRepetitions, minRepetitions);
+
+    // the same sweeps over a unique_ptr<LegalChess> per game. the games have no repetition count, their near draws only
+    // read the half move clock
+    double objectChecks = timeSweep(rounds, [&]() {
+        rows.clear();
+
+        for(size_t row = 0; row < games.size(); row++) {
+            MoveDelta delta;
+            if(games[row]->getGameResult() == GameResult::IN_PROGRESS && games[row]->getLastMoveDelta(delta) && delta.checkType != CheckType::NO_CHECK) rows.push_back(row);
+        }
+    });
+
+    double objectMaterial = timeSweep(rounds, [&]() {
+        balances.resize(games.size());
+        for(size_t row = 0; row < games.size(); row++) balances[row] = materialBalance(*games[row]);
+    });
+
+    double objectHalfMoves = timeSweep(rounds, [&]() {
+        rows.clear();
+
+        for(size_t row = 0; row < games.size(); row++) {
+            if(games[row]->getGameResult() == GameResult::IN_PROGRESS && halfMoveClock(*games[row]) >= minHalfMoves) rows.push_back(row);
+        }
+    });
+
+    printf("  %-36s %12s %12s\n", "sweep", "objects", "game table");
+    printf("  %-36s %9.1f ms %9.1f ms\n", "side to move in check", objectChecks, timeSweep(rounds, [&]() { table.findChecks(rows); }));
+    printf("  %-36s %9.1f ms %9.1f ms\n", "material balance", objectMaterial, timeSweep(rounds, [&]() { table.computeMaterialBalance(balances); }));
+    printf("  %-36s %9.1f ms %9.1f ms\n", "near draws, half moves only", objectHalfMoves, timeSweep(rounds, [&]() { table.findNearDraws(minHalfMoves, 256, rows); }));
+    printf("  %-36s %12s %9.1f ms\n", "near draws, half moves and repetitions", "n/a", timeSweep(rounds, [&]() { table.findNearDraws(minHalfMoves, minRepetitions, rows); }));
+    printf("memory: %.0f bytes/game in the columns, %.0f bytes/game for the objects\n", (double)table.getMemoryUsage()/table.size(), (double)objectBytes/games.size());
+
+    // games in progress continued a move at a time in turn, so every move on the table loads its row
+    std::vector<size_t> continued;
+
+    for(size_t row = random() % 100; row < games.size() && continued.size() < (size_t)options.getInt("continued", 2000); row += 1 + random() % 100) {
+        if(games[row]->getGameResult() == GameResult::IN_PROGRESS) continued.push_back(row);
+    }
+
+    std::vector<double> tableLatencies, objectLatencies;
+
+    for(int ply = 0; ply < 40; ply++) {
+        for(size_t row : continued) {
+            if(games[row]->getGameResult() != GameResult::IN_PROGRESS) continue;
+
+            PackedMove moves[LegalChess::MAX_LEGAL_MOVES];
+            std::string move = unpackMove(moves[random() % games[row]->getLegalMoves(moves)]);
+
+            BenchClock::time_point start = BenchClock::now();
+            table.makeMove(row, move);
+            tableLatencies.push_back(nanosecondsSince(start));
+
+            start = BenchClock::now();
+            games[row]->makeMove(move);
+            objectLatencies.push_back(nanosecondsSince(start));
+        }
+    }
+
+    // one more move on each game itself, copied into its row
+    std::vector<double> updateLatencies;
+
+    for(size_t row : continued) {
+        if(games[row]->getGameResult() != GameResult::IN_PROGRESS) continue;
+
+        PackedMove moves[LegalChess::MAX_LEGAL_MOVES];
+        games[row]->makeMove(unpackMove(moves[random() % games[row]->getLegalMoves(moves)]));
+
+        BenchClock::time_point start = BenchClock::now();
+        table.updateGame(row, *games[row]);
+        updateLatencies.push_back(nanosecondsSince(start));
+    }
+
+    for(size_t row : continued) checks.expect(describe(table.getGame(row)) == describe(*games[row]), "continued game " + std::to_string(row + 1));
+
+    printf("%lu games continued for up to 40 plies: makeMove median %.0f ns on the table, %.0f ns on the game, updateGame median %.0f ns\n",
+        (unsigned long)continued.size(), percentile(tableLatencies, 0.5), percentile(objectLatencies, 0.5), percentile(updateLatencies, 0.5));
+
+    // an illegal move leaves the row as it was, a row past the end throws
+    size_t row = continued.front();
+    std::string expected = describe(table.getGame(row));
+    bool rejected = false, outside = false;
+
+    table.getGame(continued.back());
+
+    try {
+        table.makeMove(row, "a1a1");
+    }
+    catch(const std::exception&) {
+        rejected = true;
+    }
+
+    try {
+        table.makeMove(table.size(), "e2e4");
+    }
+    catch(const GameTableException&) {
+        outside = true;
+    }
+
+    checks.expect(rejected && describe(table.getGame(row)) == expected, "illegal move leaves the row");
+    checks.expect(outside, "row past the end");
+
+    // the last game takes the row of a removed one
+    size_t size = table.size();
+    std::string last = describe(table.getGame(size - 1));
+
+    table.removeGame(row);
+    checks.expect(table.size() == size - 1 && describe(table.getGame(row)) == last, "removed row");
+
+    return checks.report("sweeps and continued games match the games");
+}
+
+};
@@ -0,0 +1,200 @@
+#include "Bench.h"
+#include "GameTimeline.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+
+namespace LC {
+
+namespace {
+
+std::string describe(const LegalChess& game) {
+    LegalChess& state = const_cast<LegalChess&>(game);
+    return std::string(gameResultToString[(int)state.getGameResult()]) + " " + state.getFENString() + " " + game.getMoveHistory();
+}
+
+// the position, history and legal moves of the timeline at ply against a validated replay of the first ply moves
+bool sameAsReplay(const LegalChess& game, const std::vector<std::string>& moves, int ply) {
+    LegalChess replayed;
+    for(int index = 0; index < ply; index++) replayed.makeMove(moves[index]);
+
+    PackedMove found[LegalChess::MAX_LEGAL_MOVES], expected[LegalChess::MAX_LEGAL_MOVES];
+    size_t foundCount = game.getLegalMoves(found), expectedCount = replayed.getLegalMoves(expected);
+
+    if(describe(game) != describe(replayed) || game.getPositionKey() != replayed.getPositionKey()) return false;
+    if(foundCount != expectedCount || !std::equal(found, found + foundCount, expected)) return false;
+
+    // a repetition only counts if the seek has the history of the ply: playing on has to end the same way
+    std::unique_ptr<LegalChess> pFork = game.fork();
+
+    for(size_t index = ply; index < moves.size() && pFork->getGameResult() == GameResult::IN_PROGRESS; index++) {
+        pFork->makeMove(moves[index]);
+        replayed.makeMove(moves[index]);
+    }
+
+    return describe(*pFork) == describe(replayed);
+}
+
+// ns per loadSnapshot of positions along a random walk
+double timeLoadSnapshot(int rounds) {
+    std::vector<BoardSnapshot> snapshots;
+    Board board;
+    std::mt19937 random(61);
+
+    for(int ply = 0; ply < 300; ply++) {
+        PackedMove moves[Board::MAX_LEGAL_MOVES];
+        size_t count = board.getLegalMoves(moves);
+        if(count == 0) break;
+
+        PackedMove packed = moves[random() % count];
+        int fromSquare = packed & 63, toSquare = (packed >> 6) & 63, promotion = (packed >> 12) & 7;
+        Move move(fromSquare/8, fromSquare%8, toSquare/8, toSquare%8, fromSquare, toSquare, unpackMove(packed));
+
+        board.applyTrustedMove(move, promotion == 0 ? 0 : " nbrq"[promotion], true);
+
+        snapshots.emplace_back();
+        board.saveSnapshot(snapshots.back());
+    }
+
+    BenchClock::time_point start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(const BoardSnapshot& snapshot : snapshots) board.loadSnapshot(snapshot);
+    }
+
+    return nanosecondsSince(start)/((double)rounds*snapshots.size());
+}
+
+}
+
+// a seek to any ply, in any order, has to give the position, history and legal moves of a validated replay, for every
+// checkpoint interval, on timelines built at once and move by move
+int runTimelineBench(const BenchOptions& options) {
+    size_t count = options.getInt("games", 200);
+    int plies = options.getInt("plies", 300);
+
+    // random games that didn't end before plies
+    std::vector<std::vector<std::string>> games;
+
+    for(const std::string& line : generateGames(count*4, plies, 59)) {
+        std::vector<std::string> moves = splitMoves(line);
+        if(games.size() < count && moves.size() == (size_t)plies) games.push_back(moves);
+    }
+
+    BenchChecks checks;
+    std::mt19937 random(67);
+
+    printf("%lu random games of %d plies:\n", (unsigned long)games.size(), plies);
+    printf("  %-3s %10s %10s %10s %10s %10s\n", "K", "bytes/ply", "seek p50", "seek p99", "next", "previous");
+
+    for(int interval : {1, 8, 32}) {
+        std::vector<std::unique_ptr<GameTimeline>> timelines;
+        size_t memory = 0;
+
+        for(const std::vector<std::string>& moves : games) {
+            std::string line = moves[0];
+            for(size_t ply = 1; ply < moves.size(); ply++) line += " " + moves[ply];
+
+            timelines.push_back(std::make_unique<GameTimeline>(line, interval));
+            memory += timelines.back()->getMemoryUsage();
+        }
+
+        for(size_t index = 0; index < games.size(); index++) {
+            std::string what = "K " + std::to_string(interval) + ", game " + std::to_string(index + 1);
+            GameTimeline& timeline = *timelines[index];
+
+            // random plies, then a timeline built move by move with seeks in between, every 20th game also ply by ply
+            // forwards and backwards
+            for(int seek = 0; seek < 20; seek++) {
+                int ply = seek == 0 ? plies : random() % (plies + 1);
+                checks.expect(sameAsReplay(timeline.seek(ply), games[index], ply), what + ", seek to ply " + std::to_string(ply));
+            }
+
+            GameTimeline grown(interval);
+
+            for(int ply = 0; ply < plies; ply++) {
+                if(ply % 3 == 0) grown.seek(ply/2);
+                grown.addMove(games[index][ply]);
+            }
+
+            checks.expect(grown.getPlyCount() == plies && describe(grown.seek(plies)) == describe(timeline.seek(plies)), what + ", built move by move");
+
+            if(index % 20 == 0) {
+                bool forwards = true, backwards = true;
+
+                for(int ply = 0; ply <= plies; ply++) forwards = forwards && sameAsReplay(grown.seek(ply), games[index], ply);
+                for(int ply = plies; ply >= 0; ply--) backwards = backwards && sameAsReplay(grown.seek(ply), games[index], ply);
+
+                checks.expect(forwards && backwards, what + ", every ply forwards and backwards");
+            }
+
+            bool rejected = false;
+
+            try {
+                timeline.seek(plies + 1);
+            }
+            catch(const GameTimelineException&) {
+                rejected = true;
+            }
+
+            checks.expect(rejected, what + ", seek past the last ply");
+        }
+
+        // random seeks, then every ply forwards and backwards
+        std::vector<double> latencies;
+
+        for(std::unique_ptr<GameTimeline>& pTimeline : timelines) {
+            for(int seek = 0; seek < 150; seek++) {
+                int ply = random() % (plies + 1);
+                BenchClock::time_point start = BenchClock::now();
+
+                pTimeline->seek(ply);
+                latencies.push_back(nanosecondsSince(start));
+            }
+        }
+
+        BenchClock::time_point start = BenchClock::now();
+
+        for(std::unique_ptr<GameTimeline>& pTimeline : timelines) {
+            for(int ply = 0; ply <= plies; ply++) pTimeline->seek(ply);
+        }
+
+        double next = nanosecondsSince(start)/((double)timelines.size()*(plies + 1));
+
+        for(std::unique_ptr<GameTimeline>& pTimeline : timelines) pTimeline->seek(plies);
+
+        start = BenchClock::now();
+
+        for(std::unique_ptr<GameTimeline>& pTimeline : timelines) {
+            for(int ply = plies; ply >= 0; ply--) pTimeline->seek(ply);
+        }
+
+        double previous = nanosecondsSince(start)/((double)timelines.size()*(plies + 1));
+
+        printf("  %-3d %10.0f %8.0f ns %8.0f ns %7.0f ns %7.0f ns\n", interval, (double)memory/timelines.size()/plies, percentile(latencies, 0.5), percentile(latencies, 0.99), next, previous);
+    }
+
+    // a trusted replay from the start to a random ply instead of a seek
+    std::vector<double> latencies;
+
+    for(const std::vector<std::string>& moves : games) {
+        for(int replay = 0; replay < 20; replay++) {
+            int ply = random() % (plies + 1);
+            BenchClock::time_point start = BenchClock::now();
+
+            LegalChess game;
+            for(int index = 0; index < ply; index++) game.makeTrustedMove(moves[index], index + 1 == ply);
+
+            latencies.push_back(nanosecondsSince(start));
+        }
+    }
+
+    printf("trusted replay from the start: median %.1f us, p99 %.1f us\n", percentile(latencies, 0.5)/1e3, percentile(latencies, 0.99)/1e3);
+    printf("Board::loadSnapshot: %.0f ns\n", timeLoadSnapshot(20000));
+
+    return checks.report("seeks match validated replays");
+}
+
+};
@@ -0,0 +1,230 @@
+#include "Bench.h"
+#include "OpeningTrie.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace LC {
+
+namespace {
+
+// 10 to 20 plies of a corpus game continued with up to 60 random legal moves, so that the games share their openings.
+// a corrupted game has one move replaced by an illegal one
+std::string openingGame(const std::vector<std::string>& base, std::mt19937& rng, bool corrupt) {
+    std::vector<std::string> opening = splitMoves(base[rng() % base.size()]);
+    std::vector<std::string> moves;
+    PackedMove legalMoves[LegalChess::MAX_LEGAL_MOVES];
+
+    LegalChess game;
+    size_t prefix = std::min<size_t>(opening.size(), 10 + rng() % 11);
+
+    for(size_t ply = 0; ply < prefix && !game.isGameOver(); ply++) {
+        game.makeMove(opening[ply]);
+        moves.push_back(opening[ply]);
+    }
+
+    for(int ply = 0; ply < 60 && !game.isGameOver(); ply++) {
+        size_t legalCount = game.getLegalMoves(legalMoves);
+        if(legalCount == 0) break;
+
+        moves.push_back(unpackMove(legalMoves[rng() % legalCount]));
+        game.makeMove(moves.back());
+    }
+
+    if(corrupt) moves[rng() % moves.size()] = rng() % 2 ? "e2e5" : "a1a1";
+
+    std::string line;
+
+    for(const std::string& move : moves) {
+        if(!line.empty()) line += ' ';
+        line += move;
+    }
+
+    return line;
+}
+
+// result and FEN after the replay, or the message of the exception it threw
+std::string replay(const std::string& line, const OpeningTrie* pTrie, ReplayMode mode) {
+    try {
+        if(pTrie) {
+            LegalChess game(line, *pTrie, mode);
+            return std::string(gameResultToString[(int)game.getGameResult()]) + " " + game.getFENString();
+        }
+
+        LegalChess game(line, mode);
+        return std::string(gameResultToString[(int)game.getGameResult()]) + " " + game.getFENString();
+    }
+    catch(const std::exception& e) {
+        return std::string("exception ") + e.what();
+    }
+}
+
+// us per game of restoring every game rounds times
+double timeRestore(const std::vector<std::string>& games, const OpeningTrie* pTrie, ReplayMode mode, int rounds) {
+    BenchClock::time_point start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(const std::string& line : games) {
+            if(pTrie) LegalChess game(line, *pTrie, mode);
+            else LegalChess game(line, mode);
+        }
+    }
+
+    return secondsSince(start)*1e6/((double)rounds*games.size());
+}
+
+}
+
+// a restore through a saved and mapped trie has to end like a replay of every move, with the same exceptions for
+// games with an illegal move
+int runTrieBench(const BenchOptions& options) {
+    std::vector<std::string> base = readGames(options.getString("corpus", "UCI.txt"));
+    size_t count = options.getInt("games", 4000);
+    size_t maxNodes = options.getInt("nodes", 65536);
+    int rounds = options.getInt("rounds", 3);
+    std::string path = options.getString("file", "lc_bench_trie.bin");
+
+    std::mt19937 rng(42);
+    std::vector<std::string> games;
+
+    // every 20th game is corrupted
+    for(size_t i = 0; i < count; i++) games.push_back(openingGame(base, rng, i % 20 == 19));
+
+    {
+        std::stringstream corpus;
+        for(const std::string& line : games) corpus << line << "\n";
+
+        OpeningTrie built;
+        BenchClock::time_point start = BenchClock::now();
+
+        built.build(corpus, maxNodes);
+        printf("built %lu nodes from %lu games in %.0f ms\n", (unsigned long)built.getNodeCount(), (unsigned long)games.size(), secondsSince(start)*1e3);
+
+        built.save(path);
+    }
+
+    OpeningTrie trie;
+    trie.load(path);
+
+    BenchChecks checks;
+    size_t covered = 0, plies = 0;
+    std::vector<std::string> legalGames;
+
+    for(size_t index = 0; index < games.size(); index++) {
+        std::string what = "game " + std::to_string(index + 1);
+        std::string validated = replay(games[index], nullptr, ReplayMode::VALIDATED);
+
+        checks.expect(replay(games[index], &trie, ReplayMode::VALIDATED) == validated, what + ", validated restore");
+
+        if(validated.compare(0, 10, "exception ") != 0) {
+            checks.expect(replay(games[index], &trie, ReplayMode::TRUSTED) == replay(games[index], nullptr, ReplayMode::TRUSTED), what + ", trusted restore");
+            legalGames.push_back(games[index]);
+        }
+
+        std::vector<std::string> moves = splitMoves(games[index]);
+        Board board;
+
+        covered += trie.restore(moves, board);
+        plies += moves.size();
+    }
+
+    // a truncated file and snapshots without a king, with two white kings or with an en passant square off the sixth
+    // rank of the side to move are rejected. the snapshot of the start position is the first copy of its grid
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        BoardSnapshot start;
+        Board().saveSnapshot(start);
+
+        size_t grid = data.find(std::string((const char*)start.grid, sizeof(start.grid)));
+        size_t enpassant = grid + offsetof(BoardSnapshot, enpassantSquare) - offsetof(BoardSnapshot, grid);
+        uint16_t thirdRank = 20;
+
+        // another file, the trie above still maps this one
+        std::string damagedPath = path + ".damaged";
+
+        auto rejects = [&](const std::string& damaged) {
+            std::ofstream output(damagedPath, std::ios::binary | std::ios::trunc);
+            output.write(damaged.data(), damaged.size());
+            output.close();
+
+            try {
+                OpeningTrie other;
+                other.load(damagedPath);
+            }
+            catch(const OpeningTrieException&) {
+                return true;
+            }
+
+            return false;
+        };
+
+        std::string noKing = data, twoKings = data, enpassantRank = data;
+
+        noKing[grid + 3] = (char)Piece::EMPTY;
+        twoKings[grid + 20] = (char)Piece::WHITE_KING;
+        memcpy(&enpassantRank[enpassant], &thirdRank, sizeof(thirdRank));
+
+        checks.expect(grid != std::string::npos && rejects(data.substr(0, data.size() - 1)), "truncated trie file");
+        checks.expect(rejects(noKing), "snapshot without a white king");
+        checks.expect(rejects(twoKings), "snapshot with two white kings");
+        checks.expect(rejects(enpassantRank), "en passant square on the third rank with white to move");
+        checks.expect(!rejects(data), "undamaged trie file");
+
+        remove(damagedPath.c_str());
+    }
+
+    remove(path.c_str());
+
+    int status = checks.report(std::to_string(games.size()) + " games (" + std::to_string(games.size() - legalGames.size()) + " with an illegal move), same result with the trie");
+
+    printf("%.0f%% of the plies restored from the trie\n", 100.0*covered/plies);
+
+    // the stored prefix of every game, from the trie and by validated moves
+    std::vector<std::vector<std::string>> prefixes;
+
+    for(const std::string& line : legalGames) {
+        std::vector<std::string> moves = splitMoves(line);
+        Board board;
+
+        moves.resize(trie.restore(moves, board));
+        if(!moves.empty()) prefixes.push_back(moves);
+    }
+
+    BenchClock::time_point start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(const std::vector<std::string>& moves : prefixes) {
+            Board board;
+            trie.restore(moves, board);
+        }
+    }
+
+    double fromTrie = secondsSince(start)*1e6/((double)rounds*prefixes.size());
+
+    start = BenchClock::now();
+
+    for(int round = 0; round < rounds; round++) {
+        for(const std::vector<std::string>& moves : prefixes) {
+            LegalChess game;
+            for(const std::string& move : moves) game.makeMove(move);
+        }
+    }
+
+    double replayed = secondsSince(start)*1e6/((double)rounds*prefixes.size());
+
+    printf("us per game:\n");
+    printf("  restore the prefix   replayed %.1f, from the trie %.1f\n", replayed, fromTrie);
+    printf("  validated restore    %.1f, with the trie %.1f\n", timeRestore(legalGames, nullptr, ReplayMode::VALIDATED, rounds), timeRestore(legalGames, &trie, ReplayMode::VALIDATED, rounds));
+    printf("  trusted restore      %.1f, with the trie %.1f\n", timeRestore(legalGames, nullptr, ReplayMode::TRUSTED, rounds), timeRestore(legalGames, &trie, ReplayMode::TRUSTED, rounds));
+
+    return status;
+}
+
+};
@@ -0,0 +1,204 @@
+#include "Bench.h"
+#include "VariationTree.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+
+namespace LC {
+
+namespace {
+
+std::string describe(const LegalChess& game) {
+    LegalChess& state = const_cast<LegalChess&>(game);
+    std::string text = std::string(gameResultToString[(int)state.getGameResult()]) + " " + state.getFENString() + " " + game.getMoveHistory();
+
+    MoveDelta delta;
+
+    if(game.getLastMoveDelta(delta)) {
+        int fields[] = {delta.fromSquare, delta.toSquare, (int)delta.capturedPiece, delta.captureSquare, delta.rookFromSquare, delta.rookToSquare, delta.choosenPiece, (int)delta.checkType, (int)delta.result};
+        for(int field : fields) text += " " + std::to_string(field);
+    }
+
+    return text;
+}
+
+// the game at the node against a validated replay of its line
+bool sameAsReplay(const LegalChess& game, const std::string& line) {
+    LegalChess replayed(line, ReplayMode::VALIDATED);
+
+    PackedMove found[LegalChess::MAX_LEGAL_MOVES], expected[LegalChess::MAX_LEGAL_MOVES];
+    size_t foundCount = game.getLegalMoves(found), expectedCount = replayed.getLegalMoves(expected);
+
+    return describe(game) == describe(replayed) && game.getPositionKey() == replayed.getPositionKey()
+        && game.getMaterialKey() == replayed.getMaterialKey() && game.getPawnKey() == replayed.getPawnKey()
+        && foundCount == expectedCount && std::equal(found, found + foundCount, expected);
+}
+
+std::string randomMove(const LegalChess& game, std::mt19937_64& random) {
+    PackedMove moves[LegalChess::MAX_LEGAL_MOVES];
+    size_t count = game.getLegalMoves(moves);
+
+    return count == 0 ? "" : unpackMove(moves[random() % count]);
+}
+
+// a main line of 100 plies, then branches of 1 to 40 random moves from random nodes until the tree has nodeCount nodes
+void growTree(VariationTree& tree, size_t nodeCount) {
+    std::mt19937_64 random(11);
+    VariationTree::NodeId node = VariationTree::ROOT;
+
+    for(int ply = 0; ply < 100; ply++) {
+        std::string move = randomMove(tree.goTo(node), random);
+        if(move.empty()) break;
+
+        node = tree.addMove(node, move);
+    }
+
+    while(tree.getNodeCount() < nodeCount) {
+        node = random() % tree.getNodeCount();
+
+        for(int ply = 0, length = 1 + random() % 40; ply < length && tree.getNodeCount() < nodeCount; ply++) {
+            std::string move = randomMove(tree.goTo(node), random);
+            if(move.empty()) break;
+
+            node = tree.addMove(node, move);
+        }
+    }
+}
+
+// goTo latencies of 30000 nodes picked by pick from the current one
+template<class F>
+void timeNavigation(VariationTree& tree, std::vector<double>& latencies, F pick) {
+    std::mt19937 random(9);
+    latencies.clear();
+
+    for(int query = 0; query < 30000; query++) {
+        VariationTree::NodeId node = pick(random);
+        BenchClock::time_point start = BenchClock::now();
+
+        tree.goTo(node);
+        latencies.push_back(nanosecondsSince(start));
+    }
+}
+
+}
+
+// every node reached by goTo, from anywhere in the tree, has to be the game of a validated replay of its line, with its
+// last move delta, for trees without snapshots and with snapshots every 4 and 16 plies
+int runVariationBench(const BenchOptions& options) {
+    size_t nodeCount = options.getInt("nodes", 10000);
+    int navigations = options.getInt("navigations", 3000);
+
+    BenchChecks checks;
+    std::vector<double> latencies;
+    size_t treeBytes = 0;
+
+    printf("%-4s %15s %12s %12s %10s %12s\n", "N", "heap bytes/node", "random p50", "random p99", "parent", "first child");
+
+    for(int interval : {0, 4, 16}) {
+        AllocationCounters before = getAllocationCounters();
+
+        VariationTree tree(interval);
+        growTree(tree, nodeCount);
+
+        size_t bytes = getAllocationCounters().liveBytes - before.liveBytes;
+        if(interval == 16) treeBytes = bytes;
+
+        std::mt19937 random(5);
+        std::string what = "N " + std::to_string(interval);
+
+        // every third navigation goes to the parent
+        for(int navigation = 0; navigation < navigations; navigation++) {
+            VariationTree::NodeId node = random() % tree.getNodeCount();
+            VariationTree::NodeId parent = tree.getParent(tree.getCurrentNode());
+
+            if(navigation % 3 == 0 && parent != VariationTree::NO_NODE) node = parent;
+
+            checks.expect(sameAsReplay(tree.goTo(node), tree.getLine(node)), what + ", node " + std::to_string(node));
+        }
+
+        // a known move gives the existing child, an illegal one throws and adds nothing
+        VariationTree::NodeId node = random() % tree.getNodeCount();
+        VariationTree::NodeId child = tree.getFirstChild(node);
+
+        if(child != VariationTree::NO_NODE) {
+            size_t count = tree.getNodeCount();
+            checks.expect(tree.addMove(node, unpackMove(tree.getMove(child))) == child && tree.getNodeCount() == count, what + ", existing move");
+        }
+
+        size_t count = tree.getNodeCount();
+        bool rejected = false;
+
+        try {
+            tree.addMove(VariationTree::ROOT, "e1e8");
+        }
+        catch(const std::exception&) {
+            rejected = true;
+        }
+
+        checks.expect(rejected && tree.getNodeCount() == count && sameAsReplay(tree.goTo(node), tree.getLine(node)), what + ", illegal move");
+
+        size_t nodes = tree.getNodeCount();
+
+        timeNavigation(tree, latencies, [&](std::mt19937& random) {
+            return (VariationTree::NodeId)(random() % nodes);
+        });
+
+        double median = percentile(latencies, 0.5), p99 = percentile(latencies, 0.99);
+
+        timeNavigation(tree, latencies, [&](std::mt19937& random) {
+            VariationTree::NodeId parent = tree.getParent(tree.getCurrentNode());
+            return parent == VariationTree::NO_NODE ? (VariationTree::NodeId)(random() % nodes) : parent;
+        });
+
+        double parent = percentile(latencies, 0.5);
+
+        timeNavigation(tree, latencies, [&](std::mt19937& random) {
+            VariationTree::NodeId child = tree.getFirstChild(tree.getCurrentNode());
+            return child == VariationTree::NO_NODE ? (VariationTree::NodeId)(random() % nodes) : child;
+        });
+
+        printf("%-4d %15.0f %9.1f us %9.1f us %7.0f ns %9.0f ns\n", interval, (double)bytes/nodes, median/1e3, p99/1e3, parent, percentile(latencies, 0.5));
+    }
+
+    // one game per line instead of the tree, and replaying a node's line from the root instead of goTo
+    VariationTree tree(16);
+    growTree(tree, nodeCount);
+
+    std::vector<VariationTree::NodeId> leaves;
+    size_t lineMoves = 0;
+
+    for(VariationTree::NodeId node = 0; node < tree.getNodeCount(); node++) {
+        if(tree.getFirstChild(node) == VariationTree::NO_NODE) {
+            leaves.push_back(node);
+            lineMoves += tree.getDepth(node);
+        }
+    }
+
+    AllocationCounters before = getAllocationCounters();
+    std::vector<std::unique_ptr<LegalChess>> lines;
+
+    for(VariationTree::NodeId leaf : leaves) lines.push_back(std::make_unique<LegalChess>(tree.getLine(leaf), ReplayMode::TRUSTED));
+
+    size_t lineBytes = getAllocationCounters().liveBytes - before.liveBytes;
+
+    std::mt19937 random(13);
+    latencies.clear();
+
+    for(int replay = 0; replay < 3000; replay++) {
+        std::string line = tree.getLine(random() % tree.getNodeCount());
+        BenchClock::time_point start = BenchClock::now();
+
+        LegalChess game(line, ReplayMode::TRUSTED);
+        latencies.push_back(nanosecondsSince(start));
+    }
+
+    printf("%lu nodes in %lu lines, %lu moves counted line by line\n", (unsigned long)tree.getNodeCount(), (unsigned long)leaves.size(), (unsigned long)lineMoves);
+    printf("one LegalChess per line: %.0f heap bytes/node, %.1fx the N=16 tree\n", (double)lineBytes/tree.getNodeCount(), (double)lineBytes/treeBytes);
+    printf("replaying a node's line from the root: median %.1f us, p99 %.1f us\n", percentile(latencies, 0.5)/1e3, percentile(latencies, 0.99)/1e3);
+
+    return checks.report("navigations match validated replays");
+}
+
+};
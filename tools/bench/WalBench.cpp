@@ -0,0 +1,527 @@
+#include "Bench.h"
+#include "MoveLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace LC {
+
+namespace {
+
+typedef std::unordered_map<uint32_t, std::unique_ptr<LegalChess>> LiveGames;
+
+// a record of the log in the order it was appended, a closing record has no move
+struct LoggedRecord {
+    uint32_t gameId;
+    std::string move;
+};
+
+std::string describe(LegalChess& game) {
+    return std::string(gameResultToString[(int)game.detectGameResult()]) + " " + game.getFENString() + " " + game.getMoveHistory();
+}
+
+// the moves of every game since it was last closed after the first count records
+std::unordered_map<uint32_t, std::string> getLines(const std::vector<LoggedRecord>& records, size_t count) {
+    std::unordered_map<uint32_t, std::string> lines;
+
+    for(size_t record = 0; record < count; record++) {
+        const LoggedRecord& logged = records[record];
+
+        if(logged.move.empty()) lines.erase(logged.gameId);
+        else {
+            std::string& line = lines[logged.gameId];
+            line += (line.empty() ? "" : " ") + logged.move;
+        }
+    }
+
+    return lines;
+}
+
+// the games recover has to rebuild from these lines, the ones still in progress
+std::map<uint32_t, std::string> getExpectedGames(const std::unordered_map<uint32_t, std::string>& lines) {
+    std::map<uint32_t, std::string> games;
+
+    for(const auto& entry : lines) {
+        LegalChess game(entry.second, ReplayMode::TRUSTED);
+        if(game.detectGameResult() == GameResult::IN_PROGRESS) games[entry.first] = describe(game);
+    }
+
+    return games;
+}
+
+bool matches(const std::map<uint32_t, std::string>& expected, LiveGames& games) {
+    if(games.size() != expected.size()) return false;
+
+    for(auto& entry : games) {
+        auto it = expected.find(entry.first);
+        if(it == expected.end() || it->second != describe(*entry.second)) return false;
+    }
+
+    return true;
+}
+
+size_t getFileSize(const std::string& path) {
+    struct stat status;
+    return stat(path.c_str(), &status) == 0 ? status.st_size : 0;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::string& data) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(data.data(), data.size());
+}
+
+std::vector<std::vector<PackedMove>> packGames(const std::vector<std::string>& lines) {
+    std::vector<std::vector<PackedMove>> games;
+
+    for(const std::string& line : lines) {
+        games.emplace_back();
+        for(const std::string& move : splitMoves(line)) games.back().push_back(packMove(move));
+    }
+
+    return games;
+}
+
+// plays the lines on a new log at path through games with the log attached, a move at a time on a random one of
+// slots games. a game that ends (or is abandoned, 1 in 64 moves) is either closed and its id taken by the next game,
+// or left open and the next game gets a new id. returns the records in log order
+std::vector<LoggedRecord> writeInterleaved(const std::string& path, const std::vector<std::string>& lines, size_t slots, BenchChecks& checks) {
+    struct Slot {
+        std::unique_ptr<LegalChess> pGame;
+        std::vector<std::string> moves;
+        size_t played = 0;
+        uint32_t gameId = 0;
+    };
+
+    std::vector<LoggedRecord> records;
+    std::mt19937 random(83);
+    size_t nextLine = 0;
+    uint32_t nextId = 0;
+    bool ordered = true;
+
+    remove(path.c_str());
+
+    {
+        std::shared_ptr<MoveLog> pLog = std::make_shared<MoveLog>(path);
+
+        // the games hold the log, they go first
+        std::vector<Slot> active(slots);
+        for(Slot& slot : active) slot.gameId = nextId++;
+
+        while(true) {
+            Slot& slot = active[random() % slots];
+
+            if(!slot.pGame) {
+                if(nextLine == lines.size()) break;
+
+                slot.pGame = std::make_unique<LegalChess>();
+                slot.pGame->attachMoveLog(pLog, slot.gameId);
+                slot.moves = splitMoves(lines[nextLine++]);
+                slot.played = 0;
+            }
+
+            slot.pGame->makeMove(slot.moves[slot.played]);
+            records.push_back({slot.gameId, slot.moves[slot.played++]});
+            ordered &= slot.pGame->getLogSequence() == records.size();
+
+            if(slot.played == slot.moves.size() || random() % 64 == 0) {
+                if(random() % 2) {
+                    uint64_t sequence = pLog->closeGame(slot.gameId);
+                    records.push_back({slot.gameId, ""});
+                    ordered &= sequence == records.size();
+                }
+                else slot.gameId = nextId++;
+
+                slot.pGame.reset();
+            }
+        }
+    }
+
+    checks.expect(ordered, "sequence numbers in append order");
+    checks.expect(getFileSize(path) == records.size()*MoveLog::RECORD_SIZE, "every record written when the log is destroyed");
+
+    return records;
+}
+
+// once a write fails the log refuses the next move before it is applied. the file size limit of the process makes
+// the next write fail
+bool refusesAfterFailure(const std::string& path) {
+    remove(path.c_str());
+
+    std::shared_ptr<MoveLog> pLog = std::make_shared<MoveLog>(path);
+    LegalChess game;
+
+    game.attachMoveLog(pLog, 1);
+    game.makeMove("e2e4");
+    pLog->waitDurable(game.getLogSequence());
+
+    struct rlimit limit, lowered;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    lowered = limit;
+    lowered.rlim_cur = MoveLog::RECORD_SIZE;
+
+    signal(SIGXFSZ, SIG_IGN);
+    setrlimit(RLIMIT_FSIZE, &lowered);
+
+    bool failed = false, refused = false;
+
+    try {
+        game.makeMove("e7e5");
+        pLog->waitDurable(game.getLogSequence());
+    }
+    catch(const MoveLogException&) {
+        failed = true;
+    }
+
+    std::string before = describe(game);
+
+    try {
+        game.makeMove("g1f3");
+    }
+    catch(const MoveLogException&) {
+        refused = true;
+    }
+
+    setrlimit(RLIMIT_FSIZE, &limit);
+    signal(SIGXFSZ, SIG_DFL);
+
+    return failed && refused && describe(game) == before;
+}
+
+struct ClientsRun {
+    double movesPerSecond;
+    std::vector<double> waits;  // us
+    bool ordered;
+    bool rebuilt;
+};
+
+// clients threads play their own games on one log and wait until each move is durable before the next one, like a
+// server that acknowledges a move once it is on disk. a finished game is closed and the client starts another
+ClientsRun runClients(const std::string& path, const std::vector<std::string>& lines, int clients, double seconds) {
+    std::vector<std::vector<double>> waits(clients);
+    std::vector<std::unique_ptr<LegalChess>> lastGames(clients);
+    std::vector<uint32_t> lastIds(clients);
+    std::atomic<bool> stop(false), ordered(true);
+    std::atomic<size_t> moves(0);
+    double elapsed;
+
+    remove(path.c_str());
+
+    {
+        std::shared_ptr<MoveLog> pLog = std::make_shared<MoveLog>(path);
+        std::vector<std::thread> threads;
+        BenchClock::time_point start = BenchClock::now();
+
+        for(int client = 0; client < clients; client++) {
+            threads.emplace_back([&, client]() {
+                std::unique_ptr<LegalChess> pGame;
+                std::vector<std::string> gameMoves;
+                size_t line = client, played = 0;
+                uint32_t gameId = client;
+
+                while(!stop.load(std::memory_order_relaxed)) {
+                    if(!pGame) {
+                        pGame = std::make_unique<LegalChess>();
+                        pGame->attachMoveLog(pLog, gameId);
+                        gameMoves = splitMoves(lines[line % lines.size()]);
+                        line += clients;
+                        played = 0;
+                    }
+
+                    pGame->makeMove(gameMoves[played++]);
+
+                    uint64_t sequence = pGame->getLogSequence();
+                    BenchClock::time_point waitStart = BenchClock::now();
+
+                    pLog->waitDurable(sequence);
+                    waits[client].push_back(nanosecondsSince(waitStart)/1e3);
+
+                    // a batch is synced as a whole and after every batch before it, so the file holds all records
+                    // up to this one
+                    if(pLog->getDurableSequence() < sequence || getFileSize(path) < sequence*MoveLog::RECORD_SIZE) ordered = false;
+
+                    moves.fetch_add(1, std::memory_order_relaxed);
+
+                    if(played == gameMoves.size()) {
+                        pLog->waitDurable(pLog->closeGame(gameId));
+                        gameId += clients;
+                        pGame.reset();
+                    }
+                }
+
+                lastIds[client] = gameId;
+                lastGames[client] = std::move(pGame);
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+
+        for(std::thread& thread : threads) thread.join();
+
+        elapsed = secondsSince(start);
+    }
+
+    // the last game of every client, all its moves were durable
+    std::map<uint32_t, std::string> expected;
+
+    for(int client = 0; client < clients; client++) {
+        if(lastGames[client] && lastGames[client]->detectGameResult() == GameResult::IN_PROGRESS) expected[lastIds[client]] = describe(*lastGames[client]);
+    }
+
+    LiveGames games;
+    MoveLog::recover(path, games);
+
+    ClientsRun run = {moves/elapsed, {}, ordered, matches(expected, games)};
+    for(std::vector<double>& clientWaits : waits) run.waits.insert(run.waits.end(), clientWaits.begin(), clientWaits.end());
+
+    return run;
+}
+
+// one write and fdatasync per move, what the log saves by syncing a batch at once
+double syncEveryMove(const std::string& path, double seconds) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) return 0;
+
+    char record[MoveLog::RECORD_SIZE] = {};
+    size_t count = 0;
+    BenchClock::time_point start = BenchClock::now();
+
+    while(secondsSince(start) < seconds && write(fd, record, sizeof(record)) == (ssize_t)sizeof(record) && fdatasync(fd) == 0) count++;
+
+    double movesPerSecond = count/secondsSince(start);
+    close(fd);
+
+    return movesPerSecond;
+}
+
+}
+
+// logs cut at random byte offsets have to rebuild the games of their whole records, the torn record is cut off when
+// the log is opened again, a missing record stops recovery, a failed log refuses moves, and a durable move is in the
+// file together with every record before it. prints durable moves/s with clients waiting for each move and the time
+// to rebuild a million games
+int runWalBench(const BenchOptions& options) {
+    std::string path = options.getString("file", "lc_bench_wal.log"), cutPath = path + ".cut";
+    int cuts = options.getInt("cuts", 100);
+    size_t chunkRecords = options.getInt("chunk-records", 34000000);
+    size_t recoverGames = options.getInt("recover-games", 1000000);
+    int recoverPlies = options.getInt("recover-plies", 20);
+    double seconds = options.getDouble("seconds", 2);
+
+    BenchChecks checks;
+    std::mt19937 random(79);
+
+    // interleaved games cut at random offsets, the first cut keeps the whole log
+    std::vector<LoggedRecord> records = writeInterleaved(path, generateGames(options.getInt("games", 1000), options.getInt("plies", 80), 81), options.getInt("slots", 64), checks);
+
+    uint32_t freshId = 0;
+    for(const LoggedRecord& logged : records) freshId = std::max(freshId, logged.gameId + 1);
+
+    std::string data = readFile(path);
+    size_t torn = 0;
+
+    for(int cut = 0; cut < cuts; cut++) {
+        size_t offset = cut == 0 ? data.size() : random() % (data.size() + 1);
+        size_t durable = offset/MoveLog::RECORD_SIZE;
+
+        writeFile(cutPath, data.substr(0, offset));
+        torn += offset % MoveLog::RECORD_SIZE != 0;
+
+        std::unordered_map<uint32_t, std::string> lines = getLines(records, durable);
+        LiveGames games;
+
+        bool rebuilt = MoveLog::recover(cutPath, games) == durable && matches(getExpectedGames(lines), games);
+
+        // opening the log cuts the torn record off, a move appended after it is recovered as well
+        {
+            std::shared_ptr<MoveLog> pLog = std::make_shared<MoveLog>(cutPath);
+            rebuilt &= getFileSize(cutPath) == durable*MoveLog::RECORD_SIZE;
+
+            LegalChess game;
+            game.attachMoveLog(pLog, freshId);
+            game.makeMove("e2e4");
+            pLog->waitDurable(game.getLogSequence());
+        }
+
+        lines[freshId] = "e2e4";
+        games.clear();
+
+        rebuilt &= MoveLog::recover(cutPath, games) == durable + 1 && matches(getExpectedGames(lines), games);
+        checks.expect(rebuilt, "log cut at byte " + std::to_string(offset) + " of " + std::to_string(data.size()));
+    }
+
+    printf("%lu records of interleaved games, %d cuts (%lu inside a record) rebuilt the games of their whole records\n", (unsigned long)records.size(), cuts, (unsigned long)torn);
+
+    // a record missing in the middle of a game
+    bool outOfOrder = false;
+
+    for(size_t record = 0; record < records.size() && !outOfOrder; record++) {
+        if(records[record].move.empty()) continue;
+
+        auto next = std::find_if(records.begin() + record + 1, records.end(), [&](const LoggedRecord& logged) { return logged.gameId == records[record].gameId; });
+        if(next == records.end() || next->move.empty()) continue;
+
+        writeFile(cutPath, std::string(data).erase(record*MoveLog::RECORD_SIZE, MoveLog::RECORD_SIZE));
+
+        try {
+            LiveGames games;
+            MoveLog::recover(cutPath, games);
+            break;
+        }
+        catch(const MoveLogException& e) {
+            outOfOrder = strstr(e.what(), "out of order") != nullptr;
+            break;
+        }
+    }
+
+    checks.expect(outOfOrder, "missing record, ply out of order");
+    checks.expect(refusesAfterFailure(path), "failed log refuses the next move before it is applied");
+
+    // clients waiting for every move
+    std::vector<std::string> lines = generateGames(1000, 120, 85);
+    std::string clientCounts = options.getString("clients", "1,8,256");
+
+    printf("  %-8s %16s %10s %10s\n", "clients", "durable moves/s", "wait p50", "wait p99");
+
+    for(const char* pCount = clientCounts.c_str(); *pCount; pCount += *pCount == ',') {
+        char* pEnd;
+        int clients = strtol(pCount, &pEnd, 10);
+        if(pEnd == pCount) break;
+
+        pCount = pEnd;
+        if(clients <= 0) continue;
+
+        ClientsRun run = runClients(path, lines, clients, seconds);
+
+        checks.expect(run.ordered, std::to_string(clients) + " clients, durable moves in the file with the records before them");
+        checks.expect(run.rebuilt, std::to_string(clients) + " clients, last games rebuilt");
+
+        printf("  %-8d %16.0f %8.0fus %8.0fus\n", clients, run.movesPerSecond, percentile(run.waits, 0.5), percentile(run.waits, 0.99));
+    }
+
+    printf("one write and fdatasync per move: %.0f moves/s\n", syncEveryMove(path, seconds));
+
+    // more records than recover replays at once (32M), games continue from one chunk into the next and ids are
+    // reused after their games were closed
+    if(chunkRecords != 0) {
+        std::vector<std::string> pool = generateGames(2000, 200, 87);
+        std::vector<std::vector<PackedMove>> packed = packGames(pool);
+        size_t slots = options.getInt("chunk-games", 20000), nextLine = slots, spanning = 0;
+        std::vector<std::pair<size_t, size_t>> active(slots);  // line and moves played
+
+        for(size_t slot = 0; slot < slots; slot++) active[slot] = {slot % packed.size(), 0};
+
+        remove(path.c_str());
+
+        {
+            std::shared_ptr<MoveLog> pLog = std::make_shared<MoveLog>(path);
+
+            for(size_t record = 0; record < chunkRecords;) {
+                if(spanning == 0 && record >= (1 << 25)) {
+                    for(const auto& slot : active) spanning += slot.second != 0;
+                }
+
+                uint32_t gameId = random() % slots;
+                auto& slot = active[gameId];
+                const std::vector<PackedMove>& moves = packed[slot.first];
+
+                pLog->append(gameId, slot.second + 1, moves[slot.second]);
+                slot.second++;
+                record++;
+
+                if(slot.second == moves.size() && record < chunkRecords) {
+                    pLog->closeGame(gameId);
+                    record++;
+                    slot = {nextLine++ % packed.size(), 0};
+                }
+            }
+        }
+
+        std::unordered_map<uint32_t, std::string> expectedLines;
+
+        for(size_t slot = 0; slot < slots; slot++) {
+            std::vector<std::string> moves = splitMoves(pool[active[slot].first]);
+            std::string& line = expectedLines[slot];
+
+            for(size_t move = 0; move < active[slot].second; move++) line += (line.empty() ? "" : " ") + moves[move];
+            if(line.empty()) expectedLines.erase(slot);
+        }
+
+        LiveGames games;
+        BenchClock::time_point start = BenchClock::now();
+        uint64_t count = MoveLog::recover(path, games);
+        double recoverSeconds = secondsSince(start);
+
+        checks.expect(count == chunkRecords && (chunkRecords <= (1 << 25) || spanning != 0) && matches(getExpectedGames(expectedLines), games), "games rebuilt across chunks");
+        printf("%lu records, %lu games open across the first chunk, rebuilt in %.1fs\n", (unsigned long)count, (unsigned long)spanning, recoverSeconds);
+    }
+
+    // a ply of every game at a time, like a server with that many live games, then every tenth game closed
+    if(recoverGames != 0) {
+        std::vector<std::string> pool;
+
+        for(const std::string& line : generateGames(1000, recoverPlies, 89)) {
+            LegalChess game(line, ReplayMode::TRUSTED);
+            if(splitMoves(line).size() == (size_t)recoverPlies && game.detectGameResult() == GameResult::IN_PROGRESS) pool.push_back(line);
+        }
+
+        std::vector<std::vector<PackedMove>> packed = packGames(pool);
+        size_t closed = 0;
+
+        remove(path.c_str());
+
+        {
+            std::shared_ptr<MoveLog> pLog = std::make_shared<MoveLog>(path);
+
+            for(int ply = 0; ply < recoverPlies; ply++) {
+                for(size_t gameId = 0; gameId < recoverGames; gameId++) pLog->append(gameId, ply + 1, packed[gameId % packed.size()][ply]);
+            }
+
+            for(size_t gameId = 0; gameId < recoverGames; gameId += 10, closed++) pLog->closeGame(gameId);
+        }
+
+        LiveGames games;
+        BenchClock::time_point start = BenchClock::now();
+        uint64_t count = MoveLog::recover(path, games);
+        double recoverSeconds = secondsSince(start);
+
+        bool rebuilt = count == recoverGames*recoverPlies + closed && games.size() == recoverGames - closed;
+
+        for(size_t gameId = 1; gameId < recoverGames && rebuilt; gameId += 1009) {
+            LegalChess game(pool[gameId % pool.size()], ReplayMode::TRUSTED);
+            auto it = games.find(gameId);
+
+            rebuilt = gameId % 10 == 0 ? it == games.end() : it != games.end() && describe(*it->second) == describe(game);
+        }
+
+        checks.expect(rebuilt, "games rebuilt");
+        printf("rebuilt %lu games of %d plies (%.1fM records, %lu games left open) in %.1fs\n", (unsigned long)recoverGames, recoverPlies, count/1e6,
+            (unsigned long)games.size(), recoverSeconds);
+    }
+
+    remove(path.c_str());
+    remove(cutPath.c_str());
+
+    return checks.report("recovered logs match the durable moves");
+}
+
+};